@@ -0,0 +1,210 @@
+// Startup latency of getting shader blobs to the render thread. Writes a
+// set of shader-sized files plus one larger asset, then measures how long
+// the render thread is held up at its first frame when it
+//   - reads every file into a std::vector (the old LoadFileIntoBuffer),
+//   - maps every file itself (FileBlob),
+//   - only picks up blobs a BlobLoader started at "SetUnityStreamingAssetsPath
+//     time", with some main-thread startup work in between.
+// On Linux the files are dropped from the page cache before every run
+// (posix_fadvise) so the reads actually go to the disk; elsewhere the
+// numbers are warm-cache ones. Every path checks the bytes it got.
+
+#include "BenchCommon.h"
+#include "../BlobLoader.h"
+
+#include <stdlib.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__)
+    #include <fcntl.h>
+    #include <unistd.h>
+#endif
+
+static const char* const kBlobNames[] =
+{
+    "BenchBlob_SimpleVertexShader.cso",
+    "BenchBlob_SimplePixelShader.cso",
+    "BenchBlob_InstancedVertexShader.cso",
+    "BenchBlob_Asset.bin",
+};
+static const size_t kBlobSizes[] = { 1200, 600, 1500, 4 * 1024 * 1024 };
+static const int kBlobCount = sizeof(kBlobNames) / sizeof(kBlobNames[0]);
+
+static unsigned char PatternByte (int blob, size_t i)
+{
+    return (unsigned char)(i * 131 + blob * 7 + (i >> 12));
+}
+
+static bool WriteBlobs (const std::string& directory)
+{
+    for (int b = 0; b < kBlobCount; ++b)
+    {
+        std::vector<unsigned char> data (kBlobSizes[b]);
+        for (size_t i = 0; i < data.size(); ++i)
+            data[i] = PatternByte (b, i);
+        const std::string path = directory + "/" + kBlobNames[b];
+        FILE* fp = fopen (path.c_str(), "wb");
+        if (!fp)
+            return false;
+        const bool ok = fwrite (&data[0], data.size(), 1, fp) == 1;
+        fclose (fp);
+        if (!ok)
+            return false;
+    }
+    return true;
+}
+
+static void RemoveBlobs (const std::string& directory)
+{
+    for (int b = 0; b < kBlobCount; ++b)
+        remove ((directory + "/" + kBlobNames[b]).c_str());
+}
+
+static void EvictBlobs (const std::string& directory)
+{
+    #if defined(__linux__)
+    for (int b = 0; b < kBlobCount; ++b)
+    {
+        const int fd = open ((directory + "/" + kBlobNames[b]).c_str(), O_RDONLY);
+        if (fd < 0)
+            continue;
+        fdatasync (fd);
+        posix_fadvise (fd, 0, 0, POSIX_FADV_DONTNEED);
+        close (fd);
+    }
+    #else
+    (void)directory;
+    #endif
+}
+
+static bool CheckBlob (int b, const unsigned char* data, size_t size)
+{
+    if (size != kBlobSizes[b])
+        return false;
+    for (size_t i = 0; i < size; i += 61)
+    {
+        if (data[i] != PatternByte (b, i))
+            return false;
+    }
+    return true;
+}
+
+// What the old code did on the render thread
+static bool ReadIntoVector (const std::string& path, std::vector<unsigned char>& data)
+{
+    FILE* fp = fopen (path.c_str(), "rb");
+    if (!fp)
+        return false;
+    fseek (fp, 0, SEEK_END);
+    const long size = ftell (fp);
+    fseek (fp, 0, SEEK_SET);
+    data.resize (size);
+    const bool ok = size > 0 && fread (&data[0], size, 1, fp) == 1;
+    fclose (fp);
+    return ok;
+}
+
+// Stand-in for the rest of startup between SetUnityStreamingAssetsPath and
+// the first render event (scene load, script init, ...)
+static void OtherStartupWork (double seconds)
+{
+    std::this_thread::sleep_for (std::chrono::duration<double>(seconds));
+}
+
+int main ()
+{
+    const char* tmp = getenv ("TMPDIR");
+    const std::string directory = tmp && *tmp ? tmp : (
+        #if defined(_WIN32)
+        "."
+        #else
+        "/tmp"
+        #endif
+        );
+    if (!WriteBlobs (directory))
+    {
+        printf ("could not write blobs to %s\n", directory.c_str());
+        return 1;
+    }
+
+    const int kRuns = 20;
+    const double kStartupWork = 0.005;
+    bool ok = true;
+    double readSeconds = 0, mapSeconds = 0, preloadSeconds = 0;
+    int mappedCount = 0;
+
+    for (int run = 0; run < kRuns; ++run)
+    {
+        // Read into vectors on the render thread
+        EvictBlobs (directory);
+        OtherStartupWork (kStartupWork);
+        {
+            BenchClock::time_point start = BenchClock::now();
+            std::vector<unsigned char> data[kBlobCount];
+            for (int b = 0; b < kBlobCount; ++b)
+                ok &= ReadIntoVector (directory + "/" + kBlobNames[b], data[b]);
+            readSeconds += BenchSecondsSince (start);
+            for (int b = 0; b < kBlobCount; ++b)
+                ok &= !data[b].empty() && CheckBlob (b, &data[b][0], data[b].size());
+        }
+
+        // Map on the render thread (pages still fault in on first use)
+        EvictBlobs (directory);
+        OtherStartupWork (kStartupWork);
+        {
+            BenchClock::time_point start = BenchClock::now();
+            FileBlob blobs[kBlobCount];
+            unsigned sum = 0;
+            for (int b = 0; b < kBlobCount; ++b)
+            {
+                ok &= blobs[b].Open ((directory + "/" + kBlobNames[b]).c_str());
+                sum += blobs[b].Prefault ();
+            }
+            mapSeconds += BenchSecondsSince (start);
+            BenchDoNotOptimize (sum);
+            for (int b = 0; b < kBlobCount; ++b)
+            {
+                ok &= CheckBlob (b, blobs[b].GetData(), blobs[b].GetSize());
+                mappedCount += blobs[b].IsMapped();
+            }
+        }
+
+        // Background load started when the path is set; the render thread
+        // only waits for whatever is not ready by its first frame
+        EvictBlobs (directory);
+        {
+            BlobLoader loader;
+            loader.Begin (directory, kBlobNames, kBlobCount);
+            OtherStartupWork (kStartupWork);
+            BenchClock::time_point start = BenchClock::now();
+            while (!loader.IsDone())
+                std::this_thread::yield ();
+            preloadSeconds += BenchSecondsSince (start);
+            for (int b = 0; b < kBlobCount; ++b)
+            {
+                const FileBlob* blob = loader.TryGet (b);
+                ok &= blob && CheckBlob (b, blob->GetData(), blob->GetSize());
+            }
+        }
+    }
+
+    // A missing file fails cleanly
+    {
+        const char* missing[] = { "BenchBlob_Missing.cso" };
+        BlobLoader loader;
+        loader.Begin (directory, missing, 1);
+        loader.Wait ();
+        ok &= loader.IsDone() && loader.HasFailed (0) && !loader.TryGet (0);
+    }
+
+    RemoveBlobs (directory);
+
+    BenchReport ("first frame stall, read into vector", readSeconds / kRuns * 1e6, "us");
+    BenchReport ("first frame stall, map on render thread", mapSeconds / kRuns * 1e6, "us");
+    BenchReport ("first frame stall, background preload", preloadSeconds / kRuns * 1e6, "us");
+    BenchReport ("blobs mapped (vs read)", (double)mappedCount / kRuns, "of 4");
+    printf ("blob contents: %s\n", ok ? "ok" : "MISMATCH");
+    return ok ? 0 : 1;
+}
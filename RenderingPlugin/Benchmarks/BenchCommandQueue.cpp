@@ -0,0 +1,133 @@
+// Two-thread stress test of the main thread -> render thread command ring:
+// one producer pushes timestamped commands as fast as it can, one consumer
+// drains them the way OnRenderEvent does. Reports throughput and the
+// push-to-pop latency distribution, and checks that nothing was lost or
+// reordered. Then the same with the producer reserving and publishing
+// commands in batches (Reserve / Commit).
+
+#include "BenchCommon.h"
+#include "../SpscQueue.h"
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+struct TimedCommand
+{
+    unsigned sequence;
+    int type;
+    BenchClock::rep pushedAt;
+    float payload[4];
+};
+
+static SpscQueue<TimedCommand, 8192> s_Queue;
+
+struct RunResult
+{
+    double seconds;
+    std::vector<double> latencies;    // clock ticks
+    unsigned fullSpins;
+    bool ordered;
+};
+
+// batch 0 pushes one command at a time with TryPush; otherwise up to batch
+// commands are reserved, written in place and published with one Commit
+static void Run (unsigned commands, unsigned batch, RunResult& result)
+{
+    const unsigned kSampleEvery = 16;
+
+    result.latencies.clear ();
+    result.latencies.reserve (commands / kSampleEvery + 1);
+    result.fullSpins = 0;
+    std::atomic<bool> ordered (true);
+    std::vector<double>& latencies = result.latencies;
+
+    BenchClock::time_point start = BenchClock::now();
+
+    std::thread consumer ([&] ()
+    {
+        unsigned expected = 0;
+        while (expected < commands)
+        {
+            s_Queue.Drain ([&] (const TimedCommand& cmd)
+            {
+                if (cmd.sequence != expected)
+                    ordered = false;
+                if ((cmd.sequence % kSampleEvery) == 0)
+                {
+                    const BenchClock::rep now = BenchClock::now().time_since_epoch().count();
+                    latencies.push_back (double(now - cmd.pushedAt));
+                }
+                ++expected;
+            });
+        }
+    });
+
+    for (unsigned i = 0; i < commands; )
+    {
+        const BenchClock::rep now = BenchClock::now().time_since_epoch().count();
+        if (batch == 0)
+        {
+            const TimedCommand cmd = { i, int(i & 3), now, { 1, 1, 0, 1 } };
+            if (s_Queue.TryPush (cmd))
+            {
+                ++i;
+                continue;
+            }
+        }
+        else
+        {
+            const unsigned wanted = std::min (batch, commands - i);
+            const unsigned reserved = s_Queue.Reserve (wanted);
+            for (unsigned j = 0; j < reserved; ++j)
+            {
+                const TimedCommand cmd = { i + j, int((i + j) & 3), now, { 1, 1, 0, 1 } };
+                s_Queue.Reserved (j) = cmd;
+            }
+            s_Queue.Commit (reserved);
+            i += reserved;
+            if (reserved == wanted)
+                continue;
+        }
+        ++result.fullSpins;
+        std::this_thread::yield ();
+    }
+    consumer.join ();
+
+    result.seconds = BenchSecondsSince (start);
+    result.ordered = ordered;
+    std::sort (latencies.begin(), latencies.end());
+}
+
+int main ()
+{
+    const unsigned kCommands = 4000000;
+    const unsigned kBatch = 64;
+
+    // Convert clock ticks to nanoseconds
+    const double tickNs = 1e9 * double(BenchClock::period::num) / double(BenchClock::period::den);
+
+    RunResult single;
+    Run (kCommands, 0, single);
+    const size_t n = single.latencies.size();
+    const std::vector<double>& latencies = single.latencies;
+
+    BenchReport ("throughput", kCommands / (single.seconds * 1e6), "Mcmds/s");
+    BenchReport ("latency p50", latencies[n / 2] * tickNs, "ns");
+    BenchReport ("latency p99", latencies[(n * 99) / 100] * tickNs, "ns");
+    BenchReport ("latency p99.9", latencies[(n * 999) / 1000] * tickNs, "ns");
+    BenchReport ("latency max", latencies[n - 1] * tickNs, "ns");
+    BenchReport ("producer found ring full", double(single.fullSpins), "times");
+
+    // Batched producer, as SubmitFrame pushes a frame's commands
+    RunResult batched;
+    Run (kCommands, kBatch, batched);
+    BenchReport ("throughput, reserve/commit 64", kCommands / (batched.seconds * 1e6), "Mcmds/s");
+    BenchReport ("latency p50, reserve/commit 64", batched.latencies[batched.latencies.size() / 2] * tickNs, "ns");
+
+    const bool ordered = single.ordered && batched.ordered;
+    BenchReport ("order preserved", ordered ? 1.0 : 0.0, "");
+
+    return ordered ? 0 : 1;
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+// Small helpers shared by the plugin micro-benchmarks. Every benchmark is a
+// standalone executable that prints one result line per measurement, so the
+// output can be diffed between runs on the build machines.
+
+#include <chrono>
+#include <stdio.h>
+
+typedef std::chrono::high_resolution_clock BenchClock;
+
+static inline double BenchSecondsSince (BenchClock::time_point start)
+{
+    return std::chrono::duration<double>(BenchClock::now() - start).count();
+}
+
+// Keeps the optimizer from discarding results the benchmark does not use,
+// and from hoisting memory reads across the call.
+#if defined(__GNUC__) || defined(__clang__)
+template <typename T>
+static inline void BenchDoNotOptimize (const T& value)
+{
+    asm volatile ("" : : "r,m" (value) : "memory");
+}
+#else
+#include <intrin.h>
+template <typename T>
+static inline void BenchDoNotOptimize (const T& value)
+{
+    static volatile char s_Sink;
+    s_Sink = *reinterpret_cast<const volatile char*>(&value);
+    _ReadWriteBarrier ();
+}
+#endif
+
+static inline void BenchReport (const char* name, double value, const char* unit)
+{
+    printf ("%-48s %14.3f %s\n", name, value, unit);
+}
@@ -0,0 +1,227 @@
+// GPU timer ring against a simulated GPU:
+//   - the GPU finishes a frame a fixed number of frames after it was issued;
+//     results must come back exactly that late, with the pass times the
+//     simulated passes took, and without BeginFrame ever waiting,
+//   - a GPU further behind than the ring is deep: frames are skipped, never
+//     waited for,
+//   - disjoint frames are dropped, passes that did not run read 0 and their
+//     queries are never read,
+//   - the mailbox never hands a reader a half-written GpuTimings.
+// Reports the ring's bookkeeping per frame, with query calls that do nothing.
+
+#include "BenchCommon.h"
+#include "../GpuTimerRing.h"
+
+#include <math.h>
+#include <string.h>
+#include <thread>
+
+// Frame begins at tick 0 of the frame; pass p runs for (p + 1) * 100 ticks
+// with 50 idle ticks between passes
+static const uint64_t kSimulatedFrequency = 1000000;    // ticks per second
+
+struct SimulatedGpu
+{
+    int latency;                // frame f is available from the BeginFrame of frame f + latency
+    int disjointEvery;          // every Nth frame is disjoint; 0 for none
+    uint64_t clock;             // ticks
+    uint64_t cpuFrame;          // frame being recorded; the GPU moves on whether it is timed or not
+    uint64_t slotFrame[kGpuTimerFrames];
+    uint32_t slotWritten[kGpuTimerFrames];
+    uint64_t slotTicks[kGpuTimerFrames][kGpuTimestampsPerFrame];
+    bool slotOpen[kGpuTimerFrames];
+    bool misuse;                // a query read that was not written, or a slot reused in flight
+};
+
+static void SimBeginFrame (void* userData, int slot)
+{
+    SimulatedGpu& gpu = *(SimulatedGpu*)userData;
+    if (gpu.slotOpen[slot])
+        gpu.misuse = true;
+    gpu.slotOpen[slot] = true;
+    gpu.slotWritten[slot] = 0;
+}
+
+static void SimTimestamp (void* userData, int slot, int query)
+{
+    SimulatedGpu& gpu = *(SimulatedGpu*)userData;
+    gpu.slotTicks[slot][query] = gpu.clock;
+    gpu.slotWritten[slot] |= 1u << query;
+}
+
+static void SimEndFrame (void* userData, int slot)
+{
+    SimulatedGpu& gpu = *(SimulatedGpu*)userData;
+    gpu.slotFrame[slot] = gpu.cpuFrame;
+}
+
+static bool SimReadFrame (void* userData, int slot, uint32_t queryMask, GpuQueryResults* out)
+{
+    SimulatedGpu& gpu = *(SimulatedGpu*)userData;
+    if (!gpu.slotOpen[slot] || (queryMask & ~gpu.slotWritten[slot]) != 0)
+        gpu.misuse = true;
+    if (gpu.cpuFrame - gpu.slotFrame[slot] < (uint64_t)gpu.latency)
+        return false;
+    gpu.slotOpen[slot] = false;
+    out->frequency = kSimulatedFrequency;
+    out->disjoint = gpu.disjointEvery && gpu.slotFrame[slot] % gpu.disjointEvery == 0;
+    for (int query = 0; query < kGpuTimestampsPerFrame; ++query)
+        out->ticks[query] = (queryMask & (1u << query)) ? gpu.slotTicks[slot][query] : 0;
+    return true;
+}
+
+static void InitSimulatedGpu (SimulatedGpu& gpu, GpuQuerySource& source, int latency, int disjointEvery)
+{
+    memset (&gpu, 0, sizeof(gpu));
+    gpu.latency = latency;
+    gpu.disjointEvery = disjointEvery;
+    source.userData = &gpu;
+    source.beginFrame = SimBeginFrame;
+    source.timestamp = SimTimestamp;
+    source.endFrame = SimEndFrame;
+    source.readFrame = SimReadFrame;
+}
+
+// One plugin frame; the instances pass only runs on even frames
+static void RunFrame (GpuTimerRing& ring, const GpuQuerySource& source, SimulatedGpu& gpu, uint64_t frame)
+{
+    gpu.cpuFrame = frame;
+    ring.BeginFrame (source, frame);
+    for (int pass = 0; pass < kGpuPassCount; ++pass)
+    {
+        gpu.clock += 50;
+        if (pass == kGpuPassInstances && (frame & 1))
+            continue;
+        ring.BeginPass (source, (GpuTimerPass)pass);
+        gpu.clock += (pass + 1) * 100;
+        ring.EndPass (source, (GpuTimerPass)pass);
+    }
+    gpu.clock += 50;
+    ring.EndFrame (source);
+}
+
+static bool CheckTimings (const GpuTimings& timings)
+{
+    const bool instances = (timings.frame & 1) == 0;
+    bool ok = true;
+    float expectedFrame = 50.0f;    // after the last pass
+    for (int pass = 0; pass < kGpuPassCount; ++pass)
+    {
+        const bool ran = pass != kGpuPassInstances || instances;
+        const float expected = ran ? (pass + 1) * 100 * 1e-3f : 0.0f;
+        ok &= fabsf (timings.passMs[pass] - expected) < 1e-4f;
+        ok &= ((timings.passMask >> pass) & 1) == (ran ? 1u : 0u);
+        expectedFrame += 50.0f + (ran ? (pass + 1) * 100.0f : 0.0f);
+    }
+    ok &= fabsf (timings.frameMs - expectedFrame * 1e-3f) < 1e-4f;
+    return ok;
+}
+
+int main ()
+{
+    const int kFrames = 1000;
+    bool ok = true;
+    GpuQuerySource source;
+    SimulatedGpu gpu;
+
+    // Latency the ring covers: every frame comes back latency frames late
+    for (int latency = 1; latency <= kGpuTimerFrames; ++latency)
+    {
+        InitSimulatedGpu (gpu, source, latency, 0);
+        GpuTimerRing ring;
+        for (uint64_t frame = 1; frame <= (uint64_t)kFrames; ++frame)
+        {
+            RunFrame (ring, source, gpu, frame);
+            if (frame > (uint64_t)latency)
+            {
+                const GpuTimings& latest = ring.GetLatest ();
+                ok &= latest.frame == frame - latency && latest.framesBehind == (uint32_t)latency - 1;
+                ok &= CheckTimings (latest);
+            }
+        }
+        ok &= ring.GetSkippedCount () == 0 && ring.GetTimedCount () + ring.GetFramesInFlight () == (uint64_t)kFrames;
+        ok &= !gpu.misuse;
+    }
+
+    // Further behind than the ring: skip, do not wait
+    uint64_t skipped = 0;
+    {
+        InitSimulatedGpu (gpu, source, kGpuTimerFrames + 2, 0);
+        GpuTimerRing ring;
+        for (uint64_t frame = 1; frame <= (uint64_t)kFrames; ++frame)
+            RunFrame (ring, source, gpu, frame);
+        skipped = ring.GetSkippedCount ();
+        ok &= skipped > 0 && ring.GetTimedCount () > 0;
+        ok &= ring.GetTimedCount () + ring.GetSkippedCount () + ring.GetFramesInFlight () == (uint64_t)kFrames;
+        ok &= CheckTimings (ring.GetLatest ()) && !gpu.misuse;
+    }
+
+    // Disjoint frames are dropped; the latest stays the last good one
+    {
+        InitSimulatedGpu (gpu, source, 2, 5);
+        GpuTimerRing ring;
+        for (uint64_t frame = 1; frame <= (uint64_t)kFrames; ++frame)
+        {
+            RunFrame (ring, source, gpu, frame);
+            ok &= ring.GetLatest ().frame % 5 != 0 || ring.GetLatest ().frame == 0;
+        }
+        ok &= ring.GetDisjointCount () == (uint64_t)(kFrames - 2) / 5;
+        ok &= ring.GetTimedCount () + ring.GetDisjointCount () + ring.GetFramesInFlight () == (uint64_t)kFrames;
+        ok &= !gpu.misuse;
+    }
+
+    // Mailbox under a concurrent reader: every field of a published
+    // GpuTimings is derived from its frame number
+    bool consistent = true;
+    {
+        GpuTimingsMailbox mailbox;
+        GpuTimings initial;
+        memset (&initial, 0, sizeof(initial));
+        initial.framesBehind = ~0u;
+        for (int pass = 0; pass < kGpuPassCount; ++pass)
+            initial.passMs[pass] = (float)pass;
+        mailbox.Publish (initial);
+        std::atomic<bool> done (false);
+        std::thread reader ([&]()
+        {
+            while (!done.load (std::memory_order_relaxed))
+            {
+                GpuTimings timings;
+                mailbox.Read (&timings);
+                const uint32_t low = (uint32_t)timings.frame;
+                consistent &= timings.passMask == low && timings.framesBehind == ~low;
+                for (int pass = 0; pass < kGpuPassCount; ++pass)
+                    consistent &= timings.passMs[pass] == (float)(low & 0xffff) + pass;
+            }
+        });
+        for (uint64_t frame = 0; frame < 2000000; ++frame)
+        {
+            GpuTimings timings;
+            timings.frame = frame;
+            timings.passMask = (uint32_t)frame;
+            timings.framesBehind = ~(uint32_t)frame;
+            timings.frameMs = 0.0f;
+            for (int pass = 0; pass < kGpuPassCount; ++pass)
+                timings.passMs[pass] = (float)(frame & 0xffff) + pass;
+            mailbox.Publish (timings);
+        }
+        done.store (true);
+        reader.join ();
+    }
+    ok &= consistent;
+
+    // Bookkeeping cost per frame, with a GPU that is never behind
+    const int kTimedFrames = 2000000;
+    InitSimulatedGpu (gpu, source, 1, 0);
+    GpuTimerRing ring;
+    BenchClock::time_point start = BenchClock::now();
+    for (uint64_t frame = 1; frame <= (uint64_t)kTimedFrames; ++frame)
+        RunFrame (ring, source, gpu, frame);
+    const double frameSeconds = BenchSecondsSince (start);
+    BenchDoNotOptimize (ring.GetLatest ());
+
+    BenchReport ("ring bookkeeping, 4 passes", frameSeconds / kTimedFrames * 1e9, "ns/frame");
+    BenchReport ("frames skipped, GPU 6 frames behind", (double)skipped, "");
+    printf ("gpu timer ring: %s\n", ok ? "ok" : "MISMATCH");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,211 @@
+// CPU cost of submitting 10k small overlays, as one draw per instance (a
+// world matrix constant buffer plus the shape's vertices streamed through a
+// transient ring for every draw) and as instances (InstanceBatchBuffer, one
+// copy of the instance data, one draw per batch). The rings write into CPU
+// memory in place of mapped D3D11 buffers, so the numbers are the plugin's
+// side of the submission only. Also times the CPU reference path on 10k
+// instances and checks SoftwareDrawInstances against drawing each instance
+// with SoftwareDrawTriangles and an explicitly built matrix.
+
+#include "BenchCommon.h"
+#include "../InstanceBatch.h"
+#include "../TransientRingAllocator.h"
+
+#include <string.h>
+#include <vector>
+
+static const int kInstanceCount = 10000;
+static const size_t kRingBytes = 4 * 1024 * 1024;
+
+static void MakeInstances (std::vector<DrawInstance>& instances, int count)
+{
+    unsigned int seed = 12345;
+    instances.resize (count);
+    for (int i = 0; i < count; ++i)
+    {
+        seed = seed * 1664525u + 1013904223u;
+        const float x = float(seed % 2000) / 1000.0f - 1.0f;
+        seed = seed * 1664525u + 1013904223u;
+        const float y = float(seed % 2000) / 1000.0f - 1.0f;
+        const float scale = 0.02f + 0.0001f * float(i % 100);
+        const float c = 0.8f, s = 0.6f;     // a fixed rotation
+        DrawInstance& d = instances[i];
+        d.transform[0] = scale * c; d.transform[1] = -scale * s; d.transform[2] = x;
+        d.transform[3] = scale * s; d.transform[4] = scale * c;  d.transform[5] = y;
+        d.z = 0.5f;
+        d.color = 0xFF000000 | seed;
+    }
+}
+
+// The world matrix of one instance, built the same way the per-draw path
+// would fill its constant buffer.
+static void MakeWorldMatrix (const DrawInstance& d, float m[16])
+{
+    memset (m, 0, 16 * sizeof(float));
+    m[0] = d.transform[0];
+    m[4] = d.transform[1];
+    m[12] = d.transform[2];
+    m[1] = d.transform[3];
+    m[5] = d.transform[4];
+    m[13] = d.transform[5];
+    m[14] = d.z;
+    m[15] = 1;
+}
+
+struct StreamedBuffer
+{
+    TransientRingAllocator ring;
+    std::vector<unsigned char> memory;
+    uint64_t frame;
+
+    StreamedBuffer () : ring (kRingBytes), memory (kRingBytes), frame (0) {}
+
+    void Write (const void* data, size_t size, size_t alignment)
+    {
+        TransientAllocation a;
+        if (!ring.Allocate (size, alignment, &a))
+        {
+            // The "GPU" is always done with the previous frames
+            ring.RetireFramesUpTo (frame);
+            ring.Allocate (size, alignment, &a);
+        }
+        memcpy (&memory[a.offset], data, size);
+    }
+
+    void EndFrame ()
+    {
+        ring.EndFrame (++frame);
+        ring.RetireFramesUpTo (frame - 1);
+    }
+};
+
+static int SubmitPerInstance (StreamedBuffer& constants, StreamedBuffer& vertices, InstanceShape shape, const DrawInstance* instances, int count)
+{
+    int totalVerts;
+    const SoftwareVertex* shapeVerts = GetInstanceShapeVertices (&totalVerts);
+    const InstanceShapeRange range = GetInstanceShapeRange (shape);
+    SoftwareVertex verts[6];
+    int draws = 0;
+    for (int i = 0; i < count; ++i)
+    {
+        float m[16];
+        MakeWorldMatrix (instances[i], m);
+        constants.Write (m, sizeof(m), 256);
+        for (int v = 0; v < range.vertexCount; ++v)
+        {
+            verts[v] = shapeVerts[range.firstVertex + v];
+            verts[v].color = instances[i].color;
+        }
+        vertices.Write (verts, range.vertexCount * sizeof(SoftwareVertex), 16);
+        ++draws;
+    }
+    constants.EndFrame ();
+    vertices.EndFrame ();
+    return draws;
+}
+
+static int SubmitInstanced (InstanceBatchBuffer& batches, StreamedBuffer& instanceData, InstanceShape shape, const DrawInstance* instances, int count)
+{
+    for (int i = 0; i < count; ++i)
+        batches.Push (1, shape, instances[i]);
+    int draws = 0;
+    for (int b = 0; b < batches.GetBatchCount (); ++b)
+    {
+        const InstanceBatch& batch = batches.GetBatch (b);
+        instanceData.Write (batches.GetInstances () + batch.firstInstance, batch.instanceCount * sizeof(DrawInstance), 16);
+        ++draws;
+    }
+    instanceData.EndFrame ();
+    batches.Reset ();
+    return draws;
+}
+
+int main ()
+{
+    std::vector<DrawInstance> instances;
+    MakeInstances (instances, kInstanceCount);
+    bool ok = true;
+
+    // Submission
+    {
+        const int kRepeats = 200;
+        StreamedBuffer constants, vertices, instanceData;
+        InstanceBatchBuffer batches;
+        int perInstanceDraws = 0, instancedDraws = 0;
+
+        BenchClock::time_point start = BenchClock::now();
+        for (int r = 0; r < kRepeats; ++r)
+        {
+            perInstanceDraws = SubmitPerInstance (constants, vertices, kInstanceShapeQuad, &instances[0], kInstanceCount);
+            BenchDoNotOptimize (vertices.memory[0]);
+        }
+        const double perInstanceSeconds = BenchSecondsSince (start);
+
+        start = BenchClock::now();
+        for (int r = 0; r < kRepeats; ++r)
+        {
+            instancedDraws = SubmitInstanced (batches, instanceData, kInstanceShapeQuad, &instances[0], kInstanceCount);
+            BenchDoNotOptimize (instanceData.memory[0]);
+        }
+        const double instancedSeconds = BenchSecondsSince (start);
+
+        BenchReport ("per-instance draws: draw calls / 10k", (double)perInstanceDraws, "draws");
+        BenchReport ("per-instance draws: submit / 10k", perInstanceSeconds / kRepeats * 1e6, "us");
+        BenchReport ("instanced: draw calls / 10k", (double)instancedDraws, "draws");
+        BenchReport ("instanced: submit / 10k", instancedSeconds / kRepeats * 1e6, "us");
+        ok &= perInstanceDraws == kInstanceCount && instancedDraws == 1;
+    }
+
+    // CPU reference path
+    const int kSize = 512;
+    CpuSurface* reference = CreateCpuSurface (kSize, kSize);
+    CpuSurface* target = CreateCpuSurface (kSize, kSize);
+    for (int si = 0; si < kInstanceShapeCount; ++si)
+    {
+        const InstanceShape shape = (InstanceShape)si;
+        const char* shapeName = shape == kInstanceShapeQuad ? "quads" : "triangles";
+        char name[64];
+
+        const RasterPath paths[] = { kRasterPathScalar, kRasterPathSimd };
+        for (int pi = 0; pi < 2; ++pi)
+        {
+            const int kRepeats = 10;
+            BenchClock::time_point start = BenchClock::now();
+            for (int r = 0; r < kRepeats; ++r)
+            {
+                SoftwareDrawInstances (*target, shape, &instances[0], kInstanceCount, paths[pi]);
+                BenchDoNotOptimize (target->pixels[0]);
+            }
+            const double seconds = BenchSecondsSince (start);
+            snprintf (name, sizeof(name), "cpu reference, 10k %s, %s", shapeName, pi == 0 ? "scalar" : "simd");
+            BenchReport (name, seconds / kRepeats * 1e3, "ms");
+        }
+
+        // One draw per instance through the plain triangle path
+        memset (reference->pixels, 0, size_t(reference->stride) * kSize);
+        memset (target->pixels, 0, size_t(target->stride) * kSize);
+        int totalVerts;
+        const SoftwareVertex* shapeVerts = GetInstanceShapeVertices (&totalVerts);
+        const InstanceShapeRange range = GetInstanceShapeRange (shape);
+        for (int i = 0; i < kInstanceCount; ++i)
+        {
+            float m[16];
+            MakeWorldMatrix (instances[i], m);
+            SoftwareVertex verts[6];
+            for (int v = 0; v < range.vertexCount; ++v)
+            {
+                verts[v] = shapeVerts[range.firstVertex + v];
+                verts[v].color = instances[i].color;
+            }
+            SoftwareDrawTriangles (*reference, m, verts, range.vertexCount);
+        }
+        SoftwareDrawInstances (*target, shape, &instances[0], kInstanceCount);
+        const bool match = memcmp (reference->pixels, target->pixels, size_t(target->stride) * kSize) == 0;
+        printf ("instanced %s: %s\n", shapeName, match ? "match per-instance draws" : "MISMATCH");
+        ok &= match;
+    }
+    DestroyCpuSurface (reference);
+    DestroyCpuSurface (target);
+
+    return ok ? 0 : 1;
+}
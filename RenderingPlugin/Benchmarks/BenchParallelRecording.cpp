@@ -0,0 +1,194 @@
+// Per-texture work groups (TextureWorkGroups.h):
+//   - grouping: clears and batches for interleaved textures come out as one
+//     group per texture, in texture order, each texture's commands in
+//     submission order; chunks cover every group exactly once,
+//   - parallel execution leaves every surface exactly as the serial path
+//     does (clears, then instance batches, one after the other),
+//   - scaling: a frame of one clear and a few quad batches per texture,
+//     over 1 to 64 textures and 1 to N threads (the render thread plus
+//     N - 1 workers).
+
+#include "BenchCommon.h"
+#include "../TextureWorkGroups.h"
+#include "../WorkerPool.h"
+
+#include <math.h>
+#include <string.h>
+#include <thread>
+#include <vector>
+
+enum
+{
+    kMaxTextures = 64,
+    kSurfaceSize = 128,
+    kBatchesPerTexture = 4,
+    kInstancesPerBatch = 16,
+};
+
+static std::vector<CpuSurface*> s_Surfaces;
+
+// Handle i + 1 is surface i
+static CpuSurface* ResolveSurface (TextureHandle texture, void*)
+{
+    return texture >= 1 && texture <= (int)s_Surfaces.size() ? s_Surfaces[texture - 1] : NULL;
+}
+
+// Textures are visited round-robin so batches of one texture are
+// interleaved with the others', as several scripts queueing would do
+static void QueueFrame (int textures, int frame, ClearCommandBuffer& clears, InstanceBatchBuffer& batches)
+{
+    clears.Reset ();
+    batches.Reset ();
+    for (int t = 0; t < textures; ++t)
+    {
+        const float color[4] = { (t & 1) ? 1.0f : 0.2f, (t & 2) ? 1.0f : 0.4f, (frame & 1) ? 0.6f : 0.0f, 1.0f };
+        clears.Push (t + 1, color);
+    }
+    for (int b = 0; b < kBatchesPerTexture; ++b)
+    {
+        for (int t = 0; t < textures; ++t)
+        {
+            for (int i = 0; i < kInstancesPerBatch; ++i)
+            {
+                const float angle = frame / 30.0f + (b * kInstancesPerBatch + i) * 0.4f + t;
+                DrawInstance instance = { { 0.2f, 0, 0.6f * cosf (angle), 0, 0.2f, 0.6f * sinf (angle) }, 0.5f, 0xFF000000u | (unsigned)(t * 40 + i * 8 + b * 60) };
+                batches.Push (t + 1, (b & 1) ? kInstanceShapeQuad : kInstanceShapeTriangle, instance);
+            }
+        }
+    }
+}
+
+static void ExecuteSerial (const ClearCommand* clears, int clearCount, const InstanceBatchBuffer& batches)
+{
+    ExecuteClearCommandsCPU (clears, clearCount, ResolveSurface, NULL);
+    const DrawInstance* instances = batches.GetInstances ();
+    for (int b = 0; b < batches.GetBatchCount (); ++b)
+    {
+        const InstanceBatch& batch = batches.GetBatch (b);
+        if (CpuSurface* surface = ResolveSurface (batch.texture, NULL))
+            SoftwareDrawInstances (*surface, batch.shape, instances + batch.firstInstance, batch.instanceCount);
+    }
+}
+
+static unsigned int HashSurfaces (int textures)
+{
+    unsigned int hash = 2166136261u;
+    for (int t = 0; t < textures; ++t)
+    {
+        const CpuSurface& surface = *s_Surfaces[t];
+        for (int y = 0; y < surface.height; ++y)
+            for (int x = 0; x < surface.width * 4; ++x)
+                hash = (hash ^ surface.pixels[y * surface.stride + x]) * 16777619u;
+    }
+    return hash;
+}
+
+static bool CheckGrouping ()
+{
+    bool ok = true;
+    ClearCommandBuffer clears;
+    InstanceBatchBuffer batches;
+    const float red[4] = { 1, 0, 0, 1 };
+    const DrawInstance instance = { { 1, 0, 0, 0, 1, 0 }, 0.5f, 0xFFFFFFFFu };
+    clears.Push (3, red);
+    clears.Push (1, red);
+    batches.Push (2, kInstanceShapeQuad, instance);        // batch 0
+    batches.Push (1, kInstanceShapeQuad, instance);        // batch 1
+    batches.Push (2, kInstanceShapeTriangle, instance);    // batch 2
+    batches.Push (2, kInstanceShapeTriangle, instance);    // still batch 2
+    batches.Push (1, kInstanceShapeTriangle, instance);    // batch 3
+    const int clearCount = clears.Prepare ();
+
+    TextureWorkGroups work;
+    ok &= work.Build (clears.Commands (), clearCount, &batches) == 3;
+    const int* order = work.GetBatchOrder ();
+    const TextureWorkGroup& g1 = work.GetGroup (0);
+    const TextureWorkGroup& g2 = work.GetGroup (1);
+    const TextureWorkGroup& g3 = work.GetGroup (2);
+    ok &= g1.texture == 1 && g1.clearCount == 1 && g1.batchCount == 2 && order[g1.firstBatch] == 1 && order[g1.firstBatch + 1] == 3;
+    ok &= g2.texture == 2 && g2.clearCount == 0 && g2.batchCount == 2 && order[g2.firstBatch] == 0 && order[g2.firstBatch + 1] == 2 && g2.cost == 3;
+    ok &= g3.texture == 3 && g3.clearCount == 1 && g3.batchCount == 0;
+
+    // Either side on its own
+    ok &= work.Build (clears.Commands (), clearCount, NULL) == 2;
+    ok &= work.Build (NULL, 0, &batches) == 2;
+    ok &= work.Build (NULL, 0, NULL) == 0;
+
+    // Chunks: consecutive, non-empty, covering every group
+    InstanceBatchBuffer many;
+    for (int t = 1; t <= 37; ++t)
+        for (int i = 0; i < t % 5; ++i)
+            many.Push (t, kInstanceShapeQuad, instance);
+    const int groups = work.Build (NULL, 0, &many);
+    std::vector<int> begins;
+    for (int chunks = 1; chunks <= 40; ++chunks)
+    {
+        const int made = work.SplitIntoChunks (chunks, begins);
+        ok &= made == (chunks < groups ? chunks : groups) && (int)begins.size() == made + 1;
+        ok &= begins.front () == 0 && begins.back () == groups;
+        for (int c = 0; c < made; ++c)
+            ok &= begins[c] < begins[c + 1];
+    }
+    return ok;
+}
+
+int main ()
+{
+    bool ok = CheckGrouping ();
+
+    for (int t = 0; t < kMaxTextures; ++t)
+        s_Surfaces.push_back (CreateCpuSurface (kSurfaceSize, kSurfaceSize));
+
+    const int hardwareThreads = (int)std::thread::hardware_concurrency ();
+    const int maxThreads = hardwareThreads > 4 ? hardwareThreads : 4;
+    static const int kTextureCounts[] = { 1, 2, 4, 8, 16, 32, 64 };
+
+    ClearCommandBuffer clears;
+    InstanceBatchBuffer batches;
+    TextureWorkGroups work;
+    for (int threads = 1; threads <= maxThreads; threads *= 2)
+    {
+        WorkerPool pool;
+        pool.Start (threads - 1, false);
+        for (size_t i = 0; i < sizeof(kTextureCounts) / sizeof(kTextureCounts[0]); ++i)
+        {
+            const int textures = kTextureCounts[i];
+
+            // Same frame both ways, compared pixel for pixel
+            QueueFrame (textures, 7, clears, batches);
+            int clearCount = clears.Prepare ();
+            ExecuteSerial (clears.Commands (), clearCount, batches);
+            const unsigned int serialHash = HashSurfaces (textures);
+            for (int t = 0; t < textures; ++t)
+                memset (s_Surfaces[t]->pixels, 0, (size_t)s_Surfaces[t]->stride * s_Surfaces[t]->height);
+            int clearsDone = 0, drawsDone = 0;
+            work.Build (clears.Commands (), clearCount, &batches);
+            work.ExecuteCPU (pool, ResolveSurface, NULL, &clearsDone, &drawsDone);
+            ok &= HashSurfaces (textures) == serialHash;
+            ok &= clearsDone == textures && drawsDone == textures * kBatchesPerTexture;
+
+            const int frames = 4096 / textures;
+            double seconds = 0.0;
+            for (int frame = 0; frame < frames; ++frame)
+            {
+                QueueFrame (textures, frame, clears, batches);
+                const BenchClock::time_point start = BenchClock::now();
+                clearCount = clears.Prepare ();
+                work.Build (clears.Commands (), clearCount, &batches);
+                work.ExecuteCPU (pool, ResolveSurface, NULL, &clearsDone, &drawsDone);
+                seconds += BenchSecondsSince (start);
+            }
+
+            char label[96];
+            snprintf (label, sizeof(label), "%2d textures, %d thread%s", textures, threads, threads == 1 ? "" : "s");
+            BenchReport (label, seconds / frames * 1e6, "us/frame");
+        }
+        pool.Stop ();
+    }
+
+    for (int t = 0; t < kMaxTextures; ++t)
+        DestroyCpuSurface (s_Surfaces[t]);
+    printf ("hardware threads: %d\n", hardwareThreads);
+    printf ("parallel recording: %s\n", ok ? "ok" : "MISMATCH");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,75 @@
+// Compares the per-pixel scalar plasma fill (FillTextureFromCode's original
+// code) against the table-driven kernels at 256^2, 1024^2 and 4096^2, and
+// checks every kernel stays within 1 LSB of the reference.
+
+#include "BenchCommon.h"
+#include "../PlasmaKernel.h"
+
+#include <stdlib.h>
+#include <vector>
+
+static int MaxAbsDiff (const std::vector<unsigned char>& a, const std::vector<unsigned char>& b)
+{
+    int worst = 0;
+    for (size_t i = 0; i < a.size(); ++i)
+    {
+        const int d = abs (int(a[i]) - int(b[i]));
+        if (d > worst)
+            worst = d;
+    }
+    return worst;
+}
+
+int main ()
+{
+    const int kSizes[] = { 256, 1024, 4096 };
+    const PlasmaKernel kKernels[] = { kPlasmaKernelScalar, kPlasmaKernelSSE41, kPlasmaKernelAVX2, kPlasmaKernelNEON };
+    // A phase well away from zero so the range reduction is exercised
+    const float t = 37.25f * 4.0f;
+    bool withinOneLsb = true;
+
+    printf ("best kernel: %s\n", GetPlasmaKernelName (kPlasmaKernelAuto));
+
+    for (int si = 0; si < 3; ++si)
+    {
+        const int size = kSizes[si];
+        const int stride = size * 4;
+        const int repeats = size <= 256 ? 100 : (size <= 1024 ? 10 : 2);
+        std::vector<unsigned char> reference (size_t(stride) * size);
+        std::vector<unsigned char> image (reference.size());
+        char name[64];
+
+        BenchClock::time_point start = BenchClock::now();
+        for (int r = 0; r < repeats; ++r)
+        {
+            FillPlasmaReference (size, size, stride, &reference[0], t);
+            BenchDoNotOptimize (reference[0]);
+        }
+        double referenceMs = BenchSecondsSince (start) * 1e3 / repeats;
+        snprintf (name, sizeof(name), "%dx%d reference", size, size);
+        BenchReport (name, referenceMs, "ms");
+
+        PlasmaTables tables;
+        for (int ki = 0; ki < 4; ++ki)
+        {
+            const PlasmaKernel kernel = kKernels[ki];
+            if (!IsPlasmaKernelSupported (kernel))
+                continue;
+
+            start = BenchClock::now();
+            for (int r = 0; r < repeats; ++r)
+            {
+                FillPlasma (tables, size, size, stride, &image[0], t, kernel);
+                BenchDoNotOptimize (image[0]);
+            }
+            const double ms = BenchSecondsSince (start) * 1e3 / repeats;
+            const int diff = MaxAbsDiff (reference, image);
+            withinOneLsb &= diff <= 1;
+
+            snprintf (name, sizeof(name), "%dx%d %s", size, size, GetPlasmaKernelName (kernel));
+            printf ("%-48s %14.3f ms  %6.2fx  max diff %d LSB\n", name, ms, referenceMs / ms, diff);
+        }
+    }
+
+    return withinOneLsb ? 0 : 1;
+}
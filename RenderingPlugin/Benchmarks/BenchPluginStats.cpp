@@ -0,0 +1,85 @@
+// Cost of keeping the plugin stats on the render thread:
+//   - AddPluginStat (plain load and store, single writer),
+//   - a locked fetch_add, what a multi-writer counter would cost,
+//   - PluginStatsTimer around an empty scope (two clock reads).
+// Then opens a stats page the way the plugin does and maps it read-only the
+// way an external monitor does; the monitor must see every counter value,
+// and pages with the wrong magic must be refused.
+
+#include "BenchCommon.h"
+#include "../PluginStats.h"
+
+#include <string>
+
+int main ()
+{
+    const int kCalls = 10000000;
+    bool ok = true;
+
+    static PluginStats s_Stats;
+
+    BenchClock::time_point start = BenchClock::now();
+    for (int i = 0; i < kCalls; ++i)
+    {
+        AddPluginStat (s_Stats.draws, 1);
+        BenchDoNotOptimize (s_Stats.draws);
+    }
+    const double addSeconds = BenchSecondsSince (start);
+
+    start = BenchClock::now();
+    for (int i = 0; i < kCalls; ++i)
+    {
+        s_Stats.clears.fetch_add (1, std::memory_order_relaxed);
+        BenchDoNotOptimize (s_Stats.clears);
+    }
+    const double fetchAddSeconds = BenchSecondsSince (start);
+    ok &= s_Stats.draws.load () == (uint64_t)kCalls && s_Stats.clears.load () == (uint64_t)kCalls;
+
+    const int kTimerCalls = kCalls / 10;
+    start = BenchClock::now();
+    for (int i = 0; i < kTimerCalls; ++i)
+    {
+        PluginStatsTimer timer (s_Stats.renderEventNs);
+    }
+    const double timerSeconds = BenchSecondsSince (start);
+
+    // Writer and monitor sides of a shared page
+    bool shared = false;
+    {
+        PluginStatsPage page;
+        const std::string name = GetPluginStatsPageName (GetPluginStatsProcessId ()) + ".bench";
+        page.Open (name.c_str ());
+        PluginStats* stats = page.Get ();
+        ok &= stats != NULL && stats->magic == kPluginStatsMagic && stats->uploadBytes.load () == 0;
+        shared = page.IsShared ();
+        if (shared)
+        {
+            const PluginStats* monitor = MapPluginStatsPage (name.c_str ());
+            ok &= monitor != NULL && monitor != stats;
+            if (monitor)
+            {
+                for (uint64_t i = 1; i <= 1000; ++i)
+                {
+                    AddPluginStat (stats->renderEvents, 1);
+                    AddPluginStat (stats->uploadBytes, i);
+                    ok &= monitor->renderEvents.load (std::memory_order_relaxed) == i;
+                }
+                ok &= monitor->uploadBytes.load () == 1000 * 1001 / 2;
+                ok &= monitor->processId == GetPluginStatsProcessId ();
+                UnmapPluginStatsPage (monitor);
+            }
+
+            // A page that is not (or no longer) a stats page is refused
+            stats->magic = 0;
+            ok &= MapPluginStatsPage (name.c_str ()) == NULL;
+        }
+        page.Close ();
+        ok &= !page.IsShared () && MapPluginStatsPage (name.c_str ()) == NULL;
+    }
+
+    BenchReport ("AddPluginStat", addSeconds / kCalls * 1e9, "ns/call");
+    BenchReport ("relaxed fetch_add", fetchAddSeconds / kCalls * 1e9, "ns/call");
+    BenchReport ("PluginStatsTimer", timerSeconds / kTimerCalls * 1e9, "ns/scope");
+    printf ("plugin stats: %s%s\n", ok ? "ok" : "MISMATCH", shared ? "" : " (no shared memory)");
+    return ok ? 0 : 1;
+}
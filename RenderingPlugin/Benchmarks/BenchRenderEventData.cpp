@@ -0,0 +1,139 @@
+// Checks the render event data path: CopyRenderEventData copies the struct
+// and its rects into the frame arena (the script's memory can change right
+// after), rejects a wrong size, a bad rect count or a full arena, and the
+// copies stay aligned; PushRenderEventClears queues one clear per rect, or
+// one whole-texture clear. Then measures copying and applying one event's
+// data, the render thread's side of carrying a frame's parameters in one
+// event.
+
+#include "BenchCommon.h"
+#include "../RenderEventData.h"
+
+#include <string.h>
+#include <vector>
+
+static RenderEventData MakeData (int rectCount, const ClearRect* rects)
+{
+    RenderEventData data;
+    memset (&data, 0, sizeof(data));
+    data.size = sizeof(data);
+    data.fields = kRenderEventDataTime | kRenderEventDataClear;
+    data.time = 1.5f;
+    data.texture = 3;
+    data.color[0] = 1.0f;
+    data.color[3] = 1.0f;
+    data.rectCount = rectCount;
+    data.rects = rects;
+    return data;
+}
+
+static bool CheckCopies ()
+{
+    bool ok = true;
+    FrameArena arena (4096);
+
+    ClearRect rects[4] = { { 0, 0, 8, 8 }, { 8, 0, 8, 8 }, { 0, 8, 8, 8 }, { 8, 8, 8, 8 } };
+    RenderEventData data = MakeData (4, rects);
+    const RenderEventData* copy = CopyRenderEventData (arena, &data);
+    ok &= copy != NULL;
+    if (copy)
+    {
+        // Script memory reused after the event
+        memset (rects, 0, sizeof(rects));
+        data.time = 0.0f;
+        ok &= copy->time == 1.5f && copy->texture == 3 && copy->rectCount == 4;
+        ok &= copy->rects != rects && copy->rects[3].x == 8 && copy->rects[3].height == 8;
+        ok &= ((size_t)copy % alignof(RenderEventData)) == 0 && ((size_t)copy->rects % alignof(ClearRect)) == 0;
+
+        ClearCommandBuffer clears (16);
+        ok &= PushRenderEventClears (*copy, clears) == 4 && clears.Count () == 4;
+    }
+
+    // Whole texture, and no clear at all
+    RenderEventData whole = MakeData (0, NULL);
+    copy = CopyRenderEventData (arena, &whole);
+    ClearCommandBuffer clears (16);
+    ok &= copy != NULL && copy->rects == NULL && PushRenderEventClears (*copy, clears) == 1;
+    whole.fields = kRenderEventDataTime;
+    copy = CopyRenderEventData (arena, &whole);
+    ok &= copy != NULL && PushRenderEventClears (*copy, clears) == 0 && clears.Count () == 1;
+
+    // Malformed
+    RenderEventData bad = MakeData (0, NULL);
+    bad.size = sizeof(bad) - 4;
+    ok &= CopyRenderEventData (arena, &bad) == NULL;
+    bad = MakeData (-1, NULL);
+    ok &= CopyRenderEventData (arena, &bad) == NULL;
+    bad = MakeData (2, NULL);
+    ok &= CopyRenderEventData (arena, &bad) == NULL;
+    bad = MakeData (kMaxRenderEventRects + 1, rects);
+    ok &= CopyRenderEventData (arena, &bad) == NULL;
+    ok &= CopyRenderEventData (arena, NULL) == NULL;
+
+    // Full arena fails, Reset makes room again
+    std::vector<ClearRect> many (kMaxRenderEventRects);
+    RenderEventData big = MakeData (kMaxRenderEventRects, &many[0]);
+    FrameArena small (1024);
+    ok &= CopyRenderEventData (small, &big) == NULL;
+    int fitted = 0;
+    while (CopyRenderEventData (small, &whole))
+        ++fitted;
+    ok &= fitted > 0 && small.GetUsedBytes () <= small.GetCapacity ();
+    small.Reset ();
+    ok &= small.GetUsedBytes () == 0 && CopyRenderEventData (small, &whole) != NULL;
+    ok &= small.GetHighWaterBytes () > sizeof(RenderEventData);
+
+    // Unaligned source
+    std::vector<unsigned char> unaligned (sizeof(RenderEventData) + 1);
+    RenderEventData source = MakeData (0, NULL);
+    memcpy (&unaligned[1], &source, sizeof(source));
+    copy = CopyRenderEventData (arena, &unaligned[1]);
+    ok &= copy != NULL && copy->time == 1.5f;
+    return ok;
+}
+
+// ns per event: copy into the arena and queue its clears, with the arena
+// reset once per frame of kEventsPerFrame events
+static double MeasureEvents (int rectCount, bool& ok)
+{
+    const int kEventsPerFrame = 8;
+    const int kFrames = 200000;
+    std::vector<ClearRect> rects (rectCount > 0 ? rectCount : 1);
+    for (int i = 0; i < rectCount; ++i)
+    {
+        const ClearRect rect = { i, i, 4, 4 };
+        rects[i] = rect;
+    }
+    const RenderEventData data = MakeData (rectCount, &rects[0]);
+
+    FrameArena arena (64 * 1024);
+    ClearCommandBuffer clears (kEventsPerFrame * (rectCount > 0 ? rectCount : 1));
+    int pushed = 0;
+    BenchClock::time_point start = BenchClock::now();
+    for (int frame = 0; frame < kFrames; ++frame)
+    {
+        for (int event = 0; event < kEventsPerFrame; ++event)
+        {
+            const RenderEventData* copy = CopyRenderEventData (arena, &data);
+            if (copy)
+                pushed += PushRenderEventClears (*copy, clears);
+        }
+        BenchDoNotOptimize (clears);
+        clears.Reset ();
+        arena.Reset ();
+    }
+    const double seconds = BenchSecondsSince (start);
+    ok &= pushed == kFrames * kEventsPerFrame * (rectCount > 0 ? rectCount : 1);
+    return seconds / ((double)kFrames * kEventsPerFrame) * 1e9;
+}
+
+int main ()
+{
+    bool ok = CheckCopies ();
+
+    BenchReport ("copy + apply, whole-texture clear", MeasureEvents (0, ok), "ns/event");
+    BenchReport ("copy + apply, 4 rects", MeasureEvents (4, ok), "ns/event");
+    BenchReport ("copy + apply, 32 rects", MeasureEvents (32, ok), "ns/event");
+    printf ("render event data: %s\n", ok ? "ok" : "MISMATCH");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,180 @@
+// Checks RenderEventTable: registered IDs reach their handler, everything
+// else (unregistered, negative, past the table) reaches the fallback, and
+// Unregister puts the fallback back. Then measures dispatch overhead per
+// event against calling the handler directly and against a switch over the
+// same IDs, for the split frame (fill, upload, clear, draw) the plugin
+// issues and for IDs in random order.
+
+#include "BenchCommon.h"
+#include "../RenderEventTable.h"
+
+#include <stdint.h>
+#include <vector>
+
+enum
+{
+    kEventFrame = 1,
+    kEventFill = 2,
+    kEventUpload = 3,
+    kEventClear = 4,
+    kEventDraw = 5,
+    kEventFlush = 6,
+    kEventCount = 7,
+};
+
+static uint64_t s_Calls[kEventCount];
+static uint64_t s_FallbackCalls;
+
+// Handlers stay out of line, as the plugin's are: only the dispatch differs
+#if defined(__GNUC__) || defined(__clang__)
+#define BENCH_NOINLINE __attribute__((noinline))
+#else
+#define BENCH_NOINLINE __declspec(noinline)
+#endif
+
+BENCH_NOINLINE static void OnFrame (int) { ++s_Calls[kEventFrame]; }
+BENCH_NOINLINE static void OnFill (int) { ++s_Calls[kEventFill]; }
+BENCH_NOINLINE static void OnUpload (int) { ++s_Calls[kEventUpload]; }
+BENCH_NOINLINE static void OnClear (int) { ++s_Calls[kEventClear]; }
+BENCH_NOINLINE static void OnDraw (int) { ++s_Calls[kEventDraw]; }
+BENCH_NOINLINE static void OnFlush (int) { ++s_Calls[kEventFlush]; }
+BENCH_NOINLINE static void OnUnknown (int) { ++s_FallbackCalls; }
+
+static void RegisterAll (RenderEventTable& table)
+{
+    table.Register (kEventFrame, OnFrame);
+    table.Register (kEventFill, OnFill);
+    table.Register (kEventUpload, OnUpload);
+    table.Register (kEventClear, OnClear);
+    table.Register (kEventDraw, OnDraw);
+    table.Register (kEventFlush, OnFlush);
+}
+
+BENCH_NOINLINE static void DispatchSwitch (int eventID)
+{
+    switch (eventID)
+    {
+    case kEventFrame: OnFrame (eventID); break;
+    case kEventFill: OnFill (eventID); break;
+    case kEventUpload: OnUpload (eventID); break;
+    case kEventClear: OnClear (eventID); break;
+    case kEventDraw: OnDraw (eventID); break;
+    case kEventFlush: OnFlush (eventID); break;
+    default: OnUnknown (eventID); break;
+    }
+}
+
+BENCH_NOINLINE static void DispatchTable (const RenderEventTable& table, int eventID)
+{
+    table.Dispatch (eventID);
+}
+
+static void ResetCalls ()
+{
+    for (int i = 0; i < kEventCount; ++i)
+        s_Calls[i] = 0;
+    s_FallbackCalls = 0;
+}
+
+static bool CheckRouting ()
+{
+    bool ok = true;
+    RenderEventTable table (OnUnknown);
+    ok &= table.GetFallback () == OnUnknown;
+    RegisterAll (table);
+    ok &= !table.Register (-1, OnDraw) && !table.Register (RenderEventTable::kMaxEvents, OnDraw);
+    ok &= !table.Register (kEventDraw + 10, NULL);
+
+    ResetCalls ();
+    for (int id = kEventFrame; id < kEventCount; ++id)
+        table.Dispatch (id);
+    for (int id = kEventFrame; id < kEventCount; ++id)
+        ok &= s_Calls[id] == 1 && table.IsRegistered (id);
+    ok &= s_FallbackCalls == 0;
+
+    const int unknown[] = { 0, kEventCount, RenderEventTable::kMaxEvents - 1, RenderEventTable::kMaxEvents, 1 << 20, -1, (int)0x80000000 };
+    const int unknownCount = (int)(sizeof(unknown) / sizeof(unknown[0]));
+    for (int i = 0; i < unknownCount; ++i)
+    {
+        table.Dispatch (unknown[i]);
+        ok &= !table.IsRegistered (unknown[i]);
+    }
+    ok &= s_FallbackCalls == (uint64_t)unknownCount;
+
+    table.Unregister (kEventDraw);
+    table.Unregister (-5);
+    table.Dispatch (kEventDraw);
+    ok &= !table.IsRegistered (kEventDraw) && s_Calls[kEventDraw] == 1 && s_FallbackCalls == (uint64_t)unknownCount + 1;
+    return ok;
+}
+
+// ns per event for each way of dispatching the same sequence
+static void MeasureSequence (const char* label, const RenderEventTable& table, const std::vector<int>& events, int rounds, bool& ok)
+{
+    char name[64];
+
+    ResetCalls ();
+    BenchClock::time_point start = BenchClock::now();
+    for (int round = 0; round < rounds; ++round)
+        for (size_t i = 0; i < events.size(); ++i)
+            OnDraw (events[i]);
+    const double directSeconds = BenchSecondsSince (start);
+
+    ResetCalls ();
+    start = BenchClock::now();
+    for (int round = 0; round < rounds; ++round)
+        for (size_t i = 0; i < events.size(); ++i)
+            DispatchSwitch (events[i]);
+    const double switchSeconds = BenchSecondsSince (start);
+    uint64_t switchCalls[kEventCount];
+    for (int i = 0; i < kEventCount; ++i)
+        switchCalls[i] = s_Calls[i];
+
+    ResetCalls ();
+    start = BenchClock::now();
+    for (int round = 0; round < rounds; ++round)
+        for (size_t i = 0; i < events.size(); ++i)
+            DispatchTable (table, events[i]);
+    const double tableSeconds = BenchSecondsSince (start);
+    for (int i = 0; i < kEventCount; ++i)
+        ok &= s_Calls[i] == switchCalls[i];
+
+    const double count = (double)events.size() * rounds;
+    snprintf (name, sizeof(name), "direct call, %s", label);
+    BenchReport (name, directSeconds / count * 1e9, "ns/event");
+    snprintf (name, sizeof(name), "switch, %s", label);
+    BenchReport (name, switchSeconds / count * 1e9, "ns/event");
+    snprintf (name, sizeof(name), "table, %s", label);
+    BenchReport (name, tableSeconds / count * 1e9, "ns/event");
+    snprintf (name, sizeof(name), "table overhead over direct, %s", label);
+    BenchReport (name, (tableSeconds - directSeconds) / count * 1e9, "ns/event");
+}
+
+int main ()
+{
+    bool ok = CheckRouting ();
+
+    RenderEventTable table (OnUnknown);
+    RegisterAll (table);
+
+    const int kEvents = 4096;
+    const int kRounds = 2000;
+
+    std::vector<int> split (kEvents);
+    for (int i = 0; i < kEvents; ++i)
+        split[i] = kEventFill + (i & 3);
+
+    std::vector<int> random (kEvents);
+    uint32_t seed = 12345;
+    for (int i = 0; i < kEvents; ++i)
+    {
+        seed = seed * 1664525u + 1013904223u;
+        random[i] = (int)((seed >> 16) % (kEventCount + 1));     // includes 0 and kEventCount: fallback
+    }
+
+    MeasureSequence ("split frame", table, split, kRounds, ok);
+    MeasureSequence ("random IDs", table, random, kRounds, ok);
+
+    printf ("render event table: %s\n", ok ? "ok" : "MISMATCH");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,258 @@
+// Cost of getting the plugin's device objects back after a device reset,
+// on a mock device whose creates take roughly what a driver's do (shaders
+// and input layouts the most). Compares
+//   - lazy re-creation: each object is created again the first time a frame
+//     needs it, so the cost lands on whichever frames touch it first,
+//   - a bulk ResourceJournal::Recreate on the render thread,
+//   - BeginRecreate on a WorkerPool at "AfterReset", with Unity's own reset
+//     work in between, and EndRecreate at the next render event.
+// Also checks that every object comes back from its own recipe exactly once,
+// that creates and releases balance, and that failures are counted.
+
+#include "BenchCommon.h"
+#include "../ResourceJournal.h"
+#include "../WorkerPool.h"
+
+#include <atomic>
+#include <string.h>
+#include <thread>
+#include <vector>
+
+enum MockKind
+{
+    kMockBuffer,
+    kMockShader,
+    kMockInputLayout,
+    kMockState,
+    kMockQuery,
+    kMockView,
+    kMockKindCount
+};
+
+// Rough per-object creation cost of a desktop driver, in microseconds
+static const double kMockCreateMicroseconds[kMockKindCount] = { 20, 150, 60, 5, 2, 10 };
+
+struct MockRecipe
+{
+    MockKind kind;
+    int index;
+    int failFromGeneration;     // 0: never fails
+};
+
+struct MockObject
+{
+    MockRecipe recipe;
+    int generation;
+};
+
+struct MockDevice
+{
+    int generation;
+    std::atomic<int> creates;
+    std::atomic<int> releases;
+};
+
+static void Spin (double microseconds)
+{
+    BenchClock::time_point start = BenchClock::now();
+    while (BenchSecondsSince (start) * 1e6 < microseconds)
+        ;
+}
+
+static void* CreateMockObject (void* device, const void* recipe, size_t recipeSize)
+{
+    MockDevice* mock = (MockDevice*)device;
+    if (recipeSize != sizeof(MockRecipe))
+        return NULL;
+    const MockRecipe* desc = (const MockRecipe*)recipe;
+    Spin (kMockCreateMicroseconds[desc->kind]);
+    if (desc->failFromGeneration && mock->generation >= desc->failFromGeneration)
+        return NULL;
+    MockObject* object = new MockObject;
+    object->recipe = *desc;
+    object->generation = mock->generation;
+    mock->creates.fetch_add (1, std::memory_order_relaxed);
+    return object;
+}
+
+static MockDevice* s_Device;
+
+static void ReleaseMockObject (void* object)
+{
+    delete (MockObject*)object;
+    s_Device->releases.fetch_add (1, std::memory_order_relaxed);
+}
+
+// What the plugin creates: a handful of global objects plus one view per
+// registered texture
+enum { kTextureCount = 128, kTexturesPerFrame = 16 };
+
+static const MockKind kGlobalKinds[] =
+{
+    kMockBuffer, kMockBuffer, kMockBuffer,                  // transient VB/CB, shape VB
+    kMockShader, kMockShader, kMockShader,                  // vertex, pixel, instanced vertex
+    kMockInputLayout, kMockInputLayout,
+    kMockState, kMockState, kMockState,                     // raster, depth, blend
+    kMockQuery, kMockQuery, kMockQuery, kMockQuery,         // frame fences
+    kMockQuery, kMockQuery, kMockQuery, kMockQuery,
+};
+static const int kGlobalCount = sizeof(kGlobalKinds) / sizeof(kGlobalKinds[0]);
+static const int kObjectCount = kGlobalCount + kTextureCount;
+
+static MockRecipe MakeRecipe (int i)
+{
+    MockRecipe recipe;
+    memset (&recipe, 0, sizeof(recipe));
+    recipe.kind = i < kGlobalCount ? kGlobalKinds[i] : kMockView;
+    recipe.index = i;
+    return recipe;
+}
+
+static bool CheckSlots (void* const* slots, int generation, int skip)
+{
+    for (int i = 0; i < kObjectCount; ++i)
+    {
+        const MockObject* object = (const MockObject*)slots[i];
+        if (i == skip)
+        {
+            if (object)
+                return false;
+            continue;
+        }
+        if (!object || object->recipe.index != i || object->generation != generation)
+            return false;
+    }
+    return true;
+}
+
+// Stand-in for the work Unity does between AfterReset and the next render
+// event (recreating its own resources)
+static void OtherResetWork (double seconds)
+{
+    std::this_thread::sleep_for (std::chrono::duration<double>(seconds));
+}
+
+int main ()
+{
+    // At least one worker, so the concurrent path is exercised even on a
+    // single core (where it still overlaps with Unity's reset work)
+    const int defaultWorkers = WorkerPool::GetDefaultWorkerCount ();
+    WorkerPool pool;
+    pool.Start (defaultWorkers > 0 ? defaultWorkers : 1, false);
+
+    MockDevice device;
+    device.generation = 0;
+    device.creates.store (0);
+    device.releases.store (0);
+    s_Device = &device;
+
+    ResourceJournal journal;
+    journal.SetDevice (&device, ReleaseMockObject);
+    void* slots[kObjectCount];
+    bool ok = true;
+    for (int i = 0; i < kObjectCount; ++i)
+    {
+        const MockRecipe recipe = MakeRecipe (i);
+        ok &= journal.Create ("mock", CreateMockObject, &recipe, sizeof(recipe), &slots[i]) != kInvalidResourceId;
+    }
+    ok &= journal.GetRecordCount () == kObjectCount && journal.GetLiveCount () == kObjectCount;
+
+    const int kResets = 10;
+    const double kResetWork = 0.010;
+    double lazyWorstFrame = 0, lazyTotal = 0, lazyFrames = 0;
+    double bulkSeconds = 0, pooledBeginSeconds = 0, pooledWaitSeconds = 0;
+
+    for (int reset = 0; reset < kResets; ++reset)
+    {
+        // Lazy: whatever a frame touches is created on the spot. Every frame
+        // needs the globals and a rotating subset of the textures.
+        journal.ReleaseObjects ();
+        ok &= journal.GetLiveCount () == 0 && slots[0] == NULL;
+        ++device.generation;
+        for (int frame = 0; frame * kTexturesPerFrame < kTextureCount; ++frame)
+        {
+            BenchClock::time_point start = BenchClock::now();
+            bool created = false;
+            for (int i = 0; i < kObjectCount; ++i)
+            {
+                const bool used = i < kGlobalCount || (i - kGlobalCount) / kTexturesPerFrame == frame;
+                if (used && !slots[i])
+                {
+                    const MockRecipe recipe = MakeRecipe (i);
+                    slots[i] = CreateMockObject (&device, &recipe, sizeof(recipe));
+                    created = true;
+                }
+            }
+            const double seconds = BenchSecondsSince (start);
+            if (created)
+                ++lazyFrames;
+            lazyTotal += seconds;
+            if (seconds > lazyWorstFrame)
+                lazyWorstFrame = seconds;
+        }
+        // (the lazily created objects bypass the journal; drop them again)
+        for (int i = 0; i < kObjectCount; ++i)
+        {
+            ReleaseMockObject (slots[i]);
+            slots[i] = NULL;
+        }
+
+        // Bulk, on the render thread
+        ++device.generation;
+        {
+            BenchClock::time_point start = BenchClock::now();
+            ok &= journal.Recreate (NULL) == 0;
+            bulkSeconds += BenchSecondsSince (start);
+        }
+        ok &= CheckSlots (slots, device.generation, -1);
+        journal.ReleaseObjects ();
+
+        // Bulk, on the workers while Unity does its own reset work
+        ++device.generation;
+        {
+            BenchClock::time_point start = BenchClock::now();
+            journal.BeginRecreate (&pool);
+            pooledBeginSeconds += BenchSecondsSince (start);
+            OtherResetWork (kResetWork);
+            start = BenchClock::now();
+            ok &= journal.EndRecreate () == 0;
+            pooledWaitSeconds += BenchSecondsSince (start);
+        }
+        ok &= CheckSlots (slots, device.generation, -1);
+    }
+
+    // A destroyed record stays gone, a failing recipe is reported and leaves
+    // its slot NULL, and everything else still comes back
+    {
+        const MockRecipe failing = { kMockView, kObjectCount, device.generation + 1 };
+        void* failingSlot = NULL;
+        const ResourceId failingId = journal.Create ("failing", CreateMockObject, &failing, sizeof(failing), &failingSlot);
+        ok &= failingId != kInvalidResourceId && failingSlot != NULL;
+        journal.ReleaseObjects ();
+
+        // Slot 0 is the first record created, so its id is 1
+        journal.Destroy (1);
+        ++device.generation;
+        ok &= journal.Recreate (&pool) == 1;
+        ok &= failingSlot == NULL && journal.Get (failingId) == NULL;
+        ok &= CheckSlots (slots, device.generation, 0);
+        ok &= journal.GetRecordCount () == kObjectCount && journal.GetLiveCount () == kObjectCount - 1;
+    }
+
+    journal.Clear ();
+    ok &= journal.GetRecordCount () == 0;
+    ok &= device.creates.load () == device.releases.load ();
+    const int workerCount = pool.GetWorkerCount ();
+    pool.Stop ();
+
+    const int lazyFramesPerReset = (int)(lazyFrames / kResets);
+    BenchReport ("lazy: frames with re-creation work", lazyFramesPerReset, "frames");
+    BenchReport ("lazy: worst frame", lazyWorstFrame * 1e6, "us");
+    BenchReport ("lazy: total", lazyTotal / kResets * 1e6, "us");
+    BenchReport ("bulk on render thread: hitch", bulkSeconds / kResets * 1e6, "us");
+    BenchReport ("bulk on workers: AfterReset", pooledBeginSeconds / kResets * 1e6, "us");
+    BenchReport ("bulk on workers: next render event", pooledWaitSeconds / kResets * 1e6, "us");
+    BenchReport ("worker threads", workerCount, "");
+    printf ("journal: %s\n", ok ? "ok" : "MISMATCH");
+    return ok ? 0 : 1;
+}
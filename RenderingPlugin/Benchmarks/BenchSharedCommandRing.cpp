@@ -0,0 +1,228 @@
+// Shared command ring (SharedCommandRing.h):
+//   - single thread: runs are contiguous, a full ring refuses a reservation
+//     rather than overwrite, freed slots come back after a wrap, and a
+//     reserved slot is not consumed before it is published,
+//   - stress: several producer threads write runs of one to three commands
+//     into a small ring while a consumer drains it; every run must come out
+//     whole and each producer's runs in order, with nothing lost,
+//   - consumer cost: executing a full ring of published commands in place.
+
+#include "BenchCommon.h"
+#include "../SharedCommandRing.h"
+
+#include <atomic>
+#include <string.h>
+#include <thread>
+#include <vector>
+
+static void WriteTagged (SharedCommand& cmd, int producer, int run, int member)
+{
+    cmd.type = member == 0 ? kSharedCommandSetColor : kSharedCommandClear;
+    cmd.texture = producer;
+    cmd.shape = member;
+    cmd.rect.x = run;
+    cmd.rect.y = producer;
+    cmd.rect.width = member;
+    cmd.rect.height = 0;
+}
+
+static bool CheckSingleThread ()
+{
+    bool ok = true;
+    SharedCommandRing ring;
+    ok &= ring.Create (5) && ring.GetCapacity () == 8;
+    SharedCommandRingHeader* header = ring.GetShared ();
+    ok &= header && header->magic == kSharedCommandRingMagic && header->commandSize == sizeof(SharedCommand);
+    ok &= ((uintptr_t)header % 64) == 0;
+
+    // Reserved but not published: nothing to consume
+    uint32_t first = 0;
+    ok &= ring.TryReserve (3, &first) && first == 0;
+    int consumed = 0;
+    ok &= ring.Consume ([&] (SharedCommand&) { ++consumed; }) == 0;
+    for (uint32_t i = 0; i < 3; ++i)
+    {
+        WriteTagged (ring.At (first + i), 1, 0, (int)i);
+        ring.Publish (first + i);
+    }
+
+    // 5 left; a run of 6 does not fit, 5 does, then the ring is full
+    ok &= !ring.TryReserve (6, &first);
+    ok &= ring.TryReserve (5, &first) && first == 3;
+    ok &= !ring.TryReserve (1, &first);
+    ok &= !ring.TryReserve (9, &first);
+    for (uint32_t i = 0; i < 5; ++i)
+    {
+        WriteTagged (ring.At (first + i), 2, 0, (int)i);
+        ring.Publish (first + i);
+    }
+
+    std::vector<int> producers;
+    ok &= ring.Consume ([&] (SharedCommand& cmd) { producers.push_back (cmd.texture); }) == 8;
+    ok &= producers.size() == 8 && producers[0] == 1 && producers[2] == 1 && producers[3] == 2 && producers[7] == 2;
+    ok &= header->consumed.load () == 8;
+
+    // Wrapped around
+    ok &= ring.TryReserve (8, &first) && first == 8;
+    for (uint32_t i = 0; i < 8; ++i)
+    {
+        WriteTagged (ring.At (first + i), 3, 0, (int)i);
+        ring.Publish (first + i);
+    }
+    ok &= ring.Consume ([&] (SharedCommand& cmd) { ok &= cmd.texture == 3; }) == 8;
+
+    // A producer view sees the same ring
+    SharedCommandRing view;
+    ok &= view.Attach (header) && view.GetCapacity () == 8;
+    ok &= view.TryReserve (2, &first) && first == 16;
+    for (uint32_t i = 0; i < 2; ++i)
+    {
+        WriteTagged (view.At (first + i), 4, 0, (int)i);
+        view.Publish (first + i);
+    }
+    ok &= ring.Consume ([&] (SharedCommand& cmd) { ok &= cmd.texture == 4; }) == 2;
+
+    int bogus = 0;
+    SharedCommandRing invalid;
+    ok &= !invalid.Attach (&bogus) && !invalid.Attach (NULL);
+    return ok;
+}
+
+static bool StressProducers (int producerCount, int runsPerProducer, uint32_t capacity, uint64_t* fullCount)
+{
+    SharedCommandRing ring;
+    if (!ring.Create (capacity))
+        return false;
+
+    std::atomic<int> finished (0);
+    std::atomic<uint64_t> full (0);
+    std::vector<std::thread> producers;
+    for (int p = 0; p < producerCount; ++p)
+    {
+        producers.push_back (std::thread ([&, p] ()
+        {
+            for (int run = 0; run < runsPerProducer; ++run)
+            {
+                const uint32_t length = 1 + (uint32_t)((run + p) % 3);
+                uint32_t first;
+                while (!ring.TryReserve (length, &first))
+                {
+                    full.fetch_add (1, std::memory_order_relaxed);
+                    std::this_thread::yield ();
+                }
+                // Publish back to front: the consumer must still wait for
+                // the whole run in order
+                for (uint32_t i = 0; i < length; ++i)
+                    WriteTagged (ring.At (first + i), p, run, (int)i);
+                for (uint32_t i = length; i-- > 0; )
+                    ring.Publish (first + i);
+            }
+            finished.fetch_add (1);
+        }));
+    }
+
+    // Consumer: a run is member 0, 1, ... of one producer's run, back to back
+    bool ok = true;
+    std::vector<int> nextRun (producerCount, 0);
+    uint64_t total = 0;
+    int openProducer = -1, openRun = -1, openMember = 0, openLength = 0;
+    for (;;)
+    {
+        const bool done = finished.load () == producerCount;
+        const uint32_t count = ring.Consume ([&] (SharedCommand& cmd)
+        {
+            const int p = cmd.texture;
+            const int run = cmd.rect.x;
+            const int member = cmd.rect.width;
+            if (p < 0 || p >= producerCount || cmd.rect.y != p || member != cmd.shape)
+            {
+                ok = false;
+                return;
+            }
+            if (openProducer < 0)
+            {
+                ok &= member == 0 && run == nextRun[p];
+                openProducer = p;
+                openRun = run;
+                openMember = 0;
+                openLength = 1 + (run + p) % 3;
+            }
+            else
+                ok &= p == openProducer && run == openRun && member == ++openMember;
+            ok &= (member == 0) == (cmd.type == kSharedCommandSetColor);
+            if (member == openLength - 1)
+            {
+                nextRun[p] = run + 1;
+                openProducer = -1;
+            }
+        });
+        total += count;
+        // Everything published before the producers finished is drained
+        if (done && count == 0)
+            break;
+        std::this_thread::yield ();
+    }
+    for (size_t i = 0; i < producers.size(); ++i)
+        producers[i].join ();
+
+    uint64_t expected = 0;
+    for (int p = 0; p < producerCount; ++p)
+    {
+        ok &= nextRun[p] == runsPerProducer;
+        for (int run = 0; run < runsPerProducer; ++run)
+            expected += 1 + (run + p) % 3;
+    }
+    ok &= total == expected && openProducer < 0;
+    *fullCount = full.load ();
+    return ok;
+}
+
+int main ()
+{
+    bool ok = CheckSingleThread ();
+
+    // Stress: a small ring so producers keep finding it full
+    const int kProducers = 4;
+    const int kRuns = 1000000;
+    uint64_t full = 0;
+    BenchClock::time_point start = BenchClock::now();
+    ok &= StressProducers (kProducers, kRuns, 256, &full);
+    const double stressSeconds = BenchSecondsSince (start);
+
+    // Consumer cost: publish a whole ring, then time executing it in place
+    const uint32_t kCapacity = 8192;
+    const int kRounds = 500;
+    SharedCommandRing ring;
+    ok &= ring.Create (kCapacity);
+    double consumeSeconds = 0.0;
+    uint64_t consumed = 0;
+    float sink = 0.0f;
+    for (int round = 0; round < kRounds; ++round)
+    {
+        uint32_t first;
+        if (!ring.TryReserve (kCapacity, &first))
+        {
+            ok = false;
+            break;
+        }
+        for (uint32_t i = 0; i < kCapacity; ++i)
+        {
+            SharedCommand& cmd = ring.At (first + i);
+            cmd.type = kSharedCommandClear;
+            cmd.texture = (int)(i & 15);
+            cmd.color[0] = (float)i;
+            ring.Publish (first + i);
+        }
+        start = BenchClock::now();
+        consumed += ring.Consume ([&] (SharedCommand& cmd) { sink += cmd.color[0] + (float)cmd.texture; });
+        consumeSeconds += BenchSecondsSince (start);
+    }
+    BenchDoNotOptimize (sink);
+    ok &= consumed == (uint64_t)kCapacity * kRounds;
+
+    BenchReport ("consume in place", consumeSeconds / (double)consumed * 1e9, "ns/cmd");
+    BenchReport ("stress, 4 producers, runs of 1-3", (double)kProducers * kRuns / stressSeconds * 1e-6, "Mruns/s");
+    BenchReport ("stress, producer found ring full", (double)full, "times");
+    printf ("shared command ring: %s\n", ok ? "ok" : "MISMATCH");
+    return ok ? 0 : 1;
+}
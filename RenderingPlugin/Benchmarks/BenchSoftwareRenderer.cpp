@@ -0,0 +1,105 @@
+// Throughput of the software backend in pixels per second: full-surface
+// clears, one large triangle, and many small ones, with the scalar and SSE2
+// rasterizer paths. Also checks that both paths produce identical images.
+
+#include "BenchCommon.h"
+#include "../SoftwareRenderer.h"
+#include "../ClearCommands.h"
+
+#include <string.h>
+#include <vector>
+
+static size_t SurfaceBytes (const CpuSurface& s) { return size_t(s.stride) * s.height; }
+
+// Deterministic pseudo-random triangles covering the surface
+static void MakeSmallTriangles (std::vector<RasterVertex>& verts, int count, int size)
+{
+    unsigned int seed = 12345;
+    verts.resize (count * 3);
+    for (int i = 0; i < count; ++i)
+    {
+        seed = seed * 1664525u + 1013904223u;
+        const float cx = float(seed % size);
+        seed = seed * 1664525u + 1013904223u;
+        const float cy = float(seed % size);
+        verts[i * 3 + 0].x = cx;         verts[i * 3 + 0].y = cy;         verts[i * 3 + 0].color = 0xFFff0000;
+        verts[i * 3 + 1].x = cx + 13.3f; verts[i * 3 + 1].y = cy + 2.7f;  verts[i * 3 + 1].color = 0xFF00ff00;
+        verts[i * 3 + 2].x = cx + 4.1f;  verts[i * 3 + 2].y = cy + 11.9f; verts[i * 3 + 2].color = 0xFF0000ff;
+    }
+}
+
+static double RasterizeAll (CpuSurface& target, const std::vector<RasterVertex>& verts, RasterPath path, int repeats, size_t& pixels)
+{
+    pixels = 0;
+    BenchClock::time_point start = BenchClock::now();
+    for (int r = 0; r < repeats; ++r)
+    {
+        for (size_t i = 0; i + 3 <= verts.size(); i += 3)
+            pixels += RasterizeTriangle (target, &verts[i], path);
+        BenchDoNotOptimize (target.pixels[0]);
+    }
+    return BenchSecondsSince (start);
+}
+
+int main ()
+{
+    const int kSize = 1024;
+    CpuSurface* scalarTarget = CreateCpuSurface (kSize, kSize);
+    CpuSurface* simdTarget = CreateCpuSurface (kSize, kSize);
+    bool identical = true;
+
+    // Clears
+    {
+        const float color[4] = { 1, 1, 0, 1 };
+        const int kRepeats = 200;
+        BenchClock::time_point start = BenchClock::now();
+        for (int r = 0; r < kRepeats; ++r)
+        {
+            ClearCpuSurface (*simdTarget, color, NULL);
+            BenchDoNotOptimize (simdTarget->pixels[0]);
+        }
+        const double seconds = BenchSecondsSince (start);
+        BenchReport ("clear 1024x1024", double(kRepeats) * kSize * kSize / seconds / 1e6, "Mpixels/s");
+
+        // Both paths start from the same image
+        ClearCpuSurface (*scalarTarget, color, NULL);
+    }
+
+    // One large triangle, the MyVertex triangle scaled up
+    {
+        std::vector<RasterVertex> verts (3);
+        verts[0].x = 0.25f * kSize; verts[0].y = 0.625f * kSize; verts[0].color = 0xFFff0000;
+        verts[1].x = 0.75f * kSize; verts[1].y = 0.625f * kSize; verts[1].color = 0xFF00ff00;
+        verts[2].x = 0.5f * kSize;  verts[2].y = 0.25f * kSize;  verts[2].color = 0xFF0000ff;
+
+        const int kRepeats = 200;
+        size_t pixels = 0;
+        double seconds = RasterizeAll (*scalarTarget, verts, kRasterPathScalar, kRepeats, pixels);
+        BenchReport ("large triangle, scalar", pixels / seconds / 1e6, "Mpixels/s");
+        seconds = RasterizeAll (*simdTarget, verts, kRasterPathSimd, kRepeats, pixels);
+        BenchReport ("large triangle, simd", pixels / seconds / 1e6, "Mpixels/s");
+        identical &= memcmp (scalarTarget->pixels, simdTarget->pixels, SurfaceBytes (*simdTarget)) == 0;
+    }
+
+    // Many small triangles: setup cost dominates
+    {
+        std::vector<RasterVertex> verts;
+        MakeSmallTriangles (verts, 20000, kSize - 16);
+
+        const int kRepeats = 20;
+        size_t pixels = 0;
+        double seconds = RasterizeAll (*scalarTarget, verts, kRasterPathScalar, kRepeats, pixels);
+        BenchReport ("small triangles, scalar", pixels / seconds / 1e6, "Mpixels/s");
+        BenchReport ("small triangles, scalar", double(kRepeats) * 20000 / seconds / 1e6, "Mtris/s");
+        seconds = RasterizeAll (*simdTarget, verts, kRasterPathSimd, kRepeats, pixels);
+        BenchReport ("small triangles, simd", pixels / seconds / 1e6, "Mpixels/s");
+        BenchReport ("small triangles, simd", double(kRepeats) * 20000 / seconds / 1e6, "Mtris/s");
+        identical &= memcmp (scalarTarget->pixels, simdTarget->pixels, SurfaceBytes (*simdTarget)) == 0;
+    }
+
+    BenchReport ("scalar and simd images identical", identical ? 1.0 : 0.0, "");
+
+    DestroyCpuSurface (scalarTarget);
+    DestroyCpuSurface (simdTarget);
+    return identical ? 0 : 1;
+}
@@ -0,0 +1,162 @@
+// Checks RenderStateCache / StateFilteredContext against a recording mock
+// of the immediate context: the calls that reach the mock must be exactly
+// the non-redundant ones, in order, and Invalidate must make the next call
+// to every slot go through again. Then measures a frame of draws that share
+// most of their state, with and without the filter.
+
+#include "BenchCommon.h"
+#include "../RenderStateCache.h"
+
+#include <string.h>
+#include <vector>
+
+struct MockObject { int id; };
+
+// Records every call that gets through, as (method, object) pairs
+struct RecordingContext
+{
+    struct Call
+    {
+        const char* method;
+        const void* object;
+    };
+    std::vector<Call> calls;
+
+    void Record (const char* method, const void* object)
+    {
+        Call call = { method, object };
+        calls.push_back (call);
+    }
+
+    void OMSetDepthStencilState (MockObject* state, unsigned int) { Record ("OMSetDepthStencilState", state); }
+    void RSSetState (MockObject* state) { Record ("RSSetState", state); }
+    void OMSetBlendState (MockObject* state, const float*, unsigned int) { Record ("OMSetBlendState", state); }
+    void VSSetShader (MockObject* shader, MockObject* const*, unsigned int) { Record ("VSSetShader", shader); }
+    void PSSetShader (MockObject* shader, MockObject* const*, unsigned int) { Record ("PSSetShader", shader); }
+    void VSSetConstantBuffers (unsigned int, unsigned int, MockObject* const* buffers) { Record ("VSSetConstantBuffers", buffers[0]); }
+    void IASetInputLayout (MockObject* layout) { Record ("IASetInputLayout", layout); }
+    void IASetPrimitiveTopology (int) { Record ("IASetPrimitiveTopology", NULL); }
+    void IASetVertexBuffers (unsigned int, unsigned int, MockObject* const* buffers, const unsigned int*, const unsigned int*) { Record ("IASetVertexBuffers", buffers[0]); }
+};
+
+struct MockState
+{
+    MockObject depth, raster, blend, vs, ps, cb, layout, vb, vb2;
+};
+
+// The state SetDefaultGraphicsState + DoRendering set for one draw
+template <typename Context>
+static void SetDrawState (Context& ctx, MockState& s, MockObject* vb, unsigned offset)
+{
+    const unsigned stride = 16;
+    ctx.OMSetDepthStencilState (&s.depth, 0);
+    ctx.RSSetState (&s.raster);
+    ctx.OMSetBlendState (&s.blend, NULL, 0xFFFFFFFF);
+    MockObject* cb = &s.cb;
+    ctx.VSSetConstantBuffers (0, 1, &cb);
+    ctx.VSSetShader (&s.vs);
+    ctx.PSSetShader (&s.ps);
+    ctx.IASetInputLayout (&s.layout);
+    ctx.IASetPrimitiveTopology (4);
+    ctx.IASetVertexBuffers (0, 1, &vb, &stride, &offset);
+}
+
+// Unfiltered calls, shaped like the wrapper's
+struct DirectContext
+{
+    RecordingContext* ctx;
+    void OMSetDepthStencilState (MockObject* s, unsigned int r) { ctx->OMSetDepthStencilState (s, r); }
+    void RSSetState (MockObject* s) { ctx->RSSetState (s); }
+    void OMSetBlendState (MockObject* s, const float* f, unsigned int m) { ctx->OMSetBlendState (s, f, m); }
+    void VSSetShader (MockObject* s) { ctx->VSSetShader (s, NULL, 0); }
+    void PSSetShader (MockObject* s) { ctx->PSSetShader (s, NULL, 0); }
+    void VSSetConstantBuffers (unsigned int a, unsigned int b, MockObject* const* c) { ctx->VSSetConstantBuffers (a, b, c); }
+    void IASetInputLayout (MockObject* l) { ctx->IASetInputLayout (l); }
+    void IASetPrimitiveTopology (int t) { ctx->IASetPrimitiveTopology (t); }
+    void IASetVertexBuffers (unsigned int a, unsigned int b, MockObject* const* c, const unsigned int* d, const unsigned int* e) { ctx->IASetVertexBuffers (a, b, c, d, e); }
+};
+
+static bool Expect (bool condition, const char* what)
+{
+    if (!condition)
+        printf ("FAILED: %s\n", what);
+    return condition;
+}
+
+int main ()
+{
+    MockState s;
+    RecordingContext mock;
+    RenderStateCache cache;
+    StateFilteredContext<RecordingContext> ctx (&mock, cache);
+    bool ok = true;
+
+    // A fresh cache issues everything
+    SetDrawState (ctx, s, &s.vb, 0);
+    ok &= Expect (mock.calls.size () == 9, "first draw issues all nine calls");
+    ok &= Expect (cache.GetIssuedCount () == 9 && cache.GetElidedCount () == 0, "counters after first draw");
+
+    // The same state again is entirely redundant
+    mock.calls.clear ();
+    SetDrawState (ctx, s, &s.vb, 0);
+    ok &= Expect (mock.calls.empty (), "identical draw issues nothing");
+    ok &= Expect (cache.GetElidedCount () == 9, "nine elided");
+
+    // Only what changed goes through: a different buffer, then an offset
+    mock.calls.clear ();
+    SetDrawState (ctx, s, &s.vb2, 0);
+    SetDrawState (ctx, s, &s.vb2, 64);
+    ok &= Expect (mock.calls.size () == 2 && !strcmp (mock.calls[0].method, "IASetVertexBuffers") && mock.calls[0].object == &s.vb2
+        && !strcmp (mock.calls[1].method, "IASetVertexBuffers"), "vertex buffer and offset changes issue one call each");
+
+    // Blend factors are not tracked: always issued, and the slot is forgotten
+    mock.calls.clear ();
+    const float factor[4] = { 1, 1, 1, 1 };
+    ctx.OMSetBlendState (&s.blend, factor, 0xFFFFFFFF);
+    ctx.OMSetBlendState (&s.blend, NULL, 0xFFFFFFFF);
+    ok &= Expect (mock.calls.size () == 2, "blend factor call passes through and forgets the slot");
+
+    // Unity may have touched the context: everything goes through again
+    mock.calls.clear ();
+    cache.Invalidate ();
+    SetDrawState (ctx, s, &s.vb2, 64);
+    ok &= Expect (mock.calls.size () == 9, "invalidate re-issues all nine calls");
+
+    // A frame of 256 draws sharing everything but every fourth vertex buffer
+    const int kDraws = 256;
+    const int kFrames = 20000;
+    mock.calls.reserve (kDraws * 9);
+    cache.ResetCounters ();
+
+    BenchClock::time_point start = BenchClock::now();
+    for (int f = 0; f < kFrames; ++f)
+    {
+        mock.calls.clear ();
+        cache.Invalidate ();
+        for (int d = 0; d < kDraws; ++d)
+            SetDrawState (ctx, s, (d & 4) ? &s.vb2 : &s.vb, 0);
+        BenchDoNotOptimize (mock.calls[0]);
+    }
+    const double filteredUs = BenchSecondsSince (start) * 1e6 / kFrames;
+    const double issuedPerFrame = double(cache.GetIssuedCount ()) / kFrames;
+    const double elidedPerFrame = double(cache.GetElidedCount ()) / kFrames;
+
+    DirectContext direct = { &mock };
+    start = BenchClock::now();
+    for (int f = 0; f < kFrames; ++f)
+    {
+        mock.calls.clear ();
+        for (int d = 0; d < kDraws; ++d)
+            SetDrawState (direct, s, (d & 4) ? &s.vb2 : &s.vb, 0);
+        BenchDoNotOptimize (mock.calls[0]);
+    }
+    const double directUs = BenchSecondsSince (start) * 1e6 / kFrames;
+
+    BenchReport ("256 draws unfiltered", directUs, "us/frame");
+    BenchReport ("256 draws filtered", filteredUs, "us/frame");
+    BenchReport ("state calls issued", issuedPerFrame, "per frame");
+    BenchReport ("state calls elided", elidedPerFrame, "per frame");
+
+    printf ("filtering matches the expected call stream: %s\n", ok ? "yes" : "NO");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,70 @@
+// Benchmarks the texture handle registry with a mock texture type, so the
+// slot map can be measured without a graphics device.
+
+#include "BenchCommon.h"
+#include "../TextureRegistry.h"
+
+#include <vector>
+
+struct MockTexture
+{
+    void* nativeTexture;
+    void* renderTargetView;
+};
+
+int main ()
+{
+    const int kTextures = 512;
+    const int kIterations = 20000;
+
+    TextureRegistry<MockTexture> registry;
+    std::vector<TextureHandle> handles (kTextures);
+
+    // Register / unregister churn
+    BenchClock::time_point start = BenchClock::now();
+    for (int it = 0; it < kIterations / 100; ++it)
+    {
+        for (int i = 0; i < kTextures; ++i)
+        {
+            MockTexture tex = { &handles[i], NULL };
+            handles[i] = registry.Register (tex);
+        }
+        for (int i = 0; i < kTextures; ++i)
+            registry.Unregister (handles[i]);
+    }
+    double seconds = BenchSecondsSince (start);
+    BenchReport ("register+unregister", seconds * 1e9 / (double(kIterations / 100) * kTextures), "ns/op");
+
+    for (int i = 0; i < kTextures; ++i)
+    {
+        MockTexture tex = { &handles[i], NULL };
+        handles[i] = registry.Register (tex);
+    }
+
+    // Lookup by handle, in submission order
+    size_t found = 0;
+    start = BenchClock::now();
+    for (int it = 0; it < kIterations; ++it)
+    {
+        for (int i = 0; i < kTextures; ++i)
+            found += registry.Lookup (handles[i]) != NULL;
+    }
+    seconds = BenchSecondsSince (start);
+    BenchDoNotOptimize (found);
+    BenchReport ("lookup", seconds * 1e9 / (double(kIterations) * kTextures), "ns/op");
+
+    // Dense walk over every registered texture, as the render event does
+    size_t sum = 0;
+    start = BenchClock::now();
+    for (int it = 0; it < kIterations; ++it)
+    {
+        for (int i = 0; i < registry.Count(); ++i)
+            sum += (size_t)registry.ValueAt (i).nativeTexture;
+        BenchDoNotOptimize (sum);
+    }
+    seconds = BenchSecondsSince (start);
+    BenchDoNotOptimize (sum);
+    BenchReport ("dense iteration", seconds * 1e9 / (double(kIterations) * kTextures), "ns/texture");
+
+    return found == size_t(kIterations) * kTextures ? 0 : 1;
+}
@@ -0,0 +1,131 @@
+// Cost of a trace zone on the thread that records it:
+//   - an empty loop body, for reference,
+//   - one TraceTimestampNow, which a zone reads twice (the TSC read is a
+//     few ns on bare metal and can cost a lot more under a hypervisor),
+//   - PLUGIN_TRACE_ZONE around the same body (two timestamps and a ring
+//     write), and what it costs beyond its two timestamps.
+// Then several threads record numbered zones while the main thread exports
+// concurrently; the written trace must be valid enough to count every
+// thread's name and the zones each ring still held.
+
+#include "BenchCommon.h"
+#include "../TraceZones.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+static int CountOccurrences (const std::string& text, const char* pattern)
+{
+    int count = 0;
+    const size_t length = strlen (pattern);
+    for (size_t at = text.find (pattern); at != std::string::npos; at = text.find (pattern, at + length))
+        ++count;
+    return count;
+}
+
+static std::string ReadFile (const char* path)
+{
+    std::string text;
+    if (FILE* file = fopen (path, "rb"))
+    {
+        char chunk[4096];
+        size_t read;
+        while ((read = fread (chunk, 1, sizeof(chunk), file)) > 0)
+            text.append (chunk, read);
+        fclose (file);
+    }
+    return text;
+}
+
+enum { kRecorderThreads = 3, kZonesPerRecorder = 50000 };
+
+int main ()
+{
+    const int kCalls = 10000000;
+    bool ok = true;
+
+    PLUGIN_TRACE_THREAD_NAME ("Bench main");
+    volatile int sink = 0;
+
+    BenchClock::time_point start = BenchClock::now();
+    for (int i = 0; i < kCalls; ++i)
+        sink = sink + 1;
+    const double emptySeconds = BenchSecondsSince (start);
+
+    uint64_t ticks = 0;
+    start = BenchClock::now();
+    for (int i = 0; i < kCalls; ++i)
+        ticks += TraceTimestampNow ();
+    const double timestampSeconds = BenchSecondsSince (start);
+    BenchDoNotOptimize (ticks);
+
+    start = BenchClock::now();
+    for (int i = 0; i < kCalls; ++i)
+    {
+        PLUGIN_TRACE_ZONE ("BenchZone");
+        sink = sink + 1;
+    }
+    const double zoneSeconds = BenchSecondsSince (start);
+
+    // Export while other threads keep recording
+    ClearTrace ();
+    const char* path = "BenchTraceZones.json";
+    std::vector<std::thread> recorders;
+    for (int t = 0; t < kRecorderThreads; ++t)
+    {
+        recorders.push_back (std::thread ([t]()
+        {
+            char name[kTraceThreadNameSize];
+            snprintf (name, sizeof(name), "Recorder %d", t);
+            PLUGIN_TRACE_THREAD_NAME (name);
+            for (int i = 0; i < kZonesPerRecorder; ++i)
+            {
+                PLUGIN_TRACE_ZONE ("RecorderOuter");
+                PLUGIN_TRACE_ZONE ("RecorderInner");
+            }
+        }));
+    }
+    const int concurrentZones = WriteChromeTrace (path);
+    for (size_t t = 0; t < recorders.size (); ++t)
+        recorders[t].join ();
+    ok &= concurrentZones >= 0;
+
+    // Once they are done every ring is full; the oldest slot of each is left
+    // out as the writer could have been overwriting it
+    start = BenchClock::now();
+    const int zones = WriteChromeTrace (path);
+    const double exportSeconds = BenchSecondsSince (start);
+    const std::string json = ReadFile (path);
+    remove (path);
+
+    #if RENDERINGPLUGIN_TRACE
+    ok &= zones == kRecorderThreads * (kTraceBufferCapacity - 1);
+    ok &= CountOccurrences (json, "\"ph\":\"X\"") == zones;
+    // Each ring holds an odd number of zones, so one of the pair may be cut off
+    const int outer = CountOccurrences (json, "\"name\":\"RecorderOuter\"");
+    const int inner = CountOccurrences (json, "\"name\":\"RecorderInner\"");
+    ok &= outer + inner == zones && abs (outer - inner) <= kRecorderThreads;
+    for (int t = 0; t < kRecorderThreads; ++t)
+    {
+        char name[64];
+        snprintf (name, sizeof(name), "\"name\":\"Recorder %d\"", t);
+        ok &= CountOccurrences (json, name) == 1;
+    }
+    ok &= CountOccurrences (json, "\"name\":\"Bench main\"") == 1;
+    #else
+    ok &= zones == 0 && CountOccurrences (json, "\"ph\":\"X\"") == 0;
+    #endif
+    ok &= json.size () > 2 && json.compare (0, 2, "{\"") == 0 && json.compare (json.size () - 4, 4, "\n]}\n") == 0;
+
+    BenchReport ("empty body", emptySeconds / kCalls * 1e9, "ns/call");
+    BenchReport ("timestamp", timestampSeconds / kCalls * 1e9, "ns/call");
+    BenchReport ("trace zone", (zoneSeconds - emptySeconds) / kCalls * 1e9, "ns/zone");
+    BenchReport ("trace zone beyond its timestamps", (zoneSeconds - emptySeconds - 2 * timestampSeconds) / kCalls * 1e9, "ns/zone");
+    BenchReport ("export", exportSeconds * 1e3, "ms");
+    BenchReport ("zones exported", (double)zones, "");
+    printf ("trace zones: %s\n", ok ? "ok" : "MISMATCH");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,127 @@
+// Runs TransientRingAllocator against a CPU-memory stand-in for a dynamic
+// buffer, with a simulated GPU that reads each frame's allocations a few
+// frames late. Every allocation is filled with a pattern; the "GPU" checks
+// the pattern is intact before retiring the frame, so any overlap between
+// live allocations shows up as corruption. When the ring is full the
+// producer waits for the oldest frame, like the D3D11 path does. Reports
+// allocation throughput and stalls for several GPU lags, including more
+// frames in flight than the allocator has fences.
+
+#include "BenchCommon.h"
+#include "../TransientRingAllocator.h"
+
+#include <deque>
+#include <string.h>
+#include <vector>
+
+struct LiveAllocation
+{
+    size_t offset;
+    size_t size;
+    unsigned char pattern;
+};
+
+struct LiveFrame
+{
+    uint64_t frame;
+    std::vector<LiveAllocation> allocations;
+};
+
+struct SimulatedGpu
+{
+    std::vector<unsigned char> memory;
+    std::deque<LiveFrame> pending;
+    bool corrupted;
+
+    // Reads the oldest frame's data and reports it done
+    void CompleteOldest (TransientRingAllocator& ring)
+    {
+        const LiveFrame& f = pending.front ();
+        for (size_t i = 0; i < f.allocations.size (); ++i)
+        {
+            const LiveAllocation& a = f.allocations[i];
+            for (size_t b = 0; b < a.size; b += 7)
+                corrupted |= memory[a.offset + b] != a.pattern;
+        }
+        ring.RetireFramesUpTo (f.frame);
+        pending.pop_front ();
+    }
+};
+
+static unsigned s_Random = 12345;
+static unsigned NextRandom ()
+{
+    s_Random = s_Random * 1664525u + 1013904223u;
+    return s_Random >> 8;
+}
+
+int main ()
+{
+    const size_t kCapacity = 256 * 1024;
+    const int kFrames = 20000;
+    const int kLags[] = { 1, 3, 12 };
+    bool ok = true;
+
+    for (int li = 0; li < 3; ++li)
+    {
+        const int lag = kLags[li];
+        TransientRingAllocator ring (kCapacity);
+        SimulatedGpu gpu;
+        gpu.memory.resize (kCapacity);
+        gpu.corrupted = false;
+        unsigned long long allocations = 0, stalls = 0, discards = 0;
+        int failures = 0;
+
+        BenchClock::time_point start = BenchClock::now();
+        for (int frame = 1; frame <= kFrames; ++frame)
+        {
+            while ((int)gpu.pending.size () >= lag)
+                gpu.CompleteOldest (ring);
+
+            LiveFrame live;
+            live.frame = frame;
+            const int count = 1 + NextRandom () % 48;
+            for (int i = 0; i < count; ++i)
+            {
+                const size_t size = 16 + NextRandom () % 4096;
+                const size_t alignment = (i & 1) ? 256 : 16;
+                TransientAllocation a;
+                bool allocated = ring.Allocate (size, alignment, &a);
+                while (!allocated && !gpu.pending.empty ())
+                {
+                    ++stalls;
+                    gpu.CompleteOldest (ring);
+                    allocated = ring.Allocate (size, alignment, &a);
+                }
+                if (!allocated || (a.offset & (alignment - 1)) != 0 || a.offset + a.size > kCapacity)
+                {
+                    ++failures;
+                    continue;
+                }
+                discards += a.firstInFrame;
+
+                const LiveAllocation la = { a.offset, a.size, (unsigned char)(frame * 31 + i) };
+                memset (&gpu.memory[a.offset], la.pattern, a.size);
+                live.allocations.push_back (la);
+                ++allocations;
+            }
+            ring.EndFrame (frame);
+            gpu.pending.push_back (live);
+        }
+        while (!gpu.pending.empty ())
+            gpu.CompleteOldest (ring);
+        const double seconds = BenchSecondsSince (start);
+
+        const bool pass = !gpu.corrupted && failures == 0 && ring.GetUsedBytes () == 0 && discards == (unsigned long long)kFrames;
+        ok &= pass;
+
+        char name[64];
+        snprintf (name, sizeof(name), "gpu lag %d: allocations", lag);
+        BenchReport (name, allocations / seconds / 1e6, "M/s (incl. fill)");
+        snprintf (name, sizeof(name), "gpu lag %d: stalls", lag);
+        BenchReport (name, (double)stalls, "waits");
+        printf ("gpu lag %d: %s\n", lag, pass ? "no overlap" : "CORRUPTED");
+    }
+
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,104 @@
+// Procedural texture upload at 512^2 and 2048^2: the original pattern
+// (new[] a buffer, fill, upload, delete[] every frame) against the
+// double-buffered UploadRing where the fill of frame N+1 runs on the worker
+// pool while frame N is uploaded. The "upload" is a row copy into a
+// CpuSurface, as in the plugin's software backend.
+//
+// That the plugin's own frames do not allocate is checked on the real
+// render events: HeadlessHost --check-allocations.
+
+#include "BenchCommon.h"
+#include "../PlasmaKernel.h"
+#include "../SoftwareRenderer.h"
+#include "../UploadRing.h"
+#include "../WorkerPool.h"
+
+#include <string.h>
+
+static void Upload (CpuSurface& surface, const unsigned char* data, int size)
+{
+    for (int y = 0; y < size; ++y)
+        memcpy (surface.pixels + (size_t)y * surface.stride, data + (size_t)y * size * 4, (size_t)size * 4);
+}
+
+// The ring steps of FinishProceduralFill, StartProceduralFill and
+// BeginProceduralUpload in RenderingPlugin.cpp, for one fixed-size texture
+struct RingFrame
+{
+    WorkerPool* pool;
+    UploadRing ring;
+    PlasmaTables tables;
+    PlasmaFillJob job;
+    bool pending;
+
+    void Run (CpuSurface& surface, int size, float t)
+    {
+        const size_t bytes = (size_t)size * 4 * size;
+        pool->Wait ();
+        if (pending)
+            ring.EndWrite (bytes);
+        pending = false;
+
+        if (unsigned char* next = ring.BeginWrite ())
+        {
+            BeginFillPlasmaParallel (*pool, job, tables, size, size, size * 4, next, t);
+            pending = true;
+        }
+        if (const unsigned char* ready = ring.BeginRead (NULL))
+        {
+            Upload (surface, ready, size);
+            ring.EndRead ();
+        }
+    }
+};
+
+int main ()
+{
+    const int kSizes[] = { 512, 2048 };
+
+    WorkerPool pool;
+    pool.Start (WorkerPool::GetDefaultWorkerCount (), true);
+
+    for (int si = 0; si < 2; ++si)
+    {
+        const int size = kSizes[si];
+        const int frames = size <= 512 ? 500 : 50;
+        const size_t bytes = (size_t)size * 4 * size;
+        CpuSurface* surface = CreateCpuSurface (size, size);
+        char name[64];
+
+        // Per-frame new[]/delete[], filled synchronously
+        PlasmaTables tables;
+        BenchClock::time_point start = BenchClock::now();
+        for (int f = 0; f < frames; ++f)
+        {
+            unsigned char* data = new unsigned char[bytes];
+            FillPlasmaParallel (pool, tables, size, size, size * 4, data, f * 0.25f);
+            Upload (*surface, data, size);
+            delete[] data;
+        }
+        double ms = BenchSecondsSince (start) * 1e3 / frames;
+        snprintf (name, sizeof(name), "%dx%d new/delete per frame", size, size);
+        BenchReport (name, ms, "ms/frame");
+
+        // Upload ring; the first frames size the ring and the tables
+        RingFrame ringFrame;
+        ringFrame.pool = &pool;
+        ringFrame.pending = false;
+        ringFrame.ring.Reserve (bytes, 2);
+        for (int f = 0; f < 3; ++f)
+            ringFrame.Run (*surface, size, f * 0.25f);
+
+        start = BenchClock::now();
+        for (int f = 0; f < frames; ++f)
+            ringFrame.Run (*surface, size, f * 0.25f);
+        pool.Wait ();
+        ms = BenchSecondsSince (start) * 1e3 / frames;
+        snprintf (name, sizeof(name), "%dx%d upload ring", size, size);
+        BenchReport (name, ms, "ms/frame");
+
+        DestroyCpuSurface (surface);
+    }
+
+    return 0;
+}
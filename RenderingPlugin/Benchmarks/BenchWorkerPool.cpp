@@ -0,0 +1,83 @@
+// Plasma fill of a 2048^2 and a 4096^2 texture on a WorkerPool with 1..N
+// threads (the calling thread counts as one), reporting time, speedup and
+// parallel efficiency against the single-threaded fill. Also measures the
+// cost of dispatching an empty job, and checks every thread count produces
+// the same image as FillPlasma.
+
+#include "BenchCommon.h"
+#include "../PlasmaKernel.h"
+#include "../WorkerPool.h"
+
+#include <string.h>
+#include <thread>
+#include <vector>
+
+static void EmptyTask (int, void*)
+{
+}
+
+int main ()
+{
+    const int kSizes[] = { 2048, 4096 };
+    const float t = 37.25f * 4.0f;
+    int maxThreads = (int)std::thread::hardware_concurrency ();
+    if (maxThreads < 1)
+        maxThreads = 1;
+    bool identical = true;
+
+    printf ("kernel: %s, hardware threads: %d\n", GetPlasmaKernelName (kPlasmaKernelAuto), maxThreads);
+
+    for (int si = 0; si < 2; ++si)
+    {
+        const int size = kSizes[si];
+        const int stride = size * 4;
+        const int repeats = size <= 2048 ? 10 : 3;
+        std::vector<unsigned char> expected (size_t(stride) * size);
+        std::vector<unsigned char> image (expected.size());
+        PlasmaTables tables;
+        FillPlasma (tables, size, size, stride, &expected[0], t);
+
+        double singleMs = 0.0;
+        // 1, 2, 4, ... and always the full thread count last
+        for (int threads = 1; threads <= maxThreads; threads = threads < maxThreads && threads * 2 > maxThreads ? maxThreads : threads * 2)
+        {
+            WorkerPool pool;
+            pool.Start (threads - 1, true);
+
+            FillPlasmaParallel (pool, tables, size, size, stride, &image[0], t);
+            if (memcmp (&image[0], &expected[0], image.size()) != 0)
+                identical = false;
+
+            BenchClock::time_point start = BenchClock::now();
+            for (int r = 0; r < repeats; ++r)
+            {
+                FillPlasmaParallel (pool, tables, size, size, stride, &image[0], t);
+                BenchDoNotOptimize (image[0]);
+            }
+            const double ms = BenchSecondsSince (start) * 1e3 / repeats;
+            if (threads == 1)
+                singleMs = ms;
+
+            char name[64];
+            snprintf (name, sizeof(name), "%dx%d %d threads", size, size, threads);
+            BenchReport (name, ms, "ms");
+            snprintf (name, sizeof(name), "%dx%d %d threads speedup", size, size, threads);
+            BenchReport (name, singleMs / ms, "x");
+            snprintf (name, sizeof(name), "%dx%d %d threads efficiency", size, size, threads);
+            BenchReport (name, 100.0 * singleMs / (ms * threads), "%");
+        }
+    }
+
+    {
+        WorkerPool pool;
+        pool.Start (WorkerPool::GetDefaultWorkerCount (), true);
+        const int repeats = 20000;
+        BenchClock::time_point start = BenchClock::now();
+        for (int r = 0; r < repeats; ++r)
+            pool.ParallelFor (pool.GetWorkerCount () + 1, EmptyTask, NULL);
+        BenchReport ("empty job dispatch", BenchSecondsSince (start) * 1e6 / repeats, "us");
+    }
+
+    printf ("matches single-threaded fill: %s\n", identical ? "yes" : "NO");
+    return identical ? 0 : 1;
+}
@@ -0,0 +1,232 @@
+#include "BlobLoader.h"
+#include "TraceZones.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#if defined(_WIN32)
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+enum { kPrefaultStride = 4096 };
+
+
+// --------------------------------------------------------------------------
+// FileBlob
+
+FileBlob::FileBlob ()
+    : m_Data (NULL)
+    , m_Size (0)
+    , m_Mapped (false)
+    , m_MappingHandle (NULL)
+{
+}
+
+FileBlob::~FileBlob ()
+{
+    Close ();
+}
+
+// Fallback for files that cannot be mapped: one read into a heap block
+static bool ReadWholeFile (const char* path, unsigned char** data, size_t* size)
+{
+    FILE* fp = fopen (path, "rb");
+    if (!fp)
+        return false;
+    fseek (fp, 0, SEEK_END);
+    const long length = ftell (fp);
+    fseek (fp, 0, SEEK_SET);
+    bool ok = length >= 0;
+    unsigned char* buffer = NULL;
+    if (ok && length > 0)
+    {
+        buffer = (unsigned char*)malloc (length);
+        ok = buffer && fread (buffer, length, 1, fp) == 1;
+    }
+    fclose (fp);
+    if (!ok)
+    {
+        free (buffer);
+        return false;
+    }
+    *data = buffer;
+    *size = (size_t)length;
+    return true;
+}
+
+bool FileBlob::Open (const char* path)
+{
+    Close ();
+
+    #if defined(_WIN32)
+    HANDLE file = CreateFileA (path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+        return false;
+    LARGE_INTEGER length;
+    if (GetFileSizeEx (file, &length) && length.QuadPart > 0)
+    {
+        HANDLE mapping = CreateFileMappingA (file, NULL, PAGE_READONLY, 0, 0, NULL);
+        const void* view = mapping ? MapViewOfFile (mapping, FILE_MAP_READ, 0, 0, 0) : NULL;
+        if (view)
+        {
+            CloseHandle (file);
+            m_Data = (const unsigned char*)view;
+            m_Size = (size_t)length.QuadPart;
+            m_Mapped = true;
+            m_MappingHandle = mapping;
+            return true;
+        }
+        if (mapping)
+            CloseHandle (mapping);
+    }
+    CloseHandle (file);
+    #else
+    const int fd = open (path, O_RDONLY);
+    if (fd < 0)
+        return false;
+    struct stat st;
+    if (fstat (fd, &st) == 0 && st.st_size > 0)
+    {
+        void* view = mmap (NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (view != MAP_FAILED)
+        {
+            // The mapping stays valid after the descriptor is closed
+            close (fd);
+            madvise (view, (size_t)st.st_size, MADV_WILLNEED);
+            m_Data = (const unsigned char*)view;
+            m_Size = (size_t)st.st_size;
+            m_Mapped = true;
+            return true;
+        }
+    }
+    close (fd);
+    #endif
+
+    unsigned char* data = NULL;
+    size_t size = 0;
+    if (!ReadWholeFile (path, &data, &size))
+        return false;
+    m_Data = data;
+    m_Size = size;
+    return true;
+}
+
+void FileBlob::Close ()
+{
+    if (m_Mapped)
+    {
+        #if defined(_WIN32)
+        UnmapViewOfFile (m_Data);
+        CloseHandle ((HANDLE)m_MappingHandle);
+        #else
+        munmap ((void*)m_Data, m_Size);
+        #endif
+    }
+    else
+        free ((void*)m_Data);
+    m_Data = NULL;
+    m_Size = 0;
+    m_Mapped = false;
+    m_MappingHandle = NULL;
+}
+
+unsigned FileBlob::Prefault () const
+{
+    unsigned sum = 0;
+    for (size_t i = 0; i < m_Size; i += kPrefaultStride)
+        sum += ((const volatile unsigned char*)m_Data)[i];
+    if (m_Size)
+        sum += m_Data[m_Size - 1];
+    return sum;
+}
+
+
+// --------------------------------------------------------------------------
+// BlobLoader
+
+BlobLoader::BlobLoader ()
+    : m_Count (0)
+    , m_Remaining (0)
+{
+    for (int i = 0; i < kMaxBlobs; ++i)
+    {
+        m_Names[i] = NULL;
+        m_States[i].store (kBlobPending, std::memory_order_relaxed);
+    }
+}
+
+BlobLoader::~BlobLoader ()
+{
+    Reset ();
+}
+
+void BlobLoader::Begin (const std::string& directory, const char* const* names, int count)
+{
+    Reset ();
+    if (count > kMaxBlobs)
+        count = kMaxBlobs;
+    if (count <= 0)
+        return;
+
+    m_Directory = directory;
+    for (int i = 0; i < count; ++i)
+    {
+        m_Names[i] = names[i];
+        m_States[i].store (kBlobPending, std::memory_order_relaxed);
+    }
+    m_Count = count;
+    m_Remaining.store (count, std::memory_order_release);
+    m_Thread = std::thread (&BlobLoader::LoadAll, this);
+}
+
+void BlobLoader::LoadAll ()
+{
+    PLUGIN_TRACE_THREAD_NAME ("Blob loader");
+    for (int i = 0; i < m_Count; ++i)
+    {
+        PLUGIN_TRACE_ZONE ("LoadShaderBlob");
+        const std::string path = m_Directory + "/" + m_Names[i];
+        const bool ok = m_Blobs[i].Open (path.c_str ());
+        if (ok)
+            m_Blobs[i].Prefault ();
+        m_States[i].store (ok ? kBlobReady : kBlobFailed, std::memory_order_release);
+        m_Remaining.fetch_sub (1, std::memory_order_acq_rel);
+    }
+}
+
+const FileBlob* BlobLoader::TryGet (int index) const
+{
+    if (index < 0 || index >= m_Count)
+        return NULL;
+    return m_States[index].load (std::memory_order_acquire) == kBlobReady ? &m_Blobs[index] : NULL;
+}
+
+bool BlobLoader::IsDone () const
+{
+    return m_Remaining.load (std::memory_order_acquire) == 0;
+}
+
+bool BlobLoader::HasFailed (int index) const
+{
+    return index >= 0 && index < m_Count && m_States[index].load (std::memory_order_acquire) == kBlobFailed;
+}
+
+void BlobLoader::Wait ()
+{
+    if (m_Thread.joinable ())
+        m_Thread.join ();
+}
+
+void BlobLoader::Reset ()
+{
+    Wait ();
+    for (int i = 0; i < m_Count; ++i)
+        m_Blobs[i].Close ();
+    m_Count = 0;
+    m_Remaining.store (0, std::memory_order_release);
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <atomic>
+#include <stddef.h>
+#include <string>
+#include <thread>
+
+// --------------------------------------------------------------------------
+// Blob loading
+//
+// Shader bytecode and other assets the plugin reads from StreamingAssets.
+// FileBlob maps a file read-only (mmap on POSIX, a file mapping on Windows)
+// instead of copying it into a heap buffer; files that cannot be mapped
+// (empty ones, or filesystems without mmap) are read into memory instead.
+//
+// BlobLoader opens a set of blobs on a background thread as soon as the
+// directory is known and touches their pages, so by the time the render
+// thread needs them the bytes are resident. The render thread polls with
+// TryGet and never blocks on the disk.
+
+class FileBlob
+{
+public:
+    FileBlob ();
+    ~FileBlob ();
+
+    // Replaces the current contents. Returns false when the file cannot be
+    // opened or read.
+    bool Open (const char* path);
+    void Close ();
+
+    const unsigned char* GetData () const { return m_Data; }
+    size_t GetSize () const { return m_Size; }
+    bool IsMapped () const { return m_Mapped; }
+
+    // Reads one byte per page so later accesses do not fault. Returns a
+    // value depending on every touched byte, for the benefit of benchmarks.
+    unsigned Prefault () const;
+
+private:
+    FileBlob (const FileBlob&);
+    FileBlob& operator= (const FileBlob&);
+
+    const unsigned char* m_Data;
+    size_t m_Size;
+    bool m_Mapped;
+    void* m_MappingHandle;  // Windows only
+};
+
+
+class BlobLoader
+{
+public:
+    enum { kMaxBlobs = 16 };
+
+    BlobLoader ();
+    ~BlobLoader ();
+
+    // Starts loading directory + "/" + names[i] for every i in [0, count)
+    // on a background thread. Whatever was loaded before is closed first,
+    // so no other thread may be reading blobs during Begin. names must
+    // stay valid until the load is done.
+    void Begin (const std::string& directory, const char* const* names, int count);
+
+    // Blob index once it is loaded, NULL while it is still loading, when
+    // it failed to load, or when no load was started.
+    const FileBlob* TryGet (int index) const;
+    bool IsStarted () const { return m_Count > 0; }
+    bool IsDone () const;
+    bool HasFailed (int index) const;
+    const char* GetName (int index) const { return m_Names[index]; }
+
+    // Blocks until the background load finished.
+    void Wait ();
+    // Waits, then closes every blob.
+    void Reset ();
+
+private:
+    enum BlobState
+    {
+        kBlobPending,
+        kBlobReady,
+        kBlobFailed,
+    };
+
+    void LoadAll ();
+
+    std::thread m_Thread;
+    std::string m_Directory;
+    const char* m_Names[kMaxBlobs];
+    int m_Count;
+    FileBlob m_Blobs[kMaxBlobs];
+    std::atomic<int> m_States[kMaxBlobs];
+    std::atomic<int> m_Remaining;
+};
@@ -0,0 +1,124 @@
+#include "ClearCommands.h"
+
+#include <algorithm>
+
+
+ClearCommandBuffer::ClearCommandBuffer (int capacity)
+    : m_Count (0)
+    , m_Sequence (0)
+{
+    m_Commands.resize (capacity);
+}
+
+bool ClearCommandBuffer::Push (const ClearCommandDesc& desc)
+{
+    if (m_Count >= (int)m_Commands.size())
+        return false;
+
+    ClearCommand& cmd = m_Commands[m_Count++];
+    cmd.desc = desc;
+    cmd.sequence = m_Sequence++;
+    return true;
+}
+
+bool ClearCommandBuffer::Push (TextureHandle texture, const float color[4], const ClearRect* rect)
+{
+    ClearCommandDesc desc;
+    desc.texture = texture;
+    for (int i = 0; i < 4; ++i)
+        desc.color[i] = color[i];
+    if (rect)
+        desc.rect = *rect;
+    else
+        desc.rect.x = desc.rect.y = desc.rect.width = desc.rect.height = 0;
+    return Push (desc);
+}
+
+static bool CommandLess (const ClearCommand& a, const ClearCommand& b)
+{
+    if (a.desc.texture != b.desc.texture)
+        return a.desc.texture < b.desc.texture;
+    return a.sequence < b.sequence;
+}
+
+int ClearCommandBuffer::Prepare ()
+{
+    if (m_Count == 0)
+        return 0;
+
+    ClearCommand* cmds = &m_Commands[0];
+    std::sort (cmds, cmds + m_Count, CommandLess);
+
+    // For each texture keep only what follows its last full clear; anything
+    // before it would be overwritten anyway.
+    int out = 0;
+    int groupBegin = 0;
+    while (groupBegin < m_Count)
+    {
+        const TextureHandle texture = cmds[groupBegin].desc.texture;
+        int groupEnd = groupBegin + 1;
+        while (groupEnd < m_Count && cmds[groupEnd].desc.texture == texture)
+            ++groupEnd;
+
+        int keepFrom = groupBegin;
+        for (int i = groupEnd - 1; i >= groupBegin; --i)
+        {
+            if (IsFullClear (cmds[i].desc))
+            {
+                keepFrom = i;
+                break;
+            }
+        }
+
+        for (int i = keepFrom; i < groupEnd; ++i)
+            cmds[out++] = cmds[i];
+        groupBegin = groupEnd;
+    }
+
+    m_Count = out;
+    return m_Count;
+}
+
+
+void ClearCpuSurface (CpuSurface& surface, const float color[4], const ClearRect* rect)
+{
+    int x0 = 0, y0 = 0, x1 = surface.width, y1 = surface.height;
+    if (rect && rect->width > 0 && rect->height > 0)
+    {
+        x0 = std::max (rect->x, 0);
+        y0 = std::max (rect->y, 0);
+        x1 = std::min (rect->x + rect->width, surface.width);
+        y1 = std::min (rect->y + rect->height, surface.height);
+    }
+    if (x0 >= x1 || y0 >= y1)
+        return;
+
+    const unsigned int packed = PackColorRGBA8 (color);
+    for (int y = y0; y < y1; ++y)
+    {
+        unsigned int* row = reinterpret_cast<unsigned int*>(surface.pixels + y * surface.stride) + x0;
+        std::fill (row, row + (x1 - x0), packed);
+    }
+}
+
+int ExecuteClearCommandsCPU (const ClearCommand* commands, int count, CpuSurfaceResolver resolve, void* userData)
+{
+    int executed = 0;
+    CpuSurface* surface = NULL;
+    TextureHandle current = kInvalidTextureHandle;
+    for (int i = 0; i < count; ++i)
+    {
+        const ClearCommandDesc& desc = commands[i].desc;
+        // Commands are sorted by texture, so resolve once per run.
+        if (desc.texture != current || i == 0)
+        {
+            current = desc.texture;
+            surface = resolve (current, userData);
+        }
+        if (!surface)
+            continue;
+        ClearCpuSurface (*surface, desc.color, &desc.rect);
+        ++executed;
+    }
+    return executed;
+}
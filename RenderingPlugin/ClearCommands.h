@@ -0,0 +1,75 @@
+#pragma once
+
+#include "TextureRegistry.h"
+#include "CpuSurface.h"
+
+#include <vector>
+
+// --------------------------------------------------------------------------
+// Clear command buffer
+//
+// Scripts queue any number of clears for the frame (texture handle, colour,
+// optional rect); one render event then drains the whole buffer. Before
+// execution the commands are sorted by texture, keeping submission order
+// within a texture, and everything that a later full-texture clear of the
+// same texture would overwrite is dropped.
+
+// Sub-rectangle in pixels; width or height <= 0 means the whole texture.
+struct ClearRect
+{
+    int x, y, width, height;
+};
+
+// Blittable layout shared with scripts (see QueueClearTextures).
+struct ClearCommandDesc
+{
+    TextureHandle texture;
+    float color[4];
+    ClearRect rect;
+};
+
+struct ClearCommand
+{
+    ClearCommandDesc desc;
+    unsigned int sequence; // submission order, keeps the sort stable
+};
+
+static inline bool IsFullClear (const ClearCommandDesc& desc)
+{
+    return desc.rect.width <= 0 || desc.rect.height <= 0;
+}
+
+enum { kMaxClearCommands = 4096 };
+
+
+class ClearCommandBuffer
+{
+public:
+    explicit ClearCommandBuffer (int capacity = kMaxClearCommands);
+
+    // Returns false (and drops the command) when the buffer is full.
+    bool Push (const ClearCommandDesc& desc);
+    bool Push (TextureHandle texture, const float color[4], const ClearRect* rect = NULL);
+
+    // Sorts and deduplicates in place; returns the number of commands left.
+    int Prepare ();
+
+    int Count () const { return m_Count; }
+    const ClearCommand* Commands () const { return m_Count ? &m_Commands[0] : NULL; }
+    void Reset () { m_Count = 0; m_Sequence = 0; }
+
+private:
+    std::vector<ClearCommand> m_Commands;
+    int m_Count;
+    unsigned int m_Sequence;
+};
+
+
+// CPU executor: resolves each handle to a surface and clears it (or the
+// rect clipped against it). Commands whose handle does not resolve are
+// skipped. Returns the number of clears performed.
+typedef CpuSurface* (*CpuSurfaceResolver)(TextureHandle texture, void* userData);
+
+int ExecuteClearCommandsCPU (const ClearCommand* commands, int count, CpuSurfaceResolver resolve, void* userData);
+
+void ClearCpuSurface (CpuSurface& surface, const float color[4], const ClearRect* rect);
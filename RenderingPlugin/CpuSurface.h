@@ -0,0 +1,28 @@
+#pragma once
+
+// --------------------------------------------------------------------------
+// CpuSurface
+//
+// A CPU-resident RGBA8 image (byte 0 = R, matching DXGI_FORMAT_R8G8B8A8_UNORM).
+// Used by the CPU reference paths and the benchmarks; the surface does not
+// own its pixels.
+
+struct CpuSurface
+{
+    int width;
+    int height;
+    int stride;             // bytes per row
+    unsigned char* pixels;
+};
+
+// Packs a float RGBA colour into the 32 bit layout of a CpuSurface pixel.
+static inline unsigned int PackColorRGBA8 (const float color[4])
+{
+    unsigned int packed = 0;
+    for (int i = 0; i < 4; ++i)
+    {
+        float c = color[i] < 0.0f ? 0.0f : (color[i] > 1.0f ? 1.0f : color[i]);
+        packed |= (unsigned int)(c * 255.0f + 0.5f) << (i * 8);
+    }
+    return packed;
+}
@@ -0,0 +1,31 @@
+#include "FrameArena.h"
+
+#include <stdint.h>
+
+FrameArena::FrameArena (size_t capacity)
+    : m_Memory (capacity)
+    , m_Used (0)
+    , m_HighWater (0)
+{
+}
+
+void* FrameArena::Allocate (size_t size, size_t alignment)
+{
+    if (m_Memory.empty())
+        return NULL;
+    if (alignment == 0)
+        alignment = 1;
+
+    // Align the address, not the offset: the block itself is only as
+    // aligned as the heap made it
+    const uintptr_t base = (uintptr_t)&m_Memory[0];
+    const uintptr_t start = (base + m_Used + alignment - 1) & ~(uintptr_t)(alignment - 1);
+    const size_t offset = (size_t)(start - base);
+    if (offset > m_Memory.size() || size > m_Memory.size() - offset)
+        return NULL;
+
+    m_Used = offset + size;
+    if (m_Used > m_HighWater)
+        m_HighWater = m_Used;
+    return &m_Memory[0] + offset;
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <stddef.h>
+#include <vector>
+
+// --------------------------------------------------------------------------
+// Frame arena
+//
+// Linear allocator for data that lives until the end of the frame: each
+// allocation bumps a pointer into one block reserved up front, and Reset
+// releases everything at once. There is no per-allocation free and no
+// allocation from the heap after construction; when the block is full,
+// Allocate fails rather than grow.
+
+class FrameArena
+{
+public:
+    explicit FrameArena (size_t capacity);
+
+    // alignment is a power of two. Returns NULL when the rest of the block
+    // is too small.
+    void* Allocate (size_t size, size_t alignment);
+
+    template <typename T>
+    T* Copy (const T* src, size_t count)
+    {
+        T* dst = static_cast<T*>(Allocate (sizeof(T) * count, alignof(T)));
+        for (size_t i = 0; dst && i < count; ++i)
+            dst[i] = src[i];
+        return dst;
+    }
+
+    // Releases every allocation; pointers handed out before are invalid.
+    void Reset () { m_Used = 0; }
+
+    size_t GetCapacity () const { return m_Memory.size(); }
+    size_t GetUsedBytes () const { return m_Used; }
+    size_t GetHighWaterBytes () const { return m_HighWater; }   // most used since construction
+
+private:
+    std::vector<unsigned char> m_Memory;
+    size_t m_Used;
+    size_t m_HighWater;
+};
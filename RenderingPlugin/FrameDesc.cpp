@@ -0,0 +1,26 @@
+#include "FrameDesc.h"
+
+#include <stddef.h>
+
+int CountFrameDescCommands (const FrameDesc& desc)
+{
+    if (desc.size != sizeof(FrameDesc))
+        return -1;
+    if (desc.clearCount < 0 || desc.drawCount < 0 || desc.instanceCount < 0)
+        return -1;
+    if ((desc.clearCount > 0 && !desc.clears) || (desc.drawCount > 0 && !desc.draws) || (desc.instanceCount > 0 && !desc.instances))
+        return -1;
+
+    int64_t commands = (desc.fields & kFrameDescTime) ? 1 : 0;
+    commands += desc.clearCount;
+    for (int i = 0; i < desc.drawCount; ++i)
+    {
+        const FrameDrawDesc& draw = desc.draws[i];
+        if (draw.shape < 0 || draw.shape >= kInstanceShapeCount)
+            return -1;
+        if (draw.firstInstance < 0 || draw.instanceCount < 0 || draw.instanceCount > desc.instanceCount - draw.firstInstance)
+            return -1;
+        commands += draw.instanceCount;
+    }
+    return commands <= 0x7fffffff ? (int)commands : -1;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "ClearCommands.h"
+#include "InstanceBatch.h"
+
+#include <stdint.h>
+
+// --------------------------------------------------------------------------
+// Frame descriptor
+//
+// Everything a script sends for one frame, in one blittable struct handed
+// to SubmitFrame: the time, the frame's clears (texture handle, colour,
+// optional rect) and its instanced draws, as spans into arrays the script
+// owns. One call replaces SetTimeFromUnity plus a QueueClearTexture or
+// QueueDrawInstances call per item, and the plugin publishes the resulting
+// commands to the render thread in batches instead of one at a time. The
+// arrays are only read during the call.
+
+enum FrameDescFields
+{
+    kFrameDescTime = 1 << 0,        // time replaces the one from SetTimeFromUnity
+};
+
+// A run of instances drawn with one shape into one texture
+struct FrameDrawDesc
+{
+    TextureHandle texture;
+    int shape;                      // InstanceShape
+    int firstInstance;              // into FrameDesc::instances
+    int instanceCount;
+};
+
+// Blittable layout shared with scripts (see UseRenderingPlugin.cs).
+struct FrameDesc
+{
+    uint32_t size;                  // sizeof(FrameDesc); anything else is rejected
+    uint32_t fields;                // FrameDescFields that are set
+    float time;
+    int clearCount;
+    int drawCount;
+    int instanceCount;              // length of instances, which draws index
+    const ClearCommandDesc* clears;
+    const FrameDrawDesc* draws;
+    const DrawInstance* instances;
+};
+
+// Number of plugin commands desc turns into, or -1 when it is malformed
+// (size, negative counts, NULL spans, shapes or instance ranges out of
+// bounds). Nothing is queued for a malformed desc.
+int CountFrameDescCommands (const FrameDesc& desc);
@@ -0,0 +1,184 @@
+#include "GpuTimerRing.h"
+
+#include <string.h>
+
+static_assert (sizeof(GpuTimings) % sizeof(uint32_t) == 0, "GpuTimingsMailbox copies GpuTimings in 32-bit words");
+
+const char* GetGpuTimerPassName (GpuTimerPass pass)
+{
+    switch (pass)
+    {
+    case kGpuPassUpload: return "Upload";
+    case kGpuPassClear: return "Clear";
+    case kGpuPassInstances: return "Instances";
+    case kGpuPassTriangle: return "Triangle";
+    default: return "Unknown";
+    }
+}
+
+// Query indices within a slot
+enum
+{
+    kFrameBeginQuery = 0,
+    kFrameEndQuery = 1,
+    kFirstPassQuery = 2,
+};
+
+static float TicksToMs (uint64_t begin, uint64_t end, uint64_t frequency)
+{
+    return end > begin ? (float)((double)(end - begin) * 1000.0 / (double)frequency) : 0.0f;
+}
+
+
+// --------------------------------------------------------------------------
+// GpuTimerRing
+
+GpuTimerRing::GpuTimerRing ()
+    : m_Timed (0)
+    , m_Skipped (0)
+    , m_Disjoint (0)
+{
+    memset (&m_Latest, 0, sizeof(m_Latest));
+    Reset ();
+}
+
+void GpuTimerRing::Reset ()
+{
+    memset (m_Slots, 0, sizeof(m_Slots));
+    m_Oldest = 0;
+    m_InFlight = 0;
+    m_Recording = false;
+    m_OpenPass = -1;
+}
+
+bool GpuTimerRing::BeginFrame (const GpuQuerySource& source, uint64_t frame)
+{
+    Collect (source);
+    m_Recording = false;
+    m_OpenPass = -1;
+    if (m_InFlight == kGpuTimerFrames)
+    {
+        // The GPU is further behind than the ring is deep; waiting for it
+        // would be the stall this is here to avoid
+        ++m_Skipped;
+        return false;
+    }
+
+    const int slot = (m_Oldest + m_InFlight) % kGpuTimerFrames;
+    m_Slots[slot].frame = frame;
+    m_Slots[slot].queryMask = 1u << kFrameBeginQuery;
+    m_Slots[slot].passMask = 0;
+    source.beginFrame (source.userData, slot);
+    source.timestamp (source.userData, slot, kFrameBeginQuery);
+    m_Recording = true;
+    return true;
+}
+
+void GpuTimerRing::BeginPass (const GpuQuerySource& source, GpuTimerPass pass)
+{
+    if (!m_Recording || (int)pass < 0 || pass >= kGpuPassCount)
+        return;
+    const int slot = (m_Oldest + m_InFlight) % kGpuTimerFrames;
+    source.timestamp (source.userData, slot, kFirstPassQuery + 2 * pass);
+    m_Slots[slot].queryMask |= 1u << (kFirstPassQuery + 2 * pass);
+    m_OpenPass = pass;
+}
+
+void GpuTimerRing::EndPass (const GpuQuerySource& source, GpuTimerPass pass)
+{
+    if (!m_Recording || m_OpenPass != pass)
+        return;
+    const int slot = (m_Oldest + m_InFlight) % kGpuTimerFrames;
+    source.timestamp (source.userData, slot, kFirstPassQuery + 2 * pass + 1);
+    m_Slots[slot].queryMask |= 1u << (kFirstPassQuery + 2 * pass + 1);
+    m_Slots[slot].passMask |= 1u << pass;
+    m_OpenPass = -1;
+}
+
+void GpuTimerRing::EndFrame (const GpuQuerySource& source)
+{
+    if (!m_Recording)
+        return;
+    const int slot = (m_Oldest + m_InFlight) % kGpuTimerFrames;
+    source.timestamp (source.userData, slot, kFrameEndQuery);
+    m_Slots[slot].queryMask |= 1u << kFrameEndQuery;
+    source.endFrame (source.userData, slot);
+    ++m_InFlight;
+    m_Recording = false;
+    m_OpenPass = -1;
+}
+
+int GpuTimerRing::Collect (const GpuQuerySource& source)
+{
+    int collected = 0;
+    while (m_InFlight > 0)
+    {
+        GpuQueryResults results;
+        if (!source.readFrame (source.userData, m_Oldest, m_Slots[m_Oldest].queryMask, &results))
+            break;
+        const Slot& slot = m_Slots[m_Oldest];
+        const int framesBehind = m_InFlight - 1;
+        m_Oldest = (m_Oldest + 1) % kGpuTimerFrames;
+        --m_InFlight;
+        ++collected;
+
+        if (results.disjoint || results.frequency == 0)
+        {
+            ++m_Disjoint;
+            continue;
+        }
+        GpuTimings& timings = m_Latest;
+        timings.frame = slot.frame;
+        timings.passMask = slot.passMask;
+        timings.framesBehind = (uint32_t)framesBehind;
+        timings.frameMs = TicksToMs (results.ticks[kFrameBeginQuery], results.ticks[kFrameEndQuery], results.frequency);
+        for (int pass = 0; pass < kGpuPassCount; ++pass)
+        {
+            const int query = kFirstPassQuery + 2 * pass;
+            timings.passMs[pass] = (slot.passMask & (1u << pass)) ? TicksToMs (results.ticks[query], results.ticks[query + 1], results.frequency) : 0.0f;
+        }
+        ++m_Timed;
+    }
+    return collected;
+}
+
+
+// --------------------------------------------------------------------------
+// GpuTimingsMailbox
+
+GpuTimingsMailbox::GpuTimingsMailbox ()
+    : m_Sequence (0)
+{
+    for (size_t i = 0; i < sizeof(m_Words) / sizeof(m_Words[0]); ++i)
+        m_Words[i].store (0, std::memory_order_relaxed);
+}
+
+void GpuTimingsMailbox::Publish (const GpuTimings& timings)
+{
+    uint32_t words[sizeof(GpuTimings) / sizeof(uint32_t)];
+    memcpy (words, &timings, sizeof(words));
+
+    const uint32_t sequence = m_Sequence.load (std::memory_order_relaxed);
+    m_Sequence.store (sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence (std::memory_order_release);
+    for (size_t i = 0; i < sizeof(words) / sizeof(words[0]); ++i)
+        m_Words[i].store (words[i], std::memory_order_relaxed);
+    m_Sequence.store (sequence + 2, std::memory_order_release);
+}
+
+void GpuTimingsMailbox::Read (GpuTimings* out) const
+{
+    uint32_t words[sizeof(GpuTimings) / sizeof(uint32_t)];
+    for (;;)
+    {
+        const uint32_t before = m_Sequence.load (std::memory_order_acquire);
+        if (before & 1)
+            continue;
+        for (size_t i = 0; i < sizeof(words) / sizeof(words[0]); ++i)
+            words[i] = m_Words[i].load (std::memory_order_relaxed);
+        std::atomic_thread_fence (std::memory_order_acquire);
+        if (m_Sequence.load (std::memory_order_relaxed) == before)
+            break;
+    }
+    memcpy (out, words, sizeof(*out));
+}
@@ -0,0 +1,136 @@
+#pragma once
+
+#include <atomic>
+#include <stdint.h>
+
+// --------------------------------------------------------------------------
+// GPU timer ring
+//
+// GPU time of the plugin's passes, from timestamp queries bracketed by a
+// disjoint query (D3D11_QUERY_TIMESTAMP_DISJOINT / TIMESTAMP). Each frame
+// uses the queries of one slot in a small ring, and a slot is read back
+// only once the GPU has finished with it, a few frames later: reading never
+// waits, and when every slot is still in flight the frame is simply not
+// timed. Frames the driver reports as disjoint (clock changed mid-frame)
+// are dropped.
+//
+// The ring only schedules: which slot and query a timestamp goes into, and
+// when a slot can be read. The queries themselves are issued through a
+// GpuQuerySource, so the same code runs against D3D11 and against a
+// simulated GPU (see BenchGpuTimerRing). It does not allocate.
+
+enum GpuTimerPass
+{
+    kGpuPassUpload,         // procedural texture upload
+    kGpuPassClear,          // queued clears
+    kGpuPassInstances,      // instanced overlays
+    kGpuPassTriangle,       // the triangle draw
+    kGpuPassCount
+};
+
+const char* GetGpuTimerPassName (GpuTimerPass pass);
+
+enum
+{
+    kGpuTimerFrames = 4,                            // slots; results arrive up to this many frames late
+    kGpuTimestampsPerFrame = 2 + 2 * kGpuPassCount, // frame begin and end, then begin and end per pass
+};
+
+// What a slot's queries returned
+struct GpuQueryResults
+{
+    uint64_t frequency;     // ticks per second
+    bool disjoint;
+    uint64_t ticks[kGpuTimestampsPerFrame];
+};
+
+// The graphics API side. Timestamps of a slot are written in between
+// beginFrame and endFrame; readFrame must not wait, and returns false while
+// any of the slot's queries is not available yet. It only reads the
+// timestamps in queryMask (bit per query index): passes that did not run
+// issued none.
+struct GpuQuerySource
+{
+    void* userData;
+    void (*beginFrame) (void* userData, int slot);
+    void (*timestamp) (void* userData, int slot, int query);
+    void (*endFrame) (void* userData, int slot);
+    bool (*readFrame) (void* userData, int slot, uint32_t queryMask, GpuQueryResults* out);
+};
+
+// Timings of one frame, in a fixed layout scripts can read
+// (GetGpuTimings). Passes that did not run in the frame read 0.
+struct GpuTimings
+{
+    uint64_t frame;                     // frame number given to BeginFrame; 0 when there is none yet
+    uint32_t passMask;                  // bit per GpuTimerPass that ran
+    uint32_t framesBehind;              // frames issued since this one, when it was read back
+    float frameMs;                      // first to last plugin command of the frame
+    float passMs[kGpuPassCount];
+};
+
+class GpuTimerRing
+{
+public:
+    GpuTimerRing ();
+
+    // Forgets every slot in flight (device lost or reset).
+    void Reset ();
+
+    // Reads back every finished slot, then starts timing frame in the next
+    // one unless it is still in flight. Returns whether this frame is timed.
+    // Each pass is timed at most once per frame, and passes do not nest.
+    bool BeginFrame (const GpuQuerySource& source, uint64_t frame);
+    void BeginPass (const GpuQuerySource& source, GpuTimerPass pass);
+    void EndPass (const GpuQuerySource& source, GpuTimerPass pass);
+    void EndFrame (const GpuQuerySource& source);
+
+    // Reads back finished slots, oldest first; returns how many were read.
+    int Collect (const GpuQuerySource& source);
+
+    // Latest frame read back
+    const GpuTimings& GetLatest () const { return m_Latest; }
+
+    uint64_t GetTimedCount () const { return m_Timed; }
+    uint64_t GetSkippedCount () const { return m_Skipped; }      // every slot in flight
+    uint64_t GetDisjointCount () const { return m_Disjoint; }
+    int GetFramesInFlight () const { return m_InFlight; }
+
+private:
+    struct Slot
+    {
+        uint64_t frame;
+        uint32_t queryMask;     // timestamps written
+        uint32_t passMask;      // passes with both timestamps written
+    };
+
+    Slot m_Slots[kGpuTimerFrames];
+    int m_Oldest;               // oldest slot in flight
+    int m_InFlight;
+    bool m_Recording;           // between a timed BeginFrame and its EndFrame
+    int m_OpenPass;             // -1 outside a pass
+
+    GpuTimings m_Latest;
+    uint64_t m_Timed, m_Skipped, m_Disjoint;
+};
+
+
+// --------------------------------------------------------------------------
+// GpuTimingsMailbox
+//
+// Hands the latest GpuTimings from the render thread to any reader thread
+// without a lock: a sequence counter that is odd while the writer copies,
+// and readers retry when it changed under them.
+
+class GpuTimingsMailbox
+{
+public:
+    GpuTimingsMailbox ();
+
+    void Publish (const GpuTimings& timings);   // one writer
+    void Read (GpuTimings* out) const;
+
+private:
+    std::atomic<uint32_t> m_Sequence;
+    std::atomic<uint32_t> m_Words[sizeof(GpuTimings) / sizeof(uint32_t)];
+};
@@ -0,0 +1,49 @@
+#include "AllocationCounter.h"
+
+#include <atomic>
+#include <new>
+#include <stdlib.h>
+
+static std::atomic<bool> s_Enabled (false);
+static std::atomic<unsigned> s_Allocations (0);
+static thread_local int t_HostAllocationDepth = 0;
+
+void AllocationCounter::SetEnabled (bool enabled)
+{
+    s_Enabled.store (enabled, std::memory_order_relaxed);
+}
+
+unsigned AllocationCounter::GetCount ()
+{
+    return s_Allocations.load (std::memory_order_relaxed);
+}
+
+HostAllocationScope::HostAllocationScope () { ++t_HostAllocationDepth; }
+HostAllocationScope::~HostAllocationScope () { --t_HostAllocationDepth; }
+
+static void CountAllocation ()
+{
+    if (s_Enabled.load (std::memory_order_relaxed) && t_HostAllocationDepth == 0)
+        s_Allocations.fetch_add (1, std::memory_order_relaxed);
+}
+
+void* operator new (size_t size)
+{
+    CountAllocation ();
+    if (void* p = malloc (size ? size : 1))
+        return p;
+    throw std::bad_alloc ();
+}
+
+void* operator new (size_t size, const std::nothrow_t&) noexcept
+{
+    CountAllocation ();
+    return malloc (size ? size : 1);
+}
+
+void* operator new[] (size_t size) { return operator new (size); }
+void* operator new[] (size_t size, const std::nothrow_t& tag) noexcept { return operator new (size, tag); }
+void operator delete (void* p) noexcept { free (p); }
+void operator delete (void* p, const std::nothrow_t&) noexcept { free (p); }
+void operator delete[] (void* p) noexcept { free (p); }
+void operator delete[] (void* p, const std::nothrow_t&) noexcept { free (p); }
@@ -0,0 +1,25 @@
+#pragma once
+
+// --------------------------------------------------------------------------
+// AllocationCounter
+//
+// Counts C++ heap allocations for --check-allocations. Global operator new
+// is replaced for the whole process; the plugin is a shared object, so its
+// allocations and its workers' come through here too (on Windows the DLL
+// keeps its own operator new and only the host's would be seen). Memory
+// taken with malloc or mmap is not counted.
+
+namespace AllocationCounter
+{
+    // Counting is off until enabled
+    void SetEnabled (bool enabled);
+    unsigned GetCount ();
+}
+
+// Leaves the allocations the calling thread makes for the host itself out
+// of the count while it exists.
+struct HostAllocationScope
+{
+    HostAllocationScope ();
+    ~HostAllocationScope ();
+};
@@ -0,0 +1,551 @@
+// Headless host for RenderingPlugin.
+//
+// Loads the plugin through a mock IUnityInterfaces, feeds it the calls
+// UseRenderingPlugin.cs makes and issues the render event in a tight frame
+// loop. With the null device the plugin renders into software textures, the
+// first of which stands in for the render target. Prints the per-frame cost,
+// the time to the first frame, the plugin's counters (GetPluginStats) and a
+// checksum of the final image, so runs without a GPU can be compared.
+//
+//   --frames N           frames to run (1000)
+//   --textures N         textures to create (16)
+//   --size N             texture width and height (256)
+//   --clears N           clears queued per frame (64)
+//   --procedural         give the generated image a texture of its own; prints its checksum
+//   --threaded           issue the events from a separate render thread
+//   --split-events       separate fill, upload, clear and draw events; same image
+//   --event-data         time and first clear as the event's data; same image
+//   --submit-frame       one SubmitFrame call instead of the setters
+//   --shared-ring        write the frame into the shared command ring instead
+//   --instances N        instanced quads per frame (0)
+//   --workers N          restart the worker pool with N threads; with --procedural, fail
+//                        unless every frame's fill is still running when its event returns
+//   --check-allocations  fail if a frame after warm-up makes a C++ allocation (operator new)
+//   --shader-dir DIR     load shaders from DIR, standing in for StreamingAssets
+//   --trace FILE         write the trace zones (WritePluginTrace) to FILE
+//   --verbose            print the plugin's log
+//
+// Usage: HeadlessHost [--frames N] [--textures N] [--size N] [--clears N] [--procedural] [--threaded] [--split-events] [--event-data] [--submit-frame] [--shared-ring] [--instances N] [--workers N] [--check-allocations] [--shader-dir DIR] [--trace FILE] [--verbose]
+
+#include "AllocationCounter.h"
+#include "MockUnityInterfaces.h"
+#include "PluginExports.h"
+#include "../GpuTimerRing.h"
+#include "../FrameDesc.h"
+#include "../PluginStats.h"
+#include "../RenderEventData.h"
+#include "../SharedCommandRing.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <deque>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+#include <vector>
+
+typedef std::chrono::high_resolution_clock HostClock;
+
+static bool s_Verbose = false;
+
+static void UNITY_INTERFACE_API HostLog (const char* str) { if (s_Verbose) printf ("[plugin] %s", str); }
+static void UNITY_INTERFACE_API HostWarn (const char* str) { printf ("[plugin warning] %s", str); }
+static void UNITY_INTERFACE_API HostError (const char* str) { fprintf (stderr, "[plugin error] %s", str); }
+
+// FNV-1a over a software texture, to compare output between runs
+static unsigned int ChecksumTexture (int handle, int size)
+{
+    unsigned int checksum = 2166136261u;
+    const unsigned char* pixels = static_cast<const unsigned char*>(GetSoftwareTexturePixels (handle));
+    const int stride = GetSoftwareTextureStride (handle);
+    for (int y = 0; pixels && y < size; ++y)
+    {
+        for (int x = 0; x < size * 4; ++x)
+            checksum = (checksum ^ pixels[y * stride + x]) * 16777619u;
+    }
+    return checksum;
+}
+
+// The first frames size the plugin's arrays, rings and tables
+// (--check-allocations)
+enum { kAllocationWarmupFrames = 4 };
+
+
+// --------------------------------------------------------------------------
+// Render thread: Unity runs plugin events on its render thread while script
+// code keeps running on the main thread. With --threaded the host does the
+// same, handing event IDs and their data over through a small queue.
+
+class HostRenderThread
+{
+public:
+    HostRenderThread (UnityRenderingEvent renderEvent, UnityRenderingEventAndData renderEventAndData)
+        : m_RenderEvent (renderEvent)
+        , m_RenderEventAndData (renderEventAndData)
+        , m_Pending (0)
+        , m_Quit (false)
+        , m_Thread (&HostRenderThread::Run, this)
+    {
+    }
+
+    ~HostRenderThread ()
+    {
+        {
+            std::lock_guard<std::mutex> lock (m_Mutex);
+            m_Quit = true;
+        }
+        m_Wake.notify_one ();
+        m_Thread.join ();
+    }
+
+    // data must stay valid until the event has run (WaitIdle)
+    void IssuePluginEvent (int eventID, void* data = NULL)
+    {
+        {
+            HostAllocationScope hostAllocations;
+            std::lock_guard<std::mutex> lock (m_Mutex);
+            const Event event = { eventID, data };
+            m_Events.push_back (event);
+            ++m_Pending;
+        }
+        m_Wake.notify_one ();
+    }
+
+    void WaitIdle ()
+    {
+        std::unique_lock<std::mutex> lock (m_Mutex);
+        m_Idle.wait (lock, [this] { return m_Pending == 0; });
+    }
+
+private:
+    void Run ()
+    {
+        std::unique_lock<std::mutex> lock (m_Mutex);
+        for (;;)
+        {
+            m_Wake.wait (lock, [this] { return m_Quit || !m_Events.empty(); });
+            if (m_Events.empty())
+                return;
+            const Event event = m_Events.front();
+            m_Events.pop_front ();
+
+            lock.unlock ();
+            if (event.data)
+                m_RenderEventAndData (event.id, event.data);
+            else
+                m_RenderEvent (event.id);
+            lock.lock ();
+
+            if (--m_Pending == 0)
+                m_Idle.notify_all ();
+        }
+    }
+
+    struct Event
+    {
+        int id;
+        void* data;
+    };
+
+    UnityRenderingEvent m_RenderEvent;
+    UnityRenderingEventAndData m_RenderEventAndData;
+    std::mutex m_Mutex;
+    std::condition_variable m_Wake;
+    std::condition_variable m_Idle;
+    std::deque<Event> m_Events;
+    int m_Pending;
+    bool m_Quit;
+    std::thread m_Thread;
+};
+
+
+// --------------------------------------------------------------------------
+
+struct HostOptions
+{
+    int frames;
+    int textures;
+    int size;
+    int clearsPerFrame;
+    int instancesPerFrame;
+    int workers;
+    bool procedural;
+    bool threaded;
+    bool splitEvents;
+    bool eventData;
+    bool submitFrame;
+    bool sharedRing;
+    bool checkAllocations;
+    const char* shaderDir;
+    const char* tracePath;
+};
+
+static bool ParseOptions (int argc, char** argv, HostOptions& options)
+{
+    options.frames = 1000;
+    options.textures = 16;
+    options.size = 256;
+    options.clearsPerFrame = 64;
+    options.instancesPerFrame = 0;
+    options.workers = -1;
+    options.procedural = false;
+    options.threaded = false;
+    options.splitEvents = false;
+    options.eventData = false;
+    options.submitFrame = false;
+    options.sharedRing = false;
+    options.checkAllocations = false;
+    options.shaderDir = NULL;
+    options.tracePath = NULL;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const char* arg = argv[i];
+        const bool hasValue = i + 1 < argc;
+        if (!strcmp (arg, "--frames") && hasValue)
+            options.frames = atoi (argv[++i]);
+        else if (!strcmp (arg, "--textures") && hasValue)
+            options.textures = atoi (argv[++i]);
+        else if (!strcmp (arg, "--size") && hasValue)
+            options.size = atoi (argv[++i]);
+        else if (!strcmp (arg, "--clears") && hasValue)
+            options.clearsPerFrame = atoi (argv[++i]);
+        else if (!strcmp (arg, "--instances") && hasValue)
+            options.instancesPerFrame = atoi (argv[++i]);
+        else if (!strcmp (arg, "--workers") && hasValue)
+            options.workers = atoi (argv[++i]);
+        else if (!strcmp (arg, "--procedural"))
+            options.procedural = true;
+        else if (!strcmp (arg, "--threaded"))
+            options.threaded = true;
+        else if (!strcmp (arg, "--split-events"))
+            options.splitEvents = true;
+        else if (!strcmp (arg, "--event-data"))
+            options.eventData = true;
+        else if (!strcmp (arg, "--submit-frame"))
+            options.submitFrame = true;
+        else if (!strcmp (arg, "--shared-ring"))
+            options.sharedRing = true;
+        else if (!strcmp (arg, "--check-allocations"))
+            options.checkAllocations = true;
+        else if (!strcmp (arg, "--shader-dir") && hasValue)
+            options.shaderDir = argv[++i];
+        else if (!strcmp (arg, "--trace") && hasValue)
+            options.tracePath = argv[++i];
+        else if (!strcmp (arg, "--verbose"))
+            s_Verbose = true;
+        else
+        {
+            fprintf (stderr, "Usage: %s [--frames N] [--textures N] [--size N] [--clears N] [--procedural] [--threaded] [--split-events] [--event-data] [--submit-frame] [--shared-ring] [--instances N] [--workers N] [--check-allocations] [--shader-dir DIR] [--trace FILE] [--verbose]\n", argv[0]);
+            return false;
+        }
+    }
+    return options.frames > 0 && options.textures > 0 && options.size > 0 && options.clearsPerFrame >= 0 && options.instancesPerFrame >= 0;
+}
+
+// --shared-ring: the frame's commands go straight into ring slots. Each
+// clear is a SetColor + Clear run reserved in one go, so no other producer
+// can slip a colour in between.
+static bool WriteFrameToSharedRing (SharedCommandRing& ring, const float* time, const std::vector<ClearCommandDesc>& clears, int drawTexture, const std::vector<DrawInstance>& instances)
+{
+    uint32_t first;
+    if (time)
+    {
+        if (!ring.TryReserve (1, &first))
+            return false;
+        SharedCommand& cmd = ring.At (first);
+        cmd.type = kSharedCommandSetTime;
+        cmd.time = *time;
+        ring.Publish (first);
+    }
+    for (size_t i = 0; i < clears.size(); ++i)
+    {
+        if (!ring.TryReserve (2, &first))
+            return false;
+        SharedCommand& color = ring.At (first);
+        color.type = kSharedCommandSetColor;
+        memcpy (color.color, clears[i].color, sizeof(color.color));
+        SharedCommand& clear = ring.At (first + 1);
+        clear.type = kSharedCommandClear;
+        clear.texture = clears[i].texture;
+        clear.rect = clears[i].rect;
+        ring.Publish (first);
+        ring.Publish (first + 1);
+    }
+    if (!instances.empty() && !ring.TryReserve ((uint32_t)instances.size(), &first))
+        return false;
+    for (size_t i = 0; i < instances.size(); ++i)
+    {
+        SharedCommand& cmd = ring.At (first + (uint32_t)i);
+        cmd.type = kSharedCommandDrawInstance;
+        cmd.texture = drawTexture;
+        cmd.shape = kInstanceShapeQuad;
+        cmd.instance = instances[i];
+        ring.Publish (first + (uint32_t)i);
+    }
+    return true;
+}
+
+int main (int argc, char** argv)
+{
+    HostOptions options;
+    if (!ParseOptions (argc, argv, options))
+        return 1;
+
+    // Plugin load, as Unity does it
+    const HostClock::time_point loadStart = HostClock::now();
+    LinkDebug (HostLog, HostWarn, HostError);
+    MockUnity::SetRenderer (kUnityGfxRendererNull);
+    UnityPluginLoad (MockUnity::GetInterfaces());
+    if (options.workers >= 0)
+        SetWorkerThreadCount (options.workers);
+    if (options.shaderDir)
+        SetShaderOverrideFromDisk (1);
+    SetUnityStreamingAssetsPath (options.shaderDir ? options.shaderDir : ".");
+
+    std::vector<int> handles (options.textures);
+    for (int i = 0; i < options.textures; ++i)
+    {
+        handles[i] = CreateSoftwareTexture (options.size, options.size);
+        if (!handles[i])
+        {
+            fprintf (stderr, "Failed to create texture %d\n", i);
+            return 1;
+        }
+    }
+    SetSoftwareRenderTarget (handles[0]);
+    int proceduralHandle = 0;
+    if (options.procedural)
+    {
+        proceduralHandle = CreateSoftwareTexture (options.size, options.size);
+        if (!proceduralHandle)
+        {
+            fprintf (stderr, "Failed to create the procedural texture\n");
+            return 1;
+        }
+        SetProceduralTextureFromUnity (proceduralHandle);
+    }
+
+    UnityRenderingEvent renderEvent = GetRenderEventFunc ();
+    UnityRenderingEventAndData renderEventAndData = GetRenderEventAndDataFunc ();
+    HostRenderThread* renderThread = options.threaded ? new HostRenderThread (renderEvent, renderEventAndData) : NULL;
+
+    static const int kFrameEvents[] = { kPluginEventFrame };
+    static const int kSplitEvents[] = { kPluginEventFillTexture, kPluginEventUpload, kPluginEventClear, kPluginEventDraw };
+    const int* frameEvents = options.splitEvents ? kSplitEvents : kFrameEvents;
+    const int frameEventCount = options.splitEvents ? 4 : 1;
+
+    std::vector<ClearCommandDesc> clearDescs;
+    clearDescs.reserve (options.clearsPerFrame);
+    std::vector<DrawInstance> instances (options.instancesPerFrame);
+    double setupSeconds = 0.0;
+
+    SharedCommandRing sharedRing;
+    if (options.sharedRing && !sharedRing.Attach (GetSharedCommandRing ()))
+    {
+        fprintf (stderr, "The plugin has no shared command ring\n");
+        return 1;
+    }
+
+    std::vector<double> frameMicros (options.frames);
+    int firstAllocatingFrame = -1;
+    double firstFrameMicros = -1.0;
+    const HostClock::time_point runStart = HostClock::now();
+
+    for (int frame = 0; frame < options.frames; ++frame)
+    {
+        const HostClock::time_point frameStart = HostClock::now();
+        const unsigned allocationsBefore = AllocationCounter::GetCount ();
+        if (options.checkAllocations && frame == kAllocationWarmupFrames)
+            AllocationCounter::SetEnabled (true);
+
+        // With --event-data the time and clear 0 ride on the frame's first
+        // event. Clear 0 goes to the first texture, whose later clears are
+        // the same colour, so the order it lands in does not matter.
+        RenderEventData data;
+        memset (&data, 0, sizeof(data));
+        int firstQueuedClear = 0;
+        if (options.eventData)
+        {
+            data.size = sizeof(data);
+            data.fields = kRenderEventDataTime;
+            data.time = frame / 60.0f;
+            if (options.clearsPerFrame > 0)
+            {
+                const float color[4] = { 1, 1, 0, 1 };
+                data.fields |= kRenderEventDataClear;
+                data.texture = handles[0];
+                memcpy (data.color, color, sizeof(color));
+                firstQueuedClear = 1;
+            }
+        }
+
+        // Instanced quads in a ring around the center, turning with time
+        for (int i = 0; i < options.instancesPerFrame; ++i)
+        {
+            const float angle = frame / 60.0f + i * 6.2831853f / options.instancesPerFrame;
+            const DrawInstance instance = { { 0.1f, 0.0f, 0.7f * cosf (angle), 0.0f, 0.1f, 0.7f * sinf (angle) }, 0.5f, 0xff000000u | (unsigned)(i * 2654435761u >> 8) };
+            instances[i] = instance;
+        }
+
+        // Parameters, through setters or in one FrameDesc
+        clearDescs.clear ();
+        for (int i = firstQueuedClear; i < options.clearsPerFrame; ++i)
+        {
+            const ClearCommandDesc desc = { handles[i % options.textures], { 1, 1, (i & 1) ? 1.0f : 0.0f, 1 }, { 0, 0, 0, 0 } };
+            clearDescs.push_back (desc);
+        }
+        const HostClock::time_point setupStart = HostClock::now();
+        if (options.submitFrame)
+        {
+            const FrameDrawDesc draw = { handles[0], kInstanceShapeQuad, 0, options.instancesPerFrame };
+            FrameDesc desc;
+            desc.size = sizeof(desc);
+            desc.fields = options.eventData ? 0 : kFrameDescTime;
+            desc.time = frame / 60.0f;
+            desc.clearCount = (int)clearDescs.size();
+            desc.drawCount = options.instancesPerFrame > 0 ? 1 : 0;
+            desc.instanceCount = options.instancesPerFrame;
+            desc.clears = clearDescs.empty() ? NULL : &clearDescs[0];
+            desc.draws = &draw;
+            desc.instances = instances.empty() ? NULL : &instances[0];
+            SubmitFrame (&desc);
+        }
+        else if (options.sharedRing)
+        {
+            const float time = frame / 60.0f;
+            if (!WriteFrameToSharedRing (sharedRing, options.eventData ? NULL : &time, clearDescs, handles[0], instances))
+            {
+                fprintf (stderr, "Frame %d does not fit in the shared command ring\n", frame);
+                return 1;
+            }
+        }
+        else
+        {
+            if (!options.eventData)
+                SetTimeFromUnity (frame / 60.0f);
+            for (size_t i = 0; i < clearDescs.size(); ++i)
+                QueueClearTexture (clearDescs[i].texture, clearDescs[i].color[0], clearDescs[i].color[1], clearDescs[i].color[2], clearDescs[i].color[3]);
+            if (options.instancesPerFrame > 0)
+                QueueDrawInstances (handles[0], kInstanceShapeQuad, &instances[0], options.instancesPerFrame);
+        }
+        setupSeconds += std::chrono::duration<double>(HostClock::now() - setupStart).count();
+
+        for (int i = 0; i < frameEventCount; ++i)
+        {
+            void* eventData = (options.eventData && i == 0) ? &data : NULL;
+            if (renderThread)
+                renderThread->IssuePluginEvent (frameEvents[i], eventData);
+            else if (eventData)
+                renderEventAndData (frameEvents[i], eventData);
+            else
+                renderEvent (frameEvents[i]);
+        }
+        if (renderThread)
+            renderThread->WaitIdle ();
+        FlushPluginLogs ();
+        if (firstAllocatingFrame < 0 && AllocationCounter::GetCount () != allocationsBefore)
+            firstAllocatingFrame = frame;
+
+        frameMicros[frame] = std::chrono::duration<double, std::micro>(HostClock::now() - frameStart).count();
+
+        // The render target starts out black; the first frame the plugin
+        // rendered leaves the triangle (or a clear) in its center.
+        if (firstFrameMicros < 0.0)
+        {
+            const unsigned char* pixels = static_cast<const unsigned char*>(GetSoftwareTexturePixels (handles[0]));
+            const unsigned char* center = pixels + (options.size / 2) * GetSoftwareTextureStride (handles[0]) + (options.size / 2) * 4;
+            if (center[0] | center[1] | center[2] | center[3])
+                firstFrameMicros = std::chrono::duration<double, std::micro>(HostClock::now() - loadStart).count();
+        }
+    }
+
+    const double totalSeconds = std::chrono::duration<double>(HostClock::now() - runStart).count();
+    AllocationCounter::SetEnabled (false);
+    delete renderThread;
+
+    const unsigned int checksum = ChecksumTexture (handles[0], options.size);
+    const unsigned int proceduralChecksum = proceduralHandle ? ChecksumTexture (proceduralHandle, options.size) : 0;
+
+    // Copied out now: the stats page goes away with the plugin
+    const PluginStats* stats = GetPluginStats ();
+    const double events = (double)stats->renderEvents.load ();
+    const unsigned long long clears = stats->clears.load ();
+    const unsigned long long draws = stats->draws.load ();
+    const unsigned long long uploadBytes = stats->uploadBytes.load ();
+    const double renderEventNs = (double)stats->renderEventNs.load ();
+    const double doRenderingNs = (double)stats->doRenderingNs.load ();
+    const double fillTextureNs = (double)stats->fillTextureNs.load ();
+    const unsigned long long fillsOverlapped = stats->fillsOverlapped.load ();
+
+    const int traceZones = options.tracePath ? WritePluginTrace (options.tracePath) : 0;
+    GpuTimings gpuTimings;
+    const bool haveGpuTimings = GetGpuTimings (&gpuTimings) != 0;
+
+    for (int i = 0; i < options.textures; ++i)
+        UnregisterTextureFromUnity (handles[i]);
+    if (proceduralHandle)
+        UnregisterTextureFromUnity (proceduralHandle);
+    MockUnity::SendDeviceEvent (kUnityGfxDeviceEventShutdown);
+    UnityPluginUnload ();
+
+    std::sort (frameMicros.begin(), frameMicros.end());
+    printf ("frames            %d\n", options.frames);
+    printf ("textures          %d x %dx%d\n", options.textures, options.size, options.size);
+    printf ("clears per frame  %d\n", options.clearsPerFrame);
+    printf ("instances/frame   %d\n", options.instancesPerFrame);
+    printf ("procedural        %s\n", options.procedural ? "yes" : "no");
+    if (options.workers >= 0)
+        printf ("workers           %d\n", options.workers);
+    printf ("render thread     %s\n", options.threaded ? "separate" : "inline");
+    printf ("shaders           %s\n", options.shaderDir ? "disk override" : "embedded or none");
+    printf ("first frame       %.3f us after load\n", firstFrameMicros);
+    printf ("frame avg         %.3f us\n", totalSeconds * 1e6 / options.frames);
+    printf ("frame p50         %.3f us\n", frameMicros[options.frames / 2]);
+    printf ("frame p99         %.3f us\n", frameMicros[(options.frames * 99) / 100]);
+    printf ("frame max         %.3f us\n", frameMicros[options.frames - 1]);
+    printf ("frame setup       %.3f us/frame (%s)\n", setupSeconds * 1e6 / options.frames, options.submitFrame ? "SubmitFrame" : options.sharedRing ? "shared ring" : "setters");
+    printf ("plugin events     %.0f (%llu clears, %llu draws, %llu bytes uploaded)\n", events, clears, draws, uploadBytes);
+    if (events > 0)
+        printf ("plugin time       %.3f us/event (DoRendering %.3f, fill %.3f)\n", renderEventNs / events * 1e-3, doRenderingNs / events * 1e-3, fillTextureNs / events * 1e-3);
+    if (options.procedural)
+        printf ("fill overlap      %llu of %d frames\n", fillsOverlapped, options.frames);
+    if (haveGpuTimings)
+        printf ("gpu time          %.3f ms in frame %llu\n", gpuTimings.frameMs, (unsigned long long)gpuTimings.frame);
+    else
+        printf ("gpu time          none (no GPU backend)\n");
+    if (options.tracePath)
+    {
+        if (traceZones < 0)
+            printf ("trace             failed to write %s\n", options.tracePath);
+        else
+            printf ("trace             %d zones in %s\n", traceZones, options.tracePath);
+    }
+    if (options.checkAllocations)
+    {
+        const int checkedFrames = options.frames > kAllocationWarmupFrames ? options.frames - kAllocationWarmupFrames : 0;
+        if (firstAllocatingFrame < 0)
+            printf ("allocations       none in %d frames after warm-up\n", checkedFrames);
+        else
+            printf ("allocations       %u in %d frames after warm-up (first in frame %d)\n", AllocationCounter::GetCount (), checkedFrames, firstAllocatingFrame);
+    }
+    printf ("image checksum    %08x\n", checksum);
+    if (proceduralHandle)
+        printf ("procedural image  %08x\n", proceduralChecksum);
+
+    if (firstAllocatingFrame >= 0)
+    {
+        fprintf (stderr, "The plugin allocated after warm-up\n");
+        return 1;
+    }
+    if (options.procedural && options.workers > 0 && fillsOverlapped != (unsigned long long)options.frames)
+    {
+        fprintf (stderr, "The procedural fill did not run behind the rest of every frame\n");
+        return 1;
+    }
+    return 0;
+}
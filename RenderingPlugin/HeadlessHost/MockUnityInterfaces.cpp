@@ -0,0 +1,114 @@
+#include "MockUnityInterfaces.h"
+
+#include <stddef.h>
+
+namespace
+{
+    enum
+    {
+        kMaxInterfaces = 16,
+        kMaxDeviceCallbacks = 8,
+    };
+
+    // UnityInterfaceGUID has no default constructor, so the table is kept
+    // as parallel arrays.
+    unsigned long long s_InterfaceGuidHigh[kMaxInterfaces];
+    unsigned long long s_InterfaceGuidLow[kMaxInterfaces];
+    IUnityInterface* s_InterfacePtr[kMaxInterfaces];
+    int s_InterfaceCount = 0;
+
+    int FindInterface (const UnityInterfaceGUID& guid)
+    {
+        for (int i = 0; i < s_InterfaceCount; ++i)
+        {
+            if (s_InterfaceGuidHigh[i] == guid.m_GUIDHigh && s_InterfaceGuidLow[i] == guid.m_GUIDLow)
+                return i;
+        }
+        return -1;
+    }
+
+    UnityGfxRenderer s_Renderer = kUnityGfxRendererNull;
+    IUnityGraphicsDeviceEventCallback s_DeviceCallbacks[kMaxDeviceCallbacks];
+    int s_DeviceCallbackCount = 0;
+
+    IUnityInterface* UNITY_INTERFACE_API GetInterface (UnityInterfaceGUID guid)
+    {
+        const int index = FindInterface (guid);
+        return index < 0 ? NULL : s_InterfacePtr[index];
+    }
+
+    void UNITY_INTERFACE_API RegisterInterface (UnityInterfaceGUID guid, IUnityInterface* ptr)
+    {
+        int index = FindInterface (guid);
+        if (index < 0)
+        {
+            if (s_InterfaceCount >= kMaxInterfaces)
+                return;
+            index = s_InterfaceCount++;
+            s_InterfaceGuidHigh[index] = guid.m_GUIDHigh;
+            s_InterfaceGuidLow[index] = guid.m_GUIDLow;
+        }
+        s_InterfacePtr[index] = ptr;
+    }
+
+    UnityGfxRenderer UNITY_INTERFACE_API GetRenderer ()
+    {
+        return s_Renderer;
+    }
+
+    void UNITY_INTERFACE_API RegisterDeviceEventCallback (IUnityGraphicsDeviceEventCallback callback)
+    {
+        if (s_DeviceCallbackCount < kMaxDeviceCallbacks)
+            s_DeviceCallbacks[s_DeviceCallbackCount++] = callback;
+    }
+
+    void UNITY_INTERFACE_API UnregisterDeviceEventCallback (IUnityGraphicsDeviceEventCallback callback)
+    {
+        for (int i = 0; i < s_DeviceCallbackCount; ++i)
+        {
+            if (s_DeviceCallbacks[i] == callback)
+            {
+                s_DeviceCallbacks[i] = s_DeviceCallbacks[--s_DeviceCallbackCount];
+                return;
+            }
+        }
+    }
+
+    IUnityGraphics s_Graphics;
+    IUnityInterfaces s_Interfaces;
+    bool s_Initialized = false;
+}
+
+
+IUnityInterfaces* MockUnity::GetInterfaces ()
+{
+    if (!s_Initialized)
+    {
+        s_Interfaces.GetInterface = GetInterface;
+        s_Interfaces.RegisterInterface = RegisterInterface;
+
+        s_Graphics.GetRenderer = GetRenderer;
+        s_Graphics.RegisterDeviceEventCallback = RegisterDeviceEventCallback;
+        s_Graphics.UnregisterDeviceEventCallback = UnregisterDeviceEventCallback;
+        s_Interfaces.Register<IUnityGraphics>(&s_Graphics);
+
+        s_Initialized = true;
+    }
+    return &s_Interfaces;
+}
+
+void MockUnity::SetRenderer (UnityGfxRenderer renderer)
+{
+    s_Renderer = renderer;
+}
+
+void MockUnity::SendDeviceEvent (UnityGfxDeviceEventType eventType)
+{
+    for (int i = 0; i < s_DeviceCallbackCount; ++i)
+        s_DeviceCallbacks[i](eventType);
+}
+
+int MockUnity::GetRegisteredDeviceCallbackCount ()
+{
+    return s_DeviceCallbackCount;
+}
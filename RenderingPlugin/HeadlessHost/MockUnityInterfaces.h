@@ -0,0 +1,26 @@
+#pragma once
+
+#include "../Unity/IUnityInterface.h"
+#include "../Unity/IUnityGraphics.h"
+
+// --------------------------------------------------------------------------
+// MockUnityInterfaces
+//
+// Stands in for the Unity runtime so the plugin can be loaded and driven
+// without a player: an IUnityInterfaces registry plus an IUnityGraphics that
+// reports a configurable renderer (kUnityGfxRendererNull by default) and
+// lets the host fire device events at the plugin, like Unity does.
+
+namespace MockUnity
+{
+    // Returns the interface table to hand to UnityPluginLoad. The mock
+    // IUnityGraphics is registered in it.
+    IUnityInterfaces* GetInterfaces ();
+
+    void SetRenderer (UnityGfxRenderer renderer);
+
+    // Sends a device event to every callback the plugin registered.
+    void SendDeviceEvent (UnityGfxDeviceEventType eventType);
+
+    int GetRegisteredDeviceCallbackCount ();
+}
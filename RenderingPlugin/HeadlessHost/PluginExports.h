@@ -0,0 +1,57 @@
+#pragma once
+
+#include "../Unity/IUnityInterface.h"
+#include "../Unity/IUnityGraphics.h"
+
+// Functions exported by RenderingPlugin (see RenderingPlugin.def). The host
+// links against the plugin library and calls them the way Unity's P/Invoke
+// layer would.
+
+typedef void (UNITY_INTERFACE_API * PluginDebugCallback)(const char*);
+
+// eventIDs of the render event, as PluginRenderEvent in RenderingPlugin.h
+// (which the host cannot include on its own)
+enum PluginRenderEvent
+{
+    kPluginEventFrame = 1,
+    kPluginEventFillTexture = 2,
+    kPluginEventUpload = 3,
+    kPluginEventClear = 4,
+    kPluginEventDraw = 5,
+    kPluginEventFlushStats = 6,
+};
+
+struct ClearCommandDesc;
+struct DrawInstance;
+struct FrameDesc;
+struct GpuTimings;
+struct PluginStats;
+
+extern "C"
+{
+void UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API LinkDebug(PluginDebugCallback d, PluginDebugCallback w, PluginDebugCallback e);
+int UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API FlushPluginLogs();
+const PluginStats* UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API GetPluginStats();
+int UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API WritePluginTrace(const char* path);
+int UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API GetGpuTimings(GpuTimings* timings);
+void UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API SetTimeFromUnity(float t);
+void UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API SetUnityStreamingAssetsPath(const char* path);
+void UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API SetShaderOverrideFromDisk(int enabled);
+void UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API SetWorkerThreadCount(int count);
+void UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API SetTextureFromUnity(void* texturePtr);
+int UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API RegisterTextureFromUnity(void* texturePtr);
+void UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API UnregisterTextureFromUnity(int handle);
+void UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API SetProceduralTextureFromUnity(int handle);
+void UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API QueueClearTexture(int texture, float r, float g, float b, float a);
+void UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API QueueClearTextureRect(int texture, float r, float g, float b, float a, int x, int y, int width, int height);
+void UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API QueueClearTextures(const ClearCommandDesc* commands, int count);
+void UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API QueueDrawInstances(int texture, int shape, const DrawInstance* instances, int count);
+int UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API SubmitFrame(const FrameDesc* desc);
+void* UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API GetSharedCommandRing();
+int UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API CreateSoftwareTexture(int width, int height);
+void* UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API GetSoftwareTexturePixels(int handle);
+int UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API GetSoftwareTextureStride(int handle);
+void UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API SetSoftwareRenderTarget(int handle);
+UnityRenderingEvent UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API GetRenderEventFunc();
+UnityRenderingEventAndData UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API GetRenderEventAndDataFunc();
+}
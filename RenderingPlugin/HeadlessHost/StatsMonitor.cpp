@@ -0,0 +1,91 @@
+// External monitor for RenderingPlugin's stats page (Linux).
+//
+// Maps the shared-memory stats of a running process that has the plugin
+// loaded (Unity player, editor or HeadlessHost) and prints what changed in
+// every interval (times are per render event), without calling into the
+// plugin or pausing it.
+//
+// Usage: PluginStatsMonitor PID [--interval MS] [--samples N]
+
+#include "../PluginStats.h"
+
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+
+struct StatsSample
+{
+    uint64_t renderEvents, clears, uploadBytes, draws, stateCallsElided;
+    uint64_t renderEventNs, doRenderingNs, fillTextureNs, fillsOverlapped;
+};
+
+static StatsSample TakeSample (const PluginStats& stats)
+{
+    StatsSample sample;
+    sample.renderEvents = stats.renderEvents.load (std::memory_order_relaxed);
+    sample.clears = stats.clears.load (std::memory_order_relaxed);
+    sample.uploadBytes = stats.uploadBytes.load (std::memory_order_relaxed);
+    sample.draws = stats.draws.load (std::memory_order_relaxed);
+    sample.stateCallsElided = stats.stateCallsElided.load (std::memory_order_relaxed);
+    sample.renderEventNs = stats.renderEventNs.load (std::memory_order_relaxed);
+    sample.doRenderingNs = stats.doRenderingNs.load (std::memory_order_relaxed);
+    sample.fillTextureNs = stats.fillTextureNs.load (std::memory_order_relaxed);
+    sample.fillsOverlapped = stats.fillsOverlapped.load (std::memory_order_relaxed);
+    return sample;
+}
+
+int main (int argc, char** argv)
+{
+    if (argc < 2)
+    {
+        fprintf (stderr, "Usage: PluginStatsMonitor PID [--interval MS] [--samples N]\n");
+        return 1;
+    }
+    const unsigned processId = (unsigned)strtoul (argv[1], NULL, 10);
+    int intervalMs = 1000;
+    int samples = 0;    // until interrupted
+    for (int i = 2; i + 1 < argc; i += 2)
+    {
+        if (!strcmp (argv[i], "--interval"))
+            intervalMs = atoi (argv[i + 1]);
+        else if (!strcmp (argv[i], "--samples"))
+            samples = atoi (argv[i + 1]);
+    }
+    if (intervalMs <= 0)
+        intervalMs = 1000;
+
+    const std::string name = GetPluginStatsPageName (processId);
+    const PluginStats* stats = MapPluginStatsPage (name.c_str());
+    if (!stats)
+    {
+        fprintf (stderr, "No plugin stats page %s\n", name.c_str());
+        return 1;
+    }
+
+    printf ("%10s %8s %8s %12s %8s %10s %12s %12s %10s\n",
+        "events", "clears", "draws", "upload KB", "elided", "event us", "render us", "fill us", "overlaps");
+    StatsSample last = TakeSample (*stats);
+    for (int n = 0; samples <= 0 || n < samples; ++n)
+    {
+        std::this_thread::sleep_for (std::chrono::milliseconds (intervalMs));
+        const StatsSample now = TakeSample (*stats);
+        const uint64_t events = now.renderEvents - last.renderEvents;
+        const double perEvent = events ? 1e-3 / events : 0.0;
+        printf ("%10llu %8llu %8llu %12.1f %8llu %10.3f %12.3f %12.3f %10llu\n",
+            (unsigned long long)events,
+            (unsigned long long)(now.clears - last.clears),
+            (unsigned long long)(now.draws - last.draws),
+            (now.uploadBytes - last.uploadBytes) / 1024.0,
+            (unsigned long long)(now.stateCallsElided - last.stateCallsElided),
+            (now.renderEventNs - last.renderEventNs) * perEvent,
+            (now.doRenderingNs - last.doRenderingNs) * perEvent,
+            (now.fillTextureNs - last.fillTextureNs) * perEvent,
+            (unsigned long long)(now.fillsOverlapped - last.fillsOverlapped));
+        fflush (stdout);
+        last = now;
+    }
+    UnmapPluginStatsPage (stats);
+    return 0;
+}
@@ -0,0 +1,100 @@
+#include "InstanceBatch.h"
+
+static const SoftwareVertex kInstanceShapeVertices[] =
+{
+    // triangle
+    { -0.5f, -0.25f, 0, 0xFFFFFFFF },
+    {  0.5f, -0.25f, 0, 0xFFFFFFFF },
+    {  0,     0.5f,  0, 0xFFFFFFFF },
+    // quad
+    { -0.5f, -0.5f, 0, 0xFFFFFFFF },
+    {  0.5f, -0.5f, 0, 0xFFFFFFFF },
+    {  0.5f,  0.5f, 0, 0xFFFFFFFF },
+    { -0.5f, -0.5f, 0, 0xFFFFFFFF },
+    {  0.5f,  0.5f, 0, 0xFFFFFFFF },
+    { -0.5f,  0.5f, 0, 0xFFFFFFFF },
+};
+
+static const InstanceShapeRange kInstanceShapeRanges[kInstanceShapeCount] =
+{
+    { 0, 3 },
+    { 3, 6 },
+};
+
+const SoftwareVertex* GetInstanceShapeVertices (int* totalCount)
+{
+    *totalCount = sizeof(kInstanceShapeVertices) / sizeof(kInstanceShapeVertices[0]);
+    return kInstanceShapeVertices;
+}
+
+InstanceShapeRange GetInstanceShapeRange (InstanceShape shape)
+{
+    return kInstanceShapeRanges[shape];
+}
+
+
+// --------------------------------------------------------------------------
+// InstanceBatchBuffer
+
+InstanceBatchBuffer::InstanceBatchBuffer (int capacity)
+    : m_Capacity (capacity)
+{
+    m_Instances.reserve (capacity);
+    m_Batches.reserve (capacity);
+}
+
+bool InstanceBatchBuffer::Push (TextureHandle texture, InstanceShape shape, const DrawInstance& instance)
+{
+    if ((int)m_Instances.size() >= m_Capacity)
+        return false;
+
+    if (m_Batches.empty() || m_Batches.back().texture != texture || m_Batches.back().shape != shape)
+    {
+        const InstanceBatch batch = { texture, shape, (int)m_Instances.size(), 0 };
+        m_Batches.push_back (batch);
+    }
+    m_Instances.push_back (instance);
+    ++m_Batches.back().instanceCount;
+    return true;
+}
+
+void InstanceBatchBuffer::Reset ()
+{
+    m_Instances.clear ();
+    m_Batches.clear ();
+}
+
+
+// --------------------------------------------------------------------------
+// CPU reference
+
+void SoftwareDrawInstances (CpuSurface& target, InstanceShape shape, const DrawInstance* instances, int count, RasterPath path)
+{
+    const InstanceShapeRange range = kInstanceShapeRanges[shape];
+    SoftwareVertex verts[6];
+    for (int i = 0; i < range.vertexCount; ++i)
+        verts[i] = kInstanceShapeVertices[range.firstVertex + i];
+
+    // Per instance, the 2D affine transform as a column-major world matrix
+    float m[16] =
+    {
+        1, 0, 0, 0,
+        0, 1, 0, 0,
+        0, 0, 0, 0,
+        0, 0, 0, 1,
+    };
+    for (int n = 0; n < count; ++n)
+    {
+        const DrawInstance& instance = instances[n];
+        m[0] = instance.transform[0];
+        m[4] = instance.transform[1];
+        m[12] = instance.transform[2];
+        m[1] = instance.transform[3];
+        m[5] = instance.transform[4];
+        m[13] = instance.transform[5];
+        m[14] = instance.z;
+        for (int i = 0; i < range.vertexCount; ++i)
+            verts[i].color = instance.color;
+        SoftwareDrawTriangles (target, m, verts, range.vertexCount, path);
+    }
+}
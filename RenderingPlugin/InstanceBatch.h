@@ -0,0 +1,81 @@
+#pragma once
+
+#include "TextureRegistry.h"
+#include "SoftwareRenderer.h"
+
+#include <vector>
+
+// --------------------------------------------------------------------------
+// Instanced overlays
+//
+// Scripts draw many small triangles or quads into registered textures by
+// queueing instances: a 2D affine transform of the unit shape into clip
+// space, a depth and a flat colour. The render thread collects the frame's
+// instances into batches (consecutive instances for the same texture and
+// shape share one), and each batch becomes a single instanced draw on
+// D3D11, or goes through SoftwareDrawInstances on the CPU backend.
+
+enum InstanceShape
+{
+    kInstanceShapeTriangle,     // the MyVertex triangle
+    kInstanceShapeQuad,         // [-0.5, 0.5]^2, two triangles
+    kInstanceShapeCount
+};
+
+// Blittable layout shared with scripts and with the instanced vertex
+// shader's per-instance input (32 bytes).
+//   clip.x = transform[0] * x + transform[1] * y + transform[2]
+//   clip.y = transform[3] * x + transform[4] * y + transform[5]
+struct DrawInstance
+{
+    float transform[6];
+    float z;
+    unsigned int color;         // RGBA8, byte 0 is red
+};
+
+// Unit geometry of every shape in one array (white vertices), so one
+// vertex buffer holds them all.
+struct InstanceShapeRange
+{
+    int firstVertex;
+    int vertexCount;
+};
+const SoftwareVertex* GetInstanceShapeVertices (int* totalCount);
+InstanceShapeRange GetInstanceShapeRange (InstanceShape shape);
+
+struct InstanceBatch
+{
+    TextureHandle texture;
+    InstanceShape shape;
+    int firstInstance;
+    int instanceCount;
+};
+
+enum { kMaxInstancesPerFrame = 65536 };
+
+class InstanceBatchBuffer
+{
+public:
+    // Storage for capacity instances is allocated up front.
+    explicit InstanceBatchBuffer (int capacity = kMaxInstancesPerFrame);
+
+    // Returns false (and drops the instance) when the buffer is full.
+    bool Push (TextureHandle texture, InstanceShape shape, const DrawInstance& instance);
+
+    int GetBatchCount () const { return (int)m_Batches.size(); }
+    const InstanceBatch& GetBatch (int i) const { return m_Batches[i]; }
+    const DrawInstance* GetInstances () const { return m_Instances.empty() ? NULL : &m_Instances[0]; }
+    int GetInstanceCount () const { return (int)m_Instances.size(); }
+
+    void Reset ();
+
+private:
+    std::vector<DrawInstance> m_Instances;
+    std::vector<InstanceBatch> m_Batches;
+    int m_Capacity;
+};
+
+// CPU reference: draws every instance of one shape into target with the
+// same transform and viewport mapping as SoftwareDrawTriangles, so the
+// result matches drawing each instance as its own triangle list.
+void SoftwareDrawInstances (CpuSurface& target, InstanceShape shape, const DrawInstance* instances, int count, RasterPath path = kRasterPathSimd);
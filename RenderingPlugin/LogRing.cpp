@@ -0,0 +1,96 @@
+#include "LogRing.h"
+
+#include <chrono>
+#include <string.h>
+
+uint64_t LogTimestampNow ()
+{
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+
+// --------------------------------------------------------------------------
+// LogRing
+
+LogRing::LogRing ()
+    : m_Tail (0)
+    , m_Head (0)
+    , m_Dropped (0)
+{
+    // A cell is free for the producer at position p when its sequence is p,
+    // and holds a record for the consumer at p when it is p + 1
+    for (uint32_t i = 0; i < kLogRingCapacity; ++i)
+        m_Cells[i].sequence.store (i, std::memory_order_relaxed);
+}
+
+bool LogRing::Push (LogSeverity severity, const char* text, uint32_t suppressed)
+{
+    uint32_t position = m_Tail.load (std::memory_order_relaxed);
+    Cell* cell;
+    for (;;)
+    {
+        cell = &m_Cells[position & (kLogRingCapacity - 1)];
+        const uint32_t sequence = cell->sequence.load (std::memory_order_acquire);
+        const int32_t difference = (int32_t)(sequence - position);
+        if (difference == 0)
+        {
+            if (m_Tail.compare_exchange_weak (position, position + 1, std::memory_order_relaxed))
+                break;
+        }
+        else if (difference < 0)
+        {
+            // The consumer has not got to this cell since the last lap
+            m_Dropped.fetch_add (1, std::memory_order_relaxed);
+            return false;
+        }
+        else
+            position = m_Tail.load (std::memory_order_relaxed);
+    }
+
+    LogRecord& record = cell->record;
+    record.timestamp = LogTimestampNow ();
+    record.suppressed = suppressed;
+    record.severity = (uint8_t)severity;
+    size_t length = text ? strlen (text) : 0;
+    if (length >= kLogRecordTextSize)
+        length = kLogRecordTextSize - 1;
+    if (length)
+        memcpy (record.text, text, length);
+    record.text[length] = 0;
+
+    cell->sequence.store (position + 1, std::memory_order_release);
+    return true;
+}
+
+int LogRing::Drain (LogDrainFn fn, void* userData)
+{
+    int count = 0;
+    for (;;)
+    {
+        Cell& cell = m_Cells[m_Head & (kLogRingCapacity - 1)];
+        if (cell.sequence.load (std::memory_order_acquire) != m_Head + 1)
+            break;      // empty, or the next record is still being written
+        fn (cell.record, userData);
+        cell.sequence.store (m_Head + kLogRingCapacity, std::memory_order_release);
+        ++m_Head;
+        ++count;
+    }
+    return count;
+}
+
+
+// --------------------------------------------------------------------------
+// LogRateLimiter
+
+bool LogRateLimiter::Allow (uint64_t intervalNs, uint32_t* suppressed)
+{
+    const uint64_t now = LogTimestampNow ();
+    uint64_t next = m_NextAllowed.load (std::memory_order_relaxed);
+    if (now < next || !m_NextAllowed.compare_exchange_strong (next, now + intervalNs, std::memory_order_relaxed))
+    {
+        m_Suppressed.fetch_add (1, std::memory_order_relaxed);
+        return false;
+    }
+    *suppressed = m_Suppressed.exchange (0, std::memory_order_relaxed);
+    return true;
+}
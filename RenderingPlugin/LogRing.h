@@ -0,0 +1,106 @@
+#pragma once
+
+#include <atomic>
+#include <stdint.h>
+
+// --------------------------------------------------------------------------
+// LogRing
+//
+// Bounded multi-producer / single-consumer ring of fixed-size log records.
+// Any thread (render thread, workers, the main thread) can Push without
+// locks or allocation; the main thread drains the ring and only then hands
+// the text to Unity, so logging never crosses into managed code where it
+// happens. Every cell carries a sequence number: a producer claims a cell by
+// advancing the shared tail with a CAS, fills it, then publishes it by
+// bumping the sequence; the consumer takes cells strictly in order and stops
+// at one that is claimed but not yet published. When the ring is full the
+// record is dropped and counted -- a log call never waits.
+//
+// Text longer than a record holds is truncated.
+
+enum LogSeverity
+{
+    kLogSeverityLog,
+    kLogSeverityWarning,
+    kLogSeverityError,
+};
+
+// Records below this severity are compiled out of the plugin (e.g.
+// -DRENDERINGPLUGIN_LOG_MIN_SEVERITY=1 keeps warnings and errors only).
+#ifndef RENDERINGPLUGIN_LOG_MIN_SEVERITY
+#define RENDERINGPLUGIN_LOG_MIN_SEVERITY 0
+#endif
+
+enum
+{
+    kLogRecordTextSize = 112,
+    kLogRingCapacity = 1024,    // records; power of two
+};
+
+struct LogRecord
+{
+    uint64_t timestamp;         // LogTimestampNow() when pushed
+    uint32_t suppressed;        // rate-limited repeats folded into this one
+    uint8_t severity;           // LogSeverity
+    char text[kLogRecordTextSize];
+};
+
+// Monotonic nanoseconds, shared by all threads.
+uint64_t LogTimestampNow ();
+
+typedef void (*LogDrainFn)(const LogRecord& record, void* userData);
+
+class LogRing
+{
+    static_assert ((kLogRingCapacity & (kLogRingCapacity - 1)) == 0, "LogRing capacity must be a power of two");
+
+public:
+    LogRing ();
+
+    // Any thread. False (and counted) when the ring is full.
+    bool Push (LogSeverity severity, const char* text, uint32_t suppressed = 0);
+
+    // Consumer only: hands every published record to fn, oldest first, and
+    // returns how many it handed over.
+    int Drain (LogDrainFn fn, void* userData);
+
+    // Records dropped since the last call.
+    uint32_t TakeDroppedCount () { return m_Dropped.exchange (0, std::memory_order_relaxed); }
+
+private:
+    struct Cell
+    {
+        std::atomic<uint32_t> sequence;
+        LogRecord record;
+    };
+
+    LogRing (const LogRing&);
+    LogRing& operator= (const LogRing&);
+
+    Cell m_Cells[kLogRingCapacity];
+    alignas(64) std::atomic<uint32_t> m_Tail;   // producers
+    alignas(64) uint32_t m_Head;                // consumer
+    std::atomic<uint32_t> m_Dropped;
+};
+
+
+// --------------------------------------------------------------------------
+// LogRateLimiter
+//
+// One per call site (a function-local static) for messages that can fire
+// every frame: lets one through per interval and counts the rest, so the
+// next message that goes through can say how many were folded into it.
+
+class LogRateLimiter
+{
+public:
+    LogRateLimiter () : m_NextAllowed (0), m_Suppressed (0) {}
+
+    // True when this call may log; *suppressed then holds the number of calls
+    // held back since the last one that did.
+    bool Allow (uint64_t intervalNs, uint32_t* suppressed);
+
+private:
+    std::atomic<uint64_t> m_NextAllowed;
+    std::atomic<uint32_t> m_Suppressed;
+};
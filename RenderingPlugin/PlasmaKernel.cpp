@@ -0,0 +1,454 @@
+#include "PlasmaKernel.h"
+#include "TraceZones.h"
+#include "WorkerPool.h"
+
+#include <math.h>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+    #define PLASMA_X86 1
+    #include <immintrin.h>
+    #if defined(_MSC_VER)
+        #include <intrin.h>
+    #endif
+#else
+    #define PLASMA_X86 0
+#endif
+
+#if defined(__aarch64__) || defined(_M_ARM64)
+    #define PLASMA_NEON 1
+    #include <arm_neon.h>
+#else
+    #define PLASMA_NEON 0
+#endif
+
+// GCC and Clang only emit AVX2 / SSE4.1 instructions in functions that ask
+// for them; MSVC allows the intrinsics anywhere.
+#if PLASMA_X86 && (defined(__GNUC__) || defined(__clang__))
+    #define PLASMA_TARGET_AVX2 __attribute__((target("avx2")))
+    #define PLASMA_TARGET_SSE41 __attribute__((target("sse4.1")))
+#else
+    #define PLASMA_TARGET_AVX2
+    #define PLASMA_TARGET_SSE41
+#endif
+
+
+// --------------------------------------------------------------------------
+// Reference
+
+void FillPlasmaReference (int width, int height, int stride, unsigned char* dst, float t)
+{
+    for (int y = 0; y < height; ++y)
+    {
+        unsigned char* ptr = dst;
+        for (int x = 0; x < width; ++x)
+        {
+            // Simple oldskool "plasma effect", a bunch of combined sine waves
+            int vv = int(
+                (127.0f + (127.0f * sinf(x/7.0f+t))) +
+                (127.0f + (127.0f * sinf(y/5.0f-t))) +
+                (127.0f + (127.0f * sinf((x+y)/6.0f-t))) +
+                (127.0f + (127.0f * sinf(sqrtf(float(x*x + y*y))/4.0f-t)))
+                ) / 4;
+
+            // Write the texture pixel
+            ptr[0] = vv;
+            ptr[1] = vv;
+            ptr[2] = vv;
+            ptr[3] = vv;
+
+            // To next pixel (our pixels are 4 bpp)
+            ptr += 4;
+        }
+
+        // To next image row
+        dst += stride;
+    }
+}
+
+
+// --------------------------------------------------------------------------
+// Tables
+
+void PlasmaTables::Prepare (int w, int h, float phase)
+{
+    width = w;
+    height = h;
+    t = phase;
+    const double twoPi = 6.283185307179586;
+    double reduced = fmod ((double)phase, twoPi);
+    if (reduced < 0)
+        reduced += twoPi;
+    tReduced = (float)reduced;
+
+    // Same expressions as the reference, so these three terms match it exactly
+    columns.resize (w);
+    for (int x = 0; x < w; ++x)
+        columns[x] = 127.0f + (127.0f * sinf(x/7.0f+t));
+    rows.resize (h);
+    for (int y = 0; y < h; ++y)
+        rows[y] = 127.0f + (127.0f * sinf(y/5.0f-t));
+    diagonals.resize (w + h);
+    for (int d = 0; d < w + h; ++d)
+        diagonals[d] = 127.0f + (127.0f * sinf(d/6.0f-t));
+}
+
+static inline unsigned int PlasmaPixelScalar (const PlasmaTables& tb, int x, int y, float rowTerm)
+{
+    const float radial = 127.0f + (127.0f * sinf(sqrtf(float(x*x + y*y))/4.0f-tb.t));
+    const int vv = int(((tb.columns[x] + rowTerm) + tb.diagonals[x + y]) + radial) / 4;
+    return (unsigned int)vv * 0x01010101u;
+}
+
+static void FillRowsScalar (const PlasmaTables& tb, int yBegin, int yEnd, int stride, unsigned char* dst)
+{
+    for (int y = yBegin; y < yEnd; ++y)
+    {
+        unsigned int* row = reinterpret_cast<unsigned int*>(dst + (size_t)y * stride);
+        const float rowTerm = tb.rows[y];
+        for (int x = 0; x < tb.width; ++x)
+            row[x] = PlasmaPixelScalar (tb, x, y, rowTerm);
+    }
+}
+
+
+// --------------------------------------------------------------------------
+// Vectorized sine
+//
+// sin(x) = (-1)^k sin(r) with k = round(x / pi) and r = x - k pi in
+// [-pi/2, pi/2]; pi is split in three parts (Cody-Waite) so the reduction
+// stays exact for the argument range the plasma produces. sin(r) is an odd
+// degree-11 minimax polynomial, max error around 1e-7.
+
+#define PLASMA_INV_PI   0.31830988618379067f
+#define PLASMA_PI_A     3.140625f
+#define PLASMA_PI_B     9.67502593994140625e-4f
+#define PLASMA_PI_C     1.509957990978376432e-7f
+#define PLASMA_SIN_S1  -1.6666666e-1f
+#define PLASMA_SIN_S2   8.3333310e-3f
+#define PLASMA_SIN_S3  -1.9840874e-4f
+#define PLASMA_SIN_S4   2.7525562e-6f
+#define PLASMA_SIN_S5  -2.3889859e-8f
+
+#if PLASMA_X86
+
+PLASMA_TARGET_AVX2 static inline __m256 SinAVX2 (__m256 x)
+{
+    const __m256 k = _mm256_round_ps (_mm256_mul_ps (x, _mm256_set1_ps (PLASMA_INV_PI)), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+    __m256 r = _mm256_sub_ps (x, _mm256_mul_ps (k, _mm256_set1_ps (PLASMA_PI_A)));
+    r = _mm256_sub_ps (r, _mm256_mul_ps (k, _mm256_set1_ps (PLASMA_PI_B)));
+    r = _mm256_sub_ps (r, _mm256_mul_ps (k, _mm256_set1_ps (PLASMA_PI_C)));
+
+    const __m256 r2 = _mm256_mul_ps (r, r);
+    __m256 p = _mm256_set1_ps (PLASMA_SIN_S5);
+    p = _mm256_add_ps (_mm256_mul_ps (p, r2), _mm256_set1_ps (PLASMA_SIN_S4));
+    p = _mm256_add_ps (_mm256_mul_ps (p, r2), _mm256_set1_ps (PLASMA_SIN_S3));
+    p = _mm256_add_ps (_mm256_mul_ps (p, r2), _mm256_set1_ps (PLASMA_SIN_S2));
+    p = _mm256_add_ps (_mm256_mul_ps (p, r2), _mm256_set1_ps (PLASMA_SIN_S1));
+    const __m256 s = _mm256_add_ps (r, _mm256_mul_ps (_mm256_mul_ps (r, r2), p));
+
+    // Odd k flips the sign
+    const __m256i odd = _mm256_slli_epi32 (_mm256_cvtps_epi32 (k), 31);
+    return _mm256_xor_ps (s, _mm256_castsi256_ps (odd));
+}
+
+PLASMA_TARGET_AVX2 static void FillRowsAVX2 (const PlasmaTables& tb, int yBegin, int yEnd, int stride, unsigned char* dst)
+{
+    const __m256 laneOffsets = _mm256_set_ps (7, 6, 5, 4, 3, 2, 1, 0);
+    const __m256 quarter = _mm256_set1_ps (0.25f);
+    const __m256 amplitude = _mm256_set1_ps (127.0f);
+    const __m256 phase = _mm256_set1_ps (tb.tReduced);
+    const __m256i splat = _mm256_set1_epi32 (0x01010101);
+
+    for (int y = yBegin; y < yEnd; ++y)
+    {
+        unsigned int* row = reinterpret_cast<unsigned int*>(dst + (size_t)y * stride);
+        const float rowTerm = tb.rows[y];
+        const __m256 rowTermV = _mm256_set1_ps (rowTerm);
+        const __m256 yy = _mm256_set1_ps (float(y) * float(y));
+        const float* diagonals = &tb.diagonals[y];
+
+        int x = 0;
+        for (; x + 8 <= tb.width; x += 8)
+        {
+            const __m256 xf = _mm256_add_ps (_mm256_set1_ps (float(x)), laneOffsets);
+            const __m256 radius = _mm256_sqrt_ps (_mm256_add_ps (_mm256_mul_ps (xf, xf), yy));
+            const __m256 s = SinAVX2 (_mm256_sub_ps (_mm256_mul_ps (radius, quarter), phase));
+            const __m256 radial = _mm256_add_ps (amplitude, _mm256_mul_ps (amplitude, s));
+
+            __m256 sum = _mm256_add_ps (_mm256_loadu_ps (&tb.columns[x]), rowTermV);
+            sum = _mm256_add_ps (sum, _mm256_loadu_ps (diagonals + x));
+            sum = _mm256_add_ps (sum, radial);
+
+            const __m256i vv = _mm256_srli_epi32 (_mm256_cvttps_epi32 (sum), 2);
+            _mm256_storeu_si256 (reinterpret_cast<__m256i*>(row + x), _mm256_mullo_epi32 (vv, splat));
+        }
+        for (; x < tb.width; ++x)
+            row[x] = PlasmaPixelScalar (tb, x, y, rowTerm);
+    }
+}
+
+PLASMA_TARGET_SSE41 static inline __m128 SinSSE41 (__m128 x)
+{
+    const __m128 k = _mm_round_ps (_mm_mul_ps (x, _mm_set1_ps (PLASMA_INV_PI)), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+    __m128 r = _mm_sub_ps (x, _mm_mul_ps (k, _mm_set1_ps (PLASMA_PI_A)));
+    r = _mm_sub_ps (r, _mm_mul_ps (k, _mm_set1_ps (PLASMA_PI_B)));
+    r = _mm_sub_ps (r, _mm_mul_ps (k, _mm_set1_ps (PLASMA_PI_C)));
+
+    const __m128 r2 = _mm_mul_ps (r, r);
+    __m128 p = _mm_set1_ps (PLASMA_SIN_S5);
+    p = _mm_add_ps (_mm_mul_ps (p, r2), _mm_set1_ps (PLASMA_SIN_S4));
+    p = _mm_add_ps (_mm_mul_ps (p, r2), _mm_set1_ps (PLASMA_SIN_S3));
+    p = _mm_add_ps (_mm_mul_ps (p, r2), _mm_set1_ps (PLASMA_SIN_S2));
+    p = _mm_add_ps (_mm_mul_ps (p, r2), _mm_set1_ps (PLASMA_SIN_S1));
+    const __m128 s = _mm_add_ps (r, _mm_mul_ps (_mm_mul_ps (r, r2), p));
+
+    const __m128i odd = _mm_slli_epi32 (_mm_cvtps_epi32 (k), 31);
+    return _mm_xor_ps (s, _mm_castsi128_ps (odd));
+}
+
+PLASMA_TARGET_SSE41 static void FillRowsSSE41 (const PlasmaTables& tb, int yBegin, int yEnd, int stride, unsigned char* dst)
+{
+    const __m128 laneOffsets = _mm_set_ps (3, 2, 1, 0);
+    const __m128 quarter = _mm_set1_ps (0.25f);
+    const __m128 amplitude = _mm_set1_ps (127.0f);
+    const __m128 phase = _mm_set1_ps (tb.tReduced);
+    const __m128i splat = _mm_set1_epi32 (0x01010101);
+
+    for (int y = yBegin; y < yEnd; ++y)
+    {
+        unsigned int* row = reinterpret_cast<unsigned int*>(dst + (size_t)y * stride);
+        const float rowTerm = tb.rows[y];
+        const __m128 rowTermV = _mm_set1_ps (rowTerm);
+        const __m128 yy = _mm_set1_ps (float(y) * float(y));
+        const float* diagonals = &tb.diagonals[y];
+
+        int x = 0;
+        for (; x + 4 <= tb.width; x += 4)
+        {
+            const __m128 xf = _mm_add_ps (_mm_set1_ps (float(x)), laneOffsets);
+            const __m128 radius = _mm_sqrt_ps (_mm_add_ps (_mm_mul_ps (xf, xf), yy));
+            const __m128 s = SinSSE41 (_mm_sub_ps (_mm_mul_ps (radius, quarter), phase));
+            const __m128 radial = _mm_add_ps (amplitude, _mm_mul_ps (amplitude, s));
+
+            __m128 sum = _mm_add_ps (_mm_loadu_ps (&tb.columns[x]), rowTermV);
+            sum = _mm_add_ps (sum, _mm_loadu_ps (diagonals + x));
+            sum = _mm_add_ps (sum, radial);
+
+            const __m128i vv = _mm_srli_epi32 (_mm_cvttps_epi32 (sum), 2);
+            _mm_storeu_si128 (reinterpret_cast<__m128i*>(row + x), _mm_mullo_epi32 (vv, splat));
+        }
+        for (; x < tb.width; ++x)
+            row[x] = PlasmaPixelScalar (tb, x, y, rowTerm);
+    }
+}
+
+static bool CpuSupportsAVX2 ()
+{
+    #if defined(__GNUC__) || defined(__clang__)
+    return __builtin_cpu_supports ("avx2");
+    #else
+    int info[4];
+    __cpuid (info, 1);
+    const bool osxsave = (info[2] & (1 << 27)) != 0;
+    const bool avx = (info[2] & (1 << 28)) != 0;
+    if (!osxsave || !avx || (_xgetbv (0) & 6) != 6)
+        return false;
+    __cpuidex (info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+    #endif
+}
+
+static bool CpuSupportsSSE41 ()
+{
+    #if defined(__GNUC__) || defined(__clang__)
+    return __builtin_cpu_supports ("sse4.1");
+    #else
+    int info[4];
+    __cpuid (info, 1);
+    return (info[2] & (1 << 19)) != 0;
+    #endif
+}
+
+#endif // PLASMA_X86
+
+
+#if PLASMA_NEON
+
+static inline float32x4_t SinNEON (float32x4_t x)
+{
+    const float32x4_t k = vrndnq_f32 (vmulq_n_f32 (x, PLASMA_INV_PI));
+    float32x4_t r = vsubq_f32 (x, vmulq_n_f32 (k, PLASMA_PI_A));
+    r = vsubq_f32 (r, vmulq_n_f32 (k, PLASMA_PI_B));
+    r = vsubq_f32 (r, vmulq_n_f32 (k, PLASMA_PI_C));
+
+    const float32x4_t r2 = vmulq_f32 (r, r);
+    float32x4_t p = vdupq_n_f32 (PLASMA_SIN_S5);
+    p = vaddq_f32 (vmulq_f32 (p, r2), vdupq_n_f32 (PLASMA_SIN_S4));
+    p = vaddq_f32 (vmulq_f32 (p, r2), vdupq_n_f32 (PLASMA_SIN_S3));
+    p = vaddq_f32 (vmulq_f32 (p, r2), vdupq_n_f32 (PLASMA_SIN_S2));
+    p = vaddq_f32 (vmulq_f32 (p, r2), vdupq_n_f32 (PLASMA_SIN_S1));
+    const float32x4_t s = vaddq_f32 (r, vmulq_f32 (vmulq_f32 (r, r2), p));
+
+    const uint32x4_t odd = vshlq_n_u32 (vreinterpretq_u32_s32 (vcvtq_s32_f32 (k)), 31);
+    return vreinterpretq_f32_u32 (veorq_u32 (vreinterpretq_u32_f32 (s), odd));
+}
+
+static void FillRowsNEON (const PlasmaTables& tb, int yBegin, int yEnd, int stride, unsigned char* dst)
+{
+    const float laneValues[4] = { 0, 1, 2, 3 };
+    const float32x4_t laneOffsets = vld1q_f32 (laneValues);
+    const float32x4_t amplitude = vdupq_n_f32 (127.0f);
+    const float32x4_t phase = vdupq_n_f32 (tb.tReduced);
+    const uint32x4_t splat = vdupq_n_u32 (0x01010101);
+
+    for (int y = yBegin; y < yEnd; ++y)
+    {
+        unsigned int* row = reinterpret_cast<unsigned int*>(dst + (size_t)y * stride);
+        const float rowTerm = tb.rows[y];
+        const float32x4_t rowTermV = vdupq_n_f32 (rowTerm);
+        const float32x4_t yy = vdupq_n_f32 (float(y) * float(y));
+        const float* diagonals = &tb.diagonals[y];
+
+        int x = 0;
+        for (; x + 4 <= tb.width; x += 4)
+        {
+            const float32x4_t xf = vaddq_f32 (vdupq_n_f32 (float(x)), laneOffsets);
+            const float32x4_t radius = vsqrtq_f32 (vaddq_f32 (vmulq_f32 (xf, xf), yy));
+            const float32x4_t s = SinNEON (vsubq_f32 (vmulq_n_f32 (radius, 0.25f), phase));
+            const float32x4_t radial = vaddq_f32 (amplitude, vmulq_f32 (amplitude, s));
+
+            float32x4_t sum = vaddq_f32 (vld1q_f32 (&tb.columns[x]), rowTermV);
+            sum = vaddq_f32 (sum, vld1q_f32 (diagonals + x));
+            sum = vaddq_f32 (sum, radial);
+
+            const uint32x4_t vv = vshrq_n_u32 (vcvtq_u32_f32 (sum), 2);
+            vst1q_u32 (row + x, vmulq_u32 (vv, splat));
+        }
+        for (; x < tb.width; ++x)
+            row[x] = PlasmaPixelScalar (tb, x, y, rowTerm);
+    }
+}
+
+#endif // PLASMA_NEON
+
+
+// --------------------------------------------------------------------------
+// Dispatch
+
+bool IsPlasmaKernelSupported (PlasmaKernel kernel)
+{
+    switch (kernel)
+    {
+    case kPlasmaKernelAuto:
+    case kPlasmaKernelScalar:
+        return true;
+    #if PLASMA_X86
+    case kPlasmaKernelSSE41:
+        return CpuSupportsSSE41 ();
+    case kPlasmaKernelAVX2:
+        return CpuSupportsAVX2 ();
+    #endif
+    #if PLASMA_NEON
+    case kPlasmaKernelNEON:
+        return true;
+    #endif
+    default:
+        return false;
+    }
+}
+
+PlasmaKernel GetBestPlasmaKernel ()
+{
+    static const PlasmaKernel s_Best =
+        IsPlasmaKernelSupported (kPlasmaKernelAVX2) ? kPlasmaKernelAVX2 :
+        IsPlasmaKernelSupported (kPlasmaKernelSSE41) ? kPlasmaKernelSSE41 :
+        IsPlasmaKernelSupported (kPlasmaKernelNEON) ? kPlasmaKernelNEON :
+        kPlasmaKernelScalar;
+    return s_Best;
+}
+
+const char* GetPlasmaKernelName (PlasmaKernel kernel)
+{
+    switch (kernel)
+    {
+    case kPlasmaKernelAuto:   return GetPlasmaKernelName (GetBestPlasmaKernel ());
+    case kPlasmaKernelScalar: return "scalar";
+    case kPlasmaKernelSSE41:  return "sse4.1";
+    case kPlasmaKernelAVX2:   return "avx2";
+    case kPlasmaKernelNEON:   return "neon";
+    }
+    return "unknown";
+}
+
+void FillPlasmaRows (const PlasmaTables& tables, int yBegin, int yEnd, int stride, unsigned char* dst, PlasmaKernel kernel)
+{
+    if (kernel == kPlasmaKernelAuto || !IsPlasmaKernelSupported (kernel))
+        kernel = GetBestPlasmaKernel ();
+    if (yEnd > tables.height)
+        yEnd = tables.height;
+
+    switch (kernel)
+    {
+    #if PLASMA_X86
+    case kPlasmaKernelAVX2:
+        FillRowsAVX2 (tables, yBegin, yEnd, stride, dst);
+        return;
+    case kPlasmaKernelSSE41:
+        FillRowsSSE41 (tables, yBegin, yEnd, stride, dst);
+        return;
+    #endif
+    #if PLASMA_NEON
+    case kPlasmaKernelNEON:
+        FillRowsNEON (tables, yBegin, yEnd, stride, dst);
+        return;
+    #endif
+    default:
+        FillRowsScalar (tables, yBegin, yEnd, stride, dst);
+        return;
+    }
+}
+
+void FillPlasma (PlasmaTables& tables, int width, int height, int stride, unsigned char* dst, float t, PlasmaKernel kernel)
+{
+    tables.Prepare (width, height, t);
+    FillPlasmaRows (tables, 0, height, stride, dst, kernel);
+}
+
+
+// --------------------------------------------------------------------------
+// Row bands
+
+enum { kPlasmaBandsPerThread = 4 };
+
+static void FillPlasmaBand (int band, void* userData)
+{
+    PLUGIN_TRACE_ZONE ("FillPlasmaBand");
+    const PlasmaFillJob& job = *static_cast<const PlasmaFillJob*>(userData);
+    const int yBegin = band * job.rowsPerBand;
+    FillPlasmaRows (*job.tables, yBegin, yBegin + job.rowsPerBand, job.stride, job.dst, job.kernel);
+}
+
+void BeginFillPlasmaParallel (WorkerPool& pool, PlasmaFillJob& job, PlasmaTables& tables, int width, int height, int stride, unsigned char* dst, float t, PlasmaKernel kernel)
+{
+    // The tables may still be in use by the previous fill
+    pool.Wait ();
+    tables.Prepare (width, height, t);
+
+    // A few bands per thread so a slow core does not hold everyone up
+    const int threads = pool.GetWorkerCount () + 1;
+    job.tables = &tables;
+    job.rowsPerBand = ComputeRowBandHeight (height, stride, threads * kPlasmaBandsPerThread);
+    job.stride = stride;
+    job.dst = dst;
+    job.kernel = kernel == kPlasmaKernelAuto ? GetBestPlasmaKernel () : kernel;
+
+    const int bands = (height + job.rowsPerBand - 1) / job.rowsPerBand;
+    pool.Dispatch (bands, FillPlasmaBand, &job);
+}
+
+void FillPlasmaParallel (WorkerPool& pool, PlasmaTables& tables, int width, int height, int stride, unsigned char* dst, float t, PlasmaKernel kernel)
+{
+    PlasmaFillJob job;
+    BeginFillPlasmaParallel (pool, job, tables, width, height, stride, dst, t, kernel);
+    pool.Wait ();
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <vector>
+
+// --------------------------------------------------------------------------
+// Plasma kernel
+//
+// The procedural "plasma" fill from FillTextureFromCode: per pixel
+//
+//   vv = int( (127 + 127 sin(x/7 + t)) + (127 + 127 sin(y/5 - t))
+//           + (127 + 127 sin((x+y)/6 - t)) + (127 + 127 sin(|(x,y)|/4 - t)) ) / 4
+//
+// written to all four bytes of an RGBA8 pixel. The x-only, y-only and x+y
+// terms are computed once per column / row / diagonal into tables; only the
+// radial term is evaluated per pixel, with a vectorized polynomial sine on
+// AVX2 (8 pixels per iteration), SSE4.1 or NEON (4 pixels). Results stay
+// within 1 LSB of FillPlasmaReference.
+
+enum PlasmaKernel
+{
+    kPlasmaKernelAuto,      // best one the CPU supports
+    kPlasmaKernelScalar,    // tables, scalar sinf for the radial term
+    kPlasmaKernelSSE41,
+    kPlasmaKernelAVX2,
+    kPlasmaKernelNEON,
+};
+
+bool IsPlasmaKernelSupported (PlasmaKernel kernel);
+PlasmaKernel GetBestPlasmaKernel ();
+const char* GetPlasmaKernelName (PlasmaKernel kernel);
+
+// Per-frame tables shared by every row. Prepare reuses its storage, so it
+// only allocates when the texture grows.
+struct PlasmaTables
+{
+    PlasmaTables () : width (0), height (0), t (0), tReduced (0) {}
+
+    void Prepare (int width, int height, float t);
+
+    int width, height;
+    float t;                        // animation phase (g_Time * 4 in the plugin)
+    float tReduced;                 // t mod 2pi, for the vectorized sine
+    std::vector<float> columns;     // 127 + 127 sin(x/7 + t), width entries
+    std::vector<float> rows;        // 127 + 127 sin(y/5 - t), height entries
+    std::vector<float> diagonals;   // 127 + 127 sin((x+y)/6 - t), width+height entries
+};
+
+// Fills rows [yBegin, yEnd). dst points at row 0 of the image, so bands of
+// the same image can be filled independently (and concurrently).
+void FillPlasmaRows (const PlasmaTables& tables, int yBegin, int yEnd, int stride, unsigned char* dst, PlasmaKernel kernel = kPlasmaKernelAuto);
+
+// Prepare + all rows.
+void FillPlasma (PlasmaTables& tables, int width, int height, int stride, unsigned char* dst, float t, PlasmaKernel kernel = kPlasmaKernelAuto);
+
+// Prepare on the calling thread, then the rows in cache-line aligned bands
+// spread over the pool (the caller takes bands too).
+class WorkerPool;
+void FillPlasmaParallel (WorkerPool& pool, PlasmaTables& tables, int width, int height, int stride, unsigned char* dst, float t, PlasmaKernel kernel = kPlasmaKernelAuto);
+
+// Asynchronous version: returns once the bands are handed to the pool, and
+// the image is complete after pool.Wait(). job and tables must stay alive
+// (and tables untouched) until then.
+struct PlasmaFillJob
+{
+    const PlasmaTables* tables;
+    int rowsPerBand;
+    int stride;
+    unsigned char* dst;
+    PlasmaKernel kernel;
+};
+void BeginFillPlasmaParallel (WorkerPool& pool, PlasmaFillJob& job, PlasmaTables& tables, int width, int height, int stride, unsigned char* dst, float t, PlasmaKernel kernel = kPlasmaKernelAuto);
+
+// The original per-pixel scalar code, kept as the reference.
+void FillPlasmaReference (int width, int height, int stride, unsigned char* dst, float t);
@@ -0,0 +1,159 @@
+#include "PluginStats.h"
+
+#include <chrono>
+#include <new>
+#include <stdio.h>
+#include <string.h>
+
+#if defined(__linux__)
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+    #define PLUGIN_STATS_SHARED_MEMORY 1
+#elif defined(_WIN32)
+    #include <windows.h>
+    #define PLUGIN_STATS_SHARED_MEMORY 0
+#else
+    #include <unistd.h>
+    #define PLUGIN_STATS_SHARED_MEMORY 0
+#endif
+
+uint64_t PluginStatsNow ()
+{
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+uint32_t GetPluginStatsProcessId ()
+{
+    #if defined(_WIN32)
+    return (uint32_t)GetCurrentProcessId ();
+    #else
+    return (uint32_t)getpid ();
+    #endif
+}
+
+static void ResetPluginStats (PluginStats& stats)
+{
+    SetPluginStat (stats.renderEvents, 0);
+    SetPluginStat (stats.clears, 0);
+    SetPluginStat (stats.uploadBytes, 0);
+    SetPluginStat (stats.draws, 0);
+    SetPluginStat (stats.stateCallsElided, 0);
+    SetPluginStat (stats.renderEventNs, 0);
+    SetPluginStat (stats.doRenderingNs, 0);
+    SetPluginStat (stats.fillTextureNs, 0);
+    SetPluginStat (stats.fillsOverlapped, 0);
+    stats.version = kPluginStatsVersion;
+    stats.size = sizeof(PluginStats);
+    stats.processId = GetPluginStatsProcessId ();
+
+    // Readers that see the magic see the rest of the header too
+    std::atomic_thread_fence (std::memory_order_release);
+    stats.magic = kPluginStatsMagic;
+}
+
+std::string GetPluginStatsPageName (uint32_t processId)
+{
+    char name[64];
+    snprintf (name, sizeof(name), "/RenderingPluginStats.%u", (unsigned)processId);
+    return name;
+}
+
+
+// --------------------------------------------------------------------------
+// PluginStatsPage
+
+PluginStatsPage::PluginStatsPage ()
+    : m_Stats (&m_Private)
+{
+    ResetPluginStats (m_Private);
+}
+
+PluginStatsPage::~PluginStatsPage ()
+{
+    Close ();
+}
+
+void PluginStatsPage::Open (const char* name)
+{
+    Close ();
+
+    #if PLUGIN_STATS_SHARED_MEMORY
+    if (name && *name)
+    {
+        const int fd = shm_open (name, O_RDWR | O_CREAT, 0644);
+        if (fd >= 0)
+        {
+            void* view = MAP_FAILED;
+            if (ftruncate (fd, sizeof(PluginStats)) == 0)
+                view = mmap (NULL, sizeof(PluginStats), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            close (fd);
+            if (view != MAP_FAILED)
+            {
+                m_Stats = new (view) PluginStats;
+                m_Name = name;
+            }
+            else
+                shm_unlink (name);
+        }
+    }
+    #else
+    (void)name;
+    #endif
+
+    ResetPluginStats (*m_Stats);
+}
+
+void PluginStatsPage::Close ()
+{
+    #if PLUGIN_STATS_SHARED_MEMORY
+    if (IsShared ())
+    {
+        munmap (m_Stats, sizeof(PluginStats));
+        shm_unlink (m_Name.c_str ());
+    }
+    #endif
+    m_Stats = &m_Private;
+    m_Name.clear ();
+}
+
+
+// --------------------------------------------------------------------------
+// Reader side
+
+const PluginStats* MapPluginStatsPage (const char* name)
+{
+    #if PLUGIN_STATS_SHARED_MEMORY
+    const int fd = shm_open (name, O_RDONLY, 0);
+    if (fd < 0)
+        return NULL;
+    struct stat st;
+    void* view = MAP_FAILED;
+    if (fstat (fd, &st) == 0 && st.st_size >= (off_t)sizeof(PluginStats))
+        view = mmap (NULL, sizeof(PluginStats), PROT_READ, MAP_SHARED, fd, 0);
+    close (fd);
+    if (view == MAP_FAILED)
+        return NULL;
+    const PluginStats* stats = (const PluginStats*)view;
+    if (stats->magic != kPluginStatsMagic || stats->version != kPluginStatsVersion || stats->size != sizeof(PluginStats))
+    {
+        munmap (view, sizeof(PluginStats));
+        return NULL;
+    }
+    return stats;
+    #else
+    (void)name;
+    return NULL;
+    #endif
+}
+
+void UnmapPluginStatsPage (const PluginStats* stats)
+{
+    #if PLUGIN_STATS_SHARED_MEMORY
+    if (stats)
+        munmap ((void*)stats, sizeof(PluginStats));
+    #else
+    (void)stats;
+    #endif
+}
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <atomic>
+#include <stdint.h>
+#include <string>
+
+// --------------------------------------------------------------------------
+// Plugin stats
+//
+// Cumulative per-process counters of what the plugin did and how long it
+// took, in a fixed layout that readers outside the plugin can rely on:
+// scripts get a pointer to it from GetPluginStats, and on Linux the same
+// page is a named shared-memory object (/dev/shm/RenderingPluginStats.<pid>)
+// that a monitor can map and sample without calling into the plugin at all.
+// Readers check magic, version and size, then read the counters; each one
+// is a naturally aligned 64-bit value, so a read never tears.
+//
+// Only the render thread writes the counters, so adding to one is a plain
+// load and store rather than a locked read-modify-write.
+
+enum
+{
+    kPluginStatsMagic = 0x54535052,     // "RPST"
+    kPluginStatsVersion = 2,
+};
+
+struct PluginStats
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t size;                      // sizeof(PluginStats)
+    uint32_t processId;
+
+    std::atomic<uint64_t> renderEvents;         // OnRenderEvent calls
+    std::atomic<uint64_t> clears;               // clears executed
+    std::atomic<uint64_t> uploadBytes;          // texture data uploaded
+    std::atomic<uint64_t> draws;                // draw calls (instanced ones count once)
+    std::atomic<uint64_t> stateCallsElided;     // redundant state calls skipped
+    std::atomic<uint64_t> renderEventNs;        // in OnRenderEvent
+    std::atomic<uint64_t> doRenderingNs;        // in DoRendering
+    std::atomic<uint64_t> fillTextureNs;        // render thread time on the procedural fill
+                                                // (starting it, waiting for the workers)
+    std::atomic<uint64_t> fillsOverlapped;      // procedural fills still running on the workers
+                                                // when the event that started them returned
+};
+
+static_assert (sizeof(std::atomic<uint64_t>) == 8, "PluginStats counters must be plain 64-bit values");
+static_assert (sizeof(PluginStats) == 16 + 9 * 8, "PluginStats layout is read from outside the plugin");
+
+static inline void AddPluginStat (std::atomic<uint64_t>& counter, uint64_t value)
+{
+    counter.store (counter.load (std::memory_order_relaxed) + value, std::memory_order_relaxed);
+}
+
+static inline void SetPluginStat (std::atomic<uint64_t>& counter, uint64_t value)
+{
+    counter.store (value, std::memory_order_relaxed);
+}
+
+// Monotonic nanoseconds for the timers.
+uint64_t PluginStatsNow ();
+
+// Adds the time between construction and destruction to a counter.
+class PluginStatsTimer
+{
+public:
+    explicit PluginStatsTimer (std::atomic<uint64_t>& counter) : m_Counter (counter), m_Start (PluginStatsNow ()) {}
+    ~PluginStatsTimer () { AddPluginStat (m_Counter, PluginStatsNow () - m_Start); }
+
+private:
+    PluginStatsTimer (const PluginStatsTimer&);
+    PluginStatsTimer& operator= (const PluginStatsTimer&);
+
+    std::atomic<uint64_t>& m_Counter;
+    uint64_t m_Start;
+};
+
+
+// --------------------------------------------------------------------------
+// PluginStatsPage
+//
+// Where the stats live. Open puts them in a named shared-memory object
+// where the platform has one (POSIX shm on Linux) and falls back to
+// process-private storage otherwise, so Get never returns NULL.
+
+class PluginStatsPage
+{
+public:
+    PluginStatsPage ();
+    ~PluginStatsPage ();
+
+    // Zeroes the counters. name NULL, or no shared memory, keeps them private.
+    void Open (const char* name);
+    void Close ();
+
+    PluginStats* Get () { return m_Stats; }
+    bool IsShared () const { return m_Stats != &m_Private; }
+    const char* GetName () const { return m_Name.c_str (); }   // empty unless shared
+
+private:
+    PluginStatsPage (const PluginStatsPage&);
+    PluginStatsPage& operator= (const PluginStatsPage&);
+
+    PluginStats* m_Stats;
+    PluginStats m_Private;
+    std::string m_Name;
+};
+
+uint32_t GetPluginStatsProcessId ();
+
+// Default shared-memory name for the stats of process processId.
+std::string GetPluginStatsPageName (uint32_t processId);
+
+// Reader side, for monitors: maps another process's stats read-only. NULL
+// when there is no such page or it does not match this layout.
+const PluginStats* MapPluginStatsPage (const char* name);
+void UnmapPluginStatsPage (const PluginStats* stats);
@@ -0,0 +1,115 @@
+#include "RecordedPass.h"
+
+#include <string.h>
+
+RecordedPass::RecordedPass ()
+    : m_OpCount (0)
+    , m_Recording (false)
+    , m_Recorded (false)
+{
+}
+
+void RecordedPass::Begin ()
+{
+    m_Code.clear ();
+    m_OpCount = 0;
+    m_Recording = true;
+    m_Recorded = false;
+}
+
+void RecordedPass::End ()
+{
+    m_Recorded = m_Recording;
+    m_Recording = false;
+}
+
+// Reserves an op with argumentBytes of arguments and returns where they go
+void* RecordedPass::AppendOp (RecordedOp op, size_t argumentBytes)
+{
+    if (!m_Recording)
+        return NULL;
+    const size_t offset = m_Code.size();
+    const size_t size = (sizeof(RecordedOpHeader) + argumentBytes + 3) & ~size_t(3);
+    m_Code.resize (offset + size);
+    RecordedOpHeader* header = (RecordedOpHeader*)&m_Code[offset];
+    header->op = op;
+    header->size = (uint32_t)size;
+    ++m_OpCount;
+    return header + 1;
+}
+
+void RecordedPass::SetTarget (TextureHandle texture)
+{
+    if (RecordedSetTarget* args = (RecordedSetTarget*)AppendOp (kRecordedOpSetTarget, sizeof(RecordedSetTarget)))
+        args->texture = texture;
+}
+
+void RecordedPass::Clear (const float color[4], const ClearRect* rect)
+{
+    if (RecordedClear* args = (RecordedClear*)AppendOp (kRecordedOpClear, sizeof(RecordedClear)))
+    {
+        memcpy (args->color, color, sizeof(args->color));
+        if (rect)
+            args->rect = *rect;
+        else
+            memset (&args->rect, 0, sizeof(args->rect));
+    }
+}
+
+void RecordedPass::DrawTriangles (int matrixSlot, const SoftwareVertex* verts, int vertexCount)
+{
+    if (matrixSlot < 0 || matrixSlot >= kRecordedPassMatrixSlots || vertexCount <= 0)
+        return;
+    const size_t vertexBytes = (size_t)vertexCount * sizeof(SoftwareVertex);
+    if (RecordedDrawTriangles* args = (RecordedDrawTriangles*)AppendOp (kRecordedOpDrawTriangles, sizeof(RecordedDrawTriangles) + vertexBytes))
+    {
+        args->matrixSlot = matrixSlot;
+        args->vertexCount = vertexCount;
+        memcpy (args + 1, verts, vertexBytes);
+    }
+}
+
+int RecordedPass::Replay (const RecordedPassConstants& constants, CpuSurfaceResolver resolve, void* userData) const
+{
+    if (!m_Recorded || m_Code.empty())
+        return 0;
+
+    int executed = 0;
+    CpuSurface* target = NULL;
+    const unsigned char* code = &m_Code[0];
+    const unsigned char* end = code + m_Code.size();
+    while (code < end)
+    {
+        const RecordedOpHeader* header = (const RecordedOpHeader*)code;
+        const void* args = header + 1;
+        switch (header->op)
+        {
+        case kRecordedOpSetTarget:
+            target = resolve (((const RecordedSetTarget*)args)->texture, userData);
+            break;
+
+        case kRecordedOpClear:
+            if (target)
+            {
+                const RecordedClear* clear = (const RecordedClear*)args;
+                ClearCpuSurface (*target, clear->color, &clear->rect);
+                ++executed;
+            }
+            break;
+
+        case kRecordedOpDrawTriangles:
+            if (target)
+            {
+                const RecordedDrawTriangles* draw = (const RecordedDrawTriangles*)args;
+                SoftwareDrawTriangles (*target, constants.matrices[draw->matrixSlot], (const SoftwareVertex*)(draw + 1), draw->vertexCount);
+                ++executed;
+            }
+            break;
+
+        default:
+            break;
+        }
+        code += header->size;
+    }
+    return executed;
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include "ClearCommands.h"
+#include "SoftwareRenderer.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+// --------------------------------------------------------------------------
+// Recorded passes
+//
+// CPU backend counterpart of a D3D11 command list: a pass that is the same
+// every frame is encoded once into a compact bytecode and then replayed,
+// instead of being issued call by call. What does change from frame to
+// frame (the world matrix) is not part of the recording; draws name a
+// matrix slot, and each replay takes the slots' current values.
+//
+// The bytecode is a sequence of ops, each a RecordedOpHeader followed by its
+// arguments (and, for draws, the vertices). Replay walks it once with no
+// allocation; recording allocates as the code grows.
+
+enum RecordedOp
+{
+    kRecordedOpSetTarget,           // RecordedSetTarget
+    kRecordedOpClear,               // RecordedClear
+    kRecordedOpDrawTriangles,       // RecordedDrawTriangles, then the vertices
+    kRecordedOpCount
+};
+
+struct RecordedOpHeader
+{
+    uint32_t op;                    // RecordedOp
+    uint32_t size;                  // bytes, header included; a multiple of 4
+};
+
+struct RecordedSetTarget
+{
+    TextureHandle texture;
+};
+
+struct RecordedClear
+{
+    float color[4];
+    ClearRect rect;                 // width or height <= 0: whole target
+};
+
+struct RecordedDrawTriangles
+{
+    int matrixSlot;                 // into RecordedPassConstants::matrices
+    int vertexCount;
+};
+
+enum { kRecordedPassMatrixSlots = 4 };
+
+// The per-frame values a replay patches in
+struct RecordedPassConstants
+{
+    float matrices[kRecordedPassMatrixSlots][16];
+};
+
+
+class RecordedPass
+{
+public:
+    RecordedPass ();
+
+    // Starts a new recording, dropping the previous one.
+    void Begin ();
+    void SetTarget (TextureHandle texture);
+    void Clear (const float color[4], const ClearRect* rect = NULL);
+    void DrawTriangles (int matrixSlot, const SoftwareVertex* verts, int vertexCount);
+    void End ();
+
+    bool IsRecorded () const { return m_Recorded; }
+    size_t GetCodeSize () const { return m_Code.size(); }
+    int GetOpCount () const { return m_OpCount; }
+
+    // Executes the recording against the surfaces resolve returns. Ops
+    // before the first SetTarget, or after one that does not resolve, are
+    // skipped. Returns the number of clears and draws performed.
+    int Replay (const RecordedPassConstants& constants, CpuSurfaceResolver resolve, void* userData) const;
+
+private:
+    void* AppendOp (RecordedOp op, size_t argumentBytes);
+
+    std::vector<unsigned char> m_Code;
+    int m_OpCount;
+    bool m_Recording;
+    bool m_Recorded;
+};
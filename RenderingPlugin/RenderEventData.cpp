@@ -0,0 +1,45 @@
+#include "RenderEventData.h"
+
+#include <string.h>
+
+const RenderEventData* CopyRenderEventData (FrameArena& arena, const void* data)
+{
+    if (!data)
+        return NULL;
+
+    // The script's struct may be anywhere; read it through memcpy
+    RenderEventData source;
+    memcpy (&source.size, data, sizeof(source.size));
+    if (source.size != sizeof(RenderEventData))
+        return NULL;
+    memcpy (&source, data, sizeof(source));
+    if (source.rectCount < 0 || source.rectCount > kMaxRenderEventRects || (source.rectCount > 0 && !source.rects))
+        return NULL;
+
+    RenderEventData* copy = arena.Copy (&source, 1);
+    if (!copy)
+        return NULL;
+    if (source.rectCount > 0)
+    {
+        ClearRect* rects = arena.Copy (source.rects, (size_t)source.rectCount);
+        if (!rects)
+            return NULL;
+        copy->rects = rects;
+    }
+    else
+        copy->rects = NULL;
+    return copy;
+}
+
+int PushRenderEventClears (const RenderEventData& data, ClearCommandBuffer& clears)
+{
+    if (!(data.fields & kRenderEventDataClear))
+        return 0;
+    if (data.rectCount == 0)
+        return clears.Push (data.texture, data.color) ? 1 : 0;
+
+    int pushed = 0;
+    for (int i = 0; i < data.rectCount; ++i)
+        pushed += clears.Push (data.texture, data.color, &data.rects[i]) ? 1 : 0;
+    return pushed;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "ClearCommands.h"
+#include "FrameArena.h"
+
+#include <stdint.h>
+
+// --------------------------------------------------------------------------
+// Render event data
+//
+// Payload of a render event issued with IssuePluginEventAndData: what the
+// script would otherwise send through separate calls before the event
+// (SetTimeFromUnity, QueueClearTexture...), each of them a managed to native
+// transition of its own. The script fills one struct per event and passes
+// its address; the render thread copies it, rects included, into the frame
+// arena before acting on it, so the script may reuse its memory as soon as
+// the event has run.
+
+enum RenderEventDataFields
+{
+    kRenderEventDataTime = 1 << 0,      // time replaces the one from SetTimeFromUnity
+    kRenderEventDataClear = 1 << 1,     // clear texture to color, in rects (or whole)
+};
+
+enum { kMaxRenderEventRects = 1024 };
+
+// Blittable layout shared with scripts (see UseRenderingPlugin.cs).
+struct RenderEventData
+{
+    uint32_t size;              // sizeof(RenderEventData); anything else is rejected
+    uint32_t fields;            // RenderEventDataFields that are set
+    float time;
+    TextureHandle texture;
+    float color[4];
+    int rectCount;              // 0 clears the whole texture
+    const ClearRect* rects;
+};
+
+// Validates data and copies it into arena, pointing rects at the arena's
+// copy. Returns NULL when data is malformed (size, rect count) or the arena
+// is full.
+const RenderEventData* CopyRenderEventData (FrameArena& arena, const void* data);
+
+// Queues the clears the data asks for; returns how many were accepted.
+int PushRenderEventClears (const RenderEventData& data, ClearCommandBuffer& clears);
@@ -0,0 +1,29 @@
+#include "RenderEventTable.h"
+
+#include <stddef.h>
+
+RenderEventTable::RenderEventTable (RenderEventFn fallback)
+    : m_Fallback (fallback)
+{
+    for (int i = 0; i < kMaxEvents; ++i)
+        m_Handlers[i] = fallback;
+}
+
+bool RenderEventTable::Register (int eventID, RenderEventFn fn)
+{
+    if ((unsigned)eventID >= (unsigned)kMaxEvents || fn == NULL)
+        return false;
+    m_Handlers[eventID] = fn;
+    return true;
+}
+
+void RenderEventTable::Unregister (int eventID)
+{
+    if ((unsigned)eventID < (unsigned)kMaxEvents)
+        m_Handlers[eventID] = m_Fallback;
+}
+
+bool RenderEventTable::IsRegistered (int eventID) const
+{
+    return (unsigned)eventID < (unsigned)kMaxEvents && m_Handlers[eventID] != m_Fallback;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+// --------------------------------------------------------------------------
+// RenderEventTable
+//
+// Maps the eventID of a plugin render event (GL.IssuePluginEvent,
+// CommandBuffer.IssuePluginEvent) to the handler that does just that piece
+// of work. The table is a flat array of function pointers with every slot
+// filled -- IDs without a handler of their own point at the fallback -- so
+// dispatching is one bounds check, one load and an indirect call.
+//
+// Handlers are registered while the plugin loads, before the first render
+// event; the table is not synchronized.
+
+typedef void (*RenderEventFn) (int eventID);
+
+class RenderEventTable
+{
+public:
+    enum { kMaxEvents = 64 };
+
+    explicit RenderEventTable (RenderEventFn fallback);
+
+    // False when eventID is out of range.
+    bool Register (int eventID, RenderEventFn fn);
+    void Unregister (int eventID);
+
+    // IDs outside the table go to the fallback too.
+    void Dispatch (int eventID) const
+    {
+        const RenderEventFn fn = (unsigned)eventID < (unsigned)kMaxEvents ? m_Handlers[eventID] : m_Fallback;
+        fn (eventID);
+    }
+
+    bool IsRegistered (int eventID) const;
+    RenderEventFn GetFallback () const { return m_Fallback; }
+
+private:
+    RenderEventFn m_Fallback;
+    RenderEventFn m_Handlers[kMaxEvents];
+};
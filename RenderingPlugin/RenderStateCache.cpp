@@ -0,0 +1,43 @@
+#include "RenderStateCache.h"
+
+#include <stddef.h>
+
+RenderStateCache::RenderStateCache ()
+    : m_Issued (0)
+    , m_Elided (0)
+{
+    Invalidate ();
+}
+
+bool RenderStateCache::Update (RenderStateSlot slot, const void* object, uintptr_t arg0, uintptr_t arg1)
+{
+    Entry& entry = m_Entries[slot];
+    if (entry.valid && entry.object == object && entry.arg0 == arg0 && entry.arg1 == arg1)
+    {
+        ++m_Elided;
+        return false;
+    }
+    entry.object = object;
+    entry.arg0 = arg0;
+    entry.arg1 = arg1;
+    entry.valid = true;
+    ++m_Issued;
+    return true;
+}
+
+void RenderStateCache::Forget (RenderStateSlot slot)
+{
+    m_Entries[slot].valid = false;
+    ++m_Issued;
+}
+
+void RenderStateCache::Invalidate ()
+{
+    for (int i = 0; i < kRenderStateSlotCount; ++i)
+    {
+        m_Entries[i].object = NULL;
+        m_Entries[i].arg0 = 0;
+        m_Entries[i].arg1 = 0;
+        m_Entries[i].valid = false;
+    }
+}
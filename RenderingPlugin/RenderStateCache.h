@@ -0,0 +1,165 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// --------------------------------------------------------------------------
+// Render state cache
+//
+// Shadow copy of the pipeline state the plugin sets on the immediate
+// context, so calls that would set what is already bound can be skipped.
+// RenderStateCache is backend-neutral: it only remembers an object pointer
+// plus up to two integer arguments per slot and counts issued and elided
+// calls. StateFilteredContext wraps anything with the ID3D11DeviceContext
+// method names (the real context, or a recording mock) and routes the
+// tracked Set* calls through the cache; everything else goes to Get().
+//
+// Unity may change the context between plugin events, so the cache has to
+// be invalidated whenever control has left the plugin; after Invalidate the
+// next call to every slot is issued.
+
+enum RenderStateSlot
+{
+    kRenderStateDepthStencil,
+    kRenderStateRasterizer,
+    kRenderStateBlend,
+    kRenderStateVertexShader,
+    kRenderStatePixelShader,
+    kRenderStateVSConstantBuffer0,
+    kRenderStateInputLayout,
+    kRenderStatePrimitiveTopology,
+    kRenderStateVertexBuffer0,
+    kRenderStateSlotCount
+};
+
+class RenderStateCache
+{
+public:
+    RenderStateCache ();
+
+    // Returns true when the call must be issued (and records the new
+    // value), false when it would be redundant.
+    bool Update (RenderStateSlot slot, const void* object, uintptr_t arg0 = 0, uintptr_t arg1 = 0);
+
+    // For calls the cache cannot describe: they are always issued (and
+    // counted as such), and the slot is unknown until set again.
+    void Forget (RenderStateSlot slot);
+    void Invalidate ();
+
+    uint64_t GetIssuedCount () const { return m_Issued; }
+    uint64_t GetElidedCount () const { return m_Elided; }
+    void ResetCounters () { m_Issued = m_Elided = 0; }
+
+private:
+    struct Entry
+    {
+        const void* object;
+        uintptr_t arg0, arg1;
+        bool valid;
+    };
+
+    Entry m_Entries[kRenderStateSlotCount];
+    uint64_t m_Issued;
+    uint64_t m_Elided;
+};
+
+
+// Filters the state calls of Context through a RenderStateCache. The
+// method signatures follow ID3D11DeviceContext; calls the cache cannot
+// describe (blend factors, several buffers at once) are passed through and
+// forget the slot.
+template <typename Context>
+class StateFilteredContext
+{
+public:
+    StateFilteredContext (Context* context, RenderStateCache& cache) : m_Context (context), m_Cache (cache) {}
+
+    Context* Get () const { return m_Context; }
+
+    template <typename State>
+    void OMSetDepthStencilState (State* state, unsigned int stencilRef)
+    {
+        if (m_Cache.Update (kRenderStateDepthStencil, state, stencilRef))
+            m_Context->OMSetDepthStencilState (state, stencilRef);
+    }
+
+    template <typename State>
+    void RSSetState (State* state)
+    {
+        if (m_Cache.Update (kRenderStateRasterizer, state))
+            m_Context->RSSetState (state);
+    }
+
+    template <typename State>
+    void OMSetBlendState (State* state, const float blendFactor[4], unsigned int sampleMask)
+    {
+        if (blendFactor)
+        {
+            m_Cache.Forget (kRenderStateBlend);
+            m_Context->OMSetBlendState (state, blendFactor, sampleMask);
+        }
+        else if (m_Cache.Update (kRenderStateBlend, state, sampleMask))
+            m_Context->OMSetBlendState (state, blendFactor, sampleMask);
+    }
+
+    // Shaders without class instances, which is all the plugin uses
+    template <typename Shader>
+    void VSSetShader (Shader* shader)
+    {
+        if (m_Cache.Update (kRenderStateVertexShader, shader))
+            m_Context->VSSetShader (shader, NULL, 0);
+    }
+
+    template <typename Shader>
+    void PSSetShader (Shader* shader)
+    {
+        if (m_Cache.Update (kRenderStatePixelShader, shader))
+            m_Context->PSSetShader (shader, NULL, 0);
+    }
+
+    template <typename Buffer>
+    void VSSetConstantBuffers (unsigned int startSlot, unsigned int count, Buffer* const* buffers)
+    {
+        if (startSlot == 0 && count == 1)
+        {
+            if (m_Cache.Update (kRenderStateVSConstantBuffer0, buffers[0]))
+                m_Context->VSSetConstantBuffers (startSlot, count, buffers);
+            return;
+        }
+        if (startSlot == 0)
+            m_Cache.Forget (kRenderStateVSConstantBuffer0);
+        m_Context->VSSetConstantBuffers (startSlot, count, buffers);
+    }
+
+    template <typename Layout>
+    void IASetInputLayout (Layout* layout)
+    {
+        if (m_Cache.Update (kRenderStateInputLayout, layout))
+            m_Context->IASetInputLayout (layout);
+    }
+
+    template <typename Topology>
+    void IASetPrimitiveTopology (Topology topology)
+    {
+        if (m_Cache.Update (kRenderStatePrimitiveTopology, NULL, (uintptr_t)topology))
+            m_Context->IASetPrimitiveTopology (topology);
+    }
+
+    template <typename Buffer>
+    void IASetVertexBuffers (unsigned int startSlot, unsigned int count, Buffer* const* buffers, const unsigned int* strides, const unsigned int* offsets)
+    {
+        if (startSlot == 0 && count == 1)
+        {
+            if (m_Cache.Update (kRenderStateVertexBuffer0, buffers[0], strides[0], offsets[0]))
+                m_Context->IASetVertexBuffers (startSlot, count, buffers, strides, offsets);
+            return;
+        }
+        if (startSlot == 0)
+            m_Cache.Forget (kRenderStateVertexBuffer0);
+        m_Context->IASetVertexBuffers (startSlot, count, buffers, strides, offsets);
+    }
+
+private:
+    Context* m_Context;
+    RenderStateCache& m_Cache;
+};
@@ -2,16 +2,42 @@
 #include "RenderingPlugin.h"
 #include "Unity/IUnityGraphics.h"
 
+#include "TextureRegistry.h"
+#include "ClearCommands.h"
+#include "FrameDesc.h"
+#include "GpuTimerRing.h"
+#include "InstanceBatch.h"
+#include "LogRing.h"
+#include "SpscQueue.h"
+#include "SoftwareRenderer.h"
+#include "PlasmaKernel.h"
+#include "PluginStats.h"
+#include "RecordedPass.h"
+#include "RenderEventData.h"
+#include "RenderEventTable.h"
+#include "RenderStateCache.h"
+#include "ResourceJournal.h"
+#include "ShaderLibrary.h"
+#include "SharedCommandRing.h"
+#include "TextureWorkGroups.h"
+#include "TraceZones.h"
+#include "TransientRingAllocator.h"
+#include "UploadRing.h"
+#include "WorkerPool.h"
+
 #include <math.h>
 #include <stdio.h>
+#include <string.h>
 #include <vector>
 #include <string>
+#include <thread>
 
 // --------------------------------------------------------------------------
 // Include headers for the graphics APIs we support
 
 #if SUPPORT_D3D11
     #include <d3d11.h>
+    #include <d3d11_1.h>
     #include "Unity/IUnityGraphicsD3D11.h"
 #endif
 
@@ -19,37 +45,95 @@
 // Helper utilities
 
 
-// Prints a string
+// Prints a string. Messages from any thread go into s_PluginLog;
+// FlushPluginLogs, called by scripts on the main thread, hands them to the
+// callbacks registered with LinkDebug, so logging never calls into managed
+// code from the render thread.
 extern "C"
 {
-void(_stdcall *debugLog)(const char *) = NULL;
-void(_stdcall *debugWarn)(const char *) = NULL;
-void(_stdcall *debugError)(const char *) = NULL;
+void(UNITY_INTERFACE_API *debugLog)(const char *) = NULL;
+void(UNITY_INTERFACE_API *debugWarn)(const char *) = NULL;
+void(UNITY_INTERFACE_API *debugError)(const char *) = NULL;
 
-void UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API LinkDebug(void(_stdcall *d)(const char *), void(_stdcall *w)(const char *), void(_stdcall *e)(const char *))
+void UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API LinkDebug(void(UNITY_INTERFACE_API *d)(const char *), void(UNITY_INTERFACE_API *w)(const char *), void(UNITY_INTERFACE_API *e)(const char *))
 {
     debugLog = d;
     debugWarn = w;
     debugError = e;
 }
+}
+
+static LogRing s_PluginLog;
 
 static void DebugLog (const char* str)
 {
-    if (debugLog)
-        debugLog(str);
+    if (kLogSeverityLog >= RENDERINGPLUGIN_LOG_MIN_SEVERITY)
+        s_PluginLog.Push(kLogSeverityLog, str);
 }
 
 static void DebugWarn (const char* str)
 {
-    if (debugWarn)
-        debugWarn(str);
+    if (kLogSeverityWarning >= RENDERINGPLUGIN_LOG_MIN_SEVERITY)
+        s_PluginLog.Push(kLogSeverityWarning, str);
 }
 
 static void DebugError (const char* str)
 {
-    if (debugError)
-        debugError(str);
+    if (kLogSeverityError >= RENDERINGPLUGIN_LOG_MIN_SEVERITY)
+        s_PluginLog.Push(kLogSeverityError, str);
+}
+
+// For messages that can fire every frame: at most one per intervalMs from
+// each call site, the next one that gets through counts the ones held back.
+#define DEBUG_LOG_RATE_LIMITED(severity, intervalMs, str) \
+    do \
+    { \
+        if ((severity) >= RENDERINGPLUGIN_LOG_MIN_SEVERITY) \
+        { \
+            static LogRateLimiter s_RateLimiter; \
+            uint32_t suppressed; \
+            if (s_RateLimiter.Allow((uint64_t)(intervalMs) * 1000000, &suppressed)) \
+                s_PluginLog.Push((severity), (str), suppressed); \
+        } \
+    } while (0)
+
+enum { kRepeatedLogIntervalMs = 1000 };
+
+static void ForwardPluginLogRecord(const LogRecord& record, void*)
+{
+    void (UNITY_INTERFACE_API *callback)(const char *) =
+        record.severity == kLogSeverityError ? debugError :
+        record.severity == kLogSeverityWarning ? debugWarn : debugLog;
+    if (!callback)
+        return;
+    if (!record.suppressed)
+    {
+        callback(record.text);
+        return;
+    }
+    int length = (int)strlen(record.text);
+    if (length > 0 && record.text[length - 1] == '\n')
+        --length;
+    char text[kLogRecordTextSize + 64];
+    snprintf(text, sizeof(text), "%.*s (%u more like it suppressed)\n", length, record.text, (unsigned)record.suppressed);
+    callback(text);
 }
+
+// Hands every queued message to the LinkDebug callbacks; main thread only.
+// Returns the number of messages flushed.
+extern "C" int UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API FlushPluginLogs()
+{
+    const int count = s_PluginLog.Drain(ForwardPluginLogRecord, NULL);
+    if (const uint32_t dropped = s_PluginLog.TakeDroppedCount())
+    {
+        if (debugWarn)
+        {
+            char text[96];
+            snprintf(text, sizeof(text), "%u plugin log messages dropped; flush more often.\n", (unsigned)dropped);
+            debugWarn(text);
+        }
+    }
+    return count;
 }
 
 
@@ -61,20 +145,84 @@ static void DebugError (const char* str)
 
 
 // --------------------------------------------------------------------------
-// SetTimeFromUnity, an example function we export which is called by one of the scripts.
+// GetPluginStats: counters for scripts and external monitors (see
+// PluginStats.h). The page is opened when the plugin loads; on Linux it is
+// shared memory named after the process id. The pointer stays valid until
+// the plugin unloads.
 
-static float g_Time;
+static PluginStatsPage s_StatsPage;
+
+static PluginStats& Stats()
+{
+    return *s_StatsPage.Get();
+}
+
+extern "C" const PluginStats* UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API GetPluginStats()
+{
+    return s_StatsPage.Get();
+}
+
+
+// --------------------------------------------------------------------------
+// WritePluginTrace: timelines of the plugin's threads (see TraceZones.h),
+// written as Chrome trace JSON for chrome://tracing or Perfetto. Any thread,
+// any time; returns the number of zones written, or -1 when the file cannot
+// be written.
+
+extern "C" int UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API WritePluginTrace(const char* path)
+{
+    return WriteChromeTrace(path);
+}
+
+
+// --------------------------------------------------------------------------
+// GetGpuTimings: GPU time of the plugin's passes in the latest frame read
+// back from the GPU (see GpuTimerRing.h), a few frames behind the one being
+// rendered. Any thread; returns 0 while nothing has been timed (no GPU
+// backend, or no results yet).
+
+static GpuTimingsMailbox s_GpuTimings;
 
-extern "C" void UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API SetTimeFromUnity (float t) { g_Time = t; }
+extern "C" int UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API GetGpuTimings(GpuTimings* timings)
+{
+    if (!timings)
+        return 0;
+    s_GpuTimings.Read(timings);
+    return timings->frame != 0;
+}
 
 
 // --------------------------------------------------------------------------
 // SetUnityStreamingAssetsPath, an example function we export which is called by one of the scripts.
 
+// Shader bytecode is embedded in the plugin when the build has it (see
+// ShaderLibrary.h). Blobs that were not embedded, or all of them with the disk
+// override on, are mapped on a background thread as soon as the path is known,
+// so the render thread never waits on the disk. Unity sets the path once at
+// startup, before the first render event.
+
+#if SUPPORT_D3D11
+static const bool kLoadMissingShadersFromDisk = true;
+#else
+static const bool kLoadMissingShadersFromDisk = false; // nothing would use them
+#endif
+
+static ShaderLibrary s_Shaders;
+static bool s_ShaderOverrideFromDisk = false;
+
 static std::string s_UnityStreamingAssetsPath;
 extern "C" void UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API SetUnityStreamingAssetsPath(const char* path)
 {
     s_UnityStreamingAssetsPath = path;
+    s_Shaders.SetDirectory(s_UnityStreamingAssetsPath + "/Shaders/DX11_9_1", s_ShaderOverrideFromDisk, kLoadMissingShadersFromDisk);
+}
+
+// For iterating on shaders without rebuilding the plugin: with the override
+// on, the .cso files in StreamingAssets replace the embedded bytecode. Call it
+// before SetUnityStreamingAssetsPath.
+extern "C" void UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API SetShaderOverrideFromDisk(int enabled)
+{
+    s_ShaderOverrideFromDisk = enabled != 0;
 }
 
 
@@ -83,17 +231,33 @@ extern "C" void UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API SetUnityStreamingAsse
 // UnitySetInterfaces
 
 static void UNITY_INTERFACE_API OnGraphicsDeviceEvent(UnityGfxDeviceEventType eventType);
+static void RegisterRenderEvents();
 
 static IUnityInterfaces* s_UnityInterfaces = NULL;
 static IUnityGraphics* s_Graphics = NULL;
 static UnityGfxRenderer s_DeviceType = kUnityGfxRendererNull;
 
+// Workers for splitting texture generation off the render thread. Created
+// once here rather than per frame.
+static WorkerPool s_WorkerPool;
+
+// Commands scripts write straight into plugin memory (see the shared command
+// ring section below)
+enum { kSharedCommandRingCapacity = 8192 };
+static SharedCommandRing s_SharedCommands;
+
 extern "C" void    UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API UnityPluginLoad(IUnityInterfaces* unityInterfaces)
 {
     s_UnityInterfaces = unityInterfaces;
     s_Graphics = s_UnityInterfaces->Get<IUnityGraphics>();
     s_Graphics->RegisterDeviceEventCallback(OnGraphicsDeviceEvent);
-    
+
+    s_WorkerPool.Start(WorkerPool::GetDefaultWorkerCount(), true);
+    RegisterRenderEvents();
+    if (!s_SharedCommands.Create(kSharedCommandRingCapacity))
+        DebugError("Failed to allocate the shared command ring.\n");
+    s_StatsPage.Open(GetPluginStatsPageName(GetPluginStatsProcessId()).c_str());
+
     // Run OnGraphicsDeviceEvent(initialize) manually on plugin load
     OnGraphicsDeviceEvent(kUnityGfxDeviceEventInitialize);
 }
@@ -101,279 +265,1551 @@ extern "C" void    UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API UnityPluginLoad(IU
 extern "C" void UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API UnityPluginUnload()
 {
     s_Graphics->UnregisterDeviceEventCallback(OnGraphicsDeviceEvent);
+    s_WorkerPool.Stop();
+    s_Shaders.Reset();
+    s_SharedCommands.Destroy();
+    s_StatsPage.Close();
+    FlushPluginLogs();
+}
+
+// Restarts the workers with count threads, or the default number when count
+// is negative, so hosts can run the parallel paths on any machine. Call it
+// while no render event is running.
+extern "C" void UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API SetWorkerThreadCount(int count)
+{
+    s_WorkerPool.Start(count < 0 ? WorkerPool::GetDefaultWorkerCount() : count, true);
 }
 
 
 
 // --------------------------------------------------------------------------
-// SetTextureFromUnity, an example function we export which is called by one of the scripts.
+// Texture registry: scripts register any number of textures and get back a
+// small integer handle; the render thread looks them up by handle in O(1).
+//
+// Handles are allocated on the main thread (s_TextureHandles) so the exports
+// can return them right away. The render thread keeps its own mirror
+// (s_Textures) that it updates from the command queue below, so neither
+// thread ever touches the other's registry.
+
+struct PluginTexture
+{
+    void* nativeTexture;
+    CpuSurface* cpuSurface;     // plugin-owned, software textures only
+    int width, height;          // 0 when unknown
+    #if SUPPORT_D3D11
+    ID3D11RenderTargetView* d3d11RTV;
+    ResourceId d3d11RTVId;      // set once the render thread has adopted the view
+    #endif
+};
+
+// What the main thread needs to know about a handle
+struct TextureHandleInfo
+{
+    void* nativeTexture;
+    CpuSurface* cpuSurface;
+};
+
+static TextureRegistry<TextureHandleInfo> s_TextureHandles; // main thread
+static TextureRegistry<PluginTexture> s_Textures;           // render thread
+static TextureHandle s_DefaultTexture = kInvalidTextureHandle;
 
+#if SUPPORT_D3D11
 static ID3D11Device* g_D3D11Device = NULL;
-static ID3D11Texture2D* g_TexturePointer = NULL;
-static ID3D11RenderTargetView* g_pD3D11RenderTargetView = NULL;
+static ResourceJournal s_D3D11Resources;    // every object created on g_D3D11Device, render thread only
+static ID3D11RenderTargetView* CreateD3D11RenderTargetView(void* texturePtr);
+static void AdoptD3D11RenderTargetView(PluginTexture& texture);
+static void DestroyD3D11RenderTargetView(PluginTexture& texture);
+#endif
 
-extern "C" void UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API SetTextureFromUnity(void* texturePtr)
+// Releases the views the plugin created on the graphics device.
+static void ReleasePluginTextureDeviceObjects(PluginTexture& texture)
+{
+    #if SUPPORT_D3D11
+    if (texture.d3d11RTVId != kInvalidResourceId)
+        DestroyD3D11RenderTargetView(texture);
+    SAFE_RELEASE(texture.d3d11RTV);
+    #endif
+}
+
+static void ReleasePluginTexture(PluginTexture& texture)
 {
-    // A script calls this at initialization time; just remember the texture pointer here.
-    // Will update texture pixels each frame from the plugin rendering event (texture update
-    // needs to happen on the rendering thread).
-    switch (s_DeviceType)
-    {
-    case kUnityGfxRendererD3D11:
-        g_TexturePointer = reinterpret_cast<ID3D11Texture2D*>(texturePtr);
-
-        if (g_D3D11Device && g_TexturePointer)
-        {
-            D3D11_TEXTURE2D_DESC texDesc = { 0 };
-
-            // Get the format of the texture
-            g_TexturePointer->GetDesc(&texDesc);
-
-            D3D11_RENDER_TARGET_VIEW_DESC rtvDesc = { texDesc.Format };
-            rtvDesc.ViewDimension = D3D11_RTV_DIMENSION_TEXTURE2D;
-
-            // Create the render target view for the texture
-            g_D3D11Device->CreateRenderTargetView
-                (
-                    g_TexturePointer,
-                    &rtvDesc,
-                    &g_pD3D11RenderTargetView
-                    );
-        }
-        break;
+    ReleasePluginTextureDeviceObjects(texture);
+    if (texture.cpuSurface)
+    {
+        DestroyCpuSurface(texture.cpuSurface);
+        texture.cpuSurface = NULL;
     }
+    texture.nativeTexture = NULL;
 }
 
+// On device shutdown only the device objects go away; the handles stay
+// registered (scripts may still read software textures) until unregistered.
+static void ReleaseAllTextureDeviceObjects()
+{
+    for (int i = 0; i < s_Textures.Count(); ++i)
+        ReleasePluginTextureDeviceObjects(s_Textures.ValueAt(i));
+}
 
 
 
 // --------------------------------------------------------------------------
-// GraphicsDeviceEvent
+// Plugin command queue
+//
+// The exported setters run on the Unity main thread while OnRenderEvent runs
+// on the render thread. Setters never write render state directly; they push
+// typed commands into a lock-free single-producer/single-consumer ring that
+// the render thread drains at the start of each render event.
 
-// Actual setup/teardown functions defined below
-#if SUPPORT_D3D11
-static void DoEventGraphicsDeviceD3D11(UnityGfxDeviceEventType eventType);
-#endif
+enum PluginCommandType
+{
+    kPluginCommandSetTime,
+    kPluginCommandRegisterTexture,
+    kPluginCommandUnregisterTexture,
+    kPluginCommandClear,
+    kPluginCommandSetSoftwareRenderTarget,
+    kPluginCommandSetProceduralTexture,
+    kPluginCommandDrawInstance,
+};
 
-static void UNITY_INTERFACE_API OnGraphicsDeviceEvent(UnityGfxDeviceEventType eventType)
+struct PluginDrawInstance
 {
-    UnityGfxRenderer currentDeviceType = s_DeviceType;
+    DrawInstance instance;
+    InstanceShape shape;
+};
 
-    switch (eventType)
+struct PluginCommand
+{
+    PluginCommandType type;
+    TextureHandle texture;
+    union
     {
-    case kUnityGfxDeviceEventInitialize:
-        {
-            DebugLog("OnGraphicsDeviceEvent(Initialize).\n");
-            s_DeviceType = s_Graphics->GetRenderer();
-            currentDeviceType = s_DeviceType;
-            break;
-        }
+        float time;
+        PluginTexture registerTexture;
+        ClearCommandDesc clear;
+        PluginDrawInstance drawInstance;
+    };
+};
 
-    case kUnityGfxDeviceEventShutdown:
-        {
-            DebugLog("OnGraphicsDeviceEvent(Shutdown).\n");
-            s_DeviceType = kUnityGfxRendererNull;
-            g_TexturePointer = NULL;
-            break;
-        }
+enum
+{
+    kPluginCommandQueueSize = 65536,    // every instance of a frame is a command
+    kPluginCommandPushRetries = 1000,
+};
 
-    case kUnityGfxDeviceEventBeforeReset:
+static SpscQueue<PluginCommand, kPluginCommandQueueSize> s_PluginCommands;
+
+// Main thread. If the render thread has fallen a whole ring behind, give it
+// a moment to catch up before dropping the command.
+static bool PushPluginCommand(const PluginCommand& cmd)
+{
+    for (int retry = 0; retry < kPluginCommandPushRetries; ++retry)
+    {
+        if (s_PluginCommands.TryPush(cmd))
+            return true;
+        std::this_thread::yield();
+    }
+    DEBUG_LOG_RATE_LIMITED(kLogSeverityError, kRepeatedLogIntervalMs, "Plugin command queue is full; command dropped.\n");
+    return false;
+}
+
+static float g_Time;
+static ClearCommandBuffer s_ClearCommands;
+static InstanceBatchBuffer s_InstanceBatches;
+static TextureHandle s_SoftwareRenderTarget = kInvalidTextureHandle;
+static TextureHandle s_ProceduralTexture = kInvalidTextureHandle;
+static size_t s_LargestTextureBytes = 0;
+
+// Render thread
+static void ExecutePluginCommand(const PluginCommand& cmd)
+{
+    switch (cmd.type)
+    {
+    case kPluginCommandSetTime:
+        g_Time = cmd.time;
+        break;
+
+    case kPluginCommandRegisterTexture:
         {
-            DebugLog("OnGraphicsDeviceEvent(BeforeReset).\n");
+            PluginTexture texture = cmd.registerTexture;
+            #if SUPPORT_D3D11
+            if (texture.d3d11RTV)
+                AdoptD3D11RenderTargetView(texture);
+            #endif
+            if (!s_Textures.RegisterAt(cmd.texture, texture))
+            {
+                ReleasePluginTexture(texture);
+                break;
+            }
+            const size_t bytes = (size_t)texture.width * texture.height * 4;
+            if (bytes > s_LargestTextureBytes)
+                s_LargestTextureBytes = bytes;
             break;
         }
 
-    case kUnityGfxDeviceEventAfterReset:
+    case kPluginCommandUnregisterTexture:
         {
-            DebugLog("OnGraphicsDeviceEvent(AfterReset).\n");
+            PluginTexture texture;
+            if (s_Textures.Unregister(cmd.texture, &texture))
+                ReleasePluginTexture(texture);
             break;
         }
-    };
 
-    #if SUPPORT_D3D11
-    if (currentDeviceType == kUnityGfxRendererD3D11)
-        DoEventGraphicsDeviceD3D11(eventType);
-    #endif
+    case kPluginCommandClear:
+        if (!s_ClearCommands.Push(cmd.clear))
+            DEBUG_LOG_RATE_LIMITED(kLogSeverityWarning, kRepeatedLogIntervalMs, "Clear command buffer is full; clear dropped.\n");
+        break;
+
+    case kPluginCommandSetSoftwareRenderTarget:
+        s_SoftwareRenderTarget = cmd.texture;
+        break;
+
+    case kPluginCommandSetProceduralTexture:
+        s_ProceduralTexture = cmd.texture;
+        break;
 
+    case kPluginCommandDrawInstance:
+        if (!s_InstanceBatches.Push(cmd.texture, cmd.drawInstance.shape, cmd.drawInstance.instance))
+            DEBUG_LOG_RATE_LIMITED(kLogSeverityWarning, kRepeatedLogIntervalMs, "Instance buffer is full; instance dropped.\n");
+        break;
+    }
+}
+
+static void ExecutePendingPluginCommands()
+{
+    s_PluginCommands.Drain(ExecutePluginCommand);
 }
 
 
 
 // --------------------------------------------------------------------------
-// OnRenderEvent
-// This will be called for GL.IssuePluginEvent script calls; eventID will
-// be the integer passed to IssuePluginEvent. In this example, we just ignore
-// that value.
+// SetTimeFromUnity, an example function we export which is called by one of the scripts.
 
+extern "C" void UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API SetTimeFromUnity (float t)
+{
+    PluginCommand cmd;
+    cmd.type = kPluginCommandSetTime;
+    cmd.texture = kInvalidTextureHandle;
+    cmd.time = t;
+    PushPluginCommand(cmd);
+}
 
-struct MyVertex {
-    float x, y, z;
-    unsigned int color;
-};
-static void SetDefaultGraphicsState ();
-static void DoRendering (const float* worldMatrix, const float* identityMatrix, float* projectionMatrix, const MyVertex* verts);
 
-static void UNITY_INTERFACE_API OnRenderEvent(int eventID)
-{
-    // Unknown graphics device type? Do nothing.
-    if (s_DeviceType == kUnityGfxRendererNull)
-        return;
 
+// --------------------------------------------------------------------------
+// RegisterTextureFromUnity / UnregisterTextureFromUnity
 
-    // A colored triangle. Note that colors will come out differently
-    // in D3D9/11 and OpenGL, for example, since they expect color bytes
-    // in different ordering.
-    MyVertex verts[3] = {
-        { -0.5f, -0.25f,  0, 0xFFff0000 },
-        {  0.5f, -0.25f,  0, 0xFF00ff00 },
-        {  0,     0.5f ,  0, 0xFF0000ff },
-    };
+extern "C" TextureHandle UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API RegisterTextureFromUnity(void* texturePtr)
+{
+    // Will clear the texture each frame from the plugin rendering event (that
+    // needs to happen on the rendering thread), so only create the views here.
+    if (!texturePtr)
+        return kInvalidTextureHandle;
 
+    PluginCommand cmd;
+    memset(&cmd, 0, sizeof(cmd));
+    cmd.type = kPluginCommandRegisterTexture;
+    cmd.registerTexture.nativeTexture = texturePtr;
 
-    // Some transformation matrices: rotate around Z axis for world
-    // matrix, identity view matrix, and identity projection matrix.
+    switch (s_DeviceType)
+    {
+    #if SUPPORT_D3D11
+    case kUnityGfxRendererD3D11:
+        {
+            cmd.registerTexture.d3d11RTV = CreateD3D11RenderTargetView(texturePtr);
+            if (!cmd.registerTexture.d3d11RTV)
+                return kInvalidTextureHandle;
+            D3D11_TEXTURE2D_DESC desc;
+            reinterpret_cast<ID3D11Texture2D*>(texturePtr)->GetDesc(&desc);
+            cmd.registerTexture.width = desc.Width;
+            cmd.registerTexture.height = desc.Height;
+            break;
+        }
+    #endif
+    default:
+        break;
+    }
 
-    float phi = g_Time;
-    float cosPhi = cosf(phi);
-    float sinPhi = sinf(phi);
+    const TextureHandleInfo info = { texturePtr, NULL };
+    cmd.texture = s_TextureHandles.Register(info);
+    if (cmd.texture == kInvalidTextureHandle)
+    {
+        DebugWarn("RegisterTextureFromUnity: texture registry is full.\n");
+        ReleasePluginTexture(cmd.registerTexture);
+        return kInvalidTextureHandle;
+    }
 
-    float worldMatrix[16] = {
-        cosPhi,-sinPhi,0,0,
-        sinPhi,cosPhi,0,0,
-        0,0,1,0,
-        0,0,0.7f,1,
-    };
-    float identityMatrix[16] = {
-        1,0,0,0,
-        0,1,0,0,
-        0,0,1,0,
-        0,0,0,1,
-    };
-    float projectionMatrix[16] = {
-        1,0,0,0,
-        0,1,0,0,
-        0,0,1,0,
-        0,0,0,1,
-    };
+    if (!PushPluginCommand(cmd))
+    {
+        s_TextureHandles.Unregister(cmd.texture);
+        ReleasePluginTexture(cmd.registerTexture);
+        return kInvalidTextureHandle;
+    }
+    return cmd.texture;
+}
 
-    // Actual functions defined below
-    SetDefaultGraphicsState ();
-    DoRendering (worldMatrix, identityMatrix, projectionMatrix, verts);
+extern "C" void UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API UnregisterTextureFromUnity(TextureHandle handle)
+{
+    if (handle == s_DefaultTexture)
+        s_DefaultTexture = kInvalidTextureHandle;
+    if (!s_TextureHandles.Unregister(handle))
+        return;
+
+    PluginCommand cmd;
+    cmd.type = kPluginCommandUnregisterTexture;
+    cmd.texture = handle;
+    PushPluginCommand(cmd);
 }
 
+
 // --------------------------------------------------------------------------
-// GetRenderEventFunc, an example function we export which is used to get a rendering event callback function.
-extern "C" UnityRenderingEvent UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API GetRenderEventFunc()
+// SetTextureFromUnity, an example function we export which is called by one of the scripts.
+// Kept for older scripts: registers the texture and replaces the previous one set this way.
+
+extern "C" void UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API SetTextureFromUnity(void* texturePtr)
 {
-    return OnRenderEvent;
+    if (s_DefaultTexture != kInvalidTextureHandle)
+        UnregisterTextureFromUnity(s_DefaultTexture);
+    s_DefaultTexture = RegisterTextureFromUnity(texturePtr);
 }
 
 
+// --------------------------------------------------------------------------
+// SetProceduralTextureFromUnity: from the next render event on, the plugin
+// fills this texture with the animated plasma every frame (pass
+// kInvalidTextureHandle to stop). The texture must be RGBA8.
 
-// -------------------------------------------------------------------
-// Shared code
-
-#if SUPPORT_D3D11
-typedef std::vector<unsigned char> Buffer;
-bool LoadFileIntoBuffer(const std::string& fileName, Buffer& data)
+extern "C" void UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API SetProceduralTextureFromUnity(TextureHandle handle)
 {
-    FILE* fp;
-    fopen_s(&fp, fileName.c_str(), "rb");
-    if (fp)
-    {
-        fseek (fp, 0, SEEK_END);
-        int size = ftell (fp);
-        fseek (fp, 0, SEEK_SET);
-        data.resize(size);
+    PluginCommand cmd;
+    cmd.type = kPluginCommandSetProceduralTexture;
+    cmd.texture = handle;
+    PushPluginCommand(cmd);
+}
 
-        fread(&data[0], size, 1, fp);
 
-        fclose(fp);
 
-        return true;
+
+// --------------------------------------------------------------------------
+// Software textures. Without a graphics device the plugin renders into CPU
+// surfaces it owns; scripts create them here, pick one to stand in for the
+// current render target (where the triangle is drawn) and read the pixels
+// back, e.g. with Texture2D.LoadRawTextureData.
+
+#if SUPPORT_SOFTWARE
+extern "C" TextureHandle UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API CreateSoftwareTexture(int width, int height)
+{
+    PluginCommand cmd;
+    memset(&cmd, 0, sizeof(cmd));
+    cmd.type = kPluginCommandRegisterTexture;
+    cmd.registerTexture.cpuSurface = CreateCpuSurface(width, height);
+    if (!cmd.registerTexture.cpuSurface)
+        return kInvalidTextureHandle;
+    cmd.registerTexture.nativeTexture = cmd.registerTexture.cpuSurface;
+    cmd.registerTexture.width = width;
+    cmd.registerTexture.height = height;
+
+    const TextureHandleInfo info = { cmd.registerTexture.nativeTexture, cmd.registerTexture.cpuSurface };
+    cmd.texture = s_TextureHandles.Register(info);
+    if (cmd.texture == kInvalidTextureHandle)
+    {
+        DebugWarn("CreateSoftwareTexture: texture registry is full.\n");
+        ReleasePluginTexture(cmd.registerTexture);
+        return kInvalidTextureHandle;
     }
-    else
+    if (!PushPluginCommand(cmd))
     {
-        std::string errorMessage = "Failed to find ";
-        errorMessage += fileName;
-        DebugLog(errorMessage.c_str());
-        return false;
+        s_TextureHandles.Unregister(cmd.texture);
+        ReleasePluginTexture(cmd.registerTexture);
+        return kInvalidTextureHandle;
     }
+    return cmd.texture;
 }
-#endif
 
+// Returns the RGBA8 pixels of a software texture (NULL for other textures).
+// Rows are GetSoftwareTextureStride bytes apart.
+extern "C" void* UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API GetSoftwareTexturePixels(TextureHandle handle)
+{
+    const TextureHandleInfo* info = s_TextureHandles.Lookup(handle);
+    return info && info->cpuSurface ? info->cpuSurface->pixels : NULL;
+}
 
-// -------------------------------------------------------------------
-//  Direct3D 11 setup/teardown code
+extern "C" int UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API GetSoftwareTextureStride(TextureHandle handle)
+{
+    const TextureHandleInfo* info = s_TextureHandles.Lookup(handle);
+    return info && info->cpuSurface ? info->cpuSurface->stride : 0;
+}
 
+extern "C" void UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API SetSoftwareRenderTarget(TextureHandle handle)
+{
+    PluginCommand cmd;
+    cmd.type = kPluginCommandSetSoftwareRenderTarget;
+    cmd.texture = handle;
+    PushPluginCommand(cmd);
+}
+#endif // #if SUPPORT_SOFTWARE
 
-#if SUPPORT_D3D11
 
-static ID3D11Buffer* g_D3D11VB = NULL; // vertex buffer
-static ID3D11Buffer* g_D3D11CB = NULL; // constant buffer
-static ID3D11VertexShader* g_D3D11VertexShader = NULL;
-static ID3D11PixelShader* g_D3D11PixelShader = NULL;
-static ID3D11InputLayout* g_D3D11InputLayout = NULL;
-static ID3D11RasterizerState* g_D3D11RasterState = NULL;
-static ID3D11BlendState* g_D3D11BlendState = NULL;
-static ID3D11DepthStencilState* g_D3D11DepthState = NULL;
 
-static D3D11_INPUT_ELEMENT_DESC s_DX11InputElementDesc[] = {
-    { "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
-    { "COLOR", 0, DXGI_FORMAT_R8G8B8A8_UNORM, 0, 12, D3D11_INPUT_PER_VERTEX_DATA, 0 },
-};
+// --------------------------------------------------------------------------
+// Clear commands. Scripts queue any number of clears per frame; the next
+// render event executes all of them, sorted and deduplicated per texture.
 
-static bool EnsureD3D11ResourcesAreCreated()
+static void QueueClear(const ClearCommandDesc& desc)
 {
-    if (g_D3D11VertexShader)
-        return true;
+    PluginCommand cmd;
+    cmd.type = kPluginCommandClear;
+    cmd.texture = desc.texture;
+    cmd.clear = desc;
+    PushPluginCommand(cmd);
+}
 
-    // D3D11 has to load resources. Wait for Unity to provide the streaming assets path first.
-    if (s_UnityStreamingAssetsPath.empty())
-        return false;
+extern "C" void UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API QueueClearTexture(TextureHandle texture, float r, float g, float b, float a)
+{
+    const ClearCommandDesc desc = { texture, { r, g, b, a }, { 0, 0, 0, 0 } };
+    QueueClear(desc);
+}
 
-    D3D11_BUFFER_DESC desc;
-    memset (&desc, 0, sizeof(desc));
+extern "C" void UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API QueueClearTextureRect(TextureHandle texture, float r, float g, float b, float a, int x, int y, int width, int height)
+{
+    const ClearCommandDesc desc = { texture, { r, g, b, a }, { x, y, width, height } };
+    QueueClear(desc);
+}
 
-    // vertex buffer
-    desc.Usage = D3D11_USAGE_DEFAULT;
-    desc.ByteWidth = 1024;
-    desc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
-    g_D3D11Device->CreateBuffer (&desc, NULL, &g_D3D11VB);
+// Queues an array of blittable ClearCommandDesc structs in one call.
+extern "C" void UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API QueueClearTextures(const ClearCommandDesc* commands, int count)
+{
+    for (int i = 0; i < count; ++i)
+        QueueClear(commands[i]);
+}
 
-    // constant buffer
-    desc.Usage = D3D11_USAGE_DEFAULT;
-    desc.ByteWidth = 64; // hold 1 matrix
-    desc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
-    desc.CPUAccessFlags = 0;
-    g_D3D11Device->CreateBuffer (&desc, NULL, &g_D3D11CB);
 
 
-    HRESULT hr = -1;
-    Buffer vertexShader;
-    Buffer pixelShader;
-    std::string vertexShaderPath(s_UnityStreamingAssetsPath);
-    vertexShaderPath += "/Shaders/DX11_9_1/SimpleVertexShader.cso";
-    std::string fragmentShaderPath(s_UnityStreamingAssetsPath);
-    fragmentShaderPath += "/Shaders/DX11_9_1/SimplePixelShader.cso";
-    LoadFileIntoBuffer(vertexShaderPath, vertexShader);
-    LoadFileIntoBuffer(fragmentShaderPath, pixelShader);
+// --------------------------------------------------------------------------
+// Instanced overlays. Scripts queue any number of triangles or quads per
+// frame, each with its own transform and colour (see InstanceBatch.h); the
+// next render event draws them after the clears, with one instanced draw
+// per run of instances that share a texture and shape.
 
-    if (vertexShader.size() > 0 && pixelShader.size() > 0)
-    {
-        hr = g_D3D11Device->CreateVertexShader(&vertexShader[0], vertexShader.size(), nullptr, &g_D3D11VertexShader);
-        if (FAILED(hr)) DebugLog("Failed to create vertex shader.\n");
-        hr = g_D3D11Device->CreatePixelShader(&pixelShader[0], pixelShader.size(), nullptr, &g_D3D11PixelShader);
-        if (FAILED(hr)) DebugLog("Failed to create pixel shader.\n");
+extern "C" void UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API QueueDrawInstances(TextureHandle texture, int shape, const DrawInstance* instances, int count)
+{
+    if (shape < 0 || shape >= kInstanceShapeCount || !instances)
+        return;
+
+    PluginCommand cmd;
+    cmd.type = kPluginCommandDrawInstance;
+    cmd.texture = texture;
+    cmd.drawInstance.shape = (InstanceShape)shape;
+    for (int i = 0; i < count; ++i)
+    {
+        cmd.drawInstance.instance = instances[i];
+        if (!PushPluginCommand(cmd))
+            break;
+    }
+}
+
+
+
+// --------------------------------------------------------------------------
+// SubmitFrame. One call per frame carries everything the script has for it
+// (FrameDesc.h) instead of a setter call per parameter. The resulting
+// commands go into the queue in batches, each published with one store.
+
+// Main thread. Hands out queue slots for the commands of one call and
+// publishes them whenever the reserved run is used up, and at the end.
+class PluginCommandBatch
+{
+public:
+    PluginCommandBatch() : m_Reserved(0), m_Written(0) {}
+    ~PluginCommandBatch() { Flush(); }
+
+    // Slot for the next command, remaining counting it. NULL when the render
+    // thread has fallen a whole ring behind and does not catch up.
+    PluginCommand* Next(unsigned remaining)
+    {
+        if (m_Written == m_Reserved && !Refill(remaining))
+            return NULL;
+        return &s_PluginCommands.Reserved(m_Written++);
+    }
+
+    void Flush()
+    {
+        if (m_Written)
+            s_PluginCommands.Commit(m_Written);
+        m_Reserved = 0;
+        m_Written = 0;
+    }
+
+private:
+    bool Refill(unsigned remaining)
+    {
+        Flush();
+        for (int retry = 0; retry < kPluginCommandPushRetries; ++retry)
+        {
+            m_Reserved = s_PluginCommands.Reserve(remaining);
+            if (m_Reserved)
+                return true;
+            std::this_thread::yield();
+        }
+        DEBUG_LOG_RATE_LIMITED(kLogSeverityError, kRepeatedLogIntervalMs, "Plugin command queue is full; rest of the frame dropped.\n");
+        return false;
+    }
+
+    unsigned m_Reserved;
+    unsigned m_Written;
+};
+
+// Returns the number of commands queued (fewer than the desc holds only
+// when the queue stayed full), or -1 for a malformed desc.
+extern "C" int UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API SubmitFrame(const FrameDesc* desc)
+{
+    PLUGIN_TRACE_ZONE("SubmitFrame");
+    const int total = desc ? CountFrameDescCommands(*desc) : -1;
+    if (total < 0)
+    {
+        DEBUG_LOG_RATE_LIMITED(kLogSeverityWarning, kRepeatedLogIntervalMs, "SubmitFrame: malformed FrameDesc; frame ignored.\n");
+        return -1;
+    }
+
+    PluginCommandBatch batch;
+    unsigned remaining = (unsigned)total;
+    int queued = 0;
+
+    if (desc->fields & kFrameDescTime)
+    {
+        PluginCommand* cmd = batch.Next(remaining--);
+        if (!cmd)
+            return queued;
+        cmd->type = kPluginCommandSetTime;
+        cmd->texture = kInvalidTextureHandle;
+        cmd->time = desc->time;
+        ++queued;
+    }
+
+    for (int i = 0; i < desc->clearCount; ++i)
+    {
+        PluginCommand* cmd = batch.Next(remaining--);
+        if (!cmd)
+            return queued;
+        cmd->type = kPluginCommandClear;
+        cmd->texture = desc->clears[i].texture;
+        cmd->clear = desc->clears[i];
+        ++queued;
+    }
+
+    for (int d = 0; d < desc->drawCount; ++d)
+    {
+        const FrameDrawDesc& draw = desc->draws[d];
+        const DrawInstance* instances = desc->instances + draw.firstInstance;
+        for (int i = 0; i < draw.instanceCount; ++i)
+        {
+            PluginCommand* cmd = batch.Next(remaining--);
+            if (!cmd)
+                return queued;
+            cmd->type = kPluginCommandDrawInstance;
+            cmd->texture = draw.texture;
+            cmd->drawInstance.shape = (InstanceShape)draw.shape;
+            cmd->drawInstance.instance = instances[i];
+            ++queued;
+        }
+    }
+    return queued;
+}
+
+
+
+// --------------------------------------------------------------------------
+// Shared command ring. Scripts that submit commands at a high rate write
+// them straight into s_SharedCommands (SharedCommandRing.h) from any thread,
+// with no call into the plugin at all; each render event executes what has
+// been published, in place.
+
+// Render thread. Clear colour set by kSharedCommandSetColor.
+static float s_SharedClearColor[4] = { 0, 0, 0, 1 };
+
+static void ExecuteSharedCommand(const SharedCommand& cmd)
+{
+    switch (cmd.type)
+    {
+    case kSharedCommandSetTime:
+        g_Time = cmd.time;
+        break;
+
+    case kSharedCommandSetColor:
+        memcpy(s_SharedClearColor, cmd.color, sizeof(s_SharedClearColor));
+        break;
+
+    case kSharedCommandClear:
+        if (!s_ClearCommands.Push(cmd.texture, s_SharedClearColor, &cmd.rect))
+            DEBUG_LOG_RATE_LIMITED(kLogSeverityWarning, kRepeatedLogIntervalMs, "Clear command buffer is full; clear dropped.\n");
+        break;
+
+    case kSharedCommandDrawInstance:
+        if (cmd.shape < 0 || cmd.shape >= kInstanceShapeCount)
+            break;
+        if (!s_InstanceBatches.Push(cmd.texture, (InstanceShape)cmd.shape, cmd.instance))
+            DEBUG_LOG_RATE_LIMITED(kLogSeverityWarning, kRepeatedLogIntervalMs, "Instance buffer is full; instance dropped.\n");
+        break;
+
+    default:
+        break;
+    }
+}
+
+// Address of the ring's SharedCommandRingHeader, followed by its commands.
+// Fixed for as long as the plugin is loaded; NULL if it could not be
+// allocated.
+extern "C" void* UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API GetSharedCommandRing()
+{
+    return s_SharedCommands.GetShared();
+}
+
+
+
+// --------------------------------------------------------------------------
+// GraphicsDeviceEvent
+
+// Actual setup/teardown functions defined below
+#if SUPPORT_D3D11
+static void DoEventGraphicsDeviceD3D11(UnityGfxDeviceEventType eventType);
+#endif
+
+static void UNITY_INTERFACE_API OnGraphicsDeviceEvent(UnityGfxDeviceEventType eventType)
+{
+    PLUGIN_TRACE_ZONE("OnGraphicsDeviceEvent");
+    #if SUPPORT_D3D11
+    // The device the event is for; Shutdown resets s_DeviceType below
+    UnityGfxRenderer currentDeviceType = s_DeviceType;
+    #endif
+
+    switch (eventType)
+    {
+    case kUnityGfxDeviceEventInitialize:
+        {
+            DebugLog("OnGraphicsDeviceEvent(Initialize).\n");
+            s_DeviceType = s_Graphics->GetRenderer();
+            #if SUPPORT_D3D11
+            currentDeviceType = s_DeviceType;
+            #endif
+            break;
+        }
+
+    case kUnityGfxDeviceEventShutdown:
+        {
+            DebugLog("OnGraphicsDeviceEvent(Shutdown).\n");
+            ExecutePendingPluginCommands();
+            s_ClearCommands.Reset();
+            s_InstanceBatches.Reset();
+            ReleaseAllTextureDeviceObjects();
+            s_DeviceType = kUnityGfxRendererNull;
+            break;
+        }
+
+    case kUnityGfxDeviceEventBeforeReset:
+        {
+            DebugLog("OnGraphicsDeviceEvent(BeforeReset).\n");
+            break;
+        }
+
+    case kUnityGfxDeviceEventAfterReset:
+        {
+            DebugLog("OnGraphicsDeviceEvent(AfterReset).\n");
+            break;
+        }
+    };
+
+    #if SUPPORT_D3D11
+    if (currentDeviceType == kUnityGfxRendererD3D11)
+        DoEventGraphicsDeviceD3D11(eventType);
+    #endif
+
+}
+
+
+
+// --------------------------------------------------------------------------
+// OnRenderEvent
+// This will be called for GL.IssuePluginEvent and CommandBuffer.IssuePluginEvent
+// script calls; eventID will be the integer passed to IssuePluginEvent. It
+// picks the handler from s_RenderEvents, so a command buffer can schedule
+// each piece of plugin work (see PluginRenderEvent in RenderingPlugin.h)
+// where it is needed. IDs without a handler render the whole frame.
+// IssuePluginEventAndData calls OnRenderEventAndData instead, whose data
+// (RenderEventData) carries the event's parameters.
+
+
+struct MyVertex {
+    float x, y, z;
+    unsigned int color;
+};
+#if SUPPORT_SOFTWARE
+static_assert(sizeof(MyVertex) == sizeof(SoftwareVertex), "MyVertex and SoftwareVertex must match");
+#endif
+
+// What a render event does; DoRendering runs the parts in this order
+enum RenderWork
+{
+    kRenderWorkFill = 1 << 0,       // start generating the procedural texture
+    kRenderWorkUpload = 1 << 1,     // upload the last generated image
+    kRenderWorkClear = 1 << 2,      // execute and consume the queued clears
+    kRenderWorkDraw = 1 << 3,       // draw and consume the queued instances, then the triangle
+    kRenderWorkFrame = kRenderWorkFill | kRenderWorkUpload | kRenderWorkClear | kRenderWorkDraw,
+};
+
+static void SetDefaultGraphicsState ();
+static void DoRendering (unsigned work, const float* worldMatrix, const float* identityMatrix, float* projectionMatrix, const MyVertex* verts);
+static void FlushRenderStats ();
+
+#if SUPPORT_D3D11
+static void InvalidateD3D11State();
+static void FinishD3D11ResourceRecreate();
+#endif
+
+// Event data of the frame, copied out of script memory as each event
+// arrives; released once the frame has been drawn
+enum { kFrameArenaBytes = 64 * 1024 };
+static FrameArena s_FrameArena(kFrameArenaBytes);
+
+// Clears and instances the work would have consumed are dropped when it
+// cannot run. Draw ends the frame.
+static void DropRenderWork(unsigned work)
+{
+    if (work & kRenderWorkClear)
+        s_ClearCommands.Reset();
+    if (work & kRenderWorkDraw)
+    {
+        s_InstanceBatches.Reset();
+        s_FrameArena.Reset();
+    }
+}
+
+static void RunRenderWork(unsigned work)
+{
+    // Unknown graphics device type? Do nothing.
+    #if !SUPPORT_SOFTWARE
+    if (s_DeviceType == kUnityGfxRendererNull)
+    {
+        DropRenderWork(work);
+        return;
+    }
+    #endif
+
+    // Shaders are still coming from disk (override on, or not embedded): skip
+    // the work rather than wait. Every backend does this, so the headless host
+    // sees the same time to first frame as a GPU build.
+    if (s_Shaders.IsLoading())
+    {
+        DropRenderWork(work);
+        return;
+    }
+
+
+    // A colored triangle. Note that colors will come out differently
+    // in D3D9/11 and OpenGL, for example, since they expect color bytes
+    // in different ordering.
+    MyVertex verts[3] = {
+        { -0.5f, -0.25f,  0, 0xFFff0000 },
+        {  0.5f, -0.25f,  0, 0xFF00ff00 },
+        {  0,     0.5f ,  0, 0xFF0000ff },
+    };
+
+
+    // Some transformation matrices: rotate around Z axis for world
+    // matrix, identity view matrix, and identity projection matrix.
+
+    float phi = g_Time;
+    float cosPhi = cosf(phi);
+    float sinPhi = sinf(phi);
+
+    float worldMatrix[16] = {
+        cosPhi,-sinPhi,0,0,
+        sinPhi,cosPhi,0,0,
+        0,0,1,0,
+        0,0,0.7f,1,
+    };
+    float identityMatrix[16] = {
+        1,0,0,0,
+        0,1,0,0,
+        0,0,1,0,
+        0,0,0,1,
+    };
+    float projectionMatrix[16] = {
+        1,0,0,0,
+        0,1,0,0,
+        0,0,1,0,
+        0,0,0,1,
+    };
+
+    // Actual functions defined below
+    if (work & kRenderWorkDraw)
+        SetDefaultGraphicsState ();
+    DoRendering (work, worldMatrix, identityMatrix, projectionMatrix, verts);
+
+    // Clears and instances queued for this frame have been consumed
+    DropRenderWork(work);
+}
+
+static void OnFrameEvent(int)       { RunRenderWork(kRenderWorkFrame); }
+static void OnFillTextureEvent(int) { RunRenderWork(kRenderWorkFill); }
+static void OnUploadEvent(int)      { RunRenderWork(kRenderWorkUpload); }
+static void OnClearEvent(int)       { RunRenderWork(kRenderWorkClear); }
+static void OnDrawEvent(int)        { RunRenderWork(kRenderWorkDraw); }
+static void OnFlushStatsEvent(int)  { FlushRenderStats(); }
+
+static RenderEventTable s_RenderEvents(OnFrameEvent);
+
+static void RegisterRenderEvents()
+{
+    s_RenderEvents.Register(kPluginEventFrame, OnFrameEvent);
+    s_RenderEvents.Register(kPluginEventFillTexture, OnFillTextureEvent);
+    s_RenderEvents.Register(kPluginEventUpload, OnUploadEvent);
+    s_RenderEvents.Register(kPluginEventClear, OnClearEvent);
+    s_RenderEvents.Register(kPluginEventDraw, OnDrawEvent);
+    s_RenderEvents.Register(kPluginEventFlushStats, OnFlushStatsEvent);
+}
+
+// Render thread; after the commands the main thread queued, so the event's
+// own clears come after them and its time wins
+static void ApplyRenderEventData(const void* data)
+{
+    const RenderEventData* copy = CopyRenderEventData(s_FrameArena, data);
+    if (!copy)
+    {
+        DEBUG_LOG_RATE_LIMITED(kLogSeverityWarning, kRepeatedLogIntervalMs, "Render event data is malformed or the frame arena is full; data ignored.\n");
+        return;
+    }
+    if (copy->fields & kRenderEventDataTime)
+        g_Time = copy->time;
+    const int wanted = (copy->fields & kRenderEventDataClear) ? (copy->rectCount > 0 ? copy->rectCount : 1) : 0;
+    if (PushRenderEventClears(*copy, s_ClearCommands) < wanted)
+        DEBUG_LOG_RATE_LIMITED(kLogSeverityWarning, kRepeatedLogIntervalMs, "Clear command buffer is full; clear dropped.\n");
+}
+
+static void HandleRenderEvent(int eventID, const void* data)
+{
+    PLUGIN_TRACE_THREAD_NAME("Render thread");
+    PLUGIN_TRACE_ZONE("OnRenderEvent");
+    PluginStatsTimer renderEventTimer(Stats().renderEventNs);
+    AddPluginStat(Stats().renderEvents, 1);
+
+    #if SUPPORT_D3D11
+    // Objects recreated after a device reset go back in place before any
+    // command can add or remove one
+    FinishD3D11ResourceRecreate();
+    #endif
+
+    // Pick up everything the main thread has sent since the last event,
+    // then what scripts wrote into the shared ring
+    ExecutePendingPluginCommands();
+    s_SharedCommands.Consume(ExecuteSharedCommand);
+
+    #if SUPPORT_D3D11
+    // Unity may have changed any context state since our last event
+    InvalidateD3D11State();
+    #endif
+
+    if (data)
+        ApplyRenderEventData(data);
+
+    s_RenderEvents.Dispatch(eventID);
+}
+
+static void UNITY_INTERFACE_API OnRenderEvent(int eventID)
+{
+    HandleRenderEvent(eventID, NULL);
+}
+
+static void UNITY_INTERFACE_API OnRenderEventAndData(int eventID, void* data)
+{
+    HandleRenderEvent(eventID, data);
+}
+
+// --------------------------------------------------------------------------
+// GetRenderEventFunc, an example function we export which is used to get a rendering event callback function.
+extern "C" UnityRenderingEvent UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API GetRenderEventFunc()
+{
+    return OnRenderEvent;
+}
+
+// For IssuePluginEventAndData; data points to a RenderEventData.
+extern "C" UnityRenderingEventAndData UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API GetRenderEventAndDataFunc()
+{
+    return OnRenderEventAndData;
+}
+
+
+
+// -------------------------------------------------------------------
+//  Direct3D 11 setup/teardown code
+
+
+#if SUPPORT_D3D11
+
+// Immediate context, held from device initialize to shutdown rather than
+// fetched with GetImmediateContext on every event. State calls go through
+// s_D3D11StateCache so the ones that set what is already bound are skipped.
+static ID3D11DeviceContext* g_D3D11Context = NULL;
+static RenderStateCache s_D3D11StateCache;
+typedef StateFilteredContext<ID3D11DeviceContext> D3D11StateContext;
+
+static void InvalidateD3D11State()
+{
+    s_D3D11StateCache.Invalidate();
+}
+
+static ID3D11Buffer* g_D3D11VB = NULL; // vertex buffer
+static ID3D11Buffer* g_D3D11CB = NULL; // constant buffer
+static ID3D11VertexShader* g_D3D11VertexShader = NULL;
+static ID3D11PixelShader* g_D3D11PixelShader = NULL;
+static ID3D11InputLayout* g_D3D11InputLayout = NULL;
+static ID3D11RasterizerState* g_D3D11RasterState = NULL;
+static ID3D11BlendState* g_D3D11BlendState = NULL;
+static ID3D11DepthStencilState* g_D3D11DepthState = NULL;
+static ID3D11Buffer* g_D3D11ShapeVB = NULL; // unit shapes for instanced overlays
+static ID3D11VertexShader* g_D3D11InstancedVertexShader = NULL;
+static ID3D11InputLayout* g_D3D11InstancedInputLayout = NULL;
+
+static D3D11_INPUT_ELEMENT_DESC s_DX11InputElementDesc[] = {
+    { "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+    { "COLOR", 0, DXGI_FORMAT_R8G8B8A8_UNORM, 0, 12, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+};
+
+// Unit shape in slot 0, DrawInstance in slot 1
+static D3D11_INPUT_ELEMENT_DESC s_DX11InstancedInputElementDesc[] = {
+    { "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+    { "COLOR", 0, DXGI_FORMAT_R8G8B8A8_UNORM, 0, 12, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+    { "TEXCOORD", 0, DXGI_FORMAT_R32G32B32_FLOAT, 1, 0, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+    { "TEXCOORD", 1, DXGI_FORMAT_R32G32B32_FLOAT, 1, 12, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+    { "TEXCOORD", 2, DXGI_FORMAT_R32_FLOAT, 1, 24, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+    { "COLOR", 1, DXGI_FORMAT_R8G8B8A8_UNORM, 1, 28, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+};
+
+
+// -------------------------------------------------------------------
+// Transient vertex and constant data
+//
+// Per-frame vertices and constants are streamed through two large dynamic
+// buffers (g_D3D11VB, g_D3D11CB) instead of being copied in with
+// UpdateSubresource. A TransientRingAllocator hands out the space: a
+// frame's first map of a buffer is WRITE_DISCARD, every later one
+// NO_OVERWRITE. Each render event ends with an event query as its fence,
+// and the space a frame used is only reused once its query has completed.
+//
+// Constant buffer offsets need D3D11.1 (VSSetConstantBuffers1 and
+// NO_OVERWRITE maps of constant buffers); without them the constant buffer
+// holds a single matrix and is discarded on every write.
+
+enum
+{
+    kD3D11TransientVertexBytes = 1024 * 1024,
+    kD3D11TransientConstantBytes = 64 * 1024,
+    kD3D11ConstantAlignment = 256, // 16 constants, the VSSetConstantBuffers1 granularity
+};
+
+static TransientRingAllocator s_D3D11VertexRing;
+static TransientRingAllocator s_D3D11ConstantRing;
+static ID3D11DeviceContext1* g_D3D11Context1 = NULL; // only when constant buffer offsets work
+static ID3D11Query* g_D3D11FrameFences[TransientRingAllocator::kMaxFramesInFlight];
+static uint64_t s_D3D11FrameIndex = 1;      // frame being recorded
+static uint64_t s_D3D11RetiredFrame = 0;    // last frame the GPU is done with
+
+// -------------------------------------------------------------------
+// Device object journal
+//
+// Everything the plugin creates on g_D3D11Device is recorded in
+// s_D3D11Resources so a device reset costs one bulk recreate: BeforeReset
+// releases the objects, AfterReset has the worker pool create them again
+// from their recipes, and the next render event puts them back in place.
+// A recipe is the object's desc followed by any bytecode or initial data;
+// the create functions touch nothing but the device and the recipe, which
+// is what lets them run on the workers (D3D11 devices are free-threaded).
+
+struct D3D11BufferRecipe
+{
+    D3D11_BUFFER_DESC desc;
+    // followed by desc.ByteWidth bytes of initial data, if any
+};
+
+struct D3D11InputLayoutRecipe
+{
+    const D3D11_INPUT_ELEMENT_DESC* elements;   // static tables only
+    UINT elementCount;
+    // followed by the vertex shader bytecode
+};
+
+struct D3D11RenderTargetViewRecipe
+{
+    ID3D11Resource* resource;   // referenced for as long as the record exists
+    D3D11_RENDER_TARGET_VIEW_DESC desc;
+};
+
+static bool s_D3D11ResourcesCreated = false;
+static bool s_D3D11RecreatePending = false;
+static bool s_D3D11ConstantBufferRanges = false;   // g_D3D11CB was sized for offsets
+
+template <typename T>
+static void** D3D11Slot(T** slot)
+{
+    return reinterpret_cast<void**>(slot);
+}
+
+static void ReleaseD3D11Object(void* object)
+{
+    static_cast<IUnknown*>(object)->Release();
+}
+
+// Creates an object from a recipe header plus payload bytes and records it
+template <typename Header>
+static ResourceId CreateD3D11Object(const char* name, ResourceCreateFn create, const Header& header, const void* payload, size_t payloadSize, void** slot)
+{
+    std::vector<unsigned char> recipe(sizeof(Header) + payloadSize);
+    memcpy(&recipe[0], &header, sizeof(Header));
+    if (payloadSize)
+        memcpy(&recipe[sizeof(Header)], payload, payloadSize);
+    return s_D3D11Resources.Create(name, create, &recipe[0], recipe.size(), slot);
+}
+
+static void* CreateD3D11BufferFromRecipe(void* device, const void* recipe, size_t recipeSize)
+{
+    const D3D11BufferRecipe* buffer = (const D3D11BufferRecipe*)recipe;
+    const D3D11_SUBRESOURCE_DATA initialData = { buffer + 1, 0, 0 };
+    ID3D11Buffer* object = NULL;
+    static_cast<ID3D11Device*>(device)->CreateBuffer(&buffer->desc, recipeSize > sizeof(*buffer) ? &initialData : NULL, &object);
+    return object;
+}
+
+static void* CreateD3D11VertexShaderFromRecipe(void* device, const void* recipe, size_t recipeSize)
+{
+    ID3D11VertexShader* object = NULL;
+    static_cast<ID3D11Device*>(device)->CreateVertexShader(recipe, recipeSize, NULL, &object);
+    return object;
+}
+
+static void* CreateD3D11PixelShaderFromRecipe(void* device, const void* recipe, size_t recipeSize)
+{
+    ID3D11PixelShader* object = NULL;
+    static_cast<ID3D11Device*>(device)->CreatePixelShader(recipe, recipeSize, NULL, &object);
+    return object;
+}
+
+static void* CreateD3D11InputLayoutFromRecipe(void* device, const void* recipe, size_t recipeSize)
+{
+    const D3D11InputLayoutRecipe* layout = (const D3D11InputLayoutRecipe*)recipe;
+    ID3D11InputLayout* object = NULL;
+    static_cast<ID3D11Device*>(device)->CreateInputLayout(layout->elements, layout->elementCount, layout + 1, recipeSize - sizeof(*layout), &object);
+    return object;
+}
+
+static void* CreateD3D11RasterizerStateFromRecipe(void* device, const void* recipe, size_t)
+{
+    ID3D11RasterizerState* object = NULL;
+    static_cast<ID3D11Device*>(device)->CreateRasterizerState((const D3D11_RASTERIZER_DESC*)recipe, &object);
+    return object;
+}
+
+static void* CreateD3D11DepthStencilStateFromRecipe(void* device, const void* recipe, size_t)
+{
+    ID3D11DepthStencilState* object = NULL;
+    static_cast<ID3D11Device*>(device)->CreateDepthStencilState((const D3D11_DEPTH_STENCIL_DESC*)recipe, &object);
+    return object;
+}
+
+static void* CreateD3D11BlendStateFromRecipe(void* device, const void* recipe, size_t)
+{
+    ID3D11BlendState* object = NULL;
+    static_cast<ID3D11Device*>(device)->CreateBlendState((const D3D11_BLEND_DESC*)recipe, &object);
+    return object;
+}
+
+static void* CreateD3D11QueryFromRecipe(void* device, const void* recipe, size_t)
+{
+    ID3D11Query* object = NULL;
+    static_cast<ID3D11Device*>(device)->CreateQuery((const D3D11_QUERY_DESC*)recipe, &object);
+    return object;
+}
+
+static void* CreateD3D11RenderTargetViewFromRecipe(void* device, const void* recipe, size_t)
+{
+    const D3D11RenderTargetViewRecipe* view = (const D3D11RenderTargetViewRecipe*)recipe;
+    ID3D11RenderTargetView* object = NULL;
+    static_cast<ID3D11Device*>(device)->CreateRenderTargetView(view->resource, &view->desc, &object);
+    return object;
+}
+
+// The view was created on the main thread (RegisterTextureFromUnity); the
+// journal takes it over along with a reference to the texture, so the
+// texture is still there to recreate the view from after a reset.
+static void AdoptD3D11RenderTargetView(PluginTexture& texture)
+{
+    D3D11RenderTargetViewRecipe recipe;
+    texture.d3d11RTV->GetResource(&recipe.resource);
+    texture.d3d11RTV->GetDesc(&recipe.desc);
+    texture.d3d11RTVId = s_D3D11Resources.Adopt("texture render target view", CreateD3D11RenderTargetViewFromRecipe, &recipe, sizeof(recipe), texture.d3d11RTV);
+}
+
+static void DestroyD3D11RenderTargetView(PluginTexture& texture)
+{
+    ID3D11Resource* resource = NULL;
+    if (const void* recipe = s_D3D11Resources.GetRecipe(texture.d3d11RTVId))
+        resource = ((const D3D11RenderTargetViewRecipe*)recipe)->resource;
+    s_D3D11Resources.Destroy(texture.d3d11RTVId);
+    SAFE_RELEASE(resource);
+    texture.d3d11RTVId = kInvalidResourceId;
+    texture.d3d11RTV = NULL;
+}
+
+// Cached view pointers follow the journal after a release or recreate
+static void RefreshD3D11TextureViews()
+{
+    for (int i = 0; i < s_Textures.Count(); ++i)
+    {
+        PluginTexture& texture = s_Textures.ValueAt(i);
+        if (texture.d3d11RTVId != kInvalidResourceId)
+            texture.d3d11RTV = (ID3D11RenderTargetView*)s_D3D11Resources.Get(texture.d3d11RTVId);
+    }
+}
+
+// The rings start over whenever their buffers are (re)created; fences
+// written before that are never waited on.
+static GpuTimerRing s_D3D11GpuTimers;
+
+static void ResetD3D11TransientFrames()
+{
+    s_D3D11GpuTimers.Reset();
+    s_D3D11VertexRing.Reset(g_D3D11VB ? kD3D11TransientVertexBytes : 0);
+    s_D3D11ConstantRing.Reset(g_D3D11CB && g_D3D11Context1 ? kD3D11TransientConstantBytes : 0);
+    s_D3D11RetiredFrame = s_D3D11FrameIndex - 1;
+}
+
+// Sets g_D3D11Context1 when the device can bind constant buffer ranges
+static void QueryD3D11ConstantBufferOffsets()
+{
+    SAFE_RELEASE(g_D3D11Context1);
+    D3D11_FEATURE_DATA_D3D11_OPTIONS options;
+    memset (&options, 0, sizeof(options));
+    const bool offsets = SUCCEEDED(g_D3D11Device->CheckFeatureSupport (D3D11_FEATURE_D3D11_OPTIONS, &options, sizeof(options)))
+        && options.ConstantBufferOffsetting && options.MapNoOverwriteOnDynamicConstantBuffer;
+    if (offsets)
+        g_D3D11Context->QueryInterface (__uuidof(ID3D11DeviceContext1), (void**)&g_D3D11Context1);
+}
+
+static void CreateD3D11TransientBuffers()
+{
+    QueryD3D11ConstantBufferOffsets ();
+    s_D3D11ConstantBufferRanges = g_D3D11Context1 != NULL;
+
+    D3D11BufferRecipe recipe;
+    D3D11_BUFFER_DESC& desc = recipe.desc;
+    memset (&desc, 0, sizeof(desc));
+    desc.Usage = D3D11_USAGE_DYNAMIC;
+    desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+
+    // vertex buffer
+    desc.ByteWidth = kD3D11TransientVertexBytes;
+    desc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+    CreateD3D11Object ("transient vertex buffer", CreateD3D11BufferFromRecipe, recipe, NULL, 0, D3D11Slot(&g_D3D11VB));
+
+    // constant buffer
+    desc.ByteWidth = g_D3D11Context1 ? kD3D11TransientConstantBytes : kD3D11ConstantAlignment;
+    desc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+    CreateD3D11Object ("transient constant buffer", CreateD3D11BufferFromRecipe, recipe, NULL, 0, D3D11Slot(&g_D3D11CB));
+
+    // frame fences
+    D3D11_QUERY_DESC queryDesc = { D3D11_QUERY_EVENT, 0 };
+    for (int i = 0; i < TransientRingAllocator::kMaxFramesInFlight; ++i)
+        s_D3D11Resources.Create ("frame fence", CreateD3D11QueryFromRecipe, &queryDesc, sizeof(queryDesc), D3D11Slot(&g_D3D11FrameFences[i]));
+
+    ResetD3D11TransientFrames ();
+}
+
+
+// Retires every frame whose fence the GPU has passed. With wait, first
+// blocks until the oldest pending frame is done.
+static void RetireD3D11Frames(bool wait)
+{
+    while (s_D3D11RetiredFrame + 1 < s_D3D11FrameIndex)
+    {
+        const uint64_t frame = s_D3D11RetiredFrame + 1;
+        ID3D11Query* fence = g_D3D11FrameFences[frame % TransientRingAllocator::kMaxFramesInFlight];
+        if (fence)
+        {
+            HRESULT hr;
+            while ((hr = g_D3D11Context->GetData(fence, NULL, 0, wait ? 0 : D3D11_ASYNC_GETDATA_DONOTFLUSH)) == S_FALSE && wait)
+                std::this_thread::yield();
+            if (hr == S_FALSE)
+                break;
+        }
+        s_D3D11RetiredFrame = frame;
+        wait = false;
+    }
+    s_D3D11VertexRing.RetireFramesUpTo(s_D3D11RetiredFrame);
+    s_D3D11ConstantRing.RetireFramesUpTo(s_D3D11RetiredFrame);
+}
+
+static void BeginD3D11TransientFrame()
+{
+    RetireD3D11Frames(false);
+    // This frame's fence query must not still be pending from an older frame
+    if (s_D3D11FrameIndex - 1 - s_D3D11RetiredFrame >= TransientRingAllocator::kMaxFramesInFlight)
+        RetireD3D11Frames(true);
+}
+
+static void EndD3D11TransientFrame()
+{
+    ID3D11Query* fence = g_D3D11FrameFences[s_D3D11FrameIndex % TransientRingAllocator::kMaxFramesInFlight];
+    if (fence)
+        g_D3D11Context->End(fence);
+    s_D3D11VertexRing.EndFrame(s_D3D11FrameIndex);
+    s_D3D11ConstantRing.EndFrame(s_D3D11FrameIndex);
+    ++s_D3D11FrameIndex;
+}
+
+// Copies data into ring space of buffer and returns its byte offset. Fails
+// only if it does not fit even with every earlier frame retired.
+static bool WriteD3D11Transient(ID3D11Buffer* buffer, TransientRingAllocator& ring, const void* data, size_t size, size_t alignment, UINT* offset)
+{
+    TransientAllocation allocation;
+    bool allocated = ring.Allocate(size, alignment, &allocation);
+    while (!allocated && s_D3D11RetiredFrame + 1 < s_D3D11FrameIndex)
+    {
+        // Everything else is still being read by the GPU
+        RetireD3D11Frames(true);
+        allocated = ring.Allocate(size, alignment, &allocation);
+    }
+    if (!allocated)
+        return false;
+
+    D3D11_MAPPED_SUBRESOURCE mapped;
+    const D3D11_MAP mapType = allocation.firstInFrame ? D3D11_MAP_WRITE_DISCARD : D3D11_MAP_WRITE_NO_OVERWRITE;
+    if (FAILED(g_D3D11Context->Map(buffer, 0, mapType, 0, &mapped)))
+        return false;
+    memcpy(static_cast<unsigned char*>(mapped.pData) + allocation.offset, data, size);
+    g_D3D11Context->Unmap(buffer, 0);
+    *offset = (UINT)allocation.offset;
+    return true;
+}
+
+// Writes one matrix of vertex shader constants and binds it to slot 0.
+static bool SetD3D11VertexConstants(D3D11StateContext& state, const float* matrix)
+{
+    if (g_D3D11Context1)
+    {
+        UINT offset = 0;
+        if (!WriteD3D11Transient(g_D3D11CB, s_D3D11ConstantRing, matrix, 64, kD3D11ConstantAlignment, &offset))
+            return false;
+        const UINT firstConstant = offset / 16;
+        const UINT constantCount = 16;
+        g_D3D11Context1->VSSetConstantBuffers1(0, 1, &g_D3D11CB, &firstConstant, &constantCount);
+        s_D3D11StateCache.Forget(kRenderStateVSConstantBuffer0);
+        return true;
+    }
+
+    D3D11_MAPPED_SUBRESOURCE mapped;
+    if (!g_D3D11CB || FAILED(g_D3D11Context->Map(g_D3D11CB, 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped)))
+        return false;
+    memcpy(mapped.pData, matrix, 64);
+    g_D3D11Context->Unmap(g_D3D11CB, 0);
+    state.VSSetConstantBuffers(0, 1, &g_D3D11CB);
+    return true;
+}
+
+// -------------------------------------------------------------------
+// Recorded triangle pass
+//
+// The triangle's state and draw are the same every frame; only the world
+// matrix changes. They are recorded once through a deferred context into a
+// command list, and each frame replays it with ExecuteCommandList after
+// writing the matrix into g_D3D11PassCB, the one buffer the list reads that
+// changes. A command list starts from default state instead of inheriting
+// Unity's, so it binds the render target and viewport it was recorded
+// against, and is recorded again when Unity's differ. Devices that cannot
+// create deferred contexts (single-threaded ones) draw call by call.
+
+static ID3D11DeviceContext* g_D3D11DeferredContext = NULL;
+static ID3D11Buffer* g_D3D11PassVB = NULL;          // the triangle, written when recording
+static ID3D11Buffer* g_D3D11PassCB = NULL;          // world matrix, patched before every replay
+static ID3D11CommandList* g_D3D11TrianglePass = NULL;
+
+// Unity's render target and viewport the pass was recorded against. The
+// command list holds its own references to the views.
+struct D3D11PassTarget
+{
+    ID3D11RenderTargetView* rtv;
+    ID3D11DepthStencilView* dsv;
+    D3D11_VIEWPORT viewport;
+};
+static D3D11PassTarget s_D3D11TrianglePassTarget;
+
+static void CreateD3D11RecordingContexts();
+
+static void* CreateD3D11DeferredContextFromRecipe(void* device, const void* recipe, size_t)
+{
+    ID3D11DeviceContext* object = NULL;
+    static_cast<ID3D11Device*>(device)->CreateDeferredContext(*(const UINT*)recipe, &object);
+    return object;
+}
+
+static void CreateD3D11PassObjects()
+{
+    const UINT contextFlags = 0;
+    if (s_D3D11Resources.Create("deferred context", CreateD3D11DeferredContextFromRecipe, &contextFlags, sizeof(contextFlags), D3D11Slot(&g_D3D11DeferredContext)) == kInvalidResourceId)
+        return;
+    CreateD3D11RecordingContexts();
+
+    D3D11BufferRecipe recipe;
+    D3D11_BUFFER_DESC& desc = recipe.desc;
+    memset (&desc, 0, sizeof(desc));
+    desc.Usage = D3D11_USAGE_DEFAULT;
+    desc.ByteWidth = 3 * sizeof(MyVertex);
+    desc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+    CreateD3D11Object ("pass vertex buffer", CreateD3D11BufferFromRecipe, recipe, NULL, 0, D3D11Slot(&g_D3D11PassVB));
+
+    desc.Usage = D3D11_USAGE_DYNAMIC;
+    desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+    desc.ByteWidth = 64;
+    desc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+    CreateD3D11Object ("pass constant buffer", CreateD3D11BufferFromRecipe, recipe, NULL, 0, D3D11Slot(&g_D3D11PassCB));
+}
+
+// The list refers to objects a reset or shutdown releases
+static void ReleaseD3D11PassRecording()
+{
+    SAFE_RELEASE(g_D3D11TrianglePass);
+    memset(&s_D3D11TrianglePassTarget, 0, sizeof(s_D3D11TrianglePassTarget));
+}
+
+static bool RecordD3D11TrianglePass(const D3D11PassTarget& target, const MyVertex* verts)
+{
+    PLUGIN_TRACE_ZONE("RecordTrianglePass");
+    ReleaseD3D11PassRecording();
+    g_D3D11Context->UpdateSubresource(g_D3D11PassVB, 0, NULL, verts, 0, 0);
+
+    ID3D11DeviceContext* ctx = g_D3D11DeferredContext;
+    ID3D11RenderTargetView* rtv = target.rtv;
+    ctx->OMSetRenderTargets(1, &rtv, target.dsv);
+    ctx->RSSetViewports(1, &target.viewport);
+    ctx->OMSetDepthStencilState(g_D3D11DepthState, 0);
+    ctx->RSSetState(g_D3D11RasterState);
+    ctx->OMSetBlendState(g_D3D11BlendState, NULL, 0xFFFFFFFF);
+    ctx->VSSetShader(g_D3D11VertexShader, NULL, 0);
+    ctx->PSSetShader(g_D3D11PixelShader, NULL, 0);
+    ctx->VSSetConstantBuffers(0, 1, &g_D3D11PassCB);
+
+    const UINT stride = sizeof(MyVertex);
+    const UINT offset = 0;
+    ctx->IASetInputLayout(g_D3D11InputLayout);
+    ctx->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+    ctx->IASetVertexBuffers(0, 1, &g_D3D11PassVB, &stride, &offset);
+    ctx->Draw(3, 0);
+
+    if (FAILED(ctx->FinishCommandList(FALSE, &g_D3D11TrianglePass)))
+    {
+        g_D3D11TrianglePass = NULL;
+        return false;
+    }
+    s_D3D11TrianglePassTarget = target;
+    return true;
+}
+
+// Replays the recorded pass, recording it first when there is none for
+// Unity's current render target and viewport. False when the pass cannot
+// be used; the caller then draws call by call.
+static bool DrawD3D11TrianglePass(const float* worldMatrix, const MyVertex* verts)
+{
+    if (!g_D3D11DeferredContext || !g_D3D11PassVB || !g_D3D11PassCB || !g_D3D11VertexShader || !g_D3D11PixelShader || !g_D3D11InputLayout)
+        return false;
+
+    D3D11PassTarget target;
+    memset(&target, 0, sizeof(target));
+    UINT viewportCount = 1;
+    g_D3D11Context->OMGetRenderTargets(1, &target.rtv, &target.dsv);
+    g_D3D11Context->RSGetViewports(&viewportCount, &target.viewport);
+
+    bool recorded = g_D3D11TrianglePass && memcmp(&target, &s_D3D11TrianglePassTarget, sizeof(target)) == 0;
+    if (!recorded)
+        recorded = RecordD3D11TrianglePass(target, verts);
+    if (target.rtv)
+        target.rtv->Release();
+    if (target.dsv)
+        target.dsv->Release();
+    if (!recorded)
+        return false;
+
+    D3D11_MAPPED_SUBRESOURCE mapped;
+    if (FAILED(g_D3D11Context->Map(g_D3D11PassCB, 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped)))
+        return false;
+    memcpy(mapped.pData, worldMatrix, 64);
+    g_D3D11Context->Unmap(g_D3D11PassCB, 0);
+
+    // Unity's state comes back afterwards, so s_D3D11StateCache still holds
+    g_D3D11Context->ExecuteCommandList(g_D3D11TrianglePass, TRUE);
+    return true;
+}
+
+// Call by call, streaming the vertices and constants through the rings
+static bool DrawD3D11TriangleImmediate(D3D11StateContext& state, const float* worldMatrix, const MyVertex* verts)
+{
+    // constants - just the world matrix in our case
+    const bool haveConstants = SetD3D11VertexConstants (state, worldMatrix);
+
+    // set shaders
+    state.VSSetShader (g_D3D11VertexShader);
+    state.PSSetShader (g_D3D11PixelShader);
+
+    // vertices, then input assembler data and draw
+    UINT stride = sizeof(MyVertex);
+    UINT offset = 0;
+    if (!haveConstants || !WriteD3D11Transient (g_D3D11VB, s_D3D11VertexRing, verts, sizeof(verts[0])*3, 16, &offset))
+        return false;
+    state.IASetInputLayout (g_D3D11InputLayout);
+    state.IASetPrimitiveTopology (D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+    state.IASetVertexBuffers (0, 1, &g_D3D11VB, &stride, &offset);
+    g_D3D11Context->Draw (3, 0);
+    return true;
+}
+
+// GPU timers: a disjoint query and the timestamps of every pass per ring slot
+static ID3D11Query* g_D3D11TimerDisjoint[kGpuTimerFrames];
+static ID3D11Query* g_D3D11Timestamps[kGpuTimerFrames][kGpuTimestampsPerFrame];
+
+static void CreateD3D11GpuTimers()
+{
+    D3D11_QUERY_DESC disjointDesc = { D3D11_QUERY_TIMESTAMP_DISJOINT, 0 };
+    D3D11_QUERY_DESC timestampDesc = { D3D11_QUERY_TIMESTAMP, 0 };
+    for (int slot = 0; slot < kGpuTimerFrames; ++slot)
+    {
+        s_D3D11Resources.Create ("timer disjoint query", CreateD3D11QueryFromRecipe, &disjointDesc, sizeof(disjointDesc), D3D11Slot(&g_D3D11TimerDisjoint[slot]));
+        for (int query = 0; query < kGpuTimestampsPerFrame; ++query)
+            s_D3D11Resources.Create ("timestamp query", CreateD3D11QueryFromRecipe, &timestampDesc, sizeof(timestampDesc), D3D11Slot(&g_D3D11Timestamps[slot][query]));
+    }
+}
+
+static void BeginD3D11TimerFrame(void*, int slot)
+{
+    if (g_D3D11TimerDisjoint[slot])
+        g_D3D11Context->Begin(g_D3D11TimerDisjoint[slot]);
+}
+
+static void WriteD3D11Timestamp(void*, int slot, int query)
+{
+    if (g_D3D11Timestamps[slot][query])
+        g_D3D11Context->End(g_D3D11Timestamps[slot][query]);
+}
+
+static void EndD3D11TimerFrame(void*, int slot)
+{
+    if (g_D3D11TimerDisjoint[slot])
+        g_D3D11Context->End(g_D3D11TimerDisjoint[slot]);
+}
+
+static bool ReadD3D11TimerFrame(void*, int slot, uint32_t queryMask, GpuQueryResults* out)
+{
+    // A slot whose queries could not be created reads as disjoint, so it is
+    // dropped rather than waited for
+    memset(out, 0, sizeof(*out));
+    out->disjoint = true;
+    if (!g_D3D11TimerDisjoint[slot])
+        return true;
+
+    D3D11_QUERY_DATA_TIMESTAMP_DISJOINT disjoint;
+    if (g_D3D11Context->GetData(g_D3D11TimerDisjoint[slot], &disjoint, sizeof(disjoint), D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK)
+        return false;
+    for (int query = 0; query < kGpuTimestampsPerFrame; ++query)
+    {
+        if (!(queryMask & (1u << query)))
+            continue;
+        if (!g_D3D11Timestamps[slot][query])
+            return true;
+        UINT64 ticks = 0;
+        if (g_D3D11Context->GetData(g_D3D11Timestamps[slot][query], &ticks, sizeof(ticks), D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK)
+            return false;
+        out->ticks[query] = ticks;
+    }
+    out->frequency = disjoint.Frequency;
+    out->disjoint = disjoint.Disjoint != FALSE;
+    return true;
+}
+
+static const GpuQuerySource s_D3D11GpuQueries = { NULL, BeginD3D11TimerFrame, WriteD3D11Timestamp, EndD3D11TimerFrame, ReadD3D11TimerFrame };
+
+static void PublishD3D11GpuTimings()
+{
+    static uint64_t s_PublishedCount = 0;
+    if (s_D3D11GpuTimers.GetTimedCount() != s_PublishedCount)
+    {
+        s_PublishedCount = s_D3D11GpuTimers.GetTimedCount();
+        s_GpuTimings.Publish(s_D3D11GpuTimers.GetLatest());
+    }
+}
+
+static bool EnsureD3D11ResourcesAreCreated()
+{
+    // Created once per device; after a reset the journal brings them back
+    if (s_D3D11ResourcesCreated)
+        return true;
+
+    // Shaders that are not embedded come from the streaming assets path; wait for
+    // Unity to provide it and for the blobs to arrive. Until then frames are
+    // skipped rather than stalled on the disk.
+    ShaderBytecode vertexShader, pixelShader, instancedVertexShader;
+    if (s_Shaders.IsLoading())
+        return false;
+    if (!s_Shaders.Get(kShaderBlobSimpleVertex, &vertexShader) && s_UnityStreamingAssetsPath.empty())
+        return false;
+    for (int i = 0; i < kShaderBlobCount; ++i)
+    {
+        ShaderBytecode bytecode;
+        if (!s_Shaders.Get((ShaderBlobId)i, &bytecode))
+        {
+            std::string errorMessage = "Failed to find ";
+            errorMessage += GetShaderBlobFileName((ShaderBlobId)i);
+            DebugLog(errorMessage.c_str());
+        }
+    }
+    PLUGIN_TRACE_ZONE("CreateD3D11Resources");
+
+    // vertex and constant buffers
+    CreateD3D11TransientBuffers();
+    CreateD3D11GpuTimers();
+
+
+    if (s_Shaders.Get(kShaderBlobSimpleVertex, &vertexShader) && s_Shaders.Get(kShaderBlobSimplePixel, &pixelShader))
+    {
+        if (s_D3D11Resources.Create("vertex shader", CreateD3D11VertexShaderFromRecipe, vertexShader.data, vertexShader.size, D3D11Slot(&g_D3D11VertexShader)) == kInvalidResourceId)
+            DebugLog("Failed to create vertex shader.\n");
+        if (s_D3D11Resources.Create("pixel shader", CreateD3D11PixelShaderFromRecipe, pixelShader.data, pixelShader.size, D3D11Slot(&g_D3D11PixelShader)) == kInvalidResourceId)
+            DebugLog("Failed to create pixel shader.\n");
     }
     else
     {
         DebugLog("Failed to load vertex or pixel shader.\n");
     }
     // input layout
-    if (g_D3D11VertexShader && vertexShader.size() > 0)
+    if (g_D3D11VertexShader)
     {
-        g_D3D11Device->CreateInputLayout (s_DX11InputElementDesc, 2, &vertexShader[0], vertexShader.size(), &g_D3D11InputLayout);
+        const D3D11InputLayoutRecipe layout = { s_DX11InputElementDesc, 2 };
+        CreateD3D11Object ("input layout", CreateD3D11InputLayoutFromRecipe, layout, vertexShader.data, vertexShader.size, D3D11Slot(&g_D3D11InputLayout));
+    }
+
+    // instanced overlays: unit shapes and the per-instance vertex shader
+    int shapeVertexCount = 0;
+    const SoftwareVertex* shapeVertices = GetInstanceShapeVertices(&shapeVertexCount);
+    D3D11BufferRecipe shapeRecipe;
+    D3D11_BUFFER_DESC& shapeDesc = shapeRecipe.desc;
+    memset (&shapeDesc, 0, sizeof(shapeDesc));
+    shapeDesc.Usage = D3D11_USAGE_IMMUTABLE;
+    shapeDesc.ByteWidth = shapeVertexCount * sizeof(SoftwareVertex);
+    shapeDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+    CreateD3D11Object ("shape vertex buffer", CreateD3D11BufferFromRecipe, shapeRecipe, shapeVertices, shapeDesc.ByteWidth, D3D11Slot(&g_D3D11ShapeVB));
+
+    if (s_Shaders.Get(kShaderBlobInstancedVertex, &instancedVertexShader))
+    {
+        if (s_D3D11Resources.Create("instanced vertex shader", CreateD3D11VertexShaderFromRecipe, instancedVertexShader.data, instancedVertexShader.size, D3D11Slot(&g_D3D11InstancedVertexShader)) == kInvalidResourceId)
+            DebugLog("Failed to create instanced vertex shader.\n");
+        else
+        {
+            const D3D11InputLayoutRecipe layout = { s_DX11InstancedInputElementDesc, 6 };
+            CreateD3D11Object ("instanced input layout", CreateD3D11InputLayoutFromRecipe, layout, instancedVertexShader.data, instancedVertexShader.size, D3D11Slot(&g_D3D11InstancedInputLayout));
+        }
     }
 
     // render states
@@ -382,34 +1818,419 @@ static bool EnsureD3D11ResourcesAreCreated()
     rsdesc.FillMode = D3D11_FILL_SOLID;
     rsdesc.CullMode = D3D11_CULL_NONE;
     rsdesc.DepthClipEnable = TRUE;
-    g_D3D11Device->CreateRasterizerState (&rsdesc, &g_D3D11RasterState);
+    s_D3D11Resources.Create ("rasterizer state", CreateD3D11RasterizerStateFromRecipe, &rsdesc, sizeof(rsdesc), D3D11Slot(&g_D3D11RasterState));
 
     D3D11_DEPTH_STENCIL_DESC dsdesc;
     memset (&dsdesc, 0, sizeof(dsdesc));
     dsdesc.DepthEnable = TRUE;
     dsdesc.DepthWriteMask = D3D11_DEPTH_WRITE_MASK_ZERO;
     dsdesc.DepthFunc = D3D11_COMPARISON_LESS_EQUAL;
-    g_D3D11Device->CreateDepthStencilState (&dsdesc, &g_D3D11DepthState);
+    s_D3D11Resources.Create ("depth stencil state", CreateD3D11DepthStencilStateFromRecipe, &dsdesc, sizeof(dsdesc), D3D11Slot(&g_D3D11DepthState));
 
     D3D11_BLEND_DESC bdesc;
     memset (&bdesc, 0, sizeof(bdesc));
     bdesc.RenderTarget[0].BlendEnable = FALSE;
     bdesc.RenderTarget[0].RenderTargetWriteMask = 0xF;
-    g_D3D11Device->CreateBlendState (&bdesc, &g_D3D11BlendState);
+    s_D3D11Resources.Create ("blend state", CreateD3D11BlendStateFromRecipe, &bdesc, sizeof(bdesc), D3D11Slot(&g_D3D11BlendState));
+
+    // recorded triangle pass
+    CreateD3D11PassObjects();
+
+    s_D3D11ResourcesCreated = true;
+    return true;
+}
+
+static ID3D11RenderTargetView* CreateD3D11RenderTargetView(void* texturePtr)
+{
+    ID3D11Texture2D* d3dtex = reinterpret_cast<ID3D11Texture2D*>(texturePtr);
+    if (!g_D3D11Device || !d3dtex)
+        return NULL;
+
+    D3D11_TEXTURE2D_DESC texDesc = { 0 };
+
+    // Get the format of the texture
+    d3dtex->GetDesc(&texDesc);
+
+    D3D11_RENDER_TARGET_VIEW_DESC rtvDesc = { texDesc.Format };
+    rtvDesc.ViewDimension = D3D11_RTV_DIMENSION_TEXTURE2D;
+
+    // Create the render target view for the texture
+    ID3D11RenderTargetView* rtv = NULL;
+    if (FAILED(g_D3D11Device->CreateRenderTargetView(d3dtex, &rtvDesc, &rtv)))
+    {
+        DebugLog("Failed to create render target view.\n");
+        return NULL;
+    }
+    return rtv;
+}
+
+// count is what s_ClearCommands.Prepare returned for this frame
+static void ExecuteClearCommandsD3D11(ID3D11DeviceContext* ctx, int count)
+{
+    const ClearCommand* commands = s_ClearCommands.Commands();
+
+    // Rect clears need ClearView from D3D11.1
+    ID3D11DeviceContext1* ctx1 = NULL;
+
+    TextureHandle current = kInvalidTextureHandle;
+    const PluginTexture* texture = NULL;
+    for (int i = 0; i < count; ++i)
+    {
+        const ClearCommandDesc& desc = commands[i].desc;
+        if (desc.texture != current || i == 0)
+        {
+            current = desc.texture;
+            texture = s_Textures.Lookup(current);
+        }
+        if (!texture || !texture->d3d11RTV)
+            continue;
+
+        if (IsFullClear(desc))
+        {
+            ctx->ClearRenderTargetView(texture->d3d11RTV, desc.color);
+            AddPluginStat(Stats().clears, 1);
+            continue;
+        }
+
+        if (!ctx1 && FAILED(ctx->QueryInterface(__uuidof(ID3D11DeviceContext1), (void**)&ctx1)))
+        {
+            DEBUG_LOG_RATE_LIMITED(kLogSeverityWarning, kRepeatedLogIntervalMs, "Rect clears require D3D11.1; skipping.\n");
+            break;
+        }
+        const D3D11_RECT rect = { desc.rect.x, desc.rect.y, desc.rect.x + desc.rect.width, desc.rect.y + desc.rect.height };
+        ctx1->ClearView(texture->d3d11RTV, desc.color, &rect, 1);
+        AddPluginStat(Stats().clears, 1);
+    }
+
+    SAFE_RELEASE(ctx1);
+}
+
+// Draws the frame's instance batches into their textures. The batches'
+// render targets and viewports replace Unity's for the duration.
+enum { kD3D11MaxInstancesPerDraw = 8192 }; // a quarter of the transient vertex ring
+
+static void ExecuteInstanceBatchesD3D11(ID3D11DeviceContext* ctx, D3D11StateContext& state)
+{
+    const int batchCount = s_InstanceBatches.GetBatchCount();
+    if (batchCount == 0 || !g_D3D11InstancedVertexShader || !g_D3D11InstancedInputLayout || !g_D3D11ShapeVB || !g_D3D11PixelShader)
+        return;
+
+    ID3D11RenderTargetView* savedRTV = NULL;
+    ID3D11DepthStencilView* savedDSV = NULL;
+    D3D11_VIEWPORT savedViewport;
+    UINT viewportCount = 1;
+    ctx->OMGetRenderTargets(1, &savedRTV, &savedDSV);
+    ctx->RSGetViewports(&viewportCount, &savedViewport);
+
+    state.VSSetShader(g_D3D11InstancedVertexShader);
+    state.PSSetShader(g_D3D11PixelShader);
+    state.IASetInputLayout(g_D3D11InstancedInputLayout);
+    state.IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+
+    const DrawInstance* instances = s_InstanceBatches.GetInstances();
+    for (int b = 0; b < batchCount; ++b)
+    {
+        const InstanceBatch& batch = s_InstanceBatches.GetBatch(b);
+        const PluginTexture* texture = s_Textures.Lookup(batch.texture);
+        if (!texture || !texture->d3d11RTV)
+            continue;
+
+        ctx->OMSetRenderTargets(1, &texture->d3d11RTV, NULL);
+        const D3D11_VIEWPORT viewport = { 0, 0, (float)texture->width, (float)texture->height, 0, 1 };
+        ctx->RSSetViewports(1, &viewport);
+
+        const InstanceShapeRange range = GetInstanceShapeRange(batch.shape);
+        for (int first = 0; first < batch.instanceCount; first += kD3D11MaxInstancesPerDraw)
+        {
+            const int remaining = batch.instanceCount - first;
+            const int count = remaining < kD3D11MaxInstancesPerDraw ? remaining : kD3D11MaxInstancesPerDraw;
+            UINT offset = 0;
+            if (!WriteD3D11Transient(g_D3D11VB, s_D3D11VertexRing, instances + batch.firstInstance + first, count * sizeof(DrawInstance), 16, &offset))
+                break;
+            ID3D11Buffer* const buffers[2] = { g_D3D11ShapeVB, g_D3D11VB };
+            const UINT strides[2] = { sizeof(SoftwareVertex), sizeof(DrawInstance) };
+            const UINT offsets[2] = { 0, offset };
+            state.IASetVertexBuffers(0, 2, buffers, strides, offsets);
+            ctx->DrawInstanced(range.vertexCount, count, range.firstVertex, 0);
+            AddPluginStat(Stats().draws, 1);
+        }
+    }
+
+    ctx->OMSetRenderTargets(1, &savedRTV, savedDSV);
+    if (viewportCount)
+        ctx->RSSetViewports(viewportCount, &savedViewport);
+    SAFE_RELEASE(savedRTV);
+    SAFE_RELEASE(savedDSV);
+}
+
+// -------------------------------------------------------------------
+// Parallel recording of per-texture work
+//
+// When several textures have clears or instances queued, the frame's work
+// is split per texture (TextureWorkGroups.h) and the groups into one chunk
+// per recording context. The worker pool records each chunk through its
+// own deferred context into two command lists, the chunk's clears and its
+// draws. The render thread then executes every clear list and then every
+// draw list, in chunk order, so the GPU sees the commands in the order the
+// serial path issues them. Instance data goes into the transient vertex
+// ring on the render thread first, because only the immediate context can
+// map it with NO_OVERWRITE. Only used where the driver records command lists
+// itself; with the runtime's emulation the recording would still be serial
+// underneath.
+
+enum { kD3D11MaxRecordingContexts = 8 };
+static const UINT kD3D11NoInstanceOffset = 0xFFFFFFFF;
+
+struct D3D11RecordedChunk
+{
+    ID3D11CommandList* clears;
+    ID3D11CommandList* draws;
+    int clearCount;
+    int drawCount;
+};
+
+static ID3D11DeviceContext* g_D3D11RecordingContexts[kD3D11MaxRecordingContexts];
+static bool s_D3D11DriverCommandLists = false;
+static TextureWorkGroups s_D3D11TextureWork;
+static D3D11RecordedChunk s_D3D11RecordedChunks[kD3D11MaxRecordingContexts];
+static std::vector<int> s_D3D11ChunkBegins;
+static std::vector<UINT> s_D3D11InstanceOffsets;    // per draw, batches in submission order
+static std::vector<int> s_D3D11BatchFirstDraw;      // per batch, into s_D3D11InstanceOffsets
+
+// One context per thread that can pick up a chunk: the workers and the
+// render thread
+static void CreateD3D11RecordingContexts()
+{
+    D3D11_FEATURE_DATA_THREADING threading;
+    memset (&threading, 0, sizeof(threading));
+    s_D3D11DriverCommandLists = SUCCEEDED(g_D3D11Device->CheckFeatureSupport (D3D11_FEATURE_THREADING, &threading, sizeof(threading))) && threading.DriverCommandLists;
+    if (!s_D3D11DriverCommandLists || s_WorkerPool.GetWorkerCount () == 0)
+        return;
+
+    const UINT contextFlags = 0;
+    int count = s_WorkerPool.GetWorkerCount () + 1;
+    if (count > kD3D11MaxRecordingContexts)
+        count = kD3D11MaxRecordingContexts;
+    for (int i = 0; i < count; ++i)
+        s_D3D11Resources.Create ("recording context", CreateD3D11DeferredContextFromRecipe, &contextFlags, sizeof(contextFlags), D3D11Slot(&g_D3D11RecordingContexts[i]));
+}
+
+// Writes every batch's instances, split into draws as the serial path
+// does, and keeps their offsets for the recording tasks
+static void WriteD3D11InstanceData()
+{
+    const int batchCount = s_InstanceBatches.GetBatchCount();
+    const DrawInstance* instances = s_InstanceBatches.GetInstances();
+    s_D3D11BatchFirstDraw.resize(batchCount + 1);
+    s_D3D11InstanceOffsets.clear();
+    for (int b = 0; b < batchCount; ++b)
+    {
+        s_D3D11BatchFirstDraw[b] = (int)s_D3D11InstanceOffsets.size();
+        const InstanceBatch& batch = s_InstanceBatches.GetBatch(b);
+        for (int first = 0; first < batch.instanceCount; first += kD3D11MaxInstancesPerDraw)
+        {
+            const int remaining = batch.instanceCount - first;
+            const int count = remaining < kD3D11MaxInstancesPerDraw ? remaining : kD3D11MaxInstancesPerDraw;
+            UINT offset = 0;
+            if (!WriteD3D11Transient(g_D3D11VB, s_D3D11VertexRing, instances + batch.firstInstance + first, count * sizeof(DrawInstance), 16, &offset))
+                offset = kD3D11NoInstanceOffset;
+            s_D3D11InstanceOffsets.push_back(offset);
+        }
+    }
+    s_D3D11BatchFirstDraw[batchCount] = (int)s_D3D11InstanceOffsets.size();
+}
+
+// Worker task: records chunk's clears, then its draws. Reads the texture
+// registry and the queued commands while the render thread waits.
+static void RecordD3D11ChunkTask(int chunk, void*)
+{
+    ID3D11DeviceContext* ctx = g_D3D11RecordingContexts[chunk];
+    D3D11RecordedChunk& out = s_D3D11RecordedChunks[chunk];
+    const TextureWorkGroups& work = s_D3D11TextureWork;
+    const int groupBegin = s_D3D11ChunkBegins[chunk];
+    const int groupEnd = s_D3D11ChunkBegins[chunk + 1];
+    const ClearCommand* clears = s_ClearCommands.Commands();
+
+    // Rect clears need ClearView from D3D11.1
+    ID3D11DeviceContext1* ctx1 = NULL;
+    bool rectClears = true;
+    for (int g = groupBegin; g < groupEnd; ++g)
+    {
+        const TextureWorkGroup& group = work.GetGroup(g);
+        const PluginTexture* texture = s_Textures.Lookup(group.texture);
+        if (!texture || !texture->d3d11RTV)
+            continue;
+        for (int i = 0; i < group.clearCount; ++i)
+        {
+            const ClearCommandDesc& desc = clears[group.firstClear + i].desc;
+            if (IsFullClear(desc))
+            {
+                ctx->ClearRenderTargetView(texture->d3d11RTV, desc.color);
+                ++out.clearCount;
+                continue;
+            }
+            if (rectClears && !ctx1 && FAILED(ctx->QueryInterface(__uuidof(ID3D11DeviceContext1), (void**)&ctx1)))
+            {
+                DEBUG_LOG_RATE_LIMITED(kLogSeverityWarning, kRepeatedLogIntervalMs, "Rect clears require D3D11.1; skipping.\n");
+                rectClears = false;
+            }
+            if (!rectClears)
+                continue;
+            const D3D11_RECT rect = { desc.rect.x, desc.rect.y, desc.rect.x + desc.rect.width, desc.rect.y + desc.rect.height };
+            ctx1->ClearView(texture->d3d11RTV, desc.color, &rect, 1);
+            ++out.clearCount;
+        }
+    }
+    SAFE_RELEASE(ctx1);
+    if (FAILED(ctx->FinishCommandList(FALSE, &out.clears)))
+        out.clears = NULL;
+
+    // A command list starts from default state: everything the draws use is set here
+    ctx->OMSetDepthStencilState(g_D3D11DepthState, 0);
+    ctx->RSSetState(g_D3D11RasterState);
+    ctx->OMSetBlendState(g_D3D11BlendState, NULL, 0xFFFFFFFF);
+    ctx->VSSetShader(g_D3D11InstancedVertexShader, NULL, 0);
+    ctx->PSSetShader(g_D3D11PixelShader, NULL, 0);
+    ctx->IASetInputLayout(g_D3D11InstancedInputLayout);
+    ctx->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+
+    const int* batchOrder = work.GetBatchOrder();
+    for (int g = groupBegin; g < groupEnd; ++g)
+    {
+        const TextureWorkGroup& group = work.GetGroup(g);
+        const PluginTexture* texture = group.batchCount ? s_Textures.Lookup(group.texture) : NULL;
+        if (!texture || !texture->d3d11RTV)
+            continue;
+
+        ctx->OMSetRenderTargets(1, &texture->d3d11RTV, NULL);
+        const D3D11_VIEWPORT viewport = { 0, 0, (float)texture->width, (float)texture->height, 0, 1 };
+        ctx->RSSetViewports(1, &viewport);
+
+        for (int i = 0; i < group.batchCount; ++i)
+        {
+            const int b = batchOrder[group.firstBatch + i];
+            const InstanceBatch& batch = s_InstanceBatches.GetBatch(b);
+            const InstanceShapeRange range = GetInstanceShapeRange(batch.shape);
+            for (int d = s_D3D11BatchFirstDraw[b]; d < s_D3D11BatchFirstDraw[b + 1]; ++d)
+            {
+                if (s_D3D11InstanceOffsets[d] == kD3D11NoInstanceOffset)
+                    break;
+                const int first = (d - s_D3D11BatchFirstDraw[b]) * kD3D11MaxInstancesPerDraw;
+                const int remaining = batch.instanceCount - first;
+                const int count = remaining < kD3D11MaxInstancesPerDraw ? remaining : kD3D11MaxInstancesPerDraw;
+                ID3D11Buffer* const buffers[2] = { g_D3D11ShapeVB, g_D3D11VB };
+                const UINT strides[2] = { sizeof(SoftwareVertex), sizeof(DrawInstance) };
+                const UINT offsets[2] = { 0, s_D3D11InstanceOffsets[d] };
+                ctx->IASetVertexBuffers(0, 2, buffers, strides, offsets);
+                ctx->DrawInstanced(range.vertexCount, count, range.firstVertex, 0);
+                ++out.drawCount;
+            }
+        }
+    }
+    if (FAILED(ctx->FinishCommandList(FALSE, &out.draws)))
+        out.draws = NULL;
+}
 
+static int s_D3D11TextureWorkContexts = 0;
+static bool s_D3D11TextureWorkDraws = false;
+
+// Groups the clears and draws in work for recording in parallel, with
+// clearCount from s_ClearCommands.Prepare. False when that is not worth it
+// (or not possible), or while the workers are still busy with a fill; the
+// serial path then does them instead.
+static bool PrepareTextureWorkD3D11Parallel(unsigned work, int clearCount)
+{
+    if (!s_D3D11DriverCommandLists || s_WorkerPool.GetWorkerCount() == 0 || s_WorkerPool.IsJobInFlight())
+        return false;
+    int contexts = 0;
+    while (contexts < kD3D11MaxRecordingContexts && g_D3D11RecordingContexts[contexts])
+        ++contexts;
+    if (contexts < 2)
+        return false;
+
+    const bool draws = (work & kRenderWorkDraw) && g_D3D11InstancedVertexShader && g_D3D11InstancedInputLayout && g_D3D11ShapeVB && g_D3D11PixelShader;
+    if (s_D3D11TextureWork.Build(s_ClearCommands.Commands(), clearCount, draws ? &s_InstanceBatches : NULL) < 2)
+        return false;
+    s_D3D11TextureWorkContexts = contexts;
+    s_D3D11TextureWorkDraws = draws;
     return true;
 }
 
+// Records the work PrepareTextureWorkD3D11Parallel grouped on the workers
+// and executes the lists.
+static void ExecuteTextureWorkD3D11Parallel(unsigned work, GpuTimerRing& timers)
+{
+    if (s_D3D11TextureWorkDraws)
+        WriteD3D11InstanceData();
+
+    const int chunks = s_D3D11TextureWork.SplitIntoChunks(s_D3D11TextureWorkContexts, s_D3D11ChunkBegins);
+    memset(s_D3D11RecordedChunks, 0, sizeof(s_D3D11RecordedChunks));
+    {
+        PLUGIN_TRACE_ZONE("RecordTextureWork");
+        s_WorkerPool.ParallelFor(chunks, RecordD3D11ChunkTask, NULL);
+    }
+
+    // Unity's state comes back after every list, so s_D3D11StateCache still holds
+    if (work & kRenderWorkClear)
+    {
+        timers.BeginPass(s_D3D11GpuQueries, kGpuPassClear);
+        for (int c = 0; c < chunks; ++c)
+        {
+            if (s_D3D11RecordedChunks[c].clears && s_D3D11RecordedChunks[c].clearCount)
+            {
+                g_D3D11Context->ExecuteCommandList(s_D3D11RecordedChunks[c].clears, TRUE);
+                AddPluginStat(Stats().clears, s_D3D11RecordedChunks[c].clearCount);
+            }
+        }
+        timers.EndPass(s_D3D11GpuQueries, kGpuPassClear);
+    }
+    if (work & kRenderWorkDraw)
+    {
+        timers.BeginPass(s_D3D11GpuQueries, kGpuPassInstances);
+        for (int c = 0; c < chunks; ++c)
+        {
+            if (s_D3D11RecordedChunks[c].draws && s_D3D11RecordedChunks[c].drawCount)
+            {
+                g_D3D11Context->ExecuteCommandList(s_D3D11RecordedChunks[c].draws, TRUE);
+                AddPluginStat(Stats().draws, s_D3D11RecordedChunks[c].drawCount);
+            }
+        }
+        timers.EndPass(s_D3D11GpuQueries, kGpuPassInstances);
+    }
+
+    for (int c = 0; c < chunks; ++c)
+    {
+        SAFE_RELEASE(s_D3D11RecordedChunks[c].clears);
+        SAFE_RELEASE(s_D3D11RecordedChunks[c].draws);
+    }
+}
+
+// Texture views are destroyed with their textures (ReleaseAllTextureDeviceObjects)
 static void ReleaseD3D11Resources()
 {
-    SAFE_RELEASE(g_D3D11VB);
-    SAFE_RELEASE(g_D3D11CB);
-    SAFE_RELEASE(g_D3D11VertexShader);
-    SAFE_RELEASE(g_D3D11PixelShader);
-    SAFE_RELEASE(g_D3D11InputLayout);
-    SAFE_RELEASE(g_D3D11RasterState);
-    SAFE_RELEASE(g_D3D11BlendState);
-    SAFE_RELEASE(g_D3D11DepthState);
+    ReleaseD3D11PassRecording();
+    s_D3D11Resources.Clear();
+    s_D3D11ResourcesCreated = false;
+    s_D3D11RecreatePending = false;
+    SAFE_RELEASE(g_D3D11Context1);
+    ResetD3D11TransientFrames();
+}
+
+// Picks up the objects the workers recreated after a device reset
+static void FinishD3D11ResourceRecreate()
+{
+    if (!s_D3D11RecreatePending)
+        return;
+    s_D3D11RecreatePending = false;
+    const int failed = s_D3D11Resources.EndRecreate();
+    RefreshD3D11TextureViews();
+    ResetD3D11TransientFrames();
+    if (failed)
+    {
+        char message[128];
+        snprintf(message, sizeof(message), "%d of %d D3D11 objects could not be recreated after the device reset.\n", failed, s_D3D11Resources.GetRecordCount());
+        DebugWarn(message);
+    }
 }
 
 static void DoEventGraphicsDeviceD3D11(UnityGfxDeviceEventType eventType)
@@ -418,12 +2239,45 @@ static void DoEventGraphicsDeviceD3D11(UnityGfxDeviceEventType eventType)
     {
         IUnityGraphicsD3D11* d3d11 = s_UnityInterfaces->Get<IUnityGraphicsD3D11>();
         g_D3D11Device = d3d11->GetDevice();
-        
+        g_D3D11Device->GetImmediateContext(&g_D3D11Context);
+        s_D3D11Resources.SetDevice(g_D3D11Device, ReleaseD3D11Object);
+        s_D3D11StateCache.Invalidate();
+
         EnsureD3D11ResourcesAreCreated();
     }
     else if (eventType == kUnityGfxDeviceEventShutdown)
     {
         ReleaseD3D11Resources();
+        s_D3D11Resources.SetDevice(NULL, NULL);
+        SAFE_RELEASE(g_D3D11Context);
+    }
+    else if (eventType == kUnityGfxDeviceEventBeforeReset)
+    {
+        // Drop every object but keep the journal's records of them
+        ReleaseD3D11PassRecording();
+        s_D3D11Resources.ReleaseObjects();
+        s_D3D11RecreatePending = false;
+        RefreshD3D11TextureViews();
+        ResetD3D11TransientFrames();
+        s_D3D11StateCache.Invalidate();
+    }
+    else if (eventType == kUnityGfxDeviceEventAfterReset)
+    {
+        // The device and its immediate context may be new ones
+        IUnityGraphicsD3D11* d3d11 = s_UnityInterfaces->Get<IUnityGraphicsD3D11>();
+        SAFE_RELEASE(g_D3D11Context);
+        g_D3D11Device = d3d11->GetDevice();
+        g_D3D11Device->GetImmediateContext(&g_D3D11Context);
+        QueryD3D11ConstantBufferOffsets();
+        if (!s_D3D11ConstantBufferRanges)
+            SAFE_RELEASE(g_D3D11Context1);
+        s_D3D11Resources.SetDevice(g_D3D11Device, ReleaseD3D11Object);
+        s_D3D11StateCache.Invalidate();
+
+        // Everything is recreated at once on the workers while Unity carries
+        // on; the next render event waits for whatever is left.
+        s_D3D11Resources.BeginRecreate(&s_WorkerPool);
+        s_D3D11RecreatePending = true;
     }
 }
 
@@ -444,109 +2298,338 @@ static void DoEventGraphicsDeviceD3D11(UnityGfxDeviceEventType eventType)
 
 static void SetDefaultGraphicsState ()
 {
+    PLUGIN_TRACE_ZONE("SetDefaultGraphicsState");
     #if SUPPORT_D3D11
     // D3D11 case
-    if (s_DeviceType == kUnityGfxRendererD3D11)
+    if (s_DeviceType == kUnityGfxRendererD3D11 && g_D3D11Context)
     {
-        ID3D11DeviceContext* ctx = NULL;
-        g_D3D11Device->GetImmediateContext (&ctx);
-        ctx->OMSetDepthStencilState (g_D3D11DepthState, 0);
-        ctx->RSSetState (g_D3D11RasterState);
-        ctx->OMSetBlendState (g_D3D11BlendState, NULL, 0xFFFFFFFF);
-        ctx->Release();
+        D3D11StateContext ctx (g_D3D11Context, s_D3D11StateCache);
+        ctx.OMSetDepthStencilState (g_D3D11DepthState, 0);
+        ctx.RSSetState (g_D3D11RasterState);
+        ctx.OMSetBlendState (g_D3D11BlendState, NULL, 0xFFFFFFFF);
     }
     #endif
 }
 
 
-static void FillTextureFromCode (int width, int height, int stride, unsigned char* dst)
+#if SUPPORT_SOFTWARE
+static CpuSurface* ResolveSoftwareSurface(TextureHandle handle, void*)
+{
+    const PluginTexture* texture = s_Textures.Lookup(handle);
+    return texture ? texture->cpuSurface : NULL;
+}
+
+// The triangle is recorded once per render target (RecordedPass.h) and
+// replayed with each frame's world matrix, as the D3D11 backend does with
+// a command list. Handles resolve at replay, so the target may be
+// re-registered in between.
+static RecordedPass s_SoftwareTrianglePass;
+static TextureHandle s_SoftwareTrianglePassTarget = kInvalidTextureHandle;
+
+static int DrawSoftwareTrianglePass(const float* worldMatrix, const MyVertex* verts)
+{
+    if (!s_SoftwareTrianglePass.IsRecorded() || s_SoftwareTrianglePassTarget != s_SoftwareRenderTarget)
+    {
+        PLUGIN_TRACE_ZONE("RecordTrianglePass");
+        s_SoftwareTrianglePass.Begin();
+        s_SoftwareTrianglePass.SetTarget(s_SoftwareRenderTarget);
+        s_SoftwareTrianglePass.DrawTriangles(0, reinterpret_cast<const SoftwareVertex*>(verts), 3);
+        s_SoftwareTrianglePass.End();
+        s_SoftwareTrianglePassTarget = s_SoftwareRenderTarget;
+    }
+
+    RecordedPassConstants constants;
+    memcpy(constants.matrices[0], worldMatrix, sizeof(constants.matrices[0]));
+    return s_SoftwareTrianglePass.Replay(constants, ResolveSoftwareSurface, NULL);
+}
+
+// Clears and instances split per texture for the workers (TextureWorkGroups.h)
+static TextureWorkGroups s_SoftwareTextureWork;
+#endif
+
+
+// Plasma tables are kept across frames so the fill does not allocate once
+// the texture size has been seen. See PlasmaKernel.h. The rows are filled in
+// bands on the worker pool, in the background: the image is complete once
+// s_WorkerPool.Wait() returns.
+static PlasmaTables s_PlasmaTables;
+static PlasmaFillJob s_PlasmaFillJob;
+
+static void BeginFillTextureFromCode (int width, int height, int stride, unsigned char* dst)
 {
+    PLUGIN_TRACE_ZONE("FillTextureFromCode");
     const float t = g_Time * 4.0f;
+    BeginFillPlasmaParallel (s_WorkerPool, s_PlasmaFillJob, s_PlasmaTables, width, height, stride, dst, t);
+}
 
-    for (int y = 0; y < height; ++y)
+
+// --------------------------------------------------------------------------
+// Procedural texture upload
+//
+// Generated images go through s_UploadRing, two persistent 64 byte aligned
+// staging slots sized for the largest registered texture. Each frame the
+// render thread starts filling one slot for this frame and uploads the slot
+// filled during the previous frame, so the fill runs on the workers behind
+// the rest of the frame, and the texture shows the plasma one frame late.
+// Steady-state frames do not touch the heap.
+
+static UploadRing s_UploadRing;
+static bool s_ProceduralFillPending = false;
+static int s_ProceduralFillWidth = 0, s_ProceduralFillHeight = 0;  // slot being filled
+static int s_ProceduralReadyWidth = 0, s_ProceduralReadyHeight = 0; // slot ready for upload
+
+// Finishes the fill started by StartProceduralFill, which makes its image
+// ready for upload. Waiting for it counts as fill time.
+static void FinishProceduralFill ()
+{
+    {
+        PLUGIN_TRACE_ZONE("WaitForTextureFill");
+        PluginStatsTimer fillTimer (Stats().fillTextureNs);
+        s_WorkerPool.Wait ();
+    }
+    if (s_ProceduralFillPending)
+    {
+        s_UploadRing.EndWrite ((size_t)s_ProceduralFillWidth * 4 * s_ProceduralFillHeight);
+        s_ProceduralReadyWidth = s_ProceduralFillWidth;
+        s_ProceduralReadyHeight = s_ProceduralFillHeight;
+        s_ProceduralFillPending = false;
+    }
+}
+
+// Starts filling the next slot on the workers. The pool runs one job at a
+// time, so anything else that needs it this frame goes first.
+static void StartProceduralFill ()
+{
+    const PluginTexture* target = s_Textures.Lookup (s_ProceduralTexture);
+    if (!target || target->width <= 0 || target->height <= 0)
     {
-        unsigned char* ptr = dst;
-        for (int x = 0; x < width; ++x)
+        while (s_UploadRing.BeginRead (NULL))
+            s_UploadRing.EndRead ();
+        return;
+    }
+
+    const size_t bytes = (size_t)target->width * 4 * target->height;
+    if (s_UploadRing.GetSlotSize () < bytes)
+    {
+        if (!s_UploadRing.Reserve (bytes > s_LargestTextureBytes ? bytes : s_LargestTextureBytes, 2))
         {
-            // Simple oldskool "plasma effect", a bunch of combined sine waves
-            int vv = int(
-                (127.0f + (127.0f * sinf(x/7.0f+t))) +
-                (127.0f + (127.0f * sinf(y/5.0f-t))) +
-                (127.0f + (127.0f * sinf((x+y)/6.0f-t))) +
-                (127.0f + (127.0f * sinf(sqrtf(float(x*x + y*y))/4.0f-t)))
-                ) / 4;
-
-            // Write the texture pixel
-            ptr[0] = vv;
-            ptr[1] = vv;
-            ptr[2] = vv;
-            ptr[3] = vv;
-
-            // To next pixel (our pixels are 4 bpp)
-            ptr += 4;
+            DebugError ("Out of memory for the procedural texture upload ring.\n");
+            return;
         }
+    }
+
+    unsigned char* next = s_UploadRing.BeginWrite ();
+    if (next)
+    {
+        PluginStatsTimer fillTimer (Stats().fillTextureNs);
+        BeginFillTextureFromCode (target->width, target->height, target->width * 4, next);
+        s_ProceduralFillWidth = target->width;
+        s_ProceduralFillHeight = target->height;
+        s_ProceduralFillPending = true;
+    }
+}
+
+// Returns the image to upload into *texture (rows are width * 4 bytes), or
+// NULL when no fill has finished since the last upload. Call
+// EndProceduralUpload once the data has been consumed.
+static const unsigned char* BeginProceduralUpload (const PluginTexture** texture)
+{
+    *texture = s_Textures.Lookup (s_ProceduralTexture);
+    const PluginTexture* target = *texture;
+    if (!target || target->width <= 0 || target->height <= 0)
+        return NULL;
 
-        // To next image row
-        dst += stride;
+    const unsigned char* ready = s_UploadRing.BeginRead (NULL);
+    if (ready && (s_ProceduralReadyWidth != target->width || s_ProceduralReadyHeight != target->height))
+    {
+        // Filled for a different texture
+        s_UploadRing.EndRead ();
+        return NULL;
     }
+    return ready;
+}
+
+static void EndProceduralUpload ()
+{
+    s_UploadRing.EndRead ();
+}
+
+#if SUPPORT_SOFTWARE
+static void UploadCpuSurface (CpuSurface& surface, const unsigned char* data, int width, int height)
+{
+    for (int y = 0; y < height; ++y)
+        memcpy (surface.pixels + (size_t)y * surface.stride, data + (size_t)y * width * 4, (size_t)width * 4);
 }
+#endif
 
 
-static void DoRendering (const float* worldMatrix, const float* identityMatrix, float* projectionMatrix, const MyVertex* verts)
+// Does the parts of the frame in work (RenderWork bits)
+static void DoRendering (unsigned work, const float* worldMatrix, const float* identityMatrix, float* projectionMatrix, const MyVertex* verts)
 {
     // Does actual rendering of a simple triangle
+    PLUGIN_TRACE_ZONE("DoRendering");
+    PluginStatsTimer timer (Stats().doRenderingNs);
+
+    #if SUPPORT_SOFTWARE
+    // Software case: same clears and triangle, into CPU surfaces
+    if (s_DeviceType == kUnityGfxRendererNull)
+    {
+        if (work & kRenderWorkFill)
+            FinishProceduralFill();
+
+        // Clears and instances spread over several textures go to the
+        // workers, one texture per task, if the workers are free; while
+        // a fill is still running (split events) they stay on this thread.
+        const int clearCount = (work & kRenderWorkClear) ? s_ClearCommands.Prepare() : 0;
+        const InstanceBatchBuffer* batches = (work & kRenderWorkDraw) ? &s_InstanceBatches : NULL;
+        const bool parallel = s_WorkerPool.GetWorkerCount() > 0 && !s_WorkerPool.IsJobInFlight() && s_SoftwareTextureWork.Build(s_ClearCommands.Commands(), clearCount, batches) > 1;
+
+        // The next fill runs behind the rest of the frame, starting after
+        // the clears and instances when those need the workers
+        if ((work & kRenderWorkFill) && !parallel)
+            StartProceduralFill();
+
+        const PluginTexture* procedural = NULL;
+        if (work & kRenderWorkUpload)
+        {
+            if (const unsigned char* data = BeginProceduralUpload(&procedural))
+            {
+                if (procedural->cpuSurface)
+                {
+                    UploadCpuSurface(*procedural->cpuSurface, data, procedural->width, procedural->height);
+                    AddPluginStat(Stats().uploadBytes, (uint64_t)procedural->width * 4 * procedural->height);
+                }
+                EndProceduralUpload();
+            }
+        }
+
+        if (parallel)
+        {
+            {
+                PLUGIN_TRACE_ZONE("ParallelTextureWork");
+                int clears = 0, draws = 0;
+                s_SoftwareTextureWork.ExecuteCPU(s_WorkerPool, ResolveSoftwareSurface, NULL, &clears, &draws);
+                AddPluginStat(Stats().clears, clears);
+                AddPluginStat(Stats().draws, draws);
+            }
+            if (work & kRenderWorkFill)
+                StartProceduralFill();
+        }
+        else
+        {
+            if (work & kRenderWorkClear)
+                AddPluginStat(Stats().clears, ExecuteClearCommandsCPU(s_ClearCommands.Commands(), clearCount, ResolveSoftwareSurface, NULL));
+
+            const DrawInstance* instances = s_InstanceBatches.GetInstances();
+            for (int b = 0; batches && b < batches->GetBatchCount(); ++b)
+            {
+                const InstanceBatch& batch = batches->GetBatch(b);
+                if (CpuSurface* surface = ResolveSoftwareSurface(batch.texture, NULL))
+                {
+                    SoftwareDrawInstances(*surface, batch.shape, instances + batch.firstInstance, batch.instanceCount);
+                    AddPluginStat(Stats().draws, 1);
+                }
+            }
+        }
+
+        if (work & kRenderWorkDraw)
+        {
+            AddPluginStat(Stats().draws, DrawSoftwareTrianglePass(worldMatrix, verts));
+        }
+    }
+    #endif
 
     #if SUPPORT_D3D11
     // D3D11 case
-    if (s_DeviceType == kUnityGfxRendererD3D11 && EnsureD3D11ResourcesAreCreated())
-    {
-        ID3D11DeviceContext* ctx = NULL;
-        g_D3D11Device->GetImmediateContext (&ctx);
-
-        ID3D11RenderTargetView*  pCurrentRenderTarget;
-        ID3D11DepthStencilView*  pCurrentDepthStencil;
-
-        // Get the current render targets
-        ctx->OMGetRenderTargets(1, &pCurrentRenderTarget, &pCurrentDepthStencil);
-
-        ctx->OMSetRenderTargets(1, &g_pD3D11RenderTargetView, nullptr);
-
-        /*
-        // update native texture from code
-        D3D11_TEXTURE2D_DESC desc;
-        g_TexturePointer->GetDesc(&desc);
-        unsigned char* data = new unsigned char[desc.Width*desc.Height * 4];
-        FillTextureFromCode(desc.Width, desc.Height, desc.Width * 4, data);
-        ctx->UpdateSubresource(g_TexturePointer, 0, NULL, data, desc.Width * 4, 0);
-        delete[] data;
-        */
-        const float CLEAR_CLR[4] = { 1, 1, 0, 1 };  // Yellow
-
-        ctx->ClearRenderTargetView(g_pD3D11RenderTargetView, CLEAR_CLR);
-
-        // Restore the original render target
-        ctx->OMSetRenderTargets(1, &pCurrentRenderTarget, pCurrentDepthStencil);
-
-        // update constant buffer - just the world matrix in our case
-        ctx->UpdateSubresource (g_D3D11CB, 0, NULL, worldMatrix, 64, 0);
-
-        // set shaders
-        ctx->VSSetConstantBuffers (0, 1, &g_D3D11CB);
-        ctx->VSSetShader (g_D3D11VertexShader, NULL, 0);
-        ctx->PSSetShader (g_D3D11PixelShader, NULL, 0);
-
-        // update vertex buffer
-        ctx->UpdateSubresource (g_D3D11VB, 0, NULL, verts, sizeof(verts[0])*3, 0);
-
-        // set input assembler data and draw
-        ctx->IASetInputLayout (g_D3D11InputLayout);
-        ctx->IASetPrimitiveTopology (D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-        UINT stride = sizeof(MyVertex);
-        UINT offset = 0;
-        ctx->IASetVertexBuffers (0, 1, &g_D3D11VB, &stride, &offset);
-        ctx->Draw (3, 0);
+    if (s_DeviceType == kUnityGfxRendererD3D11 && g_D3D11Context && EnsureD3D11ResourcesAreCreated())
+    {
+        ID3D11DeviceContext* ctx = g_D3D11Context;
+        D3D11StateContext state (ctx, s_D3D11StateCache);
+        BeginD3D11TransientFrame();
+        GpuTimerRing& timers = s_D3D11GpuTimers;
+        timers.BeginFrame(s_D3D11GpuQueries, s_D3D11FrameIndex);
+
+        // Clears and instances spread over several textures are recorded on
+        // the workers if they are free; otherwise they are issued here, one
+        // by one. The next procedural image is generated on the workers
+        // behind the rest of the frame, once they are done recording.
+        if (work & kRenderWorkFill)
+            FinishProceduralFill();
+        const int clearCount = (work & kRenderWorkClear) ? s_ClearCommands.Prepare() : 0;
+        const bool recordInParallel = PrepareTextureWorkD3D11Parallel(work, clearCount);
+        if ((work & kRenderWorkFill) && !recordInParallel)
+            StartProceduralFill();
+
+        // update native texture from code
+        const PluginTexture* procedural = NULL;
+        if (work & kRenderWorkUpload)
+        {
+            if (const unsigned char* data = BeginProceduralUpload(&procedural))
+            {
+                ID3D11Texture2D* d3dtex = (ID3D11Texture2D*)procedural->nativeTexture;
+                timers.BeginPass(s_D3D11GpuQueries, kGpuPassUpload);
+                ctx->UpdateSubresource(d3dtex, 0, NULL, data, procedural->width * 4, 0);
+                timers.EndPass(s_D3D11GpuQueries, kGpuPassUpload);
+                AddPluginStat(Stats().uploadBytes, (uint64_t)procedural->width * 4 * procedural->height);
+                EndProceduralUpload();
+            }
+        }
+
+        if (recordInParallel)
+        {
+            ExecuteTextureWorkD3D11Parallel(work, timers);
+            if (work & kRenderWorkFill)
+                StartProceduralFill();
+        }
+
+        // Execute the clears queued for this frame. ClearRenderTargetView does
+        // not need the view to be bound, so Unity's render targets are left untouched.
+        if ((work & kRenderWorkClear) && !recordInParallel)
+        {
+            timers.BeginPass(s_D3D11GpuQueries, kGpuPassClear);
+            ExecuteClearCommandsD3D11(ctx, clearCount);
+            timers.EndPass(s_D3D11GpuQueries, kGpuPassClear);
+        }
+
+        if (work & kRenderWorkDraw)
+        {
+            // Overlays into the cleared textures
+            if (!recordInParallel)
+            {
+                timers.BeginPass(s_D3D11GpuQueries, kGpuPassInstances);
+                ExecuteInstanceBatchesD3D11(ctx, state);
+                timers.EndPass(s_D3D11GpuQueries, kGpuPassInstances);
+            }
+
+            // The triangle: its recorded pass replayed with this frame's
+            // world matrix, or call by call when there is none
+            timers.BeginPass (s_D3D11GpuQueries, kGpuPassTriangle);
+            if (DrawD3D11TrianglePass (worldMatrix, verts) || DrawD3D11TriangleImmediate (state, worldMatrix, verts))
+                AddPluginStat (Stats().draws, 1);
+            timers.EndPass (s_D3D11GpuQueries, kGpuPassTriangle);
+        }
 
-        ctx->Release();
+        timers.EndFrame (s_D3D11GpuQueries);
+        PublishD3D11GpuTimings ();
+        EndD3D11TransientFrame();
+        SetPluginStat (Stats().stateCallsElided, s_D3D11StateCache.GetElidedCount());
+    }
+    #endif
+
+    if ((work & kRenderWorkFill) && s_ProceduralFillPending && s_WorkerPool.IsJobInFlight())
+        AddPluginStat(Stats().fillsOverlapped, 1);
+}
+
+// Brings the counters that are only updated while rendering up to date:
+// picks up GPU timings that have come back since the last frame.
+static void FlushRenderStats ()
+{
+    #if SUPPORT_D3D11
+    if (s_DeviceType == kUnityGfxRendererD3D11 && g_D3D11Context && s_D3D11ResourcesCreated)
+    {
+        s_D3D11GpuTimers.Collect (s_D3D11GpuQueries);
+        PublishD3D11GpuTimings ();
+        SetPluginStat (Stats().stateCallsElided, s_D3D11StateCache.GetElidedCount());
     }
     #endif
 }
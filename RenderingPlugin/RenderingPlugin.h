@@ -39,3 +39,23 @@
 #elif UNITY_OSX || UNITY_LINUX
 	#define SUPPORT_OPENGL 1
 #endif
+
+// CPU backend, used when there is no graphics device (kUnityGfxRendererNull,
+// e.g. batch mode). Portable, so available everywhere.
+#ifndef SUPPORT_SOFTWARE
+	#define SUPPORT_SOFTWARE 1
+#endif
+
+// eventIDs understood by the function GetRenderEventFunc returns. Frame does
+// everything in one event, in the order of the others; a script that wants
+// to place the pieces itself (e.g. draw after its own clears) issues them
+// separately. IDs without a handler do the whole frame, as Frame does.
+enum PluginRenderEvent
+{
+    kPluginEventFrame = 1,
+    kPluginEventFillTexture = 2,    // start generating the procedural texture
+    kPluginEventUpload = 3,         // upload the last generated image
+    kPluginEventClear = 4,          // execute the queued clears
+    kPluginEventDraw = 5,           // instanced overlays, then the triangle
+    kPluginEventFlushStats = 6,     // read back finished GPU timings without rendering
+};
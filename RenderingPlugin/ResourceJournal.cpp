@@ -0,0 +1,218 @@
+#include "ResourceJournal.h"
+#include "WorkerPool.h"
+
+ResourceJournal::ResourceJournal ()
+    : m_RecordCount (0)
+    , m_Device (NULL)
+    , m_Release (NULL)
+    , m_RecreatePool (NULL)
+    , m_Recreating (false)
+{
+}
+
+ResourceJournal::~ResourceJournal ()
+{
+    FinishRecreate ();
+}
+
+void ResourceJournal::SetDevice (void* device, ResourceReleaseFn release)
+{
+    FinishRecreate ();
+    m_Device = device;
+    m_Release = release;
+}
+
+ResourceJournal::Record* ResourceJournal::Find (ResourceId id)
+{
+    if (id <= 0 || id > (int)m_Records.size () || !m_Records[id - 1].name)
+        return NULL;
+    return &m_Records[id - 1];
+}
+
+const ResourceJournal::Record* ResourceJournal::Find (ResourceId id) const
+{
+    if (id <= 0 || id > (int)m_Records.size () || !m_Records[id - 1].name)
+        return NULL;
+    return &m_Records[id - 1];
+}
+
+ResourceId ResourceJournal::Insert (const char* name, ResourceCreateFn create, const void* recipe, size_t recipeSize, void* object, void** slot)
+{
+    int index;
+    if (!m_FreeRecords.empty ())
+    {
+        index = m_FreeRecords.back ();
+        m_FreeRecords.pop_back ();
+    }
+    else
+    {
+        index = (int)m_Records.size ();
+        m_Records.push_back (Record ());
+    }
+
+    Record& record = m_Records[index];
+    record.name = name;
+    record.create = create;
+    record.recipe.assign ((const unsigned char*)recipe, (const unsigned char*)recipe + recipeSize);
+    record.slot = slot;
+    record.object = object;
+    if (slot)
+        *slot = object;
+    ++m_RecordCount;
+    return index + 1;
+}
+
+ResourceId ResourceJournal::Create (const char* name, ResourceCreateFn create, const void* recipe, size_t recipeSize, void** slot)
+{
+    FinishRecreate ();
+    void* object = m_Device ? create (m_Device, recipe, recipeSize) : NULL;
+    if (!object)
+    {
+        if (slot)
+            *slot = NULL;
+        return kInvalidResourceId;
+    }
+    return Insert (name, create, recipe, recipeSize, object, slot);
+}
+
+ResourceId ResourceJournal::Adopt (const char* name, ResourceCreateFn create, const void* recipe, size_t recipeSize, void* object, void** slot)
+{
+    FinishRecreate ();
+    if (!object)
+        return kInvalidResourceId;
+    return Insert (name, create, recipe, recipeSize, object, slot);
+}
+
+void* ResourceJournal::Get (ResourceId id) const
+{
+    const Record* record = Find (id);
+    return record && !m_Recreating ? record->object : NULL;
+}
+
+void ResourceJournal::ReleaseRecordObject (Record& record)
+{
+    if (record.object && m_Release)
+        m_Release (record.object);
+    record.object = NULL;
+    if (record.slot)
+        *record.slot = NULL;
+}
+
+void ResourceJournal::Destroy (ResourceId id)
+{
+    FinishRecreate ();
+    Record* record = Find (id);
+    if (!record)
+        return;
+    ReleaseRecordObject (*record);
+    record->name = NULL;
+    record->recipe.clear ();
+    record->slot = NULL;
+    m_FreeRecords.push_back (id - 1);
+    --m_RecordCount;
+}
+
+void ResourceJournal::ReleaseObjects ()
+{
+    FinishRecreate ();
+    for (size_t i = 0; i < m_Records.size (); ++i)
+    {
+        if (m_Records[i].name)
+            ReleaseRecordObject (m_Records[i]);
+    }
+}
+
+void ResourceJournal::RecreateTask (int taskIndex, void* userData)
+{
+    ResourceJournal* journal = (ResourceJournal*)userData;
+    Record& record = journal->m_Records[taskIndex];
+    if (!record.name || record.object)
+        return;
+    const void* recipe = record.recipe.empty () ? NULL : &record.recipe[0];
+    record.object = record.create (journal->m_Device, recipe, record.recipe.size ());
+}
+
+void ResourceJournal::BeginRecreate (WorkerPool* pool)
+{
+    FinishRecreate ();
+    if (!m_Device || m_Records.empty ())
+        return;
+
+    // One task per record: each writes only its own record's object, the
+    // slots are left for EndRecreate on the owning thread.
+    m_Recreating = true;
+    m_RecreatePool = pool;
+    if (pool)
+        pool->Dispatch ((int)m_Records.size (), RecreateTask, this);
+    else
+    {
+        for (int i = 0; i < (int)m_Records.size (); ++i)
+            RecreateTask (i, this);
+    }
+}
+
+void ResourceJournal::FinishRecreate ()
+{
+    if (!m_Recreating)
+        return;
+    if (m_RecreatePool)
+        m_RecreatePool->Wait ();
+    m_RecreatePool = NULL;
+    m_Recreating = false;
+
+    for (size_t i = 0; i < m_Records.size (); ++i)
+    {
+        if (m_Records[i].name && m_Records[i].slot)
+            *m_Records[i].slot = m_Records[i].object;
+    }
+}
+
+int ResourceJournal::EndRecreate ()
+{
+    FinishRecreate ();
+    int failed = 0;
+    for (size_t i = 0; i < m_Records.size (); ++i)
+    {
+        if (m_Records[i].name && !m_Records[i].object)
+            ++failed;
+    }
+    return failed;
+}
+
+void ResourceJournal::Clear ()
+{
+    FinishRecreate ();
+    for (size_t i = 0; i < m_Records.size (); ++i)
+    {
+        if (m_Records[i].name)
+            ReleaseRecordObject (m_Records[i]);
+    }
+    m_Records.clear ();
+    m_FreeRecords.clear ();
+    m_RecordCount = 0;
+}
+
+int ResourceJournal::GetLiveCount () const
+{
+    if (m_Recreating)
+        return 0;
+    int live = 0;
+    for (size_t i = 0; i < m_Records.size (); ++i)
+    {
+        if (m_Records[i].name && m_Records[i].object)
+            ++live;
+    }
+    return live;
+}
+
+const char* ResourceJournal::GetName (ResourceId id) const
+{
+    const Record* record = Find (id);
+    return record ? record->name : NULL;
+}
+
+const void* ResourceJournal::GetRecipe (ResourceId id) const
+{
+    const Record* record = Find (id);
+    return record && !record->recipe.empty () ? &record->recipe[0] : NULL;
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <stddef.h>
+#include <vector>
+
+class WorkerPool;
+
+// --------------------------------------------------------------------------
+// Resource journal
+//
+// Records every object the plugin creates on a graphics device together with
+// a copy of what it was created from (its "recipe": a desc, plus bytecode or
+// initial data appended to it) and the pointer the rest of the plugin reads
+// it through. When the device is reset, ReleaseObjects drops all objects but
+// keeps the records; Recreate then builds every one of them again in one go,
+// optionally spread over a WorkerPool, and writes the new objects back to
+// their slots. That turns a device loss into a single bounded hitch instead
+// of objects being re-created lazily as each one is next needed.
+//
+// The journal knows nothing about any graphics API: objects are void*,
+// creation goes through a ResourceCreateFn and release through the
+// ResourceReleaseFn given with the device. Create functions may run on
+// worker threads, so they must only use the device and their recipe.
+//
+// Not thread-safe: one thread (the render thread) owns the journal. Between
+// BeginRecreate and EndRecreate the workers are writing to it; any other
+// call first finishes the recreate.
+
+typedef int ResourceId;     // 0 is never a valid record
+enum { kInvalidResourceId = 0 };
+
+typedef void* (*ResourceCreateFn)(void* device, const void* recipe, size_t recipeSize);
+typedef void (*ResourceReleaseFn)(void* object);
+
+class ResourceJournal
+{
+public:
+    ResourceJournal ();
+    ~ResourceJournal ();    // forgets the records without releasing anything
+
+    void SetDevice (void* device, ResourceReleaseFn release);
+    void* GetDevice () const { return m_Device; }
+
+    // Creates an object now and records how. slot (optional) is written with
+    // the object whenever it changes, NULL included; it must outlive the
+    // record. Returns kInvalidResourceId, without recording anything, when
+    // creation fails. name must be a string literal.
+    ResourceId Create (const char* name, ResourceCreateFn create, const void* recipe, size_t recipeSize, void** slot = NULL);
+
+    // Records an object created elsewhere (e.g. on another thread) that create
+    // can build again from recipe. The journal owns it from here on.
+    ResourceId Adopt (const char* name, ResourceCreateFn create, const void* recipe, size_t recipeSize, void* object, void** slot = NULL);
+
+    // The current object; NULL while released or when recreating it failed.
+    void* Get (ResourceId id) const;
+
+    // Releases the object and forgets the record.
+    void Destroy (ResourceId id);
+
+    // Device lost/reset: releases every object and NULLs its slot, but keeps
+    // the records for Recreate.
+    void ReleaseObjects ();
+
+    // Recreates every released object with the current device. BeginRecreate
+    // hands the work to pool (or does it right away when pool is NULL);
+    // EndRecreate waits for it, writes the slots and returns how many objects
+    // could not be created. Meanwhile Get returns NULL and any call that
+    // changes the journal first waits for the recreate to finish.
+    void BeginRecreate (WorkerPool* pool);
+    int EndRecreate ();
+    int Recreate (WorkerPool* pool) { BeginRecreate (pool); return EndRecreate (); }
+    bool IsRecreating () const { return m_Recreating; }
+
+    // Releases everything and forgets all records (device shutdown).
+    void Clear ();
+
+    int GetRecordCount () const { return m_RecordCount; }
+    int GetLiveCount () const;
+    const char* GetName (ResourceId id) const;
+    const void* GetRecipe (ResourceId id) const;
+
+private:
+    struct Record
+    {
+        const char* name;           // NULL when the record is free
+        ResourceCreateFn create;
+        std::vector<unsigned char> recipe;
+        void** slot;
+        void* object;
+    };
+
+    ResourceJournal (const ResourceJournal&);
+    ResourceJournal& operator= (const ResourceJournal&);
+
+    Record* Find (ResourceId id);
+    const Record* Find (ResourceId id) const;
+    ResourceId Insert (const char* name, ResourceCreateFn create, const void* recipe, size_t recipeSize, void* object, void** slot);
+    void ReleaseRecordObject (Record& record);
+    void FinishRecreate ();
+    static void RecreateTask (int taskIndex, void* userData);
+
+    std::vector<Record> m_Records;      // id - 1
+    std::vector<int> m_FreeRecords;
+    int m_RecordCount;
+    void* m_Device;
+    ResourceReleaseFn m_Release;
+    WorkerPool* m_RecreatePool;
+    bool m_Recreating;
+};
@@ -0,0 +1,98 @@
+#include "ShaderLibrary.h"
+
+#if RENDERINGPLUGIN_EMBEDDED_SHADERS
+    #if defined(_WIN32)
+        #include <windows.h>    // fxc headers declare their arrays as BYTE
+    #endif
+    #include "SimpleVertexShader.h"
+    #include "SimplePixelShader.h"
+    #include "InstancedVertexShader.h"
+#endif
+
+static const char* const kShaderBlobFileNames[kShaderBlobCount] =
+{
+    "SimpleVertexShader.cso",
+    "SimplePixelShader.cso",
+    "InstancedVertexShader.cso",
+};
+
+const char* GetShaderBlobFileName (ShaderBlobId id)
+{
+    return kShaderBlobFileNames[id];
+}
+
+bool GetEmbeddedShaderBytecode (ShaderBlobId id, ShaderBytecode* out)
+{
+    #if RENDERINGPLUGIN_EMBEDDED_SHADERS
+    static const ShaderBytecode kEmbedded[kShaderBlobCount] =
+    {
+        { kSimpleVertexShaderBytecode, sizeof(kSimpleVertexShaderBytecode), false },
+        { kSimplePixelShaderBytecode, sizeof(kSimplePixelShaderBytecode), false },
+        { kInstancedVertexShaderBytecode, sizeof(kInstancedVertexShaderBytecode), false },
+    };
+    *out = kEmbedded[id];
+    return true;
+    #else
+    (void)id;
+    (void)out;
+    return false;
+    #endif
+}
+
+
+// --------------------------------------------------------------------------
+// ShaderLibrary
+
+ShaderLibrary::ShaderLibrary ()
+    : m_DiskOverride (false)
+    , m_LoadMissing (false)
+{
+    for (int i = 0; i < kShaderBlobCount; ++i)
+    {
+        m_DiskNames[i] = NULL;
+        m_DiskIndex[i] = -1;
+    }
+}
+
+void ShaderLibrary::SetDirectory (const std::string& directory, bool diskOverride, bool loadMissing)
+{
+    if (m_Disk.IsStarted() && directory == m_Directory && diskOverride == m_DiskOverride && loadMissing == m_LoadMissing)
+        return;
+    Reset ();
+    m_Directory = directory;
+    m_DiskOverride = diskOverride;
+    m_LoadMissing = loadMissing;
+
+    int count = 0;
+    for (int i = 0; i < kShaderBlobCount; ++i)
+    {
+        ShaderBytecode embedded;
+        const bool load = diskOverride || (loadMissing && !GetEmbeddedShaderBytecode ((ShaderBlobId)i, &embedded));
+        m_DiskIndex[i] = load ? count : -1;
+        if (load)
+            m_DiskNames[count++] = kShaderBlobFileNames[i];
+    }
+    m_Disk.Begin (directory, m_DiskNames, count);
+}
+
+bool ShaderLibrary::Get (ShaderBlobId id, ShaderBytecode* out) const
+{
+    if (m_DiskIndex[id] >= 0)
+    {
+        if (const FileBlob* blob = m_Disk.TryGet (m_DiskIndex[id]))
+        {
+            out->data = blob->GetData();
+            out->size = blob->GetSize();
+            out->fromDisk = true;
+            return out->size > 0;
+        }
+    }
+    return GetEmbeddedShaderBytecode (id, out);
+}
+
+void ShaderLibrary::Reset ()
+{
+    m_Disk.Reset ();
+    for (int i = 0; i < kShaderBlobCount; ++i)
+        m_DiskIndex[i] = -1;
+}
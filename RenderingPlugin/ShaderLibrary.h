@@ -0,0 +1,67 @@
+#pragma once
+
+#include "BlobLoader.h"
+
+#include <stddef.h>
+#include <string>
+
+// --------------------------------------------------------------------------
+// Shader library
+//
+// Bytecode of the plugin's shaders. Builds that embed the compiled blobs
+// (RENDERINGPLUGIN_EMBEDDED_SHADERS; the Visual Studio project has fxc
+// write them as headers, CMake converts .cso files with
+// cmake/EmbedShaderBlob.cmake) need no file I/O to create their shaders.
+// The .cso files under the streaming assets path are loaded through a
+// BlobLoader when the disk override is on, for iterating on shaders without
+// rebuilding, or when a blob was not embedded; whatever loads from disk
+// takes precedence over the embedded copy.
+
+enum ShaderBlobId
+{
+    kShaderBlobSimpleVertex,
+    kShaderBlobSimplePixel,
+    kShaderBlobInstancedVertex,
+    kShaderBlobCount
+};
+
+struct ShaderBytecode
+{
+    const void* data;
+    size_t size;
+    bool fromDisk;
+};
+
+const char* GetShaderBlobFileName (ShaderBlobId id);
+
+// False when the build does not embed shaders.
+bool GetEmbeddedShaderBytecode (ShaderBlobId id, ShaderBytecode* out);
+
+class ShaderLibrary
+{
+public:
+    ShaderLibrary ();
+
+    // Starts loading the blobs in directory from disk: all of them when
+    // diskOverride is set, else only those not embedded when loadMissing is
+    // set (nothing at all when every blob is embedded). Restarts only when
+    // the arguments change. No other thread may be reading blobs meanwhile.
+    void SetDirectory (const std::string& directory, bool diskOverride, bool loadMissing);
+
+    // A disk load is still in flight. Never blocks.
+    bool IsLoading () const { return m_Disk.IsStarted() && !m_Disk.IsDone(); }
+
+    // The disk copy when it loaded, else the embedded one (also while the
+    // disk load is in flight). False when the blob has neither.
+    bool Get (ShaderBlobId id, ShaderBytecode* out) const;
+
+    void Reset ();
+
+private:
+    BlobLoader m_Disk;
+    const char* m_DiskNames[kShaderBlobCount];
+    int m_DiskIndex[kShaderBlobCount];     // into m_Disk, or -1
+    std::string m_Directory;
+    bool m_DiskOverride;
+    bool m_LoadMissing;
+};
@@ -0,0 +1,11 @@
+
+// Instanced overlays: the unit shape (slot 0) is moved into clip space by a
+// per-instance 2D affine transform and drawn in the instance colour (slot 1).
+void VS (float3 pos : POSITION, float4 color : COLOR0,
+	float3 row0 : TEXCOORD0, float3 row1 : TEXCOORD1, float z : TEXCOORD2, float4 instanceColor : COLOR1,
+	out float4 ocolor : COLOR, out float4 opos : SV_Position)
+{
+	float3 p = float3(pos.xy, 1);
+	opos = float4(dot(row0, p), dot(row1, p), z, 1);
+	ocolor = instanceColor * color;
+}
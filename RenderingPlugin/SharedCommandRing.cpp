@@ -0,0 +1,109 @@
+#include "SharedCommandRing.h"
+
+#include <new>
+#include <stdlib.h>
+#include <string.h>
+
+SharedCommandRing::SharedCommandRing ()
+    : m_Allocation (NULL)
+    , m_Header (NULL)
+    , m_Commands (NULL)
+    , m_Mask (0)
+    , m_Consumed (0)
+{
+}
+
+SharedCommandRing::~SharedCommandRing ()
+{
+    Destroy ();
+}
+
+bool SharedCommandRing::Create (uint32_t capacity)
+{
+    Destroy ();
+    uint32_t rounded = 2;
+    while (rounded < capacity && rounded < 0x40000000u)
+        rounded <<= 1;
+
+    // The header and every command start on a cache line of their own
+    const size_t bytes = sizeof(SharedCommandRingHeader) + (size_t)rounded * sizeof(SharedCommand);
+    m_Allocation = malloc (bytes + 63);
+    if (!m_Allocation)
+        return false;
+    memset (m_Allocation, 0, bytes + 63);
+    unsigned char* base = (unsigned char*)(((uintptr_t)m_Allocation + 63) & ~(uintptr_t)63);
+
+    m_Header = new (base) SharedCommandRingHeader;
+    m_Header->magic = kSharedCommandRingMagic;
+    m_Header->version = kSharedCommandRingVersion;
+    m_Header->commandSize = sizeof(SharedCommand);
+    m_Header->capacity = rounded;
+    m_Header->reserve.store (0, std::memory_order_relaxed);
+    m_Header->consumed.store (0, std::memory_order_relaxed);
+
+    m_Commands = (SharedCommand*)(base + sizeof(SharedCommandRingHeader));
+    for (uint32_t i = 0; i < rounded; ++i)
+    {
+        new (&m_Commands[i]) SharedCommand;
+        m_Commands[i].type = kSharedCommandNop;
+        m_Commands[i].sequence.store (i, std::memory_order_relaxed);
+    }
+    m_Mask = rounded - 1;
+    m_Consumed = 0;
+    std::atomic_thread_fence (std::memory_order_release);
+    return true;
+}
+
+bool SharedCommandRing::Attach (void* shared)
+{
+    Destroy ();
+    SharedCommandRingHeader* header = (SharedCommandRingHeader*)shared;
+    if (!header || header->magic != kSharedCommandRingMagic || header->version != kSharedCommandRingVersion)
+        return false;
+    if (header->commandSize != sizeof(SharedCommand) || header->capacity < 2 || (header->capacity & (header->capacity - 1)) != 0)
+        return false;
+    m_Header = header;
+    m_Commands = (SharedCommand*)((unsigned char*)header + sizeof(SharedCommandRingHeader));
+    m_Mask = header->capacity - 1;
+    m_Consumed = header->consumed.load (std::memory_order_relaxed);
+    return true;
+}
+
+void SharedCommandRing::Destroy ()
+{
+    free (m_Allocation);
+    m_Allocation = NULL;
+    m_Header = NULL;
+    m_Commands = NULL;
+    m_Mask = 0;
+    m_Consumed = 0;
+}
+
+bool SharedCommandRing::TryReserve (uint32_t count, uint32_t* first)
+{
+    if (!m_Header || count == 0 || count > m_Mask + 1)
+        return false;
+
+    uint32_t position = m_Header->reserve.load (std::memory_order_relaxed);
+    for (;;)
+    {
+        // The consumer frees slots in order, so when the last slot of the run
+        // is free for this lap, all of them are
+        const uint32_t last = position + count - 1;
+        const uint32_t sequence = At (last).sequence.load (std::memory_order_acquire);
+        const int32_t lap = (int32_t)(sequence - last);
+        if (lap == 0)
+        {
+            if (m_Header->reserve.compare_exchange_weak (position, position + count, std::memory_order_relaxed))
+            {
+                *first = position;
+                return true;
+            }
+            // position now holds the current reserve index
+        }
+        else if (lap < 0)
+            return false;       // still holds a command of the previous lap: full
+        else
+            position = m_Header->reserve.load (std::memory_order_relaxed);
+    }
+}
@@ -0,0 +1,138 @@
+#pragma once
+
+#include "ClearCommands.h"
+#include "InstanceBatch.h"
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+// --------------------------------------------------------------------------
+// Shared command ring
+//
+// Command ring in plugin memory that script code writes into directly, so
+// submitting a command costs no P/Invoke at all: the plugin allocates it
+// once and hands out its address (GetSharedCommandRing), and the render
+// thread executes the commands where they lie.
+//
+// Any number of producer threads, one consumer. Every slot carries a
+// sequence number, as in Dmitry Vyukov's bounded queue: a producer claims
+// slots by advancing the reserve index with a compare-exchange once the last
+// of them reads as free, writes them, then publishes each one by storing its
+// sequence with release semantics. The consumer reads a slot once its
+// sequence says it is published (acquire), executes it, and frees it for the
+// next lap with another release store. A run of slots claimed together is
+// contiguous in the ring, so commands that depend on each other (SetColor
+// then Clear) cannot be split by another producer.
+//
+// The layout is fixed and shared with scripts (UseRenderingPlugin.cs):
+// a 128-byte header followed by capacity 64-byte commands. Capacity is a
+// power of two; the memory does not move while the ring exists.
+
+enum SharedCommandType
+{
+    kSharedCommandNop,
+    kSharedCommandSetTime,          // time
+    kSharedCommandSetColor,         // color, used by the following clears
+    kSharedCommandClear,            // texture, rect (width or height <= 0: whole texture)
+    kSharedCommandDrawInstance,     // texture, shape, instance
+    kSharedCommandTypeCount
+};
+
+struct alignas(64) SharedCommand
+{
+    std::atomic<uint32_t> sequence;     // position + 1 once published
+    uint32_t type;                      // SharedCommandType
+    TextureHandle texture;
+    int32_t shape;                      // InstanceShape
+    union
+    {
+        float time;
+        float color[4];
+        ClearRect rect;
+        DrawInstance instance;
+    };
+};
+
+struct SharedCommandRingHeader
+{
+    uint32_t magic;                     // kSharedCommandRingMagic
+    uint32_t version;
+    uint32_t commandSize;               // sizeof(SharedCommand)
+    uint32_t capacity;                  // commands; power of two
+    std::atomic<uint32_t> consumed;     // next position the consumer reads; informational
+    alignas(64) std::atomic<uint32_t> reserve;      // next position a producer claims; the line producers contend on
+    uint32_t padding[15];
+};
+
+enum
+{
+    kSharedCommandRingMagic = 0x474E5243,     // 'CRNG'
+    kSharedCommandRingVersion = 1,
+};
+
+static_assert (sizeof(SharedCommand) == 64, "SharedCommand layout is shared with scripts");
+static_assert (sizeof(SharedCommandRingHeader) == 128, "SharedCommandRingHeader layout is shared with scripts");
+
+class SharedCommandRing
+{
+public:
+    SharedCommandRing ();
+    ~SharedCommandRing ();
+
+    // Allocates and initializes the shared memory; capacity is rounded up to
+    // a power of two. False when it cannot be allocated.
+    bool Create (uint32_t capacity);
+    void Destroy ();
+
+    // Producer view of a ring created elsewhere (e.g. the plugin's, from
+    // GetSharedCommandRing). False when shared is not a ring of this layout.
+    bool Attach (void* shared);
+
+    // Address of the header, the commands follow it. NULL before Create.
+    SharedCommandRingHeader* GetShared () const { return m_Header; }
+    uint32_t GetCapacity () const { return m_Header ? m_Header->capacity : 0; }
+
+    // Producer side (any thread). Claims count consecutive slots and returns
+    // the position of the first; false when the ring has no room for them.
+    bool TryReserve (uint32_t count, uint32_t* first);
+    SharedCommand& At (uint32_t position) { return m_Commands[position & m_Mask]; }
+    void Publish (uint32_t position)
+    {
+        At (position).sequence.store (position + 1, std::memory_order_release);
+    }
+
+    // Consumer side (one thread). Hands every published command, in order,
+    // to fn, and frees its slot after fn returns; stops at the first slot
+    // not published yet, or after a whole ring. Returns the number consumed.
+    template <typename Fn>
+    uint32_t Consume (Fn fn)
+    {
+        if (!m_Header)
+            return 0;
+        const uint32_t capacity = m_Mask + 1;
+        uint32_t position = m_Consumed;
+        for (uint32_t n = 0; n < capacity; ++n, ++position)
+        {
+            SharedCommand& command = At (position);
+            if (command.sequence.load (std::memory_order_acquire) != position + 1)
+                break;
+            fn (command);
+            command.sequence.store (position + capacity, std::memory_order_release);
+        }
+        const uint32_t consumed = position - m_Consumed;
+        m_Consumed = position;
+        m_Header->consumed.store (position, std::memory_order_relaxed);
+        return consumed;
+    }
+
+private:
+    SharedCommandRing (const SharedCommandRing&);
+    SharedCommandRing& operator= (const SharedCommandRing&);
+
+    void* m_Allocation;         // NULL when attached
+    SharedCommandRingHeader* m_Header;
+    SharedCommand* m_Commands;
+    uint32_t m_Mask;
+    uint32_t m_Consumed;        // consumer's own copy of the position
+};
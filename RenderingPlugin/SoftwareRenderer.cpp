@@ -0,0 +1,272 @@
+#include "SoftwareRenderer.h"
+
+#include <algorithm>
+#include <math.h>
+#include <new>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #include <emmintrin.h>
+    #define SOFTWARE_RENDERER_SSE2 1
+#else
+    #define SOFTWARE_RENDERER_SSE2 0
+#endif
+
+
+// --------------------------------------------------------------------------
+// Surfaces
+
+enum { kSurfaceAlignment = 16 };
+
+CpuSurface* CreateCpuSurface (int width, int height)
+{
+    if (width <= 0 || height <= 0)
+        return NULL;
+
+    const int stride = (width * 4 + kSurfaceAlignment - 1) & ~(kSurfaceAlignment - 1);
+    const size_t header = (sizeof(CpuSurface) + kSurfaceAlignment - 1) & ~size_t(kSurfaceAlignment - 1);
+    char* block = new (std::nothrow) char[header + size_t(stride) * height + kSurfaceAlignment];
+    if (!block)
+        return NULL;
+
+    CpuSurface* surface = reinterpret_cast<CpuSurface*>(block);
+    uintptr_t pixels = (reinterpret_cast<uintptr_t>(block) + header + kSurfaceAlignment - 1) & ~uintptr_t(kSurfaceAlignment - 1);
+    surface->width = width;
+    surface->height = height;
+    surface->stride = stride;
+    surface->pixels = reinterpret_cast<unsigned char*>(pixels);
+    memset (surface->pixels, 0, size_t(stride) * height);
+    return surface;
+}
+
+void DestroyCpuSurface (CpuSurface* surface)
+{
+    delete[] reinterpret_cast<char*>(surface);
+}
+
+
+// --------------------------------------------------------------------------
+// Triangle setup
+//
+// Edge function for the edge a->b evaluated at p:
+//   E(p) = (b.x - a.x) * (p.y - a.y) - (b.y - a.y) * (p.x - a.x)
+//        = A * p.x + B * p.y + C
+// A pixel centre is inside when all three are >= 0 (after orienting the
+// triangle so its area is positive). The normalized edge values are the
+// barycentric weights used to interpolate the vertex colours.
+
+struct EdgeSetup
+{
+    float a[3], b[3], c[3];
+    float invArea;
+    float color[3][4]; // per vertex, per channel
+};
+
+static void SetupEdge (const RasterVertex& va, const RasterVertex& vb, float& a, float& b, float& c)
+{
+    a = -(vb.y - va.y);
+    b = vb.x - va.x;
+    c = (vb.y - va.y) * va.x - (vb.x - va.x) * va.y;
+}
+
+static bool SetupTriangle (const RasterVertex in[3], EdgeSetup& setup)
+{
+    RasterVertex v[3] = { in[0], in[1], in[2] };
+    float area = (v[1].x - v[0].x) * (v[2].y - v[0].y) - (v[1].y - v[0].y) * (v[2].x - v[0].x);
+    if (area == 0.0f)
+        return false;
+    if (area < 0.0f)
+    {
+        std::swap (v[1], v[2]);
+        area = -area;
+    }
+
+    // Weight for vertex i comes from the edge opposite to it
+    SetupEdge (v[1], v[2], setup.a[0], setup.b[0], setup.c[0]);
+    SetupEdge (v[2], v[0], setup.a[1], setup.b[1], setup.c[1]);
+    SetupEdge (v[0], v[1], setup.a[2], setup.b[2], setup.c[2]);
+    setup.invArea = 1.0f / area;
+
+    for (int i = 0; i < 3; ++i)
+        for (int k = 0; k < 4; ++k)
+            setup.color[i][k] = float((v[i].color >> (k * 8)) & 0xFF);
+    return true;
+}
+
+static inline unsigned int ShadePixelScalar (const EdgeSetup& s, float w0, float w1, float w2)
+{
+    const float l0 = w0 * s.invArea;
+    const float l1 = w1 * s.invArea;
+    const float l2 = w2 * s.invArea;
+    unsigned int packed = 0;
+    for (int k = 0; k < 4; ++k)
+    {
+        float v = l0 * s.color[0][k] + l1 * s.color[1][k] + l2 * s.color[2][k] + 0.5f;
+        v = std::min (std::max (v, 0.0f), 255.0f);
+        packed |= (unsigned int)(int)v << (k * 8);
+    }
+    return packed;
+}
+
+// Rasterizes pixels [x, xEnd) of one row with plain C++.
+static int RasterizeSpanScalar (const EdgeSetup& s, unsigned int* row, int x, int xEnd, const float rowTerm[3])
+{
+    int written = 0;
+    for (; x < xEnd; ++x)
+    {
+        const float px = float(x) + 0.5f;
+        const float w0 = s.a[0] * px + rowTerm[0];
+        const float w1 = s.a[1] * px + rowTerm[1];
+        const float w2 = s.a[2] * px + rowTerm[2];
+        if (w0 >= 0.0f && w1 >= 0.0f && w2 >= 0.0f)
+        {
+            row[x] = ShadePixelScalar (s, w0, w1, w2);
+            ++written;
+        }
+    }
+    return written;
+}
+
+#if SOFTWARE_RENDERER_SSE2
+
+// Same maths as RasterizeSpanScalar, four pixels per iteration. Returns the
+// first pixel it did not handle; the caller finishes the row with the scalar
+// path so stores never run past the surface.
+static int RasterizeSpanSSE2 (const EdgeSetup& s, unsigned int* row, int& x, int xEnd, const float rowTerm[3])
+{
+    int written = 0;
+
+    const __m128 a0 = _mm_set1_ps (s.a[0]), a1 = _mm_set1_ps (s.a[1]), a2 = _mm_set1_ps (s.a[2]);
+    const __m128 r0 = _mm_set1_ps (rowTerm[0]), r1 = _mm_set1_ps (rowTerm[1]), r2 = _mm_set1_ps (rowTerm[2]);
+    const __m128 invArea = _mm_set1_ps (s.invArea);
+    const __m128 zero = _mm_setzero_ps ();
+    const __m128 half = _mm_set1_ps (0.5f);
+    const __m128 maxChannel = _mm_set1_ps (255.0f);
+    const __m128i laneOffsets = _mm_set_epi32 (3, 2, 1, 0);
+
+    __m128 c0[4], c1[4], c2[4];
+    for (int k = 0; k < 4; ++k)
+    {
+        c0[k] = _mm_set1_ps (s.color[0][k]);
+        c1[k] = _mm_set1_ps (s.color[1][k]);
+        c2[k] = _mm_set1_ps (s.color[2][k]);
+    }
+
+    for (; x + 4 <= xEnd; x += 4)
+    {
+        const __m128 px = _mm_add_ps (_mm_cvtepi32_ps (_mm_add_epi32 (_mm_set1_epi32 (x), laneOffsets)), half);
+        const __m128 w0 = _mm_add_ps (_mm_mul_ps (a0, px), r0);
+        const __m128 w1 = _mm_add_ps (_mm_mul_ps (a1, px), r1);
+        const __m128 w2 = _mm_add_ps (_mm_mul_ps (a2, px), r2);
+
+        const __m128 inside = _mm_and_ps (_mm_and_ps (_mm_cmpge_ps (w0, zero), _mm_cmpge_ps (w1, zero)), _mm_cmpge_ps (w2, zero));
+        const int laneMask = _mm_movemask_ps (inside);
+        if (!laneMask)
+            continue;
+
+        const __m128 l0 = _mm_mul_ps (w0, invArea);
+        const __m128 l1 = _mm_mul_ps (w1, invArea);
+        const __m128 l2 = _mm_mul_ps (w2, invArea);
+
+        __m128i packed = _mm_setzero_si128 ();
+        for (int k = 0; k < 4; ++k)
+        {
+            __m128 v = _mm_add_ps (_mm_add_ps (_mm_add_ps (_mm_mul_ps (l0, c0[k]), _mm_mul_ps (l1, c1[k])), _mm_mul_ps (l2, c2[k])), half);
+            v = _mm_min_ps (_mm_max_ps (v, zero), maxChannel);
+            packed = _mm_or_si128 (packed, _mm_slli_epi32 (_mm_cvttps_epi32 (v), k * 8));
+        }
+
+        __m128i* dst = reinterpret_cast<__m128i*>(row + x);
+        const __m128i mask = _mm_castps_si128 (inside);
+        const __m128i old = _mm_loadu_si128 (dst);
+        _mm_storeu_si128 (dst, _mm_or_si128 (_mm_and_si128 (mask, packed), _mm_andnot_si128 (mask, old)));
+
+        written += (laneMask & 1) + ((laneMask >> 1) & 1) + ((laneMask >> 2) & 1) + ((laneMask >> 3) & 1);
+    }
+    return written;
+}
+
+#endif // SOFTWARE_RENDERER_SSE2
+
+
+int RasterizeTriangle (CpuSurface& target, const RasterVertex verts[3], RasterPath path)
+{
+    EdgeSetup s;
+    if (!SetupTriangle (verts, s))
+        return 0;
+
+    const float minXf = std::min (verts[0].x, std::min (verts[1].x, verts[2].x));
+    const float maxXf = std::max (verts[0].x, std::max (verts[1].x, verts[2].x));
+    const float minYf = std::min (verts[0].y, std::min (verts[1].y, verts[2].y));
+    const float maxYf = std::max (verts[0].y, std::max (verts[1].y, verts[2].y));
+
+    const int minX = std::max (0, (int)floorf (minXf));
+    const int minY = std::max (0, (int)floorf (minYf));
+    const int maxX = std::min (target.width, (int)ceilf (maxXf) + 1);
+    const int maxY = std::min (target.height, (int)ceilf (maxYf) + 1);
+    if (minX >= maxX || minY >= maxY)
+        return 0;
+
+    int written = 0;
+    for (int y = minY; y < maxY; ++y)
+    {
+        const float py = float(y) + 0.5f;
+        const float rowTerm[3] =
+        {
+            s.b[0] * py + s.c[0],
+            s.b[1] * py + s.c[1],
+            s.b[2] * py + s.c[2],
+        };
+        unsigned int* row = reinterpret_cast<unsigned int*>(target.pixels + size_t(y) * target.stride);
+
+        int x = minX;
+        #if SOFTWARE_RENDERER_SSE2
+        if (path == kRasterPathSimd)
+            written += RasterizeSpanSSE2 (s, row, x, maxX, rowTerm);
+        #endif
+        written += RasterizeSpanScalar (s, row, x, maxX, rowTerm);
+    }
+    return written;
+}
+
+
+// --------------------------------------------------------------------------
+// Vertex processing
+
+void SoftwareDrawTriangles (CpuSurface& target, const float worldMatrix[16], const SoftwareVertex* verts, int vertexCount, RasterPath path)
+{
+    const float* m = worldMatrix;
+    for (int tri = 0; tri + 3 <= vertexCount; tri += 3)
+    {
+        RasterVertex screen[3];
+        int outsideNear = 0, outsideFar = 0;
+        bool behindEye = false;
+        for (int i = 0; i < 3; ++i)
+        {
+            const SoftwareVertex& v = verts[tri + i];
+            // mul(worldMatrix, float4(pos, 1)) with column-major constant packing
+            const float cx = m[0] * v.x + m[4] * v.y + m[8]  * v.z + m[12];
+            const float cy = m[1] * v.x + m[5] * v.y + m[9]  * v.z + m[13];
+            const float cz = m[2] * v.x + m[6] * v.y + m[10] * v.z + m[14];
+            const float cw = m[3] * v.x + m[7] * v.y + m[11] * v.z + m[15];
+            if (cw <= 0.0f)
+            {
+                behindEye = true;
+                break;
+            }
+            outsideNear += cz < 0.0f;
+            outsideFar += cz > cw;
+
+            const float invW = 1.0f / cw;
+            screen[i].x = (cx * invW * 0.5f + 0.5f) * target.width;
+            screen[i].y = (0.5f - cy * invW * 0.5f) * target.height;
+            screen[i].color = v.color;
+        }
+
+        // Trivial rejection only; partially clipped triangles are drawn whole.
+        if (behindEye || outsideNear == 3 || outsideFar == 3)
+            continue;
+        RasterizeTriangle (target, screen, path);
+    }
+}
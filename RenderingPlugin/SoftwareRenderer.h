@@ -0,0 +1,51 @@
+#pragma once
+
+#include "CpuSurface.h"
+
+// --------------------------------------------------------------------------
+// Software renderer
+//
+// CPU backend used when Unity runs without a graphics device
+// (kUnityGfxRendererNull, i.e. batch mode). It renders the same things the
+// D3D11 path does -- clears and the MyVertex triangle -- into CpuSurface
+// images. Triangles go through an edge-function rasterizer that evaluates
+// four pixels at a time with SSE2 (scalar fallback elsewhere). Both paths do
+// the same float operations in the same order, so the output is bit-exact
+// between them and between runs.
+
+// Same layout as MyVertex in RenderingPlugin.cpp: position plus a packed
+// colour whose bytes land in the surface as-is (R8G8B8A8 in memory).
+struct SoftwareVertex
+{
+    float x, y, z;
+    unsigned int color;
+};
+
+// Screen-space vertex in pixels, origin top-left.
+struct RasterVertex
+{
+    float x, y;
+    unsigned int color;
+};
+
+enum RasterPath
+{
+    kRasterPathScalar,
+    kRasterPathSimd,
+};
+
+// Allocates a surface and its pixels in one block (16 byte aligned rows).
+// Pixels start out transparent black.
+CpuSurface* CreateCpuSurface (int width, int height);
+void DestroyCpuSurface (CpuSurface* surface);
+
+// Draws a triangle list. worldMatrix is laid out like the D3D11 constant
+// buffer (the shader does mul(worldMatrix, pos) with column-major packing);
+// positions are then mapped from clip space to the surface like a
+// full-surface viewport. No depth test, no culling, no blending, matching
+// the state SetDefaultGraphicsState sets up.
+void SoftwareDrawTriangles (CpuSurface& target, const float worldMatrix[16], const SoftwareVertex* verts, int vertexCount, RasterPath path = kRasterPathSimd);
+
+// Rasterizes one screen-space triangle, interpolating vertex colours.
+// Returns the number of pixels written.
+int RasterizeTriangle (CpuSurface& target, const RasterVertex verts[3], RasterPath path = kRasterPathSimd);
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <atomic>
+
+// --------------------------------------------------------------------------
+// SpscQueue
+//
+// Bounded single-producer / single-consumer ring. Used to hand commands from
+// the Unity main thread (the exported setters) to the render thread
+// (OnRenderEvent) without locks: TryPush and TryPop are wait-free, each side
+// only ever writes its own index, and the indices live on separate cache
+// lines. Each side also keeps a cached copy of the other side's index so
+// the shared line is only touched when the ring looks full or empty.
+//
+// Capacity must be a power of two. Storage is embedded in the object, so
+// the queue never allocates.
+
+enum { kSpscCacheLineSize = 64 };
+
+template <typename T, unsigned Capacity>
+class SpscQueue
+{
+    static_assert ((Capacity & (Capacity - 1)) == 0, "SpscQueue capacity must be a power of two");
+
+public:
+    SpscQueue ()
+        : m_Head (0)
+        , m_CachedTail (0)
+        , m_Tail (0)
+        , m_CachedHead (0)
+    {
+    }
+
+    // Producer side.
+    bool TryPush (const T& item)
+    {
+        const unsigned tail = m_Tail.load (std::memory_order_relaxed);
+        if (tail - m_CachedHead >= Capacity)
+        {
+            m_CachedHead = m_Head.load (std::memory_order_acquire);
+            if (tail - m_CachedHead >= Capacity)
+                return false;
+        }
+        m_Items[tail & (Capacity - 1)] = item;
+        m_Tail.store (tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Producer side, for batches: reserves up to count free slots and
+    // returns how many it got. The caller fills them through Reserved and
+    // publishes them all with one Commit, so the consumer's line is touched
+    // once per batch rather than once per item. Nothing else may be pushed
+    // in between.
+    unsigned Reserve (unsigned count)
+    {
+        const unsigned tail = m_Tail.load (std::memory_order_relaxed);
+        if (Capacity - (tail - m_CachedHead) < count)
+            m_CachedHead = m_Head.load (std::memory_order_acquire);
+        const unsigned space = Capacity - (tail - m_CachedHead);
+        return count < space ? count : space;
+    }
+
+    T& Reserved (unsigned index)
+    {
+        return m_Items[(m_Tail.load (std::memory_order_relaxed) + index) & (Capacity - 1)];
+    }
+
+    void Commit (unsigned count)
+    {
+        m_Tail.store (m_Tail.load (std::memory_order_relaxed) + count, std::memory_order_release);
+    }
+
+    // Consumer side.
+    bool TryPop (T& item)
+    {
+        const unsigned head = m_Head.load (std::memory_order_relaxed);
+        if (head == m_CachedTail)
+        {
+            m_CachedTail = m_Tail.load (std::memory_order_acquire);
+            if (head == m_CachedTail)
+                return false;
+        }
+        item = m_Items[head & (Capacity - 1)];
+        m_Head.store (head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side: hands every item that was visible on entry to fn and
+    // releases them in one store. Items pushed meanwhile wait for the next
+    // call, so a drain is bounded even under a fast producer.
+    template <typename Fn>
+    unsigned Drain (Fn fn)
+    {
+        const unsigned head = m_Head.load (std::memory_order_relaxed);
+        m_CachedTail = m_Tail.load (std::memory_order_acquire);
+        for (unsigned i = head; i != m_CachedTail; ++i)
+            fn (m_Items[i & (Capacity - 1)]);
+        m_Head.store (m_CachedTail, std::memory_order_release);
+        return m_CachedTail - head;
+    }
+
+    // Approximate; exact only when called from one of the two threads while
+    // the other is idle.
+    unsigned Size () const
+    {
+        return m_Tail.load (std::memory_order_acquire) - m_Head.load (std::memory_order_acquire);
+    }
+
+    static unsigned GetCapacity () { return Capacity; }
+
+private:
+    // Consumer-owned line
+    alignas(kSpscCacheLineSize) std::atomic<unsigned> m_Head;
+    unsigned m_CachedTail;
+
+    // Producer-owned line
+    alignas(kSpscCacheLineSize) std::atomic<unsigned> m_Tail;
+    unsigned m_CachedHead;
+
+    alignas(kSpscCacheLineSize) T m_Items[Capacity];
+};
@@ -0,0 +1,207 @@
+#pragma once
+
+#include <stddef.h>
+#include <vector>
+
+// --------------------------------------------------------------------------
+// TextureRegistry
+//
+// Maps small integer handles (that scripts can hold on to) to per-texture
+// plugin data. Backed by a slot map: a sparse slot array that carries a
+// generation counter per slot, plus a dense array of the live entries so the
+// render thread can walk every registered texture without chasing pointers.
+//
+// All storage is allocated up front by the constructor; Register, Unregister
+// and Lookup never allocate and are O(1). A handle whose texture has been
+// unregistered is detected by its stale generation and looks up as NULL.
+//
+// The registry does not know anything about the graphics API; T is whatever
+// the backend wants to store per texture (a D3D11 texture + RTV pair, a CPU
+// surface, or a mock type in the benchmarks).
+
+typedef int TextureHandle;
+
+enum
+{
+    kInvalidTextureHandle = 0,
+    kTextureHandleIndexBits = 16,
+    kTextureHandleIndexMask = (1 << kTextureHandleIndexBits) - 1,
+    kTextureHandleMaxGeneration = 0x7FFF, // keep handles positive for C#
+    kMaxRegisteredTextures = 1024,
+};
+
+
+template <typename T>
+class TextureRegistry
+{
+public:
+    explicit TextureRegistry (int capacity = kMaxRegisteredTextures)
+        : m_Capacity (capacity)
+        , m_Count (0)
+        , m_FreeHead (0)
+    {
+        if (m_Capacity > kTextureHandleIndexMask)
+            m_Capacity = kTextureHandleIndexMask;
+
+        m_Slots.resize (m_Capacity);
+        m_Values.resize (m_Capacity);
+        m_DenseToSlot.resize (m_Capacity);
+        Clear ();
+    }
+
+    // Returns kInvalidTextureHandle when the registry is full.
+    TextureHandle Register (const T& value)
+    {
+        if (m_FreeHead < 0)
+            return kInvalidTextureHandle;
+
+        const int slotIndex = m_FreeHead;
+        Slot& slot = m_Slots[slotIndex];
+        m_FreeHead = slot.next;
+
+        slot.alive = true;
+        slot.next = m_Count;
+        m_Values[m_Count] = value;
+        m_DenseToSlot[m_Count] = slotIndex;
+        ++m_Count;
+
+        return MakeHandle (slotIndex, slot.generation);
+    }
+
+    // Inserts a value under a handle that was allocated by another registry.
+    // Used by the render thread to mirror the main thread's registry, since
+    // only one thread may own handle allocation. An instance must either
+    // allocate (Register) or mirror (RegisterAt), never both.
+    bool RegisterAt (TextureHandle handle, const T& value)
+    {
+        if (handle <= kInvalidTextureHandle)
+            return false;
+        const int slotIndex = handle & kTextureHandleIndexMask;
+        if (slotIndex >= m_Capacity || m_Slots[slotIndex].alive)
+            return false;
+
+        Slot& slot = m_Slots[slotIndex];
+        slot.generation = (unsigned short)(handle >> kTextureHandleIndexBits);
+        slot.alive = true;
+        slot.next = m_Count;
+        m_Values[m_Count] = value;
+        m_DenseToSlot[m_Count] = slotIndex;
+        ++m_Count;
+        return true;
+    }
+
+    // Removes the entry, optionally handing back its value so the caller can
+    // release whatever it owns. Returns false for stale or invalid handles.
+    bool Unregister (TextureHandle handle, T* outValue = NULL)
+    {
+        const int slotIndex = FindSlot (handle);
+        if (slotIndex < 0)
+            return false;
+
+        Slot& slot = m_Slots[slotIndex];
+        const int denseIndex = slot.next;
+        if (outValue)
+            *outValue = m_Values[denseIndex];
+
+        // Keep the dense array packed by moving the last entry into the hole.
+        const int last = m_Count - 1;
+        if (denseIndex != last)
+        {
+            m_Values[denseIndex] = m_Values[last];
+            m_DenseToSlot[denseIndex] = m_DenseToSlot[last];
+            m_Slots[m_DenseToSlot[denseIndex]].next = denseIndex;
+        }
+        m_Values[last] = T();
+        --m_Count;
+
+        // Bump the generation so outstanding copies of the handle go stale.
+        slot.generation = NextGeneration (slot.generation);
+        slot.alive = false;
+        slot.next = m_FreeHead;
+        m_FreeHead = slotIndex;
+        return true;
+    }
+
+    T* Lookup (TextureHandle handle)
+    {
+        const int slotIndex = FindSlot (handle);
+        return slotIndex < 0 ? NULL : &m_Values[m_Slots[slotIndex].next];
+    }
+
+    const T* Lookup (TextureHandle handle) const
+    {
+        const int slotIndex = FindSlot (handle);
+        return slotIndex < 0 ? NULL : &m_Values[m_Slots[slotIndex].next];
+    }
+
+    bool IsValid (TextureHandle handle) const { return FindSlot (handle) >= 0; }
+
+    // Dense iteration over the live entries, in no particular order.
+    int Count () const { return m_Count; }
+    int Capacity () const { return m_Capacity; }
+    T& ValueAt (int denseIndex) { return m_Values[denseIndex]; }
+    const T& ValueAt (int denseIndex) const { return m_Values[denseIndex]; }
+    TextureHandle HandleAt (int denseIndex) const
+    {
+        const int slotIndex = m_DenseToSlot[denseIndex];
+        return MakeHandle (slotIndex, m_Slots[slotIndex].generation);
+    }
+
+    // Drops every entry and invalidates all outstanding handles.
+    void Clear ()
+    {
+        for (int i = 0; i < m_Capacity; ++i)
+        {
+            Slot& slot = m_Slots[i];
+            slot.generation = NextGeneration (slot.generation);
+            slot.alive = false;
+            slot.next = i + 1 < m_Capacity ? i + 1 : -1;
+        }
+        for (int i = 0; i < m_Count; ++i)
+            m_Values[i] = T();
+        m_Count = 0;
+        m_FreeHead = m_Capacity > 0 ? 0 : -1;
+    }
+
+private:
+    struct Slot
+    {
+        Slot () : generation (0), alive (false), next (-1) {}
+
+        unsigned short generation;
+        bool alive;
+        int next; // dense index while alive, next free slot otherwise
+    };
+
+    // Generations run 1..kTextureHandleMaxGeneration so no handle is ever 0.
+    static unsigned short NextGeneration (unsigned short generation)
+    {
+        return generation >= kTextureHandleMaxGeneration ? 1 : (unsigned short)(generation + 1);
+    }
+
+    static TextureHandle MakeHandle (int slotIndex, unsigned short generation)
+    {
+        return (TextureHandle(generation) << kTextureHandleIndexBits) | slotIndex;
+    }
+
+    int FindSlot (TextureHandle handle) const
+    {
+        if (handle <= kInvalidTextureHandle)
+            return -1;
+        const int slotIndex = handle & kTextureHandleIndexMask;
+        const int generation = handle >> kTextureHandleIndexBits;
+        if (slotIndex >= m_Capacity)
+            return -1;
+        const Slot& slot = m_Slots[slotIndex];
+        if (!slot.alive || slot.generation != generation)
+            return -1;
+        return slotIndex;
+    }
+
+    std::vector<Slot> m_Slots;
+    std::vector<T> m_Values;
+    std::vector<int> m_DenseToSlot;
+    int m_Capacity;
+    int m_Count;
+    int m_FreeHead;
+};
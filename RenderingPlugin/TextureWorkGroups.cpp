@@ -0,0 +1,128 @@
+#include "TextureWorkGroups.h"
+#include "WorkerPool.h"
+
+#include <algorithm>
+
+TextureWorkGroups::TextureWorkGroups ()
+    : m_Clears (NULL)
+    , m_Batches (NULL)
+    , m_Resolve (NULL)
+    , m_ResolveUserData (NULL)
+{
+}
+
+int TextureWorkGroups::Build (const ClearCommand* clears, int clearCount, const InstanceBatchBuffer* batches)
+{
+    m_Groups.clear ();
+    m_Clears = clears;
+    m_Batches = batches;
+
+    // Batches by texture, keeping submission order within one
+    const int batchCount = batches ? batches->GetBatchCount () : 0;
+    m_BatchOrder.resize (batchCount);
+    for (int i = 0; i < batchCount; ++i)
+        m_BatchOrder[i] = i;
+    std::sort (m_BatchOrder.begin(), m_BatchOrder.end(), [batches] (int a, int b)
+    {
+        const TextureHandle ta = batches->GetBatch (a).texture;
+        const TextureHandle tb = batches->GetBatch (b).texture;
+        return ta != tb ? ta < tb : a < b;
+    });
+
+    // Merge the two texture-ordered runs into groups
+    int c = 0, b = 0;
+    while (c < clearCount || b < batchCount)
+    {
+        TextureHandle texture;
+        if (c == clearCount)
+            texture = batches->GetBatch (m_BatchOrder[b]).texture;
+        else if (b == batchCount)
+            texture = clears[c].desc.texture;
+        else
+            texture = std::min (clears[c].desc.texture, batches->GetBatch (m_BatchOrder[b]).texture);
+
+        TextureWorkGroup group;
+        group.texture = texture;
+        group.firstClear = c;
+        while (c < clearCount && clears[c].desc.texture == texture)
+            ++c;
+        group.clearCount = c - group.firstClear;
+        group.cost = group.clearCount;
+
+        group.firstBatch = b;
+        while (b < batchCount && batches->GetBatch (m_BatchOrder[b]).texture == texture)
+            group.cost += batches->GetBatch (m_BatchOrder[b++]).instanceCount;
+        group.batchCount = b - group.firstBatch;
+        m_Groups.push_back (group);
+    }
+    m_Results.resize (m_Groups.size());
+    return (int)m_Groups.size();
+}
+
+int TextureWorkGroups::SplitIntoChunks (int chunkCount, std::vector<int>& chunkBegins) const
+{
+    const int groupCount = (int)m_Groups.size();
+    chunkBegins.clear ();
+    if (chunkCount > groupCount)
+        chunkCount = groupCount;
+    if (chunkCount <= 0)
+    {
+        chunkBegins.push_back (0);
+        return 0;
+    }
+
+    long long total = 0;
+    for (int g = 0; g < groupCount; ++g)
+        total += m_Groups[g].cost + 1;
+
+    // A chunk ends once it has reached its share of the total, but every
+    // chunk left still gets at least one group
+    long long done = 0;
+    int g = 0;
+    for (int chunk = 0; chunk < chunkCount; ++chunk)
+    {
+        chunkBegins.push_back (g);
+        const long long target = total * (chunk + 1) / chunkCount;
+        do
+            done += m_Groups[g++].cost + 1;
+        while (g < groupCount - (chunkCount - chunk - 1) && done < target);
+    }
+    chunkBegins.push_back (groupCount);
+    return chunkCount;
+}
+
+void TextureWorkGroups::ExecuteGroupTask (int groupIndex, void* userData)
+{
+    TextureWorkGroups& self = *(TextureWorkGroups*)userData;
+    const TextureWorkGroup& group = self.m_Groups[groupIndex];
+    GroupResult& result = self.m_Results[groupIndex];
+    result.clears = 0;
+    result.draws = 0;
+
+    if (group.clearCount > 0)
+        result.clears = ExecuteClearCommandsCPU (self.m_Clears + group.firstClear, group.clearCount, self.m_Resolve, self.m_ResolveUserData);
+    if (group.batchCount == 0)
+        return;
+    CpuSurface* surface = self.m_Resolve (group.texture, self.m_ResolveUserData);
+    if (!surface)
+        return;
+    const DrawInstance* instances = self.m_Batches->GetInstances ();
+    for (int i = 0; i < group.batchCount; ++i)
+    {
+        const InstanceBatch& batch = self.m_Batches->GetBatch (self.m_BatchOrder[group.firstBatch + i]);
+        SoftwareDrawInstances (*surface, batch.shape, instances + batch.firstInstance, batch.instanceCount);
+        ++result.draws;
+    }
+}
+
+void TextureWorkGroups::ExecuteCPU (WorkerPool& pool, CpuSurfaceResolver resolve, void* userData, int* clearsDone, int* drawsDone)
+{
+    m_Resolve = resolve;
+    m_ResolveUserData = userData;
+    pool.ParallelFor ((int)m_Groups.size(), ExecuteGroupTask, this);
+    for (size_t g = 0; g < m_Results.size(); ++g)
+    {
+        *clearsDone += m_Results[g].clears;
+        *drawsDone += m_Results[g].draws;
+    }
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include "ClearCommands.h"
+#include "InstanceBatch.h"
+
+#include <vector>
+
+class WorkerPool;
+
+// --------------------------------------------------------------------------
+// Per-texture work groups
+//
+// A frame's clears and instance batches, split into one group per target
+// texture so they can be recorded (D3D11 deferred contexts) or executed (CPU
+// surfaces) on several threads at once. Groups write disjoint textures, so
+// the result does not depend on which thread runs which group; within a
+// group the commands keep the order the render thread would have issued
+// them in, the texture's clears in submission order and then its batches.
+//
+// Build reuses its arrays, so steady-state frames do not allocate.
+
+struct TextureWorkGroup
+{
+    TextureHandle texture;
+    int firstClear;             // into the clears passed to Build
+    int clearCount;
+    int firstBatch;             // into GetBatchOrder()
+    int batchCount;
+    int cost;                   // clears plus instances, for splitting into chunks
+};
+
+class TextureWorkGroups
+{
+public:
+    TextureWorkGroups ();
+
+    // clears must be sorted by texture (ClearCommandBuffer::Prepare); either
+    // side may be empty. Groups come out in texture order. Returns the
+    // number of groups.
+    int Build (const ClearCommand* clears, int clearCount, const InstanceBatchBuffer* batches);
+
+    int GetGroupCount () const { return (int)m_Groups.size(); }
+    const TextureWorkGroup& GetGroup (int i) const { return m_Groups[i]; }
+    // Batch indices grouped by texture, each texture's in submission order
+    const int* GetBatchOrder () const { return m_BatchOrder.empty() ? NULL : &m_BatchOrder[0]; }
+
+    // Splits the groups into at most chunkCount runs of consecutive groups
+    // of about equal cost; chunk c is groups [chunkBegins[c], chunkBegins[c+1]).
+    // Returns the number of chunks.
+    int SplitIntoChunks (int chunkCount, std::vector<int>& chunkBegins) const;
+
+    // CPU backend: executes every group into the surfaces resolve returns,
+    // one group per task on pool (which must be idle, or the call waits for
+    // its job). Adds the clears and draws performed to the counts.
+    void ExecuteCPU (WorkerPool& pool, CpuSurfaceResolver resolve, void* userData, int* clearsDone, int* drawsDone);
+
+private:
+    static void ExecuteGroupTask (int groupIndex, void* userData);
+
+    struct GroupResult
+    {
+        int clears;
+        int draws;
+    };
+
+    std::vector<TextureWorkGroup> m_Groups;
+    std::vector<int> m_BatchOrder;
+    std::vector<GroupResult> m_Results;     // per group, written by its task
+
+    const ClearCommand* m_Clears;
+    const InstanceBatchBuffer* m_Batches;
+    CpuSurfaceResolver m_Resolve;
+    void* m_ResolveUserData;
+};
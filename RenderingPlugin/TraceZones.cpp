@@ -0,0 +1,218 @@
+#include "TraceZones.h"
+#include "PluginStats.h"
+
+#include <chrono>
+#include <mutex>
+#include <stdio.h>
+#include <string.h>
+#include <thread>
+#include <vector>
+
+uint64_t TraceFallbackTimestamp ()
+{
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+
+// --------------------------------------------------------------------------
+// Thread buffers
+//
+// Buffers are created on a thread's first zone and kept until the plugin
+// unloads, so the zones of threads that have exited still get exported.
+
+struct TraceExport
+{
+    static std::mutex s_Mutex;                          // buffer list, names, export
+    static TraceBuffer* s_Buffers[kMaxTraceThreads];
+    static int s_BufferCount;
+
+    // Ticks and steady clock time when the plugin loaded, for converting
+    // ticks to time at export
+    static uint64_t s_StartTicks;
+    static uint64_t s_StartNs;
+
+    static TraceBuffer* CreateBuffer ();
+    static void SetName (TraceBuffer& buffer, const char* name);
+    static int Write (FILE* file);
+    static void Clear ();
+    static void Release ();
+};
+
+std::mutex TraceExport::s_Mutex;
+TraceBuffer* TraceExport::s_Buffers[kMaxTraceThreads];
+int TraceExport::s_BufferCount = 0;
+uint64_t TraceExport::s_StartTicks = TraceTimestampNow ();
+uint64_t TraceExport::s_StartNs = TraceFallbackTimestamp ();
+
+static thread_local TraceBuffer* t_TraceBuffer = NULL;
+static thread_local bool t_TraceBufferRefused = false;
+
+// Frees the buffers when the plugin unloads; no thread records after that
+static struct TraceBufferRelease
+{
+    ~TraceBufferRelease () { TraceExport::Release (); }
+} s_TraceBufferRelease;
+
+TraceBuffer* TraceExport::CreateBuffer ()
+{
+    std::lock_guard<std::mutex> lock (s_Mutex);
+    if (s_BufferCount == kMaxTraceThreads)
+        return NULL;
+    TraceBuffer* buffer = new TraceBuffer;
+    snprintf (buffer->m_Name, sizeof(buffer->m_Name), "Thread %d", s_BufferCount + 1);
+    s_Buffers[s_BufferCount++] = buffer;
+    return buffer;
+}
+
+void TraceExport::SetName (TraceBuffer& buffer, const char* name)
+{
+    // Only this thread writes its name, so it can compare without the lock
+    if (!strncmp (buffer.m_Name, name, sizeof(buffer.m_Name) - 1))
+        return;
+    std::lock_guard<std::mutex> lock (s_Mutex);
+    strncpy (buffer.m_Name, name, sizeof(buffer.m_Name) - 1);
+    buffer.m_Name[sizeof(buffer.m_Name) - 1] = 0;
+}
+
+void TraceExport::Clear ()
+{
+    std::lock_guard<std::mutex> lock (s_Mutex);
+    for (int i = 0; i < s_BufferCount; ++i)
+        s_Buffers[i]->m_Cleared = s_Buffers[i]->m_Count.load (std::memory_order_acquire);
+}
+
+void TraceExport::Release ()
+{
+    std::lock_guard<std::mutex> lock (s_Mutex);
+    for (int i = 0; i < s_BufferCount; ++i)
+        delete s_Buffers[i];
+    s_BufferCount = 0;
+}
+
+TraceBuffer* GetThreadTraceBuffer ()
+{
+    if (!t_TraceBuffer && !t_TraceBufferRefused)
+    {
+        t_TraceBuffer = TraceExport::CreateBuffer ();
+        t_TraceBufferRefused = t_TraceBuffer == NULL;
+    }
+    return t_TraceBuffer;
+}
+
+void RecordTraceZone (const char* name, uint64_t begin, uint64_t end)
+{
+    TraceBuffer* buffer = t_TraceBuffer;
+    if (!buffer)
+    {
+        buffer = GetThreadTraceBuffer ();
+        if (!buffer)
+            return;
+    }
+    buffer->Record (name, begin, end);
+}
+
+void SetTraceThreadName (const char* name)
+{
+    if (TraceBuffer* buffer = GetThreadTraceBuffer ())
+        TraceExport::SetName (*buffer, name);
+}
+
+void ClearTrace ()
+{
+    TraceExport::Clear ();
+}
+
+
+// --------------------------------------------------------------------------
+// Chrome trace JSON
+//
+// Every zone becomes a complete ("X") event with its start and duration in
+// microseconds since the plugin loaded; every thread gets a thread_name
+// metadata event.
+
+static void WriteJsonString (FILE* file, const char* text)
+{
+    fputc ('"', file);
+    for (; *text; ++text)
+    {
+        const unsigned char c = (unsigned char)*text;
+        if (c == '"' || c == '\\')
+            fprintf (file, "\\%c", c);
+        else if (c < 0x20)
+            fprintf (file, "\\u%04x", c);
+        else
+            fputc (c, file);
+    }
+    fputc ('"', file);
+}
+
+int TraceExport::Write (FILE* file)
+{
+    // Tick rate over everything since load; at least a few ms so it is exact
+    // enough even right after loading
+    uint64_t ticks = TraceTimestampNow ();
+    uint64_t ns = TraceFallbackTimestamp ();
+    while (ns - s_StartNs < 10 * 1000000ull)
+    {
+        std::this_thread::sleep_for (std::chrono::milliseconds (1));
+        ticks = TraceTimestampNow ();
+        ns = TraceFallbackTimestamp ();
+    }
+    const double usPerTick = (ns - s_StartNs) * 1e-3 / (double)(ticks - s_StartTicks);
+    const unsigned processId = (unsigned)GetPluginStatsProcessId ();
+
+    std::lock_guard<std::mutex> lock (s_Mutex);
+    std::vector<TraceEvent> events;
+    events.reserve (kTraceBufferCapacity);
+
+    fprintf (file, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+    int written = 0;
+    bool first = true;
+    for (int b = 0; b < s_BufferCount; ++b)
+    {
+        TraceBuffer& buffer = *s_Buffers[b];
+        const int threadId = b + 1;
+
+        fprintf (file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%u,\"tid\":%d,\"args\":{\"name\":", first ? "" : ",\n", processId, threadId);
+        WriteJsonString (file, buffer.m_Name);
+        fprintf (file, "}}");
+        first = false;
+
+        // Copy what the ring holds, then keep only the zones the writer
+        // cannot have overwritten (or be writing) while we copied
+        const uint32_t count = buffer.m_Count.load (std::memory_order_acquire);
+        uint32_t begin = count - buffer.m_Cleared > (uint32_t)kTraceBufferCapacity ? count - kTraceBufferCapacity : buffer.m_Cleared;
+        events.clear ();
+        for (uint32_t i = begin; i != count; ++i)
+            events.push_back (buffer.m_Events[i & (kTraceBufferCapacity - 1)]);
+        std::atomic_thread_fence (std::memory_order_acquire);
+        const uint32_t countAfter = buffer.m_Count.load (std::memory_order_relaxed);
+        const uint32_t firstIntact = countAfter + 1 - kTraceBufferCapacity;
+        size_t skip = 0;
+        if ((int32_t)(firstIntact - begin) > 0)
+            skip = firstIntact - begin;
+
+        for (size_t i = skip; i < events.size (); ++i)
+        {
+            const TraceEvent& event = events[i];
+            const double start = event.begin > s_StartTicks ? (event.begin - s_StartTicks) * usPerTick : 0.0;
+            const double duration = event.end > event.begin ? (event.end - event.begin) * usPerTick : 0.0;
+            fprintf (file, ",\n{\"name\":");
+            WriteJsonString (file, event.name);
+            fprintf (file, ",\"cat\":\"plugin\",\"ph\":\"X\",\"pid\":%u,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}", processId, threadId, start, duration);
+            ++written;
+        }
+    }
+    fprintf (file, "\n]}\n");
+    return written;
+}
+
+int WriteChromeTrace (const char* path)
+{
+    FILE* file = path ? fopen (path, "wb") : NULL;
+    if (!file)
+        return -1;
+    const int written = TraceExport::Write (file);
+    const bool ok = !ferror (file);
+    return fclose (file) == 0 && ok ? written : -1;
+}
@@ -0,0 +1,133 @@
+#pragma once
+
+#include <atomic>
+#include <stdint.h>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    #include <intrin.h>
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+    #include <x86intrin.h>
+#endif
+
+// --------------------------------------------------------------------------
+// Trace zones
+//
+// Timelines of what the plugin's threads did, for when the counters in
+// PluginStats.h say something is slow but not when. A zone records its name
+// and start/end timestamps (the CPU's time stamp counter where there is one)
+// into a ring owned by the thread it runs on, so recording never takes a
+// lock; each ring keeps the most recent kTraceBufferCapacity - 1 zones (the
+// slot after them may be mid-write when exporting).
+// WriteChromeTrace turns what the rings hold into Chrome trace JSON, which
+// chrome://tracing and Perfetto (ui.perfetto.dev) open directly.
+//
+// Zone names must be string literals (or otherwise live for the whole
+// process): only the pointer is stored. Zones on one thread must nest.
+//
+// Build with RENDERINGPLUGIN_TRACE=0 (CMake option of the same name) and the
+// zone macros compile to nothing.
+
+#ifndef RENDERINGPLUGIN_TRACE
+#define RENDERINGPLUGIN_TRACE 1
+#endif
+
+enum
+{
+    kTraceBufferCapacity = 8192,    // zones per thread; power of two
+    kMaxTraceThreads = 64,          // threads after this many record nothing
+    kTraceThreadNameSize = 32,
+};
+
+struct TraceEvent
+{
+    const char* name;
+    uint64_t begin;
+    uint64_t end;
+};
+
+uint64_t TraceFallbackTimestamp ();   // steady clock, in ns
+
+// Raw timestamp in ticks; WriteChromeTrace converts them to time.
+static inline uint64_t TraceTimestampNow ()
+{
+    #if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    return __rdtsc ();
+    #elif (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+    return __rdtsc ();
+    #elif (defined(__GNUC__) || defined(__clang__)) && defined(__aarch64__)
+    uint64_t ticks;
+    asm volatile ("mrs %0, cntvct_el0" : "=r" (ticks));
+    return ticks;
+    #else
+    return TraceFallbackTimestamp ();
+    #endif
+}
+
+// One thread's zones. Only the owning thread writes; the exporter copies the
+// events and then drops any the writer may have overwritten meanwhile.
+class TraceBuffer
+{
+public:
+    TraceBuffer () : m_Count (0), m_Cleared (0) { m_Name[0] = 0; }
+
+    void Record (const char* name, uint64_t begin, uint64_t end)
+    {
+        const uint32_t index = m_Count.load (std::memory_order_relaxed);
+        TraceEvent& event = m_Events[index & (kTraceBufferCapacity - 1)];
+        event.name = name;
+        event.begin = begin;
+        event.end = end;
+        m_Count.store (index + 1, std::memory_order_release);
+    }
+
+private:
+    friend struct TraceExport;
+
+    std::atomic<uint32_t> m_Count;      // zones ever recorded
+    uint32_t m_Cleared;                 // zones before this were cleared; exporter side
+    char m_Name[kTraceThreadNameSize];
+    TraceEvent m_Events[kTraceBufferCapacity];
+};
+
+// The calling thread's buffer, created on its first zone. NULL once
+// kMaxTraceThreads threads have one.
+TraceBuffer* GetThreadTraceBuffer ();
+
+// Records a zone on the calling thread.
+void RecordTraceZone (const char* name, uint64_t begin, uint64_t end);
+
+// Names the calling thread in the trace. Cheap when the name is unchanged.
+void SetTraceThreadName (const char* name);
+
+// Writes every zone the rings hold as Chrome trace JSON. Returns the number
+// of zones written, or -1 when the file cannot be written.
+int WriteChromeTrace (const char* path);
+
+// Forgets the zones recorded so far (thread names stay).
+void ClearTrace ();
+
+
+class TraceZone
+{
+public:
+    explicit TraceZone (const char* name) : m_Name (name), m_Begin (TraceTimestampNow ()) {}
+    ~TraceZone () { RecordTraceZone (m_Name, m_Begin, TraceTimestampNow ()); }
+
+private:
+    TraceZone (const TraceZone&);
+    TraceZone& operator= (const TraceZone&);
+
+    const char* m_Name;
+    uint64_t m_Begin;
+};
+
+#define PLUGIN_TRACE_CONCAT_(a, b) a##b
+#define PLUGIN_TRACE_CONCAT(a, b) PLUGIN_TRACE_CONCAT_(a, b)
+
+#if RENDERINGPLUGIN_TRACE
+#define PLUGIN_TRACE_ZONE(name) TraceZone PLUGIN_TRACE_CONCAT(traceZone_, __LINE__) (name)
+#define PLUGIN_TRACE_THREAD_NAME(name) SetTraceThreadName (name)
+#else
+#define PLUGIN_TRACE_ZONE(name) do {} while (0)
+#define PLUGIN_TRACE_THREAD_NAME(name) do {} while (0)
+#endif
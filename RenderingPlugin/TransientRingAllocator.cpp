@@ -0,0 +1,103 @@
+#include "TransientRingAllocator.h"
+
+TransientRingAllocator::TransientRingAllocator (size_t capacity)
+{
+    Reset (capacity);
+}
+
+void TransientRingAllocator::Reset (size_t capacity)
+{
+    m_Capacity = capacity;
+    m_Head = 0;
+    m_Tail = 0;
+    m_Used = 0;
+    m_FrameBytes = 0;
+    m_FrameHasAllocations = false;
+    m_FenceHead = 0;
+    m_FenceCount = 0;
+}
+
+bool TransientRingAllocator::Allocate (size_t size, size_t alignment, TransientAllocation* out)
+{
+    if (size == 0 || size > m_Capacity)
+        return false;
+    if (alignment == 0)
+        alignment = 1;
+
+    if (m_Used == 0)
+        m_Head = m_Tail = 0;
+
+    size_t start = (m_Head + alignment - 1) & ~(alignment - 1);
+    size_t padding;
+    if (m_Used == 0 || m_Head > m_Tail)
+    {
+        // Free space is [head, capacity) followed by [0, tail)
+        if (start + size <= m_Capacity)
+            padding = start - m_Head;
+        else if (size <= m_Tail)
+        {
+            // Skip the end of the buffer and wrap around
+            padding = m_Capacity - m_Head;
+            start = 0;
+        }
+        else
+            return false;
+    }
+    else
+    {
+        // Free space is [head, tail); head == tail here means full
+        if (m_Head == m_Tail || start + size > m_Tail)
+            return false;
+        padding = start - m_Head;
+    }
+
+    const size_t consumed = padding + size;
+    m_Head = start + size;
+    if (m_Head == m_Capacity)
+        m_Head = 0;
+    m_Used += consumed;
+    m_FrameBytes += consumed;
+
+    out->offset = start;
+    out->size = size;
+    out->firstInFrame = !m_FrameHasAllocations;
+    m_FrameHasAllocations = true;
+    return true;
+}
+
+void TransientRingAllocator::EndFrame (uint64_t frame)
+{
+    m_FrameHasAllocations = false;
+    if (m_FrameBytes == 0)
+        return;
+
+    if (m_FenceCount == kMaxFramesInFlight)
+    {
+        // Retire later rather than fail: the newest fence now covers both
+        Fence& newest = m_Fences[(m_FenceHead + m_FenceCount - 1) % kMaxFramesInFlight];
+        newest.frame = frame;
+        newest.end = m_Head;
+        newest.bytes += m_FrameBytes;
+    }
+    else
+    {
+        Fence& fence = m_Fences[(m_FenceHead + m_FenceCount) % kMaxFramesInFlight];
+        fence.frame = frame;
+        fence.end = m_Head;
+        fence.bytes = m_FrameBytes;
+        ++m_FenceCount;
+    }
+    m_FrameBytes = 0;
+}
+
+void TransientRingAllocator::RetireFramesUpTo (uint64_t frame)
+{
+    while (m_FenceCount > 0 && m_Fences[m_FenceHead].frame <= frame)
+    {
+        const Fence& fence = m_Fences[m_FenceHead];
+        m_Tail = fence.end;
+        m_Used -= fence.bytes;
+        m_FenceHead = (m_FenceHead + 1) % kMaxFramesInFlight;
+        --m_FenceCount;
+    }
+}
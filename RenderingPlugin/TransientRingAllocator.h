@@ -0,0 +1,75 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// --------------------------------------------------------------------------
+// Transient ring allocator
+//
+// Bookkeeping for per-frame data (vertices, constants) streamed through one
+// large dynamic buffer. Allocations are carved out of the buffer in ring
+// order; at the end of a frame the allocations made during it are fenced
+// with the frame number, and their space only becomes reusable once the
+// caller reports that frame as finished on the GPU (RetireFramesUpTo).
+// While the GPU lags behind, the data it has yet to read is never
+// overwritten, so a D3D11 buffer can be mapped with WRITE_DISCARD for a
+// frame's first allocation and NO_OVERWRITE for the rest.
+//
+// The allocator only hands out offsets and never touches the memory, so
+// the same code runs against a CPU-memory stand-in (see BenchTransientRing).
+// It does not allocate after Reset.
+
+struct TransientAllocation
+{
+    size_t offset;
+    size_t size;
+    bool firstInFrame;  // first allocation since the last EndFrame
+};
+
+class TransientRingAllocator
+{
+public:
+    enum { kMaxFramesInFlight = 8 };
+
+    explicit TransientRingAllocator (size_t capacity = 0);
+
+    // Forgets every allocation and fence.
+    void Reset (size_t capacity);
+
+    // offset is a multiple of alignment (a power of two). Returns false when
+    // the free space is too small until more frames retire.
+    bool Allocate (size_t size, size_t alignment, TransientAllocation* out);
+
+    // Fences everything allocated since the previous EndFrame with frame
+    // (increasing from call to call). With kMaxFramesInFlight fences pending,
+    // the frame is merged into the newest one.
+    void EndFrame (uint64_t frame);
+
+    // Every frame up to and including frame is done with its data.
+    void RetireFramesUpTo (uint64_t frame);
+
+    int GetFramesInFlight () const { return m_FenceCount; }
+    uint64_t GetOldestFrameInFlight () const { return m_FenceCount ? m_Fences[m_FenceHead].frame : 0; }
+
+    size_t GetCapacity () const { return m_Capacity; }
+    size_t GetUsedBytes () const { return m_Used; }
+
+private:
+    struct Fence
+    {
+        uint64_t frame;
+        size_t end;     // m_Head when the frame ended
+        size_t bytes;   // space the frame used, including padding
+    };
+
+    size_t m_Capacity;
+    size_t m_Head;          // next free byte
+    size_t m_Tail;          // start of the oldest allocation still in use
+    size_t m_Used;          // bytes between tail and head, padding included
+    size_t m_FrameBytes;    // used by the frame being recorded
+    bool m_FrameHasAllocations;
+
+    Fence m_Fences[kMaxFramesInFlight];
+    int m_FenceHead;        // oldest
+    int m_FenceCount;
+};
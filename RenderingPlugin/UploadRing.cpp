@@ -0,0 +1,96 @@
+#include "UploadRing.h"
+
+#include <new>
+#include <stdint.h>
+
+UploadRing::UploadRing ()
+    : m_Block (NULL)
+    , m_Slots (NULL)
+    , m_SlotSize (0)
+    , m_SlotCount (0)
+    , m_WriteSlot (0)
+    , m_ReadSlot (0)
+    , m_Filled (0)
+    , m_Writing (false)
+    , m_Allocations (0)
+{
+    for (int i = 0; i < kMaxSlots; ++i)
+        m_Bytes[i] = 0;
+}
+
+UploadRing::~UploadRing ()
+{
+    Release ();
+}
+
+bool UploadRing::Reserve (size_t slotBytes, int slotCount)
+{
+    if (slotCount < 2)
+        slotCount = 2;
+    if (slotCount > kMaxSlots)
+        slotCount = kMaxSlots;
+    const size_t slotSize = (slotBytes + kAlignment - 1) & ~size_t(kAlignment - 1);
+    if (slotSize <= m_SlotSize && slotCount == m_SlotCount)
+        return true;
+
+    const size_t newSize = slotSize > m_SlotSize ? slotSize : m_SlotSize;
+    char* block = new (std::nothrow) char[newSize * slotCount + kAlignment];
+    if (!block)
+        return false;
+
+    Release ();
+    m_Block = block;
+    m_Slots = reinterpret_cast<unsigned char*>((reinterpret_cast<uintptr_t>(block) + kAlignment - 1) & ~uintptr_t(kAlignment - 1));
+    m_SlotSize = newSize;
+    m_SlotCount = slotCount;
+    ++m_Allocations;
+    return true;
+}
+
+void UploadRing::Release ()
+{
+    delete[] m_Block;
+    m_Block = NULL;
+    m_Slots = NULL;
+    m_SlotSize = 0;
+    m_SlotCount = 0;
+    m_WriteSlot = 0;
+    m_ReadSlot = 0;
+    m_Filled = 0;
+    m_Writing = false;
+}
+
+unsigned char* UploadRing::BeginWrite ()
+{
+    if (!m_Slots || m_Filled == m_SlotCount)
+        return NULL;
+    m_Writing = true;
+    return SlotData (m_WriteSlot);
+}
+
+void UploadRing::EndWrite (size_t bytes)
+{
+    if (!m_Writing)
+        return;
+    m_Writing = false;
+    m_Bytes[m_WriteSlot] = bytes < m_SlotSize ? bytes : m_SlotSize;
+    m_WriteSlot = (m_WriteSlot + 1) % m_SlotCount;
+    ++m_Filled;
+}
+
+const unsigned char* UploadRing::BeginRead (size_t* bytes)
+{
+    if (m_Filled == 0)
+        return NULL;
+    if (bytes)
+        *bytes = m_Bytes[m_ReadSlot];
+    return SlotData (m_ReadSlot);
+}
+
+void UploadRing::EndRead ()
+{
+    if (m_Filled == 0)
+        return;
+    m_ReadSlot = (m_ReadSlot + 1) % m_SlotCount;
+    --m_Filled;
+}
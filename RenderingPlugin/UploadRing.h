@@ -0,0 +1,71 @@
+#pragma once
+
+#include <stddef.h>
+
+// --------------------------------------------------------------------------
+// UploadRing
+//
+// Persistent staging memory for per-frame texture uploads. A small ring of
+// equally sized, 64 byte aligned slots lives in one block; the producer
+// fills the next free slot while the consumer uploads the oldest filled one
+// (e.g. with UpdateSubresource), so CPU generation of frame N+1 overlaps the
+// upload of frame N.
+//
+// The block is only (re)allocated by Reserve, when a larger texture is
+// registered; acquiring, filling and releasing slots never allocates. The
+// bookkeeping is not thread-safe: one thread calls all methods, although
+// other threads may write into a slot between BeginWrite and EndWrite.
+
+class UploadRing
+{
+public:
+    enum
+    {
+        kAlignment = 64,
+        kMaxSlots = 3,
+    };
+
+    UploadRing ();
+    ~UploadRing ();
+
+    // Makes every slot at least slotBytes large, with slotCount (2 or 3)
+    // slots. Only allocates when the slots need to grow or the count
+    // changes; that drops any filled slots. Returns false if out of memory.
+    bool Reserve (size_t slotBytes, int slotCount = kMaxSlots);
+    void Release ();
+
+    // Producer: the next free slot, or NULL when all of them are filled and
+    // waiting to be uploaded. EndWrite marks it filled with bytes of data.
+    unsigned char* BeginWrite ();
+    void EndWrite (size_t bytes);
+
+    // Consumer: the oldest filled slot (NULL if none); EndRead frees it.
+    const unsigned char* BeginRead (size_t* bytes);
+    void EndRead ();
+
+    size_t GetSlotSize () const { return m_SlotSize; }
+    int GetSlotCount () const { return m_SlotCount; }
+    int GetFilledCount () const { return m_Filled; }
+
+    // Number of times the backing block was allocated, for checking that
+    // steady-state frames do not allocate.
+    unsigned GetAllocationCount () const { return m_Allocations; }
+
+private:
+    UploadRing (const UploadRing&);
+    UploadRing& operator= (const UploadRing&);
+
+    unsigned char* SlotData (int slot) const { return m_Slots + (size_t)slot * m_SlotSize; }
+
+    char* m_Block;
+    unsigned char* m_Slots;     // m_Block rounded up to kAlignment
+    size_t m_SlotSize;          // multiple of kAlignment
+    int m_SlotCount;
+    size_t m_Bytes[kMaxSlots];
+
+    int m_WriteSlot;            // next slot BeginWrite hands out
+    int m_ReadSlot;             // oldest filled slot
+    int m_Filled;
+    bool m_Writing;
+    unsigned m_Allocations;
+};
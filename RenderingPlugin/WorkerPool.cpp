@@ -0,0 +1,214 @@
+#include "WorkerPool.h"
+#include "TraceZones.h"
+
+#include <stdio.h>
+
+#if defined(_WIN32)
+    #include <windows.h>
+#elif defined(__linux__)
+    #include <pthread.h>
+    #include <sched.h>
+#endif
+
+enum
+{
+    kCacheLineSize = 64,
+    kLatchSpinCount = 4096,
+};
+
+
+// --------------------------------------------------------------------------
+// CompletionLatch
+
+void CompletionLatch::CountDown ()
+{
+    if (m_Count.fetch_sub (1, std::memory_order_acq_rel) == 1)
+    {
+        // Take the lock so a waiter cannot miss the wakeup between its
+        // check and its wait.
+        std::lock_guard<std::mutex> lock (m_Mutex);
+        m_Done.notify_all ();
+    }
+}
+
+void CompletionLatch::Wait ()
+{
+    for (int spin = 0; spin < kLatchSpinCount; ++spin)
+    {
+        if (m_Count.load (std::memory_order_acquire) == 0)
+            return;
+    }
+    std::unique_lock<std::mutex> lock (m_Mutex);
+    m_Done.wait (lock, [this] { return m_Count.load (std::memory_order_acquire) == 0; });
+}
+
+
+// --------------------------------------------------------------------------
+// WorkerPool
+
+static void PinCurrentThread (int cpu)
+{
+    const unsigned cpuCount = std::thread::hardware_concurrency ();
+    if (cpuCount == 0)
+        return;
+    cpu %= cpuCount;
+
+    #if defined(_WIN32)
+    SetThreadAffinityMask (GetCurrentThread (), DWORD_PTR(1) << cpu);
+    #elif defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO (&set);
+    CPU_SET (cpu, &set);
+    pthread_setaffinity_np (pthread_self (), sizeof(set), &set);
+    #else
+    (void)cpu;
+    #endif
+}
+
+WorkerPool::WorkerPool ()
+    : m_JobGeneration (0)
+    , m_Quit (false)
+    , m_Fn (NULL)
+    , m_UserData (NULL)
+    , m_TaskCount (0)
+    , m_NextTask (0)
+    , m_JobInFlight (false)
+{
+}
+
+WorkerPool::~WorkerPool ()
+{
+    Stop ();
+}
+
+int WorkerPool::GetDefaultWorkerCount ()
+{
+    const int hardwareThreads = (int)std::thread::hardware_concurrency ();
+    return hardwareThreads > 1 ? hardwareThreads - 1 : 0;
+}
+
+void WorkerPool::Start (int threadCount, bool pinThreads)
+{
+    Stop ();
+    m_Quit = false;
+    m_Threads.reserve (threadCount);
+    for (int i = 0; i < threadCount; ++i)
+        m_Threads.push_back (std::thread (&WorkerPool::WorkerMain, this, i, pinThreads));
+}
+
+void WorkerPool::Stop ()
+{
+    Wait ();
+    if (m_Threads.empty ())
+        return;
+    {
+        std::lock_guard<std::mutex> lock (m_Mutex);
+        m_Quit = true;
+    }
+    m_Wake.notify_all ();
+    for (size_t i = 0; i < m_Threads.size (); ++i)
+        m_Threads[i].join ();
+    m_Threads.clear ();
+}
+
+void WorkerPool::RunTasks ()
+{
+    for (;;)
+    {
+        const int task = m_NextTask.fetch_add (1, std::memory_order_relaxed);
+        if (task >= m_TaskCount)
+            return;
+        m_Fn (task, m_UserData);
+    }
+}
+
+void WorkerPool::WorkerMain (int workerIndex, bool pin)
+{
+    // Leave the first core to the thread that issues the jobs
+    if (pin)
+        PinCurrentThread (workerIndex + 1);
+
+    char traceName[kTraceThreadNameSize];
+    snprintf (traceName, sizeof(traceName), "Worker %d", workerIndex + 1);
+    PLUGIN_TRACE_THREAD_NAME (traceName);
+
+    unsigned seenGeneration = 0;
+    for (;;)
+    {
+        {
+            std::unique_lock<std::mutex> lock (m_Mutex);
+            m_Wake.wait (lock, [&] { return m_Quit || m_JobGeneration != seenGeneration; });
+            if (m_Quit)
+                return;
+            seenGeneration = m_JobGeneration;
+        }
+        RunTasks ();
+        m_Latch.CountDown ();
+    }
+}
+
+void WorkerPool::Dispatch (int taskCount, WorkerTaskFn fn, void* userData)
+{
+    Wait ();
+    if (taskCount <= 0)
+        return;
+
+    if (m_Threads.empty ())
+    {
+        for (int i = 0; i < taskCount; ++i)
+            fn (i, userData);
+        return;
+    }
+
+    // Every worker checks in once it runs out of tasks, so none of them can
+    // still be looking at this job when the next one is published.
+    m_Latch.Reset ((int)m_Threads.size ());
+    {
+        std::lock_guard<std::mutex> lock (m_Mutex);
+        m_Fn = fn;
+        m_UserData = userData;
+        m_TaskCount = taskCount;
+        m_NextTask.store (0, std::memory_order_relaxed);
+        ++m_JobGeneration;
+    }
+    m_Wake.notify_all ();
+    m_JobInFlight = true;
+}
+
+void WorkerPool::Wait ()
+{
+    if (!m_JobInFlight)
+        return;
+
+    // The caller would only be waiting otherwise
+    RunTasks ();
+    m_Latch.Wait ();
+    m_JobInFlight = false;
+}
+
+void WorkerPool::ParallelFor (int taskCount, WorkerTaskFn fn, void* userData)
+{
+    if (taskCount == 1)
+    {
+        Wait ();
+        fn (0, userData);
+        return;
+    }
+    Dispatch (taskCount, fn, userData);
+    Wait ();
+}
+
+
+int ComputeRowBandHeight (int height, int stride, int bandCount)
+{
+    if (bandCount < 1)
+        bandCount = 1;
+    int rows = (height + bandCount - 1) / bandCount;
+
+    // Smallest row count whose byte size is a whole number of cache lines
+    int align = 1;
+    while (((long long)align * stride) % kCacheLineSize != 0 && align < kCacheLineSize)
+        ++align;
+    rows = ((rows + align - 1) / align) * align;
+    return rows > 0 ? rows : 1;
+}
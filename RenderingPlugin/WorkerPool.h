@@ -0,0 +1,96 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// --------------------------------------------------------------------------
+// WorkerPool
+//
+// Persistent worker threads for splitting per-frame work (e.g. texture fill
+// row bands) off Unity's render thread. Threads are created once, when the
+// plugin loads, and optionally pinned one per core; between jobs they sleep.
+//
+// ParallelFor publishes a job, lets the workers and the calling thread pull
+// task indices from a shared counter, and returns once every worker has
+// counted down a completion latch. It never creates threads or allocates.
+
+typedef void (*WorkerTaskFn)(int taskIndex, void* userData);
+
+// Counts down once per worker that is done with a job. Wait spins briefly
+// (jobs are usually short) before falling back to blocking.
+class CompletionLatch
+{
+public:
+    CompletionLatch () : m_Count (0) {}
+
+    void Reset (int count) { m_Count.store (count, std::memory_order_relaxed); }
+    void CountDown ();
+    void Wait ();
+
+private:
+    std::atomic<int> m_Count;
+    std::mutex m_Mutex;
+    std::condition_variable m_Done;
+};
+
+
+class WorkerPool
+{
+public:
+    WorkerPool ();
+    ~WorkerPool ();
+
+    // threadCount workers in addition to the calling thread; 0 runs
+    // everything on the caller.
+    void Start (int threadCount, bool pinThreads);
+    void Stop ();
+
+    int GetWorkerCount () const { return (int)m_Threads.size(); }
+
+    // Runs fn(i, userData) for every i in [0, taskCount). Only one thread
+    // may issue jobs at a time.
+    void ParallelFor (int taskCount, WorkerTaskFn fn, void* userData);
+
+    // Split version of ParallelFor: Dispatch hands the job to the workers
+    // and returns right away, so the caller can do something else meanwhile
+    // (userData must stay alive until Wait). Wait runs any tasks nobody has
+    // picked up yet and blocks until the job is done; it returns at once
+    // when no job is in flight. Dispatch waits for the previous job first.
+    void Dispatch (int taskCount, WorkerTaskFn fn, void* userData);
+    void Wait ();
+
+    // True from a Dispatch until the Wait that finishes its job; issuing
+    // thread only.
+    bool IsJobInFlight () const { return m_JobInFlight; }
+
+    // Workers to use by default: one less than the hardware threads, so
+    // together with the render thread every core has one.
+    static int GetDefaultWorkerCount ();
+
+private:
+    void WorkerMain (int workerIndex, bool pin);
+    void RunTasks ();
+
+    std::vector<std::thread> m_Threads;
+
+    std::mutex m_Mutex;
+    std::condition_variable m_Wake;
+    unsigned m_JobGeneration;
+    bool m_Quit;
+
+    WorkerTaskFn m_Fn;
+    void* m_UserData;
+    int m_TaskCount;
+    std::atomic<int> m_NextTask;
+    CompletionLatch m_Latch;
+    bool m_JobInFlight;     // issuing thread only
+};
+
+
+// Splits height rows into about bandCount bands whose byte size is a
+// multiple of a cache line, so no two bands ever write the same line.
+// Returns the rows per band (the last band may be shorter).
+int ComputeRowBandHeight (int height, int stride, int bandCount);
@@ -0,0 +1,34 @@
+# Turns a compiled shader blob into a C++ header holding it as a constexpr
+# byte array, k<NAME>Bytecode -- the same name the Visual Studio project has
+# fxc give its header output. Run as a build step:
+#   cmake -DBLOB=<file.cso> -DNAME=<ShaderName> -DOUTPUT=<header> -P EmbedShaderBlob.cmake
+
+if(NOT BLOB OR NOT NAME OR NOT OUTPUT)
+    message(FATAL_ERROR "EmbedShaderBlob.cmake needs BLOB, NAME and OUTPUT")
+endif()
+
+file(READ "${BLOB}" _hex HEX)
+string(LENGTH "${_hex}" _hexLength)
+if(_hexLength EQUAL 0)
+    message(FATAL_ERROR "${BLOB} is empty")
+endif()
+
+# Two hex digits per byte, 16 bytes per line (CMake regexes have no {n})
+string(REGEX REPLACE "([0-9a-f][0-9a-f])" "0x\\1," _bytes "${_hex}")
+set(_line "")
+foreach(_i RANGE 1 16)
+    string(APPEND _line "0x[0-9a-f][0-9a-f],")
+endforeach()
+string(REGEX REPLACE "(${_line})" "\\1\n    " _bytes "${_bytes}")
+string(STRIP "${_bytes}" _bytes)
+get_filename_component(_blobName "${BLOB}" NAME)
+
+file(WRITE "${OUTPUT}"
+"// Generated from ${_blobName} by EmbedShaderBlob.cmake; do not edit.
+#pragma once
+
+constexpr unsigned char k${NAME}Bytecode[] =
+{
+    ${_bytes}
+};
+")
@@ -2,6 +2,7 @@ using UnityEngine;
 using System;
 using System.Collections;
 using System.Runtime.InteropServices;
+using System.Threading;
 
 
 public class UseRenderingPlugin : MonoBehaviour
@@ -23,20 +24,32 @@ public class UseRenderingPlugin : MonoBehaviour
     private static void DebugWarnWrapper(string log) { Debug.LogWarning(log); }
     private static void DebugErrorWrapper(string log) { Debug.LogError(log); }
 
+    // The plugin queues its log messages (from any thread) and only calls the
+    // functions above from here, once per frame on the main thread.
+    [DllImport("RenderingPlugin")]
+    private static extern int FlushPluginLogs();
+
     // Native plugin rendering events are only called if a plugin is used
     // by some script. This means we have to DllImport at least
     // one function in some active script.
-    // For this example, we'll call into plugin's SetTimeFromUnity
-    // function and pass the current time so the plugin can animate.
+    // SetTimeFromUnity passes the current time so the plugin can animate;
+    // this example sends it with the rest of the frame in SubmitFrame
+    // instead (see PluginFrame below), which has the same effect.
 
     [DllImport ("RenderingPlugin")]
     private static extern void SetTimeFromUnity(float t);
 
 
     // We'll also pass native pointer to a texture in Unity.
-    // The plugin will fill texture data from native code.
+    // The plugin hands back a handle that later calls refer to it by.
+    [DllImport ("RenderingPlugin")]
+    private static extern int RegisterTextureFromUnity(System.IntPtr texture);
+
+
+    // Clears are queued per frame and all executed by the next plugin event.
+    // PluginFrame below sends all of a frame's clears in one call instead.
     [DllImport ("RenderingPlugin")]
-    private static extern void SetTextureFromUnity(System.IntPtr texture);
+    private static extern void QueueClearTexture(int texture, float r, float g, float b, float a);
 
 
     [DllImport("RenderingPlugin")]
@@ -46,6 +59,97 @@ public class UseRenderingPlugin : MonoBehaviour
     [DllImport("RenderingPlugin")]
     private static extern IntPtr GetRenderEventFunc();
 
+    // eventIDs of the render event; the values match PluginRenderEvent in
+    // RenderingPlugin.h. Frame does all of the others, in this order.
+    private const int kPluginEventFrame = 1;
+    private const int kPluginEventFillTexture = 2;
+    private const int kPluginEventUpload = 3;
+    private const int kPluginEventClear = 4;
+    private const int kPluginEventDraw = 5;
+    private const int kPluginEventFlushStats = 6;
+
+    // For CommandBuffer.IssuePluginEventAndData; the data is a RenderEventData.
+    [DllImport("RenderingPlugin")]
+    private static extern IntPtr GetRenderEventAndDataFunc();
+
+    // Parameters of one render event, passed with it instead of through
+    // SetTimeFromUnity / QueueClearTexture; the layout matches
+    // RenderEventData.h. The memory must stay valid until the render thread
+    // has run the event.
+    [StructLayout(LayoutKind.Sequential)]
+    public struct RenderEventData
+    {
+        public uint size;           // Marshal.SizeOf(typeof(RenderEventData))
+        public uint fields;         // kRenderEventData* bits
+        public float time;
+        public int texture;
+        [MarshalAs(UnmanagedType.ByValArray, SizeConst = 4)]
+        public float[] color;
+        public int rectCount;       // 0 clears the whole texture
+        public IntPtr rects;        // rectCount x, y, width, height ints
+    }
+
+    private const uint kRenderEventDataTime = 1;
+    private const uint kRenderEventDataClear = 2;
+
+
+    // Cumulative counters kept by the plugin; the layout matches PluginStats.h.
+    // The pointer stays valid while the plugin is loaded.
+    [StructLayout(LayoutKind.Sequential)]
+    public struct PluginStats
+    {
+        public uint magic;
+        public uint version;
+        public uint size;
+        public uint processId;
+        public ulong renderEvents;
+        public ulong clears;
+        public ulong uploadBytes;
+        public ulong draws;
+        public ulong stateCallsElided;
+        public ulong renderEventNs;
+        public ulong doRenderingNs;
+        public ulong fillTextureNs;
+        public ulong fillsOverlapped;
+    }
+
+    [DllImport("RenderingPlugin")]
+    private static extern IntPtr GetPluginStats();
+
+    public static PluginStats ReadPluginStats()
+    {
+        return (PluginStats)Marshal.PtrToStructure(GetPluginStats(), typeof(PluginStats));
+    }
+
+    // GPU time of the plugin's passes (D3D11 only), a few frames behind;
+    // the layout matches GpuTimings in GpuTimerRing.h.
+    [StructLayout(LayoutKind.Sequential)]
+    public struct GpuTimings
+    {
+        public ulong frame;
+        public uint passMask;
+        public uint framesBehind;
+        public float frameMs;
+        [MarshalAs(UnmanagedType.ByValArray, SizeConst = 4)]
+        public float[] passMs;      // upload, clear, instances, triangle
+    }
+
+    // Returns 0 while nothing has been timed yet.
+    [DllImport("RenderingPlugin")]
+    public static extern int GetGpuTimings(out GpuTimings timings);
+
+    // Writes the plugin's recent trace zones as Chrome trace JSON, for
+    // Perfetto or chrome://tracing. Returns the number of zones, -1 on failure.
+    [DllImport("RenderingPlugin")]
+    public static extern int WritePluginTrace([MarshalAs(UnmanagedType.LPStr)] string path);
+
+
+    private int textureHandle;
+
+    private PluginFrame pluginFrame;
+    private SharedCommandRing commandRing;
+    private IntPtr renderEventFunc;
+
 
     IEnumerator Start()
     {
@@ -70,23 +174,358 @@ public class UseRenderingPlugin : MonoBehaviour
         GetComponent<Renderer>().material.mainTexture = tex;
 
         // Pass texture pointer to the plugin
-        SetTextureFromUnity (tex.GetNativeTexturePtr());
+        textureHandle = RegisterTextureFromUnity (tex.GetNativeTexturePtr());
+    }
+
+    private void OnDestroy()
+    {
+        if (pluginFrame != null)
+            pluginFrame.Dispose();
+        pluginFrame = null;
     }
 
     private IEnumerator CallPluginAtEndOfFrames()
     {
+        // Everything below is set up once; the loop itself allocates nothing.
+        // The frame goes through the shared command ring when the plugin has
+        // one, otherwise through SubmitFrame.
+        commandRing = SharedCommandRing.Attach();
+        if (commandRing == null)
+            pluginFrame = new PluginFrame(16, 4, 256);
+        renderEventFunc = GetRenderEventFunc();
+        Color clearColor = new Color(1, 1, 0, 1);
+
         while (true) {
             // Wait until all frame rendering is done
             yield return new WaitForEndOfFrame();
 
-            // Set time for the plugin
-            SetTimeFromUnity (Time.timeSinceLevelLoad);
+            // This frame's time and clears: written straight into plugin
+            // memory, or handed over in one call
+            if (commandRing != null)
+            {
+                commandRing.WriteTime(Time.timeSinceLevelLoad);
+                commandRing.WriteClear(textureHandle, clearColor);
+            }
+            else
+            {
+                pluginFrame.AddClear(textureHandle, clearColor);
+                pluginFrame.Submit(Time.timeSinceLevelLoad);
+            }
+
+            // Issue a plugin event. The ID picks what the plugin does; a
+            // whole frame here. The pieces can also be issued separately
+            // (kPluginEventClear ... kPluginEventDraw) at the points in the
+            // frame they belong.
+            GL.IssuePluginEvent(renderEventFunc, kPluginEventFrame);
 
-            // Issue a plugin event with arbitrary integer identifier.
-            // The plugin can distinguish between different
-            // things it needs to do based on this ID.
-            // For our simple plugin, it does not matter which ID we pass here.
-            GL.IssuePluginEvent(GetRenderEventFunc(), 1);
+            // Forward whatever the plugin logged since last frame
+            FlushPluginLogs ();
         }
     }
 }
+
+
+// Collects one frame's parameters for the plugin and hands them over with a
+// single SubmitFrame call. The arrays are allocated and pinned once, so
+// adding to a frame and submitting it allocate nothing; the layouts match
+// FrameDesc.h, ClearCommands.h and InstanceBatch.h.
+public class PluginFrame : IDisposable
+{
+    public const int kShapeTriangle = 0;
+    public const int kShapeQuad = 1;
+
+    [StructLayout(LayoutKind.Sequential)]
+    public struct Clear
+    {
+        public int texture;
+        public float r, g, b, a;
+        public int x, y, width, height;     // width or height <= 0: whole texture
+    }
+
+    [StructLayout(LayoutKind.Sequential)]
+    public struct Draw
+    {
+        public int texture;
+        public int shape;
+        public int firstInstance;
+        public int instanceCount;
+    }
+
+    // clip = (m00 x + m01 y + tx, m10 x + m11 y + ty)
+    [StructLayout(LayoutKind.Sequential)]
+    public struct Instance
+    {
+        public float m00, m01, tx;
+        public float m10, m11, ty;
+        public float z;
+        public uint color;                  // RGBA8, red in the low byte
+    }
+
+    [StructLayout(LayoutKind.Sequential)]
+    private struct FrameDesc
+    {
+        public uint size;
+        public uint fields;
+        public float time;
+        public int clearCount;
+        public int drawCount;
+        public int instanceCount;
+        public IntPtr clears;
+        public IntPtr draws;
+        public IntPtr instances;
+    }
+
+    private const uint kFrameDescTime = 1;
+
+    // Returns the number of commands queued, -1 when the desc is rejected.
+    [DllImport("RenderingPlugin")]
+    private static extern int SubmitFrame(ref FrameDesc desc);
+
+    private readonly Clear[] clears;
+    private readonly Draw[] draws;
+    private readonly Instance[] instances;
+    private GCHandle clearsHandle, drawsHandle, instancesHandle;
+    private int clearCount, drawCount, instanceCount;
+
+    public PluginFrame(int maxClears, int maxDraws, int maxInstances)
+    {
+        clears = new Clear[Math.Max(maxClears, 1)];
+        draws = new Draw[Math.Max(maxDraws, 1)];
+        instances = new Instance[Math.Max(maxInstances, 1)];
+        clearsHandle = GCHandle.Alloc(clears, GCHandleType.Pinned);
+        drawsHandle = GCHandle.Alloc(draws, GCHandleType.Pinned);
+        instancesHandle = GCHandle.Alloc(instances, GCHandleType.Pinned);
+    }
+
+    public void Dispose()
+    {
+        if (clearsHandle.IsAllocated) clearsHandle.Free();
+        if (drawsHandle.IsAllocated) drawsHandle.Free();
+        if (instancesHandle.IsAllocated) instancesHandle.Free();
+    }
+
+    // False when the frame is full
+    public bool AddClear(int texture, Color color)
+    {
+        return AddClearRect(texture, color, 0, 0, 0, 0);
+    }
+
+    public bool AddClearRect(int texture, Color color, int x, int y, int width, int height)
+    {
+        if (clearCount == clears.Length)
+            return false;
+        Clear clear;
+        clear.texture = texture;
+        clear.r = color.r; clear.g = color.g; clear.b = color.b; clear.a = color.a;
+        clear.x = x; clear.y = y; clear.width = width; clear.height = height;
+        clears[clearCount++] = clear;
+        return true;
+    }
+
+    // Copies count instances; false when the frame has no room for them
+    public bool AddDraw(int texture, int shape, Instance[] source, int count)
+    {
+        if (drawCount == draws.Length || count > instances.Length - instanceCount)
+            return false;
+        Array.Copy(source, 0, instances, instanceCount, count);
+        Draw draw;
+        draw.texture = texture;
+        draw.shape = shape;
+        draw.firstInstance = instanceCount;
+        draw.instanceCount = count;
+        draws[drawCount++] = draw;
+        instanceCount += count;
+        return true;
+    }
+
+    // Sends the frame with its time and starts the next one.
+    public int Submit(float time)
+    {
+        FrameDesc desc;
+        desc.size = (uint)Marshal.SizeOf(typeof(FrameDesc));
+        desc.fields = kFrameDescTime;
+        desc.time = time;
+        desc.clearCount = clearCount;
+        desc.drawCount = drawCount;
+        desc.instanceCount = instanceCount;
+        desc.clears = clearsHandle.AddrOfPinnedObject();
+        desc.draws = drawsHandle.AddrOfPinnedObject();
+        desc.instances = instancesHandle.AddrOfPinnedObject();
+        int queued = SubmitFrame(ref desc);
+        clearCount = 0;
+        drawCount = 0;
+        instanceCount = 0;
+        return queued;
+    }
+}
+
+
+// Writes commands straight into the plugin's shared command ring
+// (SharedCommandRing.h), so queuing one costs no call into the plugin at
+// all; the next render event executes them in place. Any thread may write.
+// Unity 5.2 has no NativeArray: the ring is reached through the fixed,
+// 64-byte aligned address GetSharedCommandRing returns, which needs unsafe
+// code (smcs.rsp). The layouts below match SharedCommand and
+// SharedCommandRingHeader.
+public unsafe class SharedCommandRing
+{
+    private const uint kMagic = 0x474E5243;     // 'CRNG'
+    private const uint kVersion = 1;
+
+    private const uint kSetTime = 1;
+    private const uint kSetColor = 2;
+    private const uint kClear = 3;
+    private const uint kDrawInstance = 4;
+
+    [StructLayout(LayoutKind.Explicit, Size = 128)]
+    private struct Header
+    {
+        [FieldOffset(0)] public uint magic;
+        [FieldOffset(4)] public uint version;
+        [FieldOffset(8)] public uint commandSize;
+        [FieldOffset(12)] public uint capacity;
+        [FieldOffset(16)] public uint consumed;
+        [FieldOffset(64)] public int reserve;   // uint in the plugin; int for Interlocked
+    }
+
+    [StructLayout(LayoutKind.Explicit, Size = 64)]
+    private struct Command
+    {
+        [FieldOffset(0)] public uint sequence;  // position + 1 once published
+        [FieldOffset(4)] public uint type;
+        [FieldOffset(8)] public int texture;
+        [FieldOffset(12)] public int shape;
+        [FieldOffset(16)] public float time;
+        [FieldOffset(16)] public float r;
+        [FieldOffset(20)] public float g;
+        [FieldOffset(24)] public float b;
+        [FieldOffset(28)] public float a;
+        [FieldOffset(16)] public int x;
+        [FieldOffset(20)] public int y;
+        [FieldOffset(24)] public int width;
+        [FieldOffset(28)] public int height;
+        [FieldOffset(16)] public PluginFrame.Instance instance;
+    }
+
+    [DllImport("RenderingPlugin")]
+    private static extern IntPtr GetSharedCommandRing();
+
+    private readonly Header* header;
+    private readonly Command* commands;
+    private readonly uint mask;
+
+    private SharedCommandRing(Header* header)
+    {
+        this.header = header;
+        commands = (Command*)((byte*)header + sizeof(Header));
+        mask = header->capacity - 1;
+    }
+
+    // The plugin's ring, or null when it has none of this layout
+    public static SharedCommandRing Attach()
+    {
+        Header* header = (Header*)GetSharedCommandRing();
+        if (header == null || header->magic != kMagic || header->version != kVersion)
+            return null;
+        if (header->commandSize != sizeof(Command) || header->capacity < 2 || (header->capacity & (header->capacity - 1)) != 0)
+            return null;
+        return new SharedCommandRing(header);
+    }
+
+    // False for any of these when the ring is full; nothing is written then.
+    public bool WriteTime(float time)
+    {
+        uint first;
+        if (!TryReserve(1, out first))
+            return false;
+        Command* cmd = At(first);
+        cmd->type = kSetTime;
+        cmd->time = time;
+        Publish(first);
+        return true;
+    }
+
+    public bool WriteClear(int texture, Color color)
+    {
+        return WriteClearRect(texture, color, 0, 0, 0, 0);
+    }
+
+    // SetColor and Clear are reserved as one run, so no other writer's
+    // colour can land between them.
+    public bool WriteClearRect(int texture, Color color, int x, int y, int width, int height)
+    {
+        uint first;
+        if (!TryReserve(2, out first))
+            return false;
+        Command* set = At(first);
+        set->type = kSetColor;
+        set->r = color.r; set->g = color.g; set->b = color.b; set->a = color.a;
+        Command* clear = At(first + 1);
+        clear->type = kClear;
+        clear->texture = texture;
+        clear->x = x; clear->y = y; clear->width = width; clear->height = height;
+        Publish(first);
+        Publish(first + 1);
+        return true;
+    }
+
+    public bool WriteDraw(int texture, int shape, PluginFrame.Instance[] source, int count)
+    {
+        uint first;
+        if (count <= 0 || !TryReserve((uint)count, out first))
+            return false;
+        for (int i = 0; i < count; ++i)
+        {
+            Command* cmd = At(first + (uint)i);
+            cmd->type = kDrawInstance;
+            cmd->texture = texture;
+            cmd->shape = shape;
+            cmd->instance = source[i];
+            Publish(first + (uint)i);
+        }
+        return true;
+    }
+
+    private Command* At(uint position)
+    {
+        return commands + (position & mask);
+    }
+
+    // As SharedCommandRing::TryReserve: the run is free once its last slot
+    // has been freed for this lap, then the reserve index is advanced past it.
+    private bool TryReserve(uint count, out uint first)
+    {
+        first = 0;
+        if (count > mask + 1)
+            return false;
+        uint position = (uint)Thread.VolatileRead(ref header->reserve);
+        while (true)
+        {
+            uint last = position + count - 1;
+            uint sequence = At(last)->sequence;
+            Thread.MemoryBarrier();
+            int lap = (int)(sequence - last);
+            if (lap < 0)
+                return false;
+            if (lap == 0)
+            {
+                uint seen = (uint)Interlocked.CompareExchange(ref header->reserve, (int)(position + count), (int)position);
+                if (seen == position)
+                {
+                    first = position;
+                    return true;
+                }
+                position = seen;
+            }
+            else
+                position = (uint)Thread.VolatileRead(ref header->reserve);
+        }
+    }
+
+    // The command's fields are written before its sequence says so
+    private void Publish(uint position)
+    {
+        Thread.MemoryBarrier();
+        At(position)->sequence = position + 1;
+    }
+}